@@ -74,6 +74,19 @@ static void uninit(struct plplay *p)
         pl_cache_destroy(&p->cache);
     }
 
+    if (p->trace) {
+        FILE *file = fopen(p->args.trace_file, "wb");
+        if (file) {
+            int num = pl_trace_save_file(p->trace, file);
+            printf("Wrote %d spans to %s\n", num, p->args.trace_file);
+            fclose(file);
+        } else {
+            fprintf(stderr, "Failed opening '%s': %s\n", p->args.trace_file,
+                    strerror(errno));
+        }
+        pl_trace_destroy(&p->trace);
+    }
+
     // Free this before destroying the window to release associated GPU buffers
     avcodec_free_context(&p->codec);
     avformat_free_context(p->format);
@@ -688,6 +701,12 @@ int main(int argc, char *argv[])
     opts->params.info_callback = info_callback;
     opts->params.info_priv = &state;
 
+    if (state.args.trace_file) {
+        state.trace = pl_trace_create(state.log, NULL);
+        opts->params.span_callback = pl_trace_span_cb;
+        opts->params.span_priv = state.trace;
+    }
+
     struct plplay *p = &state;
     if (!open_file(p, state.args.filename))
         goto error;
@@ -3,6 +3,7 @@
 
 #include <libplacebo/options.h>
 #include <libplacebo/utils/frame_queue.h>
+#include <libplacebo/utils/trace.h>
 
 #include "common.h"
 #include "pl_thread.h"
@@ -29,6 +30,7 @@ struct plplay_args {
     const struct pl_render_params *preset;
     enum pl_log_level verbosity;
     const char *window_impl;
+    const char *trace_file;
     const char *filename;
     bool hwdec;
 };
@@ -47,6 +49,7 @@ struct plplay {
     pl_queue queue;
     pl_cache cache;
     uint64_t cache_sig;
+    pl_trace trace;
 
     // libav*
     AVFormatContext *format;
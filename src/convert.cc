@@ -68,14 +68,14 @@ struct has_std_from_chars_impl {
 template <typename T>
 constexpr bool has_std_from_chars = has_std_from_chars_impl<T>::value;
 
+// Returns a pointer past the end of the parsed value, or NULL on failure
 template <typename T, typename... Args>
-static inline bool from_chars(pl_str str, T &n, Args ...args)
+static inline const char *parse_chars(const char *begin, const char *end,
+                                      T &n, Args ...args)
 {
     if constexpr (has_std_from_chars<T>) {
-        auto [ptr, ec] = std::from_chars((const char *) str.buf,
-                                         (const char *) str.buf + str.len,
-                                         n, args...);
-        return ec == std::errc();
+        auto [ptr, ec] = std::from_chars(begin, end, n, args...);
+        return ec == std::errc() ? ptr : nullptr;
     } else {
         constexpr bool is_fp = std::is_same_v<float, T> || std::is_same_v<double, T>;
         static_assert(is_fp, "Not implemented!");
@@ -86,14 +86,20 @@ static inline bool from_chars(pl_str str, T &n, Args ...args)
 #else
         // FIXME: Fallback for libc++, as it does not implement floating-point
         // variant of std::from_chars. Remove this when appropriate.
-        auto [ptr, ec] = fast_float::from_chars((const char *) str.buf,
-                                                (const char *) str.buf + str.len,
-                                                n, args...);
-        return ec == std::errc();
+        auto [ptr, ec] = fast_float::from_chars(begin, end, n, args...);
+        return ec == std::errc() ? ptr : nullptr;
 #endif
     }
 }
 
+template <typename T, typename... Args>
+static inline bool from_chars(pl_str str, T &n, Args ...args)
+{
+    return parse_chars((const char *) str.buf,
+                       (const char *) str.buf + str.len,
+                       n, args...);
+}
+
 }
 
 #define CHAR_CONVERT(name, type, ...)                           \
@@ -114,6 +120,35 @@ CHAR_CONVERT(uint64, uint64_t)
 CHAR_CONVERT(float, float)
 CHAR_CONVERT(double, double)
 
+size_t pl_str_parse_floats(pl_str *str, float *out, size_t num)
+{
+    const char *pos = (const char *) str->buf;
+    const char * const end = pos + str->len;
+    size_t count = 0;
+
+    while (count < num) {
+        const char *start = pos;
+        while (start < end && pl_isspace(*start))
+            start++;
+        if (start == end)
+            break;
+        // Tolerate a leading '+', which std::from_chars rejects
+        if (*start == '+' && start + 1 < end && *(start + 1) != '-')
+            start++;
+
+        const char *next = parse_chars(start, end, out[count]);
+        if (!next || (next < end && !pl_isspace(*next)))
+            break;
+
+        pos = next;
+        count++;
+    }
+
+    str->len -= pos - (const char *) str->buf;
+    str->buf = (uint8_t *) pos;
+    return count;
+}
+
 /* *****************************************************************************
  *
  * Copyright (c) 2007-2016 Alexis Naveros.
@@ -26,6 +26,7 @@
 // MIN_AGE are evicted to make room. (Failing that, the passes array doubles)
 #define MAX_PASSES 100
 #define MIN_AGE 10
+#define UBO_RING_SIZE 4
 
 enum {
     TMP_PRELUDE,   // GLSL version, global definitions, etc.
@@ -42,7 +43,9 @@ struct pl_dispatch_t {
     uint8_t current_ident;
     uint8_t current_index;
     bool dynamic_constants;
+    bool batch_uniforms;
     int max_passes;
+    struct pl_dispatch_stats stats;
 
     void (*info_callback)(void *, const struct pl_dispatch_info *);
     void *info_priv;
@@ -85,6 +88,14 @@ struct pass {
     int ubo_index;
     pl_buf ubo;
 
+    // for batched uniform updates, the UBO is assembled in host memory and
+    // written out as a whole to the next buffer in the ring
+    pl_buf ubo_ring[UBO_RING_SIZE];
+    uint8_t *ubo_data;
+    size_t ubo_size;
+    int ubo_idx;
+    bool ubo_dirty;
+
     // Cached pl_pass_run_params. This will also contain mutable allocations
     // for the push constants, descriptor bindings (including the binding for
     // the UBO pre-filled), vertex array and variable updates
@@ -97,6 +108,7 @@ struct pass {
     uint64_t ts_sum;
     uint64_t samples[PL_ARRAY_SIZE(((struct pl_dispatch_info *) NULL)->samples)];
     int ts_idx;
+    uint64_t compile_time; // not yet reported
 };
 
 static void pass_destroy(pl_dispatch dp, struct pass *pass)
@@ -104,7 +116,12 @@ static void pass_destroy(pl_dispatch dp, struct pass *pass)
     if (!pass)
         return;
 
-    pl_buf_destroy(dp->gpu, &pass->ubo);
+    if (pass->ubo_data) {
+        for (int i = 0; i < UBO_RING_SIZE; i++)
+            pl_buf_destroy(dp->gpu, &pass->ubo_ring[i]);
+    } else {
+        pl_buf_destroy(dp->gpu, &pass->ubo);
+    }
     pl_pass_destroy(dp->gpu, &pass->pass);
     pl_timer_destroy(dp->gpu, &pass->timer);
     pl_free(pass);
@@ -167,6 +184,21 @@ void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic)
     dp->dynamic_constants = dynamic;
 }
 
+void pl_dispatch_batch_uniforms(pl_dispatch dp, bool enable)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->batch_uniforms = enable;
+    pl_mutex_unlock(&dp->lock);
+}
+
+struct pl_dispatch_stats pl_dispatch_get_stats(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    struct pl_dispatch_stats stats = dp->stats;
+    pl_mutex_unlock(&dp->lock);
+    return stats;
+}
+
 void pl_dispatch_callback(pl_dispatch dp, void *priv,
                           void (*cb)(void *priv, const struct pl_dispatch_info *))
 {
@@ -214,8 +246,8 @@ static bool add_pass_var(pl_dispatch dp, void *tmp, struct pass *pass,
     // the offsets and support UBOs for older GL as well, but this is a nice
     // safety net for driver bugs (and also rules out potentially buggy drivers)
     // Also avoid UBOs for highly dynamic stuff since that requires synchronizing
-    // the UBO writes every frame
-    bool try_ubo = !can_var || !sv->dynamic;
+    // the UBO writes every frame, unless those writes are batched anyway
+    bool try_ubo = !can_var || !sv->dynamic || dp->batch_uniforms;
     if (try_ubo && gpu->glsl.version >= 440 && gpu->limits.max_ubo_size) {
         if (sh_buf_desc_append(tmp, gpu, &pass->ubo_desc, &pv->layout, sv->var)) {
             pv->type = PASS_VAR_UBO;
@@ -904,6 +936,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     }
 
     // Need to compile new shader, execute templates now
+    pl_clock_t compile_start = pl_clock_now();
     if (vert_builder) {
         pl_str vert = pl_str_builder_exec(vert_builder);
         params.vertex_shader = (char *) vert.buf;
@@ -928,6 +961,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
         PL_ERR(dp, "Failed creating render pass for dispatch");
         // Add it anyway
     }
+    pass->compile_time = pl_clock_diff(pl_clock_now(), compile_start) * 1e9;
 
     struct pl_pass_run_params *rparams = &pass->run_params;
     rparams->pass = pass->pass;
@@ -936,7 +970,12 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     rparams->desc_bindings = pl_calloc_ptr(pass, params.num_descriptors,
                                            rparams->desc_bindings);
 
-    if (ubo_size && pass->pass) {
+    if (ubo_size && pass->pass && dp->batch_uniforms) {
+        // Defer creating the UBOs until the first update
+        pass->ubo_data = pl_zalloc(pass, ubo_size);
+        pass->ubo_size = ubo_size;
+        pass->ubo_idx = -1;
+    } else if (ubo_size && pass->pass) {
         // Create the UBO
         pass->ubo = pl_buf_create(dp->gpu, pl_buf_params(
             .size = ubo_size,
@@ -995,11 +1034,18 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
         break;
     }
     case PASS_VAR_UBO: {
+        if (pass->ubo_data) {
+            memcpy_layout(pass->ubo_data, pv->layout, sv->data, host_layout);
+            pass->ubo_dirty = true;
+            break;
+        }
+
         pl_assert(pass->ubo);
         const size_t offset = pv->layout.offset;
         if (host_layout.stride == pv->layout.stride) {
             pl_assert(host_layout.size == pv->layout.size);
             pl_buf_write(dp->gpu, pass->ubo, offset, sv->data, host_layout.size);
+            dp->stats.ubo_writes++;
         } else {
             // Coalesce strided UBO write into a single pl_buf_write to avoid
             // unnecessary synchronization overhead by assembling the correctly
@@ -1015,6 +1061,7 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
                 dst += pv->layout.stride;
             }
             pl_buf_write(dp->gpu, pass->ubo, offset, tmp, pv->layout.size);
+            dp->stats.ubo_writes++;
         }
         break;
     }
@@ -1025,6 +1072,42 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
     };
 }
 
+static bool update_pass_vars(pl_dispatch dp, struct pass *pass, pl_shader sh)
+{
+    struct pl_pass_run_params *rparams = &pass->run_params;
+    rparams->num_var_updates = 0;
+    for (int i = 0; i < sh->vars.num; i++)
+        update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    dp->stats.var_updates += rparams->num_var_updates;
+
+    if (!pass->ubo_dirty)
+        return true;
+
+    // Write the whole UBO at once, to the next buffer in the ring. This
+    // avoids stalling on buffers still in use by previous dispatches
+    pass->ubo_idx = (pass->ubo_idx + 1) % UBO_RING_SIZE;
+    pl_buf *ubo = &pass->ubo_ring[pass->ubo_idx];
+    if (!*ubo) {
+        *ubo = pl_buf_create(dp->gpu, pl_buf_params(
+            .size = pass->ubo_size,
+            .uniform = true,
+            .host_writable = true,
+        ));
+
+        if (!*ubo) {
+            PL_ERR(dp, "Failed creating uniform buffer for dispatch");
+            return false;
+        }
+    }
+
+    pl_buf_write(dp->gpu, *ubo, 0, pass->ubo_data, pass->ubo_size);
+    pass->ubo = *ubo;
+    pass->ubo_dirty = false;
+    rparams->desc_bindings[pass->ubo_index].object = *ubo;
+    dp->stats.ubo_writes++;
+    return true;
+}
+
 static void compute_vertex_attribs(pl_dispatch dp, pl_shader sh,
                                    int width, int height, ident_t *out_scale)
 {
@@ -1157,12 +1240,16 @@ static void run_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
         }
     }
 
+    const uint64_t compile_time = pass->compile_time;
+    pass->compile_time = 0;
     if (!dp->info_callback)
         return;
 
     struct pl_dispatch_info info;
     info.signature = pass->signature;
     info.shader = shader;
+    info.compile_time = compile_time;
+    info.lut_time = sh->info->lut_time;
 
     // Test to see if the ring buffer already wrapped around once
     if (pass->samples[pass->ts_idx]) {
@@ -1298,9 +1385,8 @@ bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
         rparams->desc_bindings[i] = sh->descs.elem[i].binding;
 
     // Update all of the variables (if needed)
-    rparams->num_var_updates = 0;
-    for (int i = 0; i < sh->vars.num; i++)
-        update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    if (!update_pass_vars(dp, pass, sh))
+        goto error;
 
     // Update the vertex data
     if (rparams->vertex_data) {
@@ -1407,9 +1493,8 @@ bool pl_dispatch_compute(pl_dispatch dp, const struct pl_dispatch_compute_params
         rparams->desc_bindings[i] = sh->descs.elem[i].binding;
 
     // Update all of the variables (if needed)
-    rparams->num_var_updates = 0;
-    for (int i = 0; i < sh->vars.num; i++)
-        update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    if (!update_pass_vars(dp, pass, sh))
+        goto error;
 
     // Update the dispatch size
     int groups = 1;
@@ -1544,9 +1629,8 @@ bool pl_dispatch_vertex(pl_dispatch dp, const struct pl_dispatch_vertex_params *
         rparams->desc_bindings[i] = sh->descs.elem[i].binding;
 
     // Update all of the variables (if needed)
-    rparams->num_var_updates = 0;
-    for (int i = 0; i < sh->vars.num; i++)
-        update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    if (!update_pass_vars(dp, pass, sh))
+        goto error;
 
     // Update the scissors
     rparams->scissors = params->scissors;
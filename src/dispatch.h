@@ -29,3 +29,18 @@ pl_shader pl_dispatch_begin_ex(pl_dispatch dp, bool unique);
 //
 // This is a private API because it's sort of clunky/stateful.
 void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic);
+
+// Pack all variables that don't fit into push constants into each pass's
+// uniform buffer, including dynamic ones, and write out the whole buffer at
+// once (rotating through a small ring of buffers) whenever any of them
+// changes. This replaces one `pl_var_update` per changed variable by a single
+// buffer write and bind per pass, which helps on APIs without push constants
+// (i.e. OpenGL). Only affects passes created afterwards.
+void pl_dispatch_batch_uniforms(pl_dispatch dp, bool enable);
+
+struct pl_dispatch_stats {
+    uint64_t var_updates;   // number of `pl_var_update`s issued
+    uint64_t ubo_writes;    // number of uniform buffer writes
+};
+
+struct pl_dispatch_stats pl_dispatch_get_stats(pl_dispatch dp);
@@ -39,6 +39,7 @@
 #include "common.h"
 #include "filters.h"
 #include "log.h"
+#include "pl_thread.h"
 
 #ifdef PL_HAVE_WIN32
 #define j1 _j1
@@ -75,6 +76,39 @@ bool pl_filter_config_eq(const struct pl_filter_config *a,
     return eq;
 }
 
+static inline struct pl_filter_ctx kernel_ctx(const struct pl_filter_config *c)
+{
+    return (struct pl_filter_ctx) {
+        .radius = pl_filter_radius_bound(c),
+        .params = {
+            c->kernel->tunable[0] ? c->params[0] : c->kernel->params[0],
+            c->kernel->tunable[1] ? c->params[1] : c->kernel->params[1],
+        },
+    };
+}
+
+static inline struct pl_filter_ctx window_ctx(const struct pl_filter_config *c)
+{
+    return (struct pl_filter_ctx) {
+        .radius = c->window->radius,
+        .params = {
+            c->window->tunable[0] ? c->wparams[0] : c->window->params[0],
+            c->window->tunable[1] ? c->wparams[1] : c->window->params[1],
+        },
+    };
+}
+
+// Maps an absolute offset inside [0, radius] to the kernel's coordinate
+// system, applying the blur and taper coefficients as needed
+static inline double kernel_x(const struct pl_filter_config *c, float radius,
+                              double x)
+{
+    double kx = x <= c->taper ? 0.0 : (x - c->taper) / (1.0 - c->taper / radius);
+    if (c->blur > 0.0)
+        kx /= c->blur;
+    return kx;
+}
+
 double pl_filter_sample(const struct pl_filter_config *c, double x)
 {
     const float radius = pl_filter_radius_bound(c);
@@ -89,46 +123,102 @@ double pl_filter_sample(const struct pl_filter_config *c, double x)
     if (x > radius)
         return 0.0;
 
-    // Apply the blur and taper coefficients as needed
-    double kx = x <= c->taper ? 0.0 : (x - c->taper) / (1.0 - c->taper / radius);
-    if (c->blur > 0.0)
-        kx /= c->blur;
-
     pl_assert(!c->kernel->opaque);
-    double k = c->kernel->weight(&(const struct pl_filter_ctx) {
-        .radius = radius,
-        .params = {
-            c->kernel->tunable[0] ? c->params[0] : c->kernel->params[0],
-            c->kernel->tunable[1] ? c->params[1] : c->kernel->params[1],
-        },
-    }, kx);
+    const struct pl_filter_ctx kctx = kernel_ctx(c);
+    double k = c->kernel->weight(&kctx, kernel_x(c, radius, x));
 
     // Apply the optional windowing function
     if (c->window) {
         pl_assert(!c->window->opaque);
+        const struct pl_filter_ctx wctx = window_ctx(c);
         double wx = x / radius * c->window->radius;
-        k *= c->window->weight(&(struct pl_filter_ctx) {
-            .radius = c->window->radius,
-            .params = {
-                c->window->tunable[0] ? c->wparams[0] : c->window->params[0],
-                c->window->tunable[1] ? c->wparams[1] : c->window->params[1],
-            },
-        }, wx);
+        k *= c->window->weight(&wctx, wx);
     }
 
     return k < 0 ? (1 - c->clamp) * k : k;
 }
 
+static inline void filter_weights(const struct pl_filter_function *fun,
+                                  const struct pl_filter_ctx *ctx,
+                                  const double *x, double *out, int n)
+{
+    if (fun->weight_n) {
+        fun->weight_n(ctx, x, out, n);
+    } else {
+        for (int i = 0; i < n; i++)
+            out[i] = fun->weight(ctx, x[i]);
+    }
+}
+
+void pl_filter_sample_n(const struct pl_filter_config *c, const double *x,
+                        double *out, int n)
+{
+    pl_assert(!c->kernel->opaque);
+    pl_assert(!c->window || !c->window->opaque);
+    const float radius = pl_filter_radius_bound(c);
+    const struct pl_filter_ctx kctx = kernel_ctx(c);
+    const struct pl_filter_ctx wctx = c->window ? window_ctx(c) : kctx;
+
+    enum { BATCH = 64 };
+    double kx[BATCH], kw[BATCH], wx[BATCH], ww[BATCH];
+    int idx[BATCH];
+
+    for (int base = 0; base < n; base += BATCH) {
+        const int num = PL_MIN(n - base, BATCH);
+
+        // Gather all values inside the kernel radius (see pl_filter_sample)
+        int valid = 0;
+        for (int i = 0; i < num; i++) {
+            const double ax = fabs(x[base + i]);
+            if (ax > radius) {
+                out[base + i] = 0.0;
+                continue;
+            }
+
+            kx[valid] = kernel_x(c, radius, ax);
+            if (c->window)
+                wx[valid] = ax / radius * c->window->radius;
+            idx[valid++] = base + i;
+        }
+
+        filter_weights(c->kernel, &kctx, kx, kw, valid);
+        if (c->window) {
+            filter_weights(c->window, &wctx, wx, ww, valid);
+            for (int i = 0; i < valid; i++)
+                kw[i] *= ww[i];
+        }
+
+        for (int i = 0; i < valid; i++) {
+            const double k = kw[i];
+            out[idx[i]] = k < 0 ? (1 - c->clamp) * k : k;
+        }
+    }
+}
+
 static void filter_cutoffs(const struct pl_filter_config *c, float cutoff,
                            float *out_radius, float *out_radius_zero)
 {
     const float bound = pl_filter_radius_bound(c);
-    float prev = 0.0, fprev = pl_filter_sample(c, prev);
-    bool found_root = false;
-
     const float step = 1e-2f;
-    for (float x = 0.0; x < bound + step; x += step) {
-        float fx = pl_filter_sample(c, x);
+
+    // Sample the entire filter in one batch. Note that the sample positions
+    // are deliberately accumulated in single precision.
+    int num = 0;
+    for (float x = 0.0; x < bound + step; x += step)
+        num++;
+
+    double *xs = pl_alloc(NULL, 2 * (num + 1) * sizeof(double));
+    double *fxs = xs + num + 1;
+    xs[0] = 0.0; // prev
+    num = 0;
+    for (float x = 0.0; x < bound + step; x += step)
+        xs[++num] = x;
+    pl_filter_sample_n(c, xs, fxs, num + 1);
+
+    float prev = 0.0, fprev = fxs[0];
+    bool found_root = false;
+    for (int i = 1; i <= num; i++) {
+        float x = xs[i], fx = fxs[i];
         if ((fprev > cutoff && fx <= cutoff) || (fprev < -cutoff && fx >= -cutoff)) {
             // Found zero crossing
             float root = x - fx * (x - prev) / (fx - fprev); // secant method
@@ -142,34 +232,117 @@ static void filter_cutoffs(const struct pl_filter_config *c, float cutoff,
         fprev = fx;
     }
 
+    pl_free(xs);
     if (!found_root)
         *out_radius_zero = *out_radius = bound;
 }
 
 // Compute a single row of weights for a given filter in one dimension, indexed
 // by the indicated subpixel offset. Writes `f->row_size` values to `out`.
-static void compute_row(struct pl_filter_t *f, double offset, float *out)
+// `tmp` must have room for `2 * f->row_size` values.
+static void compute_row(const struct pl_filter_t *f, double offset, float *out,
+                        double *tmp)
 {
+    // For the example of a filter with row size 4 and offset 0.3, we have:
+    //
+    // 0    1 *  2    3
+    //
+    // * indicates the sampled position. What we want to compute is the
+    // distance from each index to that sampled position.
+    pl_assert(f->row_size % 2 == 0);
+    const int base = f->row_size / 2 - 1; // index to the left of the center
+    const double center = base + offset; // offset of center relative to idx 0
+    double *xs = tmp, *ws = tmp + f->row_size;
+    for (int i = 0; i < f->row_size; i++)
+        xs[i] = i - center;
+    pl_filter_sample_n(&f->params.config, xs, ws, f->row_size);
+
     double wsum = 0.0;
-    for (int i = 0; i < f->row_size; i++) {
-        // For the example of a filter with row size 4 and offset 0.3, we have:
-        //
-        // 0    1 *  2    3
-        //
-        // * indicates the sampled position. What we want to compute is the
-        // distance from each index to that sampled position.
-        pl_assert(f->row_size % 2 == 0);
-        const int base = f->row_size / 2 - 1; // index to the left of the center
-        const double center = base + offset; // offset of center relative to idx 0
-        double w = pl_filter_sample(&f->params.config, i - center);
-        out[i] = w;
-        wsum += w;
-    }
+    for (int i = 0; i < f->row_size; i++)
+        wsum += ws[i];
 
     // Readjust weights to preserve energy
     pl_assert(wsum > 0);
     for (int i = 0; i < f->row_size; i++)
-        out[i] /= wsum;
+        out[i] = ws[i] / wsum;
+}
+
+struct generate_args {
+    const struct pl_filter_t *f;
+    float *weights;
+    int start;
+    int count;
+};
+
+static PL_THREAD_VOID generate_rows(void *priv)
+{
+    const struct generate_args *args = priv;
+    const struct pl_filter_t *f = args->f;
+    const int lut_entries = f->params.lut_entries;
+    const int end = args->start + args->count;
+
+    if (f->params.config.polar) {
+        // Compute a 1D array indexed by radius
+        double *tmp = pl_alloc(NULL, 2 * args->count * sizeof(double));
+        double *xs = tmp, *ws = tmp + args->count;
+        for (int i = args->start; i < end; i++)
+            xs[i - args->start] = f->radius * i / (lut_entries - 1);
+        pl_filter_sample_n(&f->params.config, xs, ws, args->count);
+        for (int i = 0; i < args->count; i++)
+            args->weights[args->start + i] = ws[i];
+        pl_free(tmp);
+    } else {
+        // Compute a 2D array indexed by the subpixel position
+        double *tmp = pl_alloc(NULL, 2 * f->row_size * sizeof(double));
+        for (int i = args->start; i < end; i++) {
+            compute_row(f, i / (double) (lut_entries - 1),
+                        args->weights + f->row_stride * i, tmp);
+        }
+        pl_free(tmp);
+    }
+
+    PL_THREAD_RETURN();
+}
+
+static void generate_weights(const struct pl_filter_t *f, float *weights)
+{
+    // Spawning threads is only worth it for sufficiently large LUTs
+    enum { MAX_WORKERS = 16, MIN_SAMPLES_PER_WORKER = 4096 };
+    struct generate_args args[MAX_WORKERS];
+
+    const int lut_entries = f->params.lut_entries;
+    const int row_samples = f->params.config.polar ? 1 : f->row_size;
+    const int max_workers = PL_CLAMP(lut_entries * row_samples / MIN_SAMPLES_PER_WORKER,
+                                     1, MAX_WORKERS);
+    const int num_per_worker = PL_DIV_UP(lut_entries, max_workers);
+    const int num_workers = PL_DIV_UP(lut_entries, num_per_worker);
+    for (int i = 0; i < num_workers; i++) {
+        const int start = i * num_per_worker;
+        args[i] = (struct generate_args) {
+            .f       = f,
+            .weights = weights,
+            .start   = start,
+            .count   = PL_MIN(num_per_worker, lut_entries - start),
+        };
+    }
+
+    if (num_workers == 1) {
+        generate_rows(&args[0]);
+        return;
+    }
+
+    pl_thread workers[MAX_WORKERS] = {0};
+    for (int i = 0; i < num_workers; i++) {
+        if (pl_thread_create(&workers[i], generate_rows, &args[i]) != 0)
+            generate_rows(&args[i]); // fallback
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        if (!workers[i])
+            continue;
+        if (pl_thread_join(workers[i]) != 0)
+            generate_rows(&args[i]); // fallback
+    }
 }
 
 // Needed for backwards compatibility with v1 configuration API
@@ -210,12 +383,7 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
 
     float *weights;
     if (params->config.polar) {
-        // Compute a 1D array indexed by radius
         weights = pl_alloc(f, params->lut_entries * sizeof(float));
-        for (int i = 0; i < params->lut_entries; i++) {
-            double x = f->radius * i / (params->lut_entries - 1);
-            weights[i] = pl_filter_sample(&params->config, x);
-        }
     } else {
         // Pick the most appropriate row size
         f->row_size = ceilf(f->radius) * 2;
@@ -227,15 +395,10 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
             f->insufficient = true;
         }
         f->row_stride = PL_ALIGN(f->row_size, params->row_stride_align);
-
-        // Compute a 2D array indexed by the subpixel position
         weights = pl_calloc(f, params->lut_entries * f->row_stride, sizeof(float));
-        for (int i = 0; i < params->lut_entries; i++) {
-            compute_row(f, i / (double)(params->lut_entries - 1),
-                        weights + f->row_stride * i);
-        }
     }
 
+    generate_weights(f, weights);
     f->weights = weights;
     return f;
 }
@@ -284,9 +447,9 @@ static double cosine(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_cosine = {
-    .name   = "cosine",
-    .weight = cosine,
-    .radius = M_PI / 2.0,
+    .name     = "cosine",
+    .weight   = cosine,
+    .radius   = M_PI / 2.0,
 };
 
 static double hann(const struct pl_filter_ctx *f, double x)
@@ -295,15 +458,15 @@ static double hann(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_hann = {
-    .name   = "hann",
-    .weight = hann,
-    .radius = 1.0,
+    .name     = "hann",
+    .weight   = hann,
+    .radius   = 1.0,
 };
 
 static const struct pl_filter_function filter_function_hanning = {
-    .name   = "hanning", // alias
-    .weight = hann,
-    .radius = 1.0,
+    .name     = "hanning", // alias
+    .weight   = hann,
+    .radius   = 1.0,
 };
 
 static double hamming(const struct pl_filter_ctx *f, double x)
@@ -312,9 +475,9 @@ static double hamming(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_hamming = {
-    .name   = "hamming",
-    .weight = hamming,
-    .radius = 1.0,
+    .name     = "hamming",
+    .weight   = hamming,
+    .radius   = 1.0,
 };
 
 static double welch(const struct pl_filter_ctx *f, double x)
@@ -323,9 +486,9 @@ static double welch(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_welch = {
-    .name   = "welch",
-    .weight = welch,
-    .radius = 1.0,
+    .name     = "welch",
+    .weight   = welch,
+    .radius   = 1.0,
 };
 
 static double bessel_i0(double x)
@@ -349,12 +512,23 @@ static double kaiser(const struct pl_filter_ctx *f, double x)
     return bessel_i0(alpha * sqrt(1.0 - x * x)) / scale;
 }
 
+static void kaiser_n(const struct pl_filter_ctx *f, const double *x,
+                     double *out, int n)
+{
+    // Hoist the (expensive) normalization out of the loop
+    double alpha = fmax(f->params[0], 0.0);
+    double scale = bessel_i0(alpha);
+    for (int i = 0; i < n; i++)
+        out[i] = bessel_i0(alpha * sqrt(1.0 - x[i] * x[i])) / scale;
+}
+
 const struct pl_filter_function pl_filter_function_kaiser = {
-    .name    = "kaiser",
-    .weight  = kaiser,
-    .radius  = 1.0,
-    .params  = {2.0},
-    .tunable = {true},
+    .name     = "kaiser",
+    .weight   = kaiser,
+    .weight_n = kaiser_n,
+    .radius   = 1.0,
+    .params   = {2.0},
+    .tunable  = {true},
 };
 
 static double blackman(const struct pl_filter_ctx *f, double x)
@@ -366,11 +540,11 @@ static double blackman(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_blackman = {
-    .name    = "blackman",
-    .weight  = blackman,
-    .radius  = 1.0,
-    .params  = {0.16},
-    .tunable = {true},
+    .name     = "blackman",
+    .weight   = blackman,
+    .radius   = 1.0,
+    .params   = {0.16},
+    .tunable  = {true},
 };
 
 static double bohman(const struct pl_filter_ctx *f, double x)
@@ -380,9 +554,9 @@ static double bohman(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_bohman = {
-    .name   = "bohman",
-    .weight = bohman,
-    .radius = 1.0,
+    .name     = "bohman",
+    .weight   = bohman,
+    .radius   = 1.0,
 };
 
 static double gaussian(const struct pl_filter_ctx *f, double x)
@@ -409,15 +583,15 @@ static double quadratic(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_quadratic = {
-    .name   = "quadratic",
-    .weight = quadratic,
-    .radius = 1.5,
+    .name     = "quadratic",
+    .weight   = quadratic,
+    .radius   = 1.5,
 };
 
 static const struct pl_filter_function filter_function_quadric = {
-    .name   = "quadric", // alias
-    .weight = quadratic,
-    .radius = 1.5,
+    .name     = "quadric", // alias
+    .weight   = quadratic,
+    .radius   = 1.5,
 };
 
 static double sinc(const struct pl_filter_ctx *f, double x)
@@ -465,85 +639,117 @@ const struct pl_filter_function pl_filter_function_sphinx = {
     .resizable = true,
 };
 
-static double cubic(const struct pl_filter_ctx *f, double x)
+struct cubic_coeffs {
+    double p0, p2, p3, q0, q1, q2, q3;
+};
+
+static inline struct cubic_coeffs cubic_coeffs(const struct pl_filter_ctx *f)
 {
     const double b = f->params[0], c = f->params[1];
-    double p0 = 6.0 - 2.0 * b,
-           p2 = -18.0 + 12.0 * b + 6.0 * c,
-           p3 = 12.0 - 9.0 * b - 6.0 * c,
-           q0 = 8.0 * b + 24.0 * c,
-           q1 = -12.0 * b - 48.0 * c,
-           q2 = 6.0 * b + 30.0 * c,
-           q3 = -b - 6.0 * c;
+    return (struct cubic_coeffs) {
+        .p0 = 6.0 - 2.0 * b,
+        .p2 = -18.0 + 12.0 * b + 6.0 * c,
+        .p3 = 12.0 - 9.0 * b - 6.0 * c,
+        .q0 = 8.0 * b + 24.0 * c,
+        .q1 = -12.0 * b - 48.0 * c,
+        .q2 = 6.0 * b + 30.0 * c,
+        .q3 = -b - 6.0 * c,
+    };
+}
 
+static inline double cubic_eval(const struct cubic_coeffs *k, double x)
+{
     if (x < 1.0) {
-        return (p0 + x * x * (p2 + x * p3)) / p0;
+        return (k->p0 + x * x * (k->p2 + x * k->p3)) / k->p0;
     } else {
-        return (q0 + x * (q1 + x * (q2 + x * q3))) / p0;
+        return (k->q0 + x * (k->q1 + x * (k->q2 + x * k->q3))) / k->p0;
     }
 }
 
+static double cubic(const struct pl_filter_ctx *f, double x)
+{
+    const struct cubic_coeffs k = cubic_coeffs(f);
+    return cubic_eval(&k, x);
+}
+
+static void cubic_n(const struct pl_filter_ctx *f, const double *x,
+                    double *out, int n)
+{
+    // Hoist the coefficient setup out of the loop
+    const struct cubic_coeffs k = cubic_coeffs(f);
+    for (int i = 0; i < n; i++)
+        out[i] = cubic_eval(&k, x[i]);
+}
+
 const struct pl_filter_function pl_filter_function_cubic = {
-    .name    = "cubic",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {1.0, 0.0},
-    .tunable = {true, true},
+    .name     = "cubic",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {1.0, 0.0},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_hermite = {
-    .name    = "hermite",
-    .weight  = cubic,
-    .radius  = 1.0,
-    .params  = {0.0, 0.0},
+    .name     = "hermite",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 1.0,
+    .params   = {0.0, 0.0},
 };
 
 const struct pl_filter_function pl_filter_function_bicubic = {
-    .name    = "bicubic",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {1.0, 0.0},
-    .tunable = {true, true},
+    .name     = "bicubic",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {1.0, 0.0},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_bcspline = {
-    .name    = "bcspline",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {1.0, 0.0},
-    .tunable = {true, true},
+    .name     = "bcspline",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {1.0, 0.0},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_catmull_rom = {
-    .name    = "catmull_rom",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {0.0, 0.5},
-    .tunable = {true, true},
+    .name     = "catmull_rom",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {0.0, 0.5},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_mitchell = {
-    .name    = "mitchell",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {1/3.0, 1/3.0},
-    .tunable = {true, true},
+    .name     = "mitchell",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {1/3.0, 1/3.0},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_robidoux = {
-    .name    = "robidoux",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {12 / (19 + 9 * M_SQRT2), 113 / (58 + 216 * M_SQRT2)},
-    .tunable = {true, true},
+    .name     = "robidoux",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {12 / (19 + 9 * M_SQRT2), 113 / (58 + 216 * M_SQRT2)},
+    .tunable  = {true, true},
 };
 
 const struct pl_filter_function pl_filter_function_robidouxsharp = {
-    .name    = "robidouxsharp",
-    .weight  = cubic,
-    .radius  = 2.0,
-    .params  = {6 / (13 + 7 * M_SQRT2), 7 / (2 + 12 * M_SQRT2)},
-    .tunable = {true, true},
+    .name     = "robidouxsharp",
+    .weight   = cubic,
+    .weight_n = cubic_n,
+    .radius   = 2.0,
+    .params   = {6 / (13 + 7 * M_SQRT2), 7 / (2 + 12 * M_SQRT2)},
+    .tunable  = {true, true},
 };
 
 static double spline16(const struct pl_filter_ctx *f, double x)
@@ -556,9 +762,9 @@ static double spline16(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_spline16 = {
-    .name   = "spline16",
-    .weight = spline16,
-    .radius = 2.0,
+    .name     = "spline16",
+    .weight   = spline16,
+    .radius   = 2.0,
 };
 
 static double spline36(const struct pl_filter_ctx *f, double x)
@@ -573,9 +779,9 @@ static double spline36(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_spline36 = {
-    .name   = "spline36",
-    .weight = spline36,
-    .radius = 3.0,
+    .name     = "spline36",
+    .weight   = spline36,
+    .radius   = 3.0,
 };
 
 static double spline64(const struct pl_filter_ctx *f, double x)
@@ -592,9 +798,9 @@ static double spline64(const struct pl_filter_ctx *f, double x)
 }
 
 const struct pl_filter_function pl_filter_function_spline64 = {
-    .name   = "spline64",
-    .weight = spline64,
-    .radius = 4.0,
+    .name     = "spline64",
+    .weight   = spline64,
+    .radius   = 4.0,
 };
 
 static double oversample(const struct pl_filter_ctx *f, double x)
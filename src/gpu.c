@@ -26,6 +26,13 @@ void pl_gpu_destroy(pl_gpu gpu)
         return;
 
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    if (impl->host_mem.num) {
+        PL_WARN(gpu, "%d host memory range(s) still registered on pl_gpu "
+                "destruction!", impl->host_mem.num);
+    }
+    for (int i = 0; i < impl->host_mem.num; i++)
+        pl_buf_destroy(gpu, &impl->host_mem.elem[i].buf);
+    pl_mutex_destroy(&impl->host_lock);
     pl_dispatch_destroy(&impl->dp);
     impl->destroy(gpu);
 }
@@ -639,6 +646,115 @@ static bool pl_buf_params_superset(struct pl_buf_params a, struct pl_buf_params
            (a.drawable       || !b.drawable);
 }
 
+// Rounds a host memory range outwards to the nearest import boundaries
+static void host_mem_range(pl_gpu gpu, const void *ptr, size_t size,
+                           uintptr_t *base, size_t *aligned_size)
+{
+    const size_t align = PL_DEF(gpu->limits.align_host_ptr, 1);
+    *base = (uintptr_t) ptr - (uintptr_t) ptr % align;
+    *aligned_size = PL_ALIGN((uintptr_t) ptr + size - *base, align);
+}
+
+bool pl_gpu_register_host_mem(pl_gpu gpu, void *ptr, size_t size)
+{
+    if (!(gpu->import_caps.buf & PL_HANDLE_HOST_PTR))
+        return false;
+
+    uintptr_t base;
+    size_t aligned_size;
+    host_mem_range(gpu, ptr, size, &base, &aligned_size);
+    if (!size || aligned_size > gpu->limits.max_buf_size)
+        return false;
+
+    // This may legitimately fail (e.g. for memory the driver can't import),
+    // so suppress errors and leave it up to the caller to decide
+    pl_log_level_cap(gpu->log, PL_LOG_DEBUG);
+    pl_buf buf = pl_buf_create(gpu, pl_buf_params(
+        .size = aligned_size,
+        .import_handle = PL_HANDLE_HOST_PTR,
+        .shared_mem = {
+            .handle.ptr = (void *) base,
+            .size = aligned_size,
+        },
+    ));
+    pl_log_level_cap(gpu->log, PL_LOG_NONE);
+    if (!buf)
+        return false;
+
+    PL_DEBUG(gpu, "Registered host memory %p + %zu -> %zu", (void *) base,
+             (size_t) ((uintptr_t) ptr - base), aligned_size);
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_mutex_lock(&impl->host_lock);
+    PL_ARRAY_APPEND((void *) gpu, impl->host_mem, (struct pl_host_mem) {
+        .base = base,
+        .size = aligned_size,
+        .buf = buf,
+    });
+    pl_mutex_unlock(&impl->host_lock);
+    return true;
+}
+
+void pl_gpu_unregister_host_mem(pl_gpu gpu, void *ptr, size_t size)
+{
+    uintptr_t base;
+    size_t aligned_size;
+    host_mem_range(gpu, ptr, size, &base, &aligned_size);
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_buf buf = NULL;
+    pl_mutex_lock(&impl->host_lock);
+    for (int i = 0; i < impl->host_mem.num; i++) {
+        const struct pl_host_mem *mem = &impl->host_mem.elem[i];
+        if (mem->base == base && mem->size == aligned_size) {
+            buf = mem->buf;
+            PL_ARRAY_REMOVE_AT(impl->host_mem, i);
+            break;
+        }
+    }
+    pl_mutex_unlock(&impl->host_lock);
+
+    if (!buf) {
+        PL_ERR(gpu, "Attempted to unregister host memory %p + %zu, which was "
+               "never registered!", ptr, size);
+        return;
+    }
+
+    // The memory may be freed by the user as soon as we return, so make sure
+    // the GPU is done reading from it
+    while (pl_buf_poll(gpu, buf, UINT64_MAX))
+        ; // do nothing
+    pl_buf_destroy(gpu, &buf);
+}
+
+pl_buf pl_gpu_host_mem_get(pl_gpu gpu, const void *ptr, size_t size,
+                           size_t *offset)
+{
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    const uintptr_t start = (uintptr_t) ptr;
+    pl_buf buf = NULL;
+
+    pl_mutex_lock(&impl->host_lock);
+    for (int i = 0; i < impl->host_mem.num; i++) {
+        const struct pl_host_mem *mem = &impl->host_mem.elem[i];
+        if (start >= mem->base && start - mem->base <= mem->size &&
+            size <= mem->size - (start - mem->base))
+        {
+            buf = mem->buf;
+            *offset = start - mem->base;
+            break;
+        }
+    }
+    pl_mutex_unlock(&impl->host_lock);
+    return buf;
+}
+
+uint64_t pl_gpu_host_mem_hits(pl_gpu gpu)
+{
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    return atomic_load(&impl->host_mem_hits);
+}
+
 bool pl_buf_recreate(pl_gpu gpu, pl_buf *buf, const struct pl_buf_params *params)
 {
 
@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "pl_thread.h"
 
 #include <libplacebo/gpu.h>
 #include <libplacebo/dispatch.h>
@@ -32,6 +33,13 @@
 // This struct must be the first member of the gpu's priv struct. The `pl_gpu`
 // helpers will cast the priv struct to this struct!
 
+// Host memory range registered via `pl_gpu_register_host_mem`
+struct pl_host_mem {
+    uintptr_t base; // start of the range, rounded down to `align_host_ptr`
+    size_t size;    // size of the range, rounded up to `align_host_ptr`
+    pl_buf buf;     // host pointer import spanning the whole range
+};
+
 #define GPU_PFN(name) __typeof__(pl_##name) *name
 struct pl_gpu_fns {
     // This is a pl_dispatch used (on the pl_gpu itself!) for the purposes of
@@ -44,6 +52,12 @@ struct pl_gpu_fns {
     // Internal cache, or NULL. Set by the user (via pl_gpu_set_cache).
     _Atomic(pl_cache) cache;
 
+    // Registered host memory ranges, and the number of uploads served directly
+    // from them
+    pl_mutex host_lock;
+    PL_ARRAY(struct pl_host_mem) host_mem;
+    _Atomic uint64_t host_mem_hits;
+
     // Destructors: These also free the corresponding objects, but they
     // must not be called on NULL. (The NULL checks are done by the pl_*_destroy
     // wrappers)
@@ -126,6 +140,16 @@ int pl_tex_transfer_slices(pl_gpu gpu, pl_fmt texel_fmt,
                            const struct pl_tex_transfer_params *params,
                            struct pl_tex_transfer_params **out_slices);
 
+// Returns the host pointer import covering `size` bytes at `ptr`, if this
+// range is part of a memory region registered with `pl_gpu_register_host_mem`,
+// or NULL otherwise. `*offset` is set to the offset of `ptr` within the buffer.
+pl_buf pl_gpu_host_mem_get(pl_gpu gpu, const void *ptr, size_t size,
+                           size_t *offset);
+
+// Returns the number of texture uploads that were served directly from
+// registered host memory. Used for testing.
+uint64_t pl_gpu_host_mem_hits(pl_gpu gpu);
+
 // Helper that wraps pl_tex_upload/download using texture upload buffers to
 // ensure that params->buf is always set.
 bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params);
@@ -281,6 +281,8 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
     // Finally, create a `pl_dispatch` object for internal operations
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
     atomic_init(&impl->cache, NULL);
+    pl_mutex_init(&impl->host_lock);
+    atomic_init(&impl->host_mem_hits, 0);
     impl->dp = pl_dispatch_create(gpu->log, gpu);
     return gpu;
 }
@@ -547,6 +549,24 @@ bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     struct pl_tex_transfer_params fixed = *params;
     fixed.ptr = NULL;
 
+    // Memory registered by the user is already imported, so we can always
+    // upload from it directly. Synchronous uploads need to wait for the GPU
+    // to finish reading, since the caller is free to reuse the memory after
+    // we return.
+    if (!params->no_import)
+        fixed.buf = pl_gpu_host_mem_get(gpu, params->ptr, size, &fixed.buf_offset);
+    if (fixed.buf) {
+        if (!pl_tex_upload(gpu, &fixed))
+            return false;
+        struct pl_gpu_fns *impl = PL_PRIV(gpu);
+        atomic_fetch_add(&impl->host_mem_hits, 1);
+        if (!params->callback) {
+            while (pl_buf_poll(gpu, fixed.buf, 10000000)) // 10 ms
+                PL_TRACE(gpu, "pl_tex_upload: synchronous/blocking (host mem)");
+        }
+        return true;
+    }
+
     // If we can import host pointers directly, and the function is being used
     // asynchronously, then we can use host pointer import to skip a memcpy. In
     // the synchronous case, we still force a host memcpy to avoid stalling the
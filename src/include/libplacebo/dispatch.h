@@ -62,6 +62,12 @@ struct pl_dispatch_info {
     uint64_t last;
     uint64_t peak;
     uint64_t average;
+
+    // CPU time (in nanoseconds) spent compiling this pass as part of this
+    // dispatch, and spent (re)generating LUTs while building the shader,
+    // respectively. Both are 0 if nothing needed to be (re)generated.
+    uint64_t compile_time;
+    uint64_t lut_time;
 };
 
 // Helper function to make a copy of `pl_dispatch_info`, while overriding
@@ -59,6 +59,13 @@ struct pl_filter_function {
     // sophisticated filter function which does not fit into the pl_filter
     // framework. `weight()` will always return 0.0.
     bool opaque;
+
+    // Optional batched version of `weight`, which computes the weights for
+    // `n` offsets at once. Must produce the same results as calling `weight`
+    // on each element of `x` individually. If left as NULL, `weight` will be
+    // called in a loop instead.
+    void (*weight_n)(const struct pl_filter_ctx *f, const double *x,
+                     double *out, int n);
 };
 
 // Deprecated function, merely checks a->weight == b->weight
@@ -265,6 +272,12 @@ PL_API bool pl_filter_config_eq(const struct pl_filter_config *a,
 // respecting all parameters of the configuration.
 PL_API double pl_filter_sample(const struct pl_filter_config *c, double x);
 
+// Batched version of `pl_filter_sample`, which samples the filter at `n`
+// different x coordinates at once. Makes use of `pl_filter_function.weight_n`
+// where available. The results are identical to `pl_filter_sample`.
+PL_API void pl_filter_sample_n(const struct pl_filter_config *c,
+                               const double *x, double *out, int n);
+
 // A list of built-in filter configurations. Since they are just combinations
 // of the above filter functions, they are not described in much further
 // detail.
@@ -413,6 +426,9 @@ typedef const struct pl_filter_t {
 // The resulting pl_filter must be freed with `pl_filter_free` when no longer
 // needed. Returns NULL if filter generation fails due to invalid parameters
 // (i.e. missing a required parameter).
+//
+// Note: For large LUTs, the filter weights may be computed by multiple
+// internal worker threads in parallel. The result is deterministic regardless.
 PL_API pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params);
 PL_API void pl_filter_free(pl_filter *filter);
 
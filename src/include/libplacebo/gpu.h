@@ -882,7 +882,8 @@ struct pl_tex_transfer_params {
     // helpful to avoid having to manually poll buffers all the time)
     //
     // When this is *not* specified, uploads from `ptr` are still asynchronous
-    // but require a host memcpy, while downloads from `ptr` are blocking. As
+    // but require a host memcpy (unless the memory was registered with
+    // `pl_gpu_register_host_mem`), while downloads from `ptr` are blocking. As
     // such, it's recommended to always try using asynchronous texture
     // transfers wherever possible.
     //
@@ -917,6 +918,24 @@ PL_API bool pl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *param
 // Download data from a texture. Returns whether successful.
 PL_API bool pl_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *params);
 
+// Registers a range of host memory that will be uploaded from repeatedly,
+// such as a pool of decoded frames that gets recycled. For as long as the
+// range stays registered, uploads from `ptr` transfers lying entirely within
+// it read directly from the host memory, using a single PL_HANDLE_HOST_PTR
+// import that is shared by all uploads, instead of copying the data into a
+// staging buffer first. This also applies to uploads without a `callback`,
+// which then block until the GPU has finished reading the data.
+//
+// The memory must stay valid until it is unregistered again. Returns false if
+// the memory could not be imported (or if the GPU does not support host
+// pointer imports), in which case uploads keep using the regular path.
+PL_API bool pl_gpu_register_host_mem(pl_gpu gpu, void *ptr, size_t size);
+
+// Unregisters a range previously registered with `pl_gpu_register_host_mem`,
+// with the same `ptr` and `size`. Must be called before freeing or unmapping
+// the memory. This waits for any pending uploads from the range to complete.
+PL_API void pl_gpu_unregister_host_mem(pl_gpu gpu, void *ptr, size_t size);
+
 // Returns whether or not a texture is currently "in use". This can either be
 // because of a pending read operation, a pending write operation or a pending
 // texture export operation. Note that this function's usefulness is extremely
@@ -31,6 +31,7 @@
 #include <libplacebo/shaders/sampling.h>
 #include <libplacebo/shaders/custom.h>
 #include <libplacebo/swapchain.h>
+#include <libplacebo/utils/tex_pool.h>
 
 PL_API_BEGIN
 
@@ -69,6 +70,15 @@ struct pl_render_errors {
 PL_API pl_renderer pl_renderer_create(pl_log log, pl_gpu gpu);
 PL_API void pl_renderer_destroy(pl_renderer *rr);
 
+// Draw intermediate textures from a `pl_tex_pool` shared with other renderers
+// on the same `pl_gpu`, instead of from the renderer's own internal pool.
+// Intermediates whose lifetimes don't overlap may share the same texture.
+// Pass NULL to revert to the internal pool. The pool must outlive the
+// renderer, or at least until this function is called again.
+//
+// Note: Must not be called concurrently with `pl_render_*`.
+PL_API void pl_renderer_set_tex_pool(pl_renderer rr, pl_tex_pool pool);
+
 // Returns current renderer state, see pl_render_errors.
 PL_API struct pl_render_errors pl_renderer_get_errors(pl_renderer rr);
 
@@ -121,6 +131,67 @@ struct pl_render_info {
     // For PL_RENDER_STAGE_BLEND, this specifies the number of frames
     // being blended (since that results in a different shader).
     int count;
+
+    // For passes shared between multiple targets by `pl_render_image_multi`,
+    // this is the estimated GPU time (in nanoseconds) saved by not repeating
+    // this pass for each target. Always 0 otherwise.
+    uint64_t time_saved;
+
+    // Total number of calls to `pl_render_image_mix` on this renderer which
+    // were rendered normally, and which were skipped entirely by reusing the
+    // previous output (see `skip_redundant_frames`), respectively. Since
+    // skipped frames don't execute any passes, they are only reflected here
+    // once the next pass is executed.
+    uint64_t frames_rendered;
+    uint64_t frames_reused;
+
+    // Number of render stages (including user hooks) in the current frame up
+    // to this pass, which were fused into the pass that precedes them rather
+    // than requiring an intermediate texture (`passes_fused`), and number of
+    // intermediate passes which could not be fused and had to be written to
+    // an intermediate texture (`passes_unfused`), respectively.
+    int passes_fused;
+    int passes_unfused;
+};
+
+enum pl_render_span_type {
+    PL_RENDER_SPAN_FRAME,   // a full call to `pl_render_image` etc.
+    PL_RENDER_SPAN_STEP,    // an internal rendering step, e.g. scaling
+    PL_RENDER_SPAN_LUT,     // (re)generating the LUTs used by a shader
+    PL_RENDER_SPAN_COMPILE, // compiling a shader
+    PL_RENDER_SPAN_PASS,    // executing a shader
+    PL_RENDER_SPAN_TYPE_COUNT,
+};
+
+// A timestamped span of work done by the renderer, for profiling purposes.
+// Spans are reported once they complete, so enclosing spans (e.g. frames) are
+// reported after the spans they contain.
+struct pl_render_span {
+    // Name of this span. For frames and steps, this is the name of the
+    // function (e.g. "pass_scale_main"). Otherwise, this is the description of
+    // the corresponding shader. Only valid until the callback returns.
+    const char *name;
+    enum pl_render_span_type type;
+    enum pl_render_stage stage;
+
+    // For spans associated with a shader, the signature of the pass.
+    uint64_t signature;
+
+    // Start of this span on the CPU timeline, in nanoseconds since the
+    // creation of the `pl_renderer`. For LUT generation and shader
+    // compilation, this is reconstructed from the duration, as they are
+    // measured deeper inside the shader system.
+    uint64_t start;
+
+    // CPU time spent in this span, in nanoseconds. 0 for PL_RENDER_SPAN_PASS,
+    // whose CPU cost is included in the enclosing step.
+    uint64_t cpu_time;
+
+    // For PL_RENDER_SPAN_PASS, the last measured GPU execution time of this
+    // pass, in nanoseconds, if timer queries are available. Note that GPU
+    // timers are read back asynchronously, so this may lag behind by a few
+    // frames, and is 0 until the first result is available.
+    uint64_t gpu_time;
 };
 
 // Represents the options used for rendering. These affect the quality of
@@ -293,6 +364,80 @@ struct pl_render_params {
     // resize, but should make it much more smooth.
     bool preserve_mixing_cache;
 
+    // Upper limit on the total size (in bytes) of the textures backing the
+    // frame mixing cache of `pl_render_image_mix`. When set, frames which are
+    // no longer required for the current mix are kept around (e.g. for
+    // pausing or seeking backwards) until this limit is reached, after which
+    // they are evicted in least-recently-used order. Frames required for the
+    // current mix are never evicted, so this limit may be exceeded in cases
+    // where the mixer radius spans more frames than fit into it. If 0, frames
+    // are evicted as soon as they are no longer required (the default).
+    size_t mixing_cache_max_bytes;
+
+    // Store frames in the mixing cache at reduced precision, if the GPU
+    // supports a suitable format that is smaller than the normal FBO format.
+    // Opaque frames are stored as 10-bit unorm (e.g. rgb10a2) when rendering
+    // to non-floating point targets, and as 16-bit float otherwise. In either
+    // case, the rounding error introduced per frame is below 1/2046 (~0.0005)
+    // of the encoded signal value (absolute for unorm, relative for float). The
+    // error of the mixed output is bounded by the same amount, scaled by the
+    // sum of absolute (normalized) mixer weights - i.e. 1 for non-negative
+    // mixers such as `pl_filter_oversample`. Roughly halves the memory cost
+    // of the cache on typical hardware.
+    bool mixing_cache_reduced_precision;
+
+    // Allows `pl_render_image_mix` to skip rendering entirely if it would
+    // produce exactly the same output as the previous call, i.e. if it mixes
+    // the same frames (signatures and crops) with the same weights, into a
+    // target of the same size and format, using the same render parameters.
+    // This commonly happens while paused or when displaying still images or
+    // low framerate content on high refresh rate displays. In this case, the
+    // previous output is copied to the target instead. This requires keeping
+    // around a copy of the output, and only works for single-plane targets
+    // whose texture has `blit_dst` set. Targets without `blit_src`, such as
+    // most swapchain images, are rendered into the copy first. It's disabled
+    // when using custom hooks or temporal dithering, since those may vary
+    // from frame to frame, and when using `PL_CLEAR_SKIP` for either `border`
+    // or `background`.
+    //
+    // Note: This relies on the frame signatures being unique.
+    bool skip_redundant_frames;
+
+    // Allows `pl_render_image` to only redraw the overlays if it's called
+    // with the same image, target and render parameters as the previous call,
+    // except for the `overlays` of either. The output before drawing overlays
+    // is kept around, and only the region covered by the old and new overlays
+    // is restored from it before drawing the new overlays on top. This makes
+    // e.g. subtitle or OSD updates on top of a paused image very cheap. Has
+    // the same requirements and restrictions as `skip_redundant_frames`, and
+    // additionally requires `blit_src` on the target texture.
+    //
+    // Note: Since only the changed region is redrawn, this relies on the
+    // target still containing the previous output, and therefore only works
+    // for offscreen targets that are rendered to repeatedly. Rotating targets
+    // such as swapchain images are treated as different targets, and always
+    // rendered in full.
+    //
+    // Note: Since there is no way to detect changes to the contents of the
+    // image textures, the image is considered unchanged as long as its
+    // planes and metadata are. Users updating textures in-place must call
+    // `pl_renderer_flush_cache` after doing so, or disable this option.
+    bool partial_overlay_updates;
+
+    // Packs the textures of small overlays into a texture atlas managed by
+    // the renderer, so that consecutive overlays with the same `mode`, `repr`
+    // and `color` can be drawn in a single pass. This greatly speeds up
+    // drawing large numbers of overlays, e.g. individual subtitle glyphs.
+    // Overlay textures are copied into the atlas the first time they're
+    // seen, and subsequently identified only by their handle.
+    //
+    // Note: Since changes to the contents of overlay textures can't be
+    // detected, users updating overlay textures in-place must call
+    // `pl_renderer_flush_cache` after doing so, or disable this option. Due
+    // to the padding between textures in the atlas, sampling near the edges
+    // of an overlay texture may differ slightly from the unbatched case.
+    bool batch_overlays;
+
     // --- Performance tuning / debugging options
     // These may affect performance or may make debugging problems easier,
     // but shouldn't have any effect on the quality.
@@ -303,6 +448,21 @@ struct pl_render_params {
     // it will still read from, if they happen to already be cached)
     bool skip_caching_single_frame;
 
+    // If set, `pl_render_image` splits outputs larger than this size (in
+    // pixels, along either dimension) into tiles of at most this size, which
+    // are rendered independently and stitched together in the target. Each
+    // tile is padded by the footprint of the main scaler, so intermediate
+    // textures stay bounded by the tile size (plus padding) rather than the
+    // size of the whole image. This is intended for very large outputs, whose
+    // full-size intermediates would exceed the GPU's texture size limits or
+    // memory budget.
+    //
+    // Note: Tiling is skipped for planar or rotated targets, and when using
+    // features which depend on the entire frame, such as custom hooks, error
+    // diffusion, distortion, corner rounding, film grain, as well as peak
+    // detection and contrast recovery for HDR sources.
+    int output_tile_size;
+
     // Disables linearization / sigmoidization before scaling. This might be
     // useful when tracking down unexpected image artifacts or excessing
     // ringing, but it shouldn't normally be necessary.
@@ -352,6 +512,15 @@ struct pl_render_params {
     void (*info_callback)(void *priv, const struct pl_render_info *info);
     void *info_priv;
 
+    // This callback is invoked for every span of work completed by the
+    // renderer, including CPU-side steps, LUT generation, shader compilation
+    // and shader execution. Optional. See `pl_render_span`, as well as
+    // <libplacebo/utils/trace.h> for a ready-made consumer.
+    //
+    // Note: `span` is only valid until this function returns.
+    void (*span_callback)(void *priv, const struct pl_render_span *span);
+    void *span_priv;
+
     // --- Deprecated/removed fields
     PL_DEPRECATED_IN(v6.254) bool allow_delayed_peak_detect; // moved to pl_peak_detect_params
     PL_DEPRECATED_IN(v6.327) const struct pl_icc_params *icc_params; // use pl_frame.icc
@@ -718,6 +887,25 @@ PL_API bool pl_render_image(pl_renderer rr, const struct pl_frame *image,
                             const struct pl_frame *target,
                             const struct pl_render_params *params);
 
+// Render a single `image` to multiple `targets` (up to 16), e.g. to produce
+// several output sizes of the same source frame. This is equivalent to
+// calling `pl_render_image` for each target, except that the work of reading
+// the image (plane merging, debanding, film grain, chroma upscaling, color
+// decoding etc.) is only performed once, and only scaling, color mapping and
+// output encoding are done per target. Where possible, smaller targets are
+// downscaled from the intermediate result of a larger target instead of from
+// the full image.
+//
+// Only targets resulting in the same (effective) image crop as the first
+// target can share work, all others are rendered individually.
+// `pl_render_info.time_saved` reports the GPU time saved by the shared passes.
+//
+// Note: All targets are acquired at the same time, for the duration of this
+// call.
+PL_API bool pl_render_image_multi(pl_renderer rr, const struct pl_frame *image,
+                                  const struct pl_frame *targets, int num_targets,
+                                  const struct pl_render_params *params);
+
 // Flushes the internal state of this renderer. This is normally not needed,
 // even if the image parameters, colorspace or target configuration change,
 // since libplacebo will internally detect such circumstances and recreate
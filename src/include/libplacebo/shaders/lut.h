@@ -54,14 +54,38 @@ struct pl_custom_lut {
     // Note: This is purely informative, `pl_shader_custom_lut` ignores it.
     struct pl_color_repr repr_in, repr_out;
     struct pl_color_space color_in, color_out;
+
+    // Optional pre-padded LUT data, in the same order as `data` but with four
+    // floats (R, G, B, ignored) per sample. If set, this takes priority over
+    // `data`, and is uploaded as-is without any repacking. `data` may be left
+    // as NULL in this case.
+    const float *data_rgba;
 };
 
 // Parse a 3DLUT in .cube format. Returns NULL if the file fails parsing.
 PL_API struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *str, size_t str_len);
 
-// Frees a LUT created by `pl_lut_parse_*`.
+// Frees a LUT created by `pl_lut_parse_*` or `pl_lut_load`.
 PL_API void pl_lut_free(struct pl_custom_lut **lut);
 
+// Serialize a LUT into a compact binary representation, suitable for e.g.
+// storing inside a `pl_cache` (keyed on `lut->signature`) to avoid re-parsing
+// the original .cube file. The LUT data is stored pre-padded to RGBA. If
+// `half` is true, it is additionally stored as 16-bit half floats, halving the
+// size at the cost of a relative error of up to 2^-11 per sample.
+//
+// Returns the number of bytes required. If `out` is NULL, only the size is
+// computed. Returns 0 if the LUT is invalid.
+//
+// Note: The resulting data is specific to the libplacebo version and platform.
+// Do not use it as an interchange format.
+PL_API size_t pl_lut_save(const struct pl_custom_lut *lut, bool half, uint8_t *out);
+
+// Load a LUT previously saved with `pl_lut_save`. Returns NULL if the data is
+// invalid or was saved by a different version of libplacebo. The resulting
+// LUT only has `data_rgba` set, which is used directly for uploads.
+PL_API struct pl_custom_lut *pl_lut_load(pl_log log, const uint8_t *data, size_t size);
+
 // Apply a `pl_custom_lut`. The user is responsible for ensuring colors going
 // into the LUT are in the expected format as informed by the LUT metadata.
 //
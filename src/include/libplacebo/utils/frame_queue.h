@@ -120,8 +120,18 @@ PL_API void pl_queue_reset(pl_queue queue);
 //
 // When no more frames are available, call this function with `frame == NULL`
 // to indicate EOF and begin draining the frame queue.
+//
+// Note: This function is lock-free in the common case, so it does not contend
+// with a concurrent `pl_queue_update` call on another thread. Pushed frames
+// are only inserted into the queue by the next call to another `pl_queue_*`
+// function, e.g. `pl_queue_update`.
 PL_API void pl_queue_push(pl_queue queue, const struct pl_source_frame *frame);
 
+// Push multiple frames at once. Equivalent to calling `pl_queue_push` on each
+// frame in `frames` in order, but cheaper.
+PL_API void pl_queue_push_n(pl_queue queue, const struct pl_source_frame *frames,
+                            int num);
+
 // Variant of `pl_queue_push` that blocks while the queue is judged
 // (internally) to be "too full". This is useful for asynchronous decoder loops
 // in order to prevent the queue from exhausting available RAM if frames are
@@ -132,6 +142,24 @@ PL_API void pl_queue_push(pl_queue queue, const struct pl_source_frame *frame);
 PL_API bool pl_queue_push_block(pl_queue queue, uint64_t timeout,
                                 const struct pl_source_frame *frame);
 
+// Hand off mapping of upcoming frames to a pool of `num_threads` worker
+// threads, which start mapping frames as soon as they are pushed, rather than
+// calling `pl_source_frame.map` synchronously from within `pl_queue_update`.
+// Pass 0 to disable (the default). Limited to 16 threads.
+//
+// In this mode, the number of frames mapped ahead of time adapts to the
+// measured `map` latency relative to the estimated vsync duration (see
+// `pl_queue_estimate_vps`), instead of being fixed.
+//
+// Note: This requires `pl_gpu_limits.thread_safe`, and the `map` callback must
+// be safe to call from multiple threads concurrently. `unmap` and `discard`
+// may also be called from the worker threads.
+PL_API void pl_queue_set_map_threads(pl_queue queue, int num_threads);
+
+// Returns the current number of not-yet-mapped frames that the queue will
+// accept and map ahead of time.
+PL_API int pl_queue_prefetch_frames(pl_queue queue);
+
 struct pl_queue_params {
     // The PTS of the frame that will be rendered. This should be set to the
     // timestamp (in seconds) of the next vsync, relative to the initial frame.
@@ -0,0 +1,87 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBPLACEBO_TEX_POOL_H_
+#define LIBPLACEBO_TEX_POOL_H_
+
+#include <libplacebo/gpu.h>
+
+PL_API_BEGIN
+
+// A pool of transient textures, such as the intermediate render targets used
+// by `pl_renderer`. A single pool may be shared between multiple users (e.g.
+// several renderers) of the same `pl_gpu`. Textures are bucketed by size
+// class, and idle textures are handed out again for requests with matching
+// parameters. Idle textures that go unused for a while, or that exceed the
+// configured budget, are freed in least-recently-used order.
+//
+// Thread-safety: Safe
+typedef struct pl_tex_pool_t *pl_tex_pool;
+
+struct pl_tex_pool_params {
+    // Upper limit on the total size (in bytes) of all textures held by the
+    // pool. Idle textures are reallocated or evicted to stay below this
+    // limit. Since textures in use are never freed, this limit may be
+    // exceeded temporarily. If 0, no limit is imposed.
+    size_t max_bytes;
+};
+
+#define pl_tex_pool_params(...) (&(struct pl_tex_pool_params) { __VA_ARGS__ })
+
+PL_API pl_tex_pool pl_tex_pool_create(pl_gpu gpu, const struct pl_tex_pool_params *params);
+
+// Destroys all textures held by the pool. Textures still acquired at this
+// point are destroyed as well, so this should only be called after all users
+// of the pool are done with it.
+PL_API void pl_tex_pool_destroy(pl_tex_pool *pool);
+
+// Updates the pool parameters, evicting idle textures as needed to satisfy
+// the new budget.
+PL_API void pl_tex_pool_set_params(pl_tex_pool pool,
+                                   const struct pl_tex_pool_params *params);
+
+// Returns a texture matching `params`, either by reusing an idle texture or
+// by (re)creating one. The contents of the texture are undefined. Returns
+// NULL on failure. `params->debug_tag`, `initial_data` and `user_data` are
+// ignored for the purposes of matching.
+PL_API pl_tex pl_tex_pool_acquire(pl_tex_pool pool, const struct pl_tex_params *params);
+
+// Returns a texture previously acquired from `pool` back to the pool, and
+// sets `*tex` to NULL. The texture may be handed out again immediately, so
+// the caller must not issue any further operations referencing it.
+// (Operations already issued are fine, since GPU commands execute in order)
+PL_API void pl_tex_pool_release(pl_tex_pool pool, pl_tex *tex);
+
+// Frees all idle textures held by the pool.
+PL_API void pl_tex_pool_flush(pl_tex_pool pool);
+
+struct pl_tex_pool_stats {
+    size_t bytes_held;      // total size of all textures held by the pool
+    size_t bytes_used;      // total size of currently acquired textures
+    int num_textures;       // number of textures held by the pool
+    int num_used;           // number of currently acquired textures
+    uint64_t hits;          // acquisitions satisfied by an idle texture
+    uint64_t allocs;        // acquisitions requiring a new texture
+    uint64_t reallocs;      // acquisitions recreating an idle texture
+    uint64_t evictions;     // idle textures freed to respect limits
+};
+
+PL_API struct pl_tex_pool_stats pl_tex_pool_get_stats(pl_tex_pool pool);
+
+PL_API_END
+
+#endif // LIBPLACEBO_TEX_POOL_H_
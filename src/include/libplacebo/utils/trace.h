@@ -0,0 +1,73 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBPLACEBO_TRACE_H_
+#define LIBPLACEBO_TRACE_H_
+
+#include <libplacebo/cache.h>
+#include <libplacebo/renderer.h>
+
+PL_API_BEGIN
+
+// A bounded ring buffer of `pl_render_span`s, which can be exported in the
+// Chrome trace event format (as understood by e.g. chrome://tracing or
+// Perfetto). To use it, set `pl_render_params.span_callback` to
+// `pl_trace_span_cb` and `pl_render_params.span_priv` to the `pl_trace`.
+//
+// Thread-safety: Safe
+typedef struct pl_trace_t *pl_trace;
+
+struct pl_trace_params {
+    // Maximum number of spans to keep around. Once this limit is reached, the
+    // oldest spans are overwritten. If 0, defaults to 65536.
+    int max_spans;
+};
+
+#define pl_trace_params(...) (&(struct pl_trace_params) { __VA_ARGS__ })
+
+PL_API pl_trace pl_trace_create(pl_log log, const struct pl_trace_params *params);
+PL_API void pl_trace_destroy(pl_trace *trace);
+
+// Records a span. Intended for use as `pl_render_params.span_callback`, with
+// `priv` being the `pl_trace`.
+PL_API void pl_trace_span_cb(void *priv, const struct pl_render_span *span);
+
+// Discards all recorded spans.
+PL_API void pl_trace_reset(pl_trace trace);
+
+// Returns the number of spans currently held by the trace.
+PL_API int pl_trace_num_spans(pl_trace trace);
+
+// Serializes all recorded spans, oldest first, as Chrome trace event JSON.
+// CPU work is placed on a thread named "CPU", and the GPU execution time of
+// shader passes on a thread named "GPU", aligned with the point in time at
+// which the pass was dispatched. Returns the number of spans written.
+PL_API int pl_trace_save_ex(pl_trace trace,
+                            void (*write)(void *priv, size_t size, const void *ptr),
+                            void *priv);
+
+// Writes data directly to a pointer. Returns the number of bytes that *would*
+// have been written, so this can be used on a size 0 buffer to get the required
+// total size.
+PL_API size_t pl_trace_save(pl_trace trace, uint8_t *data, size_t size);
+
+// Writes data to a FILE stream at the current position.
+#define pl_trace_save_file(t, file) pl_trace_save_ex(t, pl_write_file_cb, file)
+
+PL_API_END
+
+#endif // LIBPLACEBO_TRACE_H_
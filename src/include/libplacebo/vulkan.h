@@ -235,6 +235,15 @@ struct pl_vulkan_params {
     // the driver is misbehaving. Some features may be disabled if this is set.
     bool no_compute;
 
+    // Enables defragmentation of device memory, for long-running sessions. If
+    // nonzero, memory slabs whose utilization drops below this fraction (e.g.
+    // 0.25) are periodically evacuated during `pl_gpu_flush`, by moving the
+    // textures and buffers they contain into other slabs via GPU copies, after
+    // which the emptied slabs are freed. Only idle objects not shared with the
+    // user or external APIs are moved, i.e. excluding exported, imported,
+    // wrapped, held, unwrapped and host-mapped objects. Disabled by default.
+    float defrag_threshold;
+
     // Bitmask of extra queue families to enable. If set, then *all* queue
     // families matching *any* of these flags will be enabled at device
     // creation time. Setting this to VK_QUEUE_FLAG_BITS_MAX_ENUM effectively
@@ -298,6 +307,13 @@ PL_API void pl_vulkan_destroy(pl_vulkan *vk);
 // the underlying `pl_vulkan`. Returns NULL for any other type of `gpu`.
 PL_API pl_vulkan pl_vulkan_get(pl_gpu gpu);
 
+// Immediately evacuates sparsely used memory slabs, as described by
+// `pl_vulkan_params.defrag_threshold`. Returns the total size (in bytes) of
+// the memory slabs which will be freed once the resulting copies complete.
+// Does nothing (and returns 0) if defragmentation is not enabled, or if `gpu`
+// is not a vulkan GPU.
+PL_API size_t pl_vulkan_defrag(pl_gpu gpu);
+
 struct pl_vulkan_device_params {
     // The instance to use. Required!
     //
@@ -425,6 +441,9 @@ struct pl_vulkan_import_params {
     void (*unlock_queue)(void *ctx, uint32_t qf, uint32_t qidx);
     void *queue_ctx;
 
+    // See `pl_vulkan_params.defrag_threshold`.
+    float defrag_threshold;
+
     // --- Misc/debugging options
 
     // Restrict specific features to e.g. work around driver bugs, or simply
@@ -39,6 +39,11 @@ static void gl_gpu_destroy(pl_gpu gpu)
     while (p->callbacks.num > 0)
         gl_poll_callbacks(gpu);
 
+    for (int i = 0; i < GL_XFER_SLOTS; i++) {
+        if (p->xfer[i].buf)
+            gl_buf_destroy(gpu, p->xfer[i].buf);
+    }
+
     pl_free((void *) gpu);
 }
 
@@ -242,6 +247,7 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl pl_gl, const struct pl_opengl_para
     p->has_invalidate_tex = gl_test_ext(gpu, "GL_ARB_invalidate_subdata", 43, 0);
     p->has_queries = gl_test_ext(gpu, "GL_ARB_timer_query", 30, 0);
     p->has_storage = gl_test_ext(gpu, "GL_ARB_shader_image_load_store", 42, 31);
+    p->has_buf_storage = gl_test_ext(gpu, "GL_ARB_buffer_storage", 44, 0);
     p->has_readback = true;
 
     if (p->has_readback && p->gles_ver) {
@@ -25,6 +25,16 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl gl, const struct pl_opengl_params
 
 // --- pl_gpu internal structs and functions
 
+// Number of persistently mapped staging buffers used for texture transfers
+// from/to host memory. These are used in round-robin order, and a buffer is
+// only reused once the GPU is done with it, which also paces the transfers.
+#define GL_XFER_SLOTS 4
+
+struct gl_xfer_slot {
+    pl_buf buf;
+    bool pending; // download result not yet copied out to host memory
+};
+
 struct pl_gl {
     struct pl_gpu_fns impl;
     pl_opengl gl;
@@ -42,6 +52,10 @@ struct pl_gl {
     // Sync objects and associated callbacks
     PL_ARRAY(struct gl_cb) callbacks;
 
+    // Staging ring for texture transfers
+    struct gl_xfer_slot xfer[GL_XFER_SLOTS];
+    int xfer_idx;
+
 
     // Incrementing counters to keep track of object uniqueness
     int buf_id;
@@ -50,6 +64,7 @@ struct pl_gl {
     int gl_ver;
     int gles_ver;
     bool has_storage;
+    bool has_buf_storage;
     bool has_invalidate_fb;
     bool has_invalidate_tex;
     bool has_vao;
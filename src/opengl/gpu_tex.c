@@ -883,6 +883,138 @@ static int get_alignment(size_t pitch)
     return 1;
 }
 
+// Transfers outside of this range bypass the staging ring
+#define XFER_MIN_SIZE (32 << 10)  // 32 KiB
+#define XFER_MAX_SIZE (64 << 20)  // 64 MiB
+#define XFER_ALIGN    (4 << 20)   // 4 MiB
+
+// Returns the next slot of the staging ring, with a buffer of at least `size`
+// bytes that is no longer in use, or NULL on failure. Must be called with the
+// context current.
+static struct gl_xfer_slot *xfer_slot_get(pl_gpu gpu, size_t size)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_xfer_slot *slot = &p->xfer[p->xfer_idx];
+    p->xfer_idx = (p->xfer_idx + 1) % GL_XFER_SLOTS;
+
+    if (slot->buf) {
+        if (gl_buf_poll(gpu, slot->buf, UINT64_MAX))
+            return NULL;
+
+        if (slot->pending) {
+            // The callback copying out a previous download is not guaranteed
+            // to have run even after the buffer itself has become idle
+            gl->Finish();
+            gl_poll_callbacks(gpu);
+            if (slot->pending)
+                return NULL;
+        }
+    }
+
+    // Also reallocate buffers far larger than needed, so that a single large
+    // transfer doesn't pin that much memory for the lifetime of the `pl_gpu`
+    const size_t buf_size = PL_ALIGN2(size, XFER_ALIGN);
+    if (!slot->buf || slot->buf->params.size < size ||
+        slot->buf->params.size > 4 * buf_size)
+    {
+        if (slot->buf)
+            gl_buf_destroy(gpu, slot->buf);
+        slot->buf = gl_buf_create(gpu, pl_buf_params(
+            .size = buf_size,
+            .host_mapped = true,
+            .memory_type = PL_BUF_MEM_HOST,
+        ));
+        if (!slot->buf)
+            return NULL;
+    }
+
+    return slot;
+}
+
+static bool use_xfer_ring(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    if (params->buf || !p->has_buf_storage)
+        return false;
+
+    // Prefer importing the host pointer directly, if possible
+    bool can_import = gpu->import_caps.buf & PL_HANDLE_HOST_PTR;
+    if (can_import && params->callback && !params->no_import)
+        return false;
+
+    size_t size = pl_tex_transfer_size(params);
+    return size >= XFER_MIN_SIZE && size <= XFER_MAX_SIZE;
+}
+
+static bool tex_upload_ring(pl_gpu gpu, const struct pl_tex_transfer_params *params,
+                            struct gl_xfer_slot *slot)
+{
+    memcpy(slot->buf->data, params->ptr, pl_tex_transfer_size(params));
+
+    struct pl_tex_transfer_params fixed = *params;
+    fixed.ptr = NULL;
+    fixed.buf = slot->buf;
+    fixed.buf_offset = 0;
+    fixed.callback = NULL;
+    if (!gl_tex_upload(gpu, &fixed))
+        return false;
+
+    // The host memory is no longer needed once it has been copied, so there
+    // is no need to wait for the upload itself to complete
+    if (params->callback)
+        params->callback(params->priv);
+    return true;
+}
+
+struct xfer_download {
+    struct gl_xfer_slot *slot;
+    void *ptr;
+    size_t size;
+    void (*callback)(void *priv);
+    void *priv;
+};
+
+static void xfer_download_cb(void *priv)
+{
+    struct xfer_download *dl = priv;
+    memcpy(dl->ptr, dl->slot->buf->data, dl->size);
+    dl->slot->pending = false;
+    dl->callback(dl->priv);
+    pl_free(dl);
+}
+
+static bool tex_download_ring(pl_gpu gpu, const struct pl_tex_transfer_params *params,
+                              struct gl_xfer_slot *slot)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+
+    // Register the callback ourselves, only once the download succeeded, so
+    // that a failure can't leave the slot pending forever
+    struct pl_tex_transfer_params fixed = *params;
+    fixed.ptr = NULL;
+    fixed.buf = slot->buf;
+    fixed.buf_offset = 0;
+    fixed.callback = NULL;
+    if (!gl_tex_download(gpu, &fixed))
+        return false;
+
+    slot->pending = true;
+    PL_ARRAY_APPEND(gpu, p->callbacks, (struct gl_cb) {
+        .sync = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+        .callback = xfer_download_cb,
+        .priv = pl_alloc_struct(NULL, struct xfer_download, {
+            .slot = slot,
+            .ptr = params->ptr,
+            .size = pl_tex_transfer_size(params),
+            .callback = params->callback,
+            .priv = params->priv,
+        }),
+    });
+    return true;
+}
+
 bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
@@ -893,6 +1025,25 @@ bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     struct pl_tex_gl *tex_gl = PL_PRIV(tex);
     struct pl_buf_gl *buf_gl = buf ? PL_PRIV(buf) : NULL;
 
+    // Uploads from registered host memory can skip the copy altogether
+    if (!buf && !params->no_import && (gpu->import_caps.buf & PL_HANDLE_HOST_PTR)) {
+        size_t offset;
+        if (pl_gpu_host_mem_get(gpu, params->ptr, pl_tex_transfer_size(params), &offset))
+            return pl_tex_upload_pbo(gpu, params);
+    }
+
+    // Stage uploads from host memory through the persistently mapped ring, so
+    // the driver does not need to make a synchronous copy of its own
+    if (use_xfer_ring(gpu, params)) {
+        if (!MAKE_CURRENT())
+            return false;
+        struct gl_xfer_slot *slot = xfer_slot_get(gpu, pl_tex_transfer_size(params));
+        bool ok = slot && tex_upload_ring(gpu, params, slot);
+        RELEASE_CURRENT();
+        if (slot)
+            return ok;
+    }
+
     // If the user requests asynchronous uploads, it's more efficient to do
     // them via a PBO - this allows us to skip blocking the caller, especially
     // when the host pointer can be imported directly.
@@ -1002,6 +1153,18 @@ bool gl_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     struct pl_buf_gl *buf_gl = buf ? PL_PRIV(buf) : NULL;
     bool ok = true;
 
+    // Asynchronous downloads are staged through the ring as well, and copied
+    // out to host memory once complete
+    if (params->callback && use_xfer_ring(gpu, params)) {
+        if (!MAKE_CURRENT())
+            return false;
+        struct gl_xfer_slot *slot = xfer_slot_get(gpu, pl_tex_transfer_size(params));
+        bool ring_ok = slot && tex_download_ring(gpu, params, slot);
+        RELEASE_CURRENT();
+        if (slot)
+            return ring_ok;
+    }
+
     if (params->callback && !buf) {
         size_t buf_size = pl_tex_transfer_size(params);
         const size_t min_size = 32*1024; // 32 KiB
@@ -580,6 +580,8 @@ static bool parse_preset(opt_ctx p, pl_str str, void *out)
                 params->num_hooks = prev.num_hooks;
                 params->info_callback = prev.info_callback;
                 params->info_priv = prev.info_priv;
+                params->span_callback = prev.span_callback;
+                params->span_priv = prev.span_priv;
             } else {
                 memcpy(out, priv->presets[i].val, priv->size);
             }
@@ -1150,7 +1152,12 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_INT("lut_entries", "Scaler LUT entries", params.lut_entries, .max = 256, .deprecated = true),
     OPT_FLOAT("polar_cutoff", "Polar LUT cutoff", params.polar_cutoff, .max = 1.0, .deprecated = true),
     OPT_BOOL("preserve_mixing_cache", "Preserve mixing cache", params.preserve_mixing_cache),
+    OPT_BOOL("mixing_cache_reduced_precision", "Reduced precision mixing cache", params.mixing_cache_reduced_precision),
     OPT_BOOL("skip_caching_single_frame", "Skip caching single frame", params.skip_caching_single_frame),
+    OPT_INT("output_tile_size", "Output tile size", params.output_tile_size, .max = 16384),
+    OPT_BOOL("skip_redundant_frames", "Skip redundant frames", params.skip_redundant_frames),
+    OPT_BOOL("partial_overlay_updates", "Partial overlay updates", params.partial_overlay_updates),
+    OPT_BOOL("batch_overlays", "Batch overlays", params.batch_overlays),
     OPT_BOOL("disable_linear_scaling", "Disable linear scaling", params.disable_linear_scaling),
     OPT_BOOL("disable_builtin_scalers", "Disable built-in scalers", params.disable_builtin_scalers),
     OPT_BOOL("correct_subpixel_offset", "Correct subpixel offsets", params.correct_subpixel_offsets),
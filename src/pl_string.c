@@ -113,21 +113,6 @@ size_t pl_strcspn(pl_str str, const char *reject)
     return str.len;
 }
 
-static inline bool pl_isspace(char c)
-{
-    switch (c) {
-    case ' ':
-    case '\n':
-    case '\r':
-    case '\t':
-    case '\v':
-    case '\f':
-        return true;
-    default:
-        return false;
-    }
-}
-
 pl_str pl_str_strip(pl_str str)
 {
     while (str.len && pl_isspace(str.buf[0])) {
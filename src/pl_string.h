@@ -113,11 +113,32 @@ bool pl_str_parse_uint64(pl_str str, uint64_t *out);
 bool pl_str_parse_float(pl_str str, float *out);
 bool pl_str_parse_double(pl_str str, double *out);
 
+// Parses up to `num` whitespace-separated floats from the start of `str`,
+// stopping at the first value that fails parsing. Returns the number of
+// values successfully parsed, and advances `str` to the first unparsed byte.
+// Faster than calling `pl_str_parse_float` on each value individually.
+size_t pl_str_parse_floats(pl_str *str, float *out, size_t num);
+
 // Variants of string.h functions
 int pl_strchr(pl_str str, int c);
 size_t pl_strspn(pl_str str, const char *accept);
 size_t pl_strcspn(pl_str str, const char *reject);
 
+static inline bool pl_isspace(char c)
+{
+    switch (c) {
+    case ' ':
+    case '\n':
+    case '\r':
+    case '\t':
+    case '\v':
+    case '\f':
+        return true;
+    default:
+        return false;
+    }
+}
+
 // Strip leading/trailing whitespace
 pl_str pl_str_strip(pl_str str);
 
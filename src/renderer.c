@@ -33,6 +33,7 @@ struct cached_frame {
     pl_rect2df crop;
     pl_tex tex;
     int comps;
+    uint64_t last_used; // for LRU eviction
     bool evict; // for garbage collection
 };
 
@@ -47,6 +48,19 @@ struct osd_vertex {
     float color[4];
 };
 
+// Overlay texture atlas (for `batch_overlays`), one per texture format
+struct atlas_entry {
+    pl_tex src;
+    pl_rect2d rc; // position of `src` inside the atlas
+};
+
+struct overlay_atlas {
+    pl_fmt fmt;
+    pl_tex tex;
+    PL_ARRAY(struct atlas_entry) entries; // sorted by `src`
+    int shelf_x, shelf_y, shelf_h; // state of the shelf packer
+};
+
 struct icc_state {
     pl_icc_object icc;
     uint64_t error; // set to profile signature on failure
@@ -56,6 +70,7 @@ struct pl_renderer_t {
     pl_gpu gpu;
     pl_dispatch dp;
     pl_log log;
+    pl_clock_t epoch; // reference point for `pl_render_span.start`
 
     // Cached feature checks (inverted)
     enum pl_render_error errors;
@@ -69,7 +84,8 @@ struct pl_renderer_t {
     pl_shader_obj grain_state[4];
     pl_shader_obj lut_state[3];
     pl_shader_obj icc_state[2];
-    PL_ARRAY(pl_tex) fbos;
+    pl_tex_pool fbos;       // intermediate textures, see `pl_renderer_set_tex_pool`
+    pl_tex_pool own_fbos;   // internal pool, used unless overridden
     struct sampler sampler_main;
     struct sampler sampler_contrast;
     struct sampler samplers_src[4];
@@ -79,10 +95,24 @@ struct pl_renderer_t {
     PL_ARRAY(struct osd_vertex) osd_vertices;
     PL_ARRAY(uint16_t) osd_indices;
     struct pl_vertex_attrib osd_attribs[3];
+    PL_ARRAY(struct overlay_atlas) atlases;
 
     // Frame cache (for frame mixing / interpolation)
     PL_ARRAY(struct cached_frame) frames;
     PL_ARRAY(pl_tex) frame_fbos;
+    uint64_t frame_tick;
+
+    // Previous output of `pl_render_image_mix` (for `skip_redundant_frames`)
+    pl_tex prev_output;
+    uint64_t prev_output_key;
+    uint64_t frames_rendered;
+    uint64_t frames_reused;
+
+    // Output of `pl_render_image` before drawing overlays, and the region
+    // covered by overlays since (for `partial_overlay_updates`)
+    pl_tex base_output;
+    uint64_t base_key;
+    pl_rect2d base_dirty;
 
     // For debugging / logging purposes
     int prev_dither;
@@ -111,6 +141,8 @@ pl_renderer pl_renderer_create(pl_log log, pl_gpu gpu)
         .gpu  = gpu,
         .log = log,
         .dp  = pl_dispatch_create(log, gpu),
+        .epoch = pl_clock_now(),
+        .own_fbos = pl_tex_pool_create(gpu, NULL),
         .osd_attribs = {
             {
                 .name = "pos",
@@ -129,6 +161,17 @@ pl_renderer pl_renderer_create(pl_log log, pl_gpu gpu)
     };
 
     assert(rr->dp);
+    rr->fbos = rr->own_fbos;
+
+    // Without push constants, every changed dynamic variable costs a separate
+    // uniform update per pass, so write them out as whole UBOs instead
+    const struct pl_gpu_limits *limits = &gpu->limits;
+    if (!limits->max_pushc_size && limits->max_variable_comps &&
+        limits->max_ubo_size && gpu->glsl.version >= 440)
+    {
+        pl_dispatch_batch_uniforms(rr->dp, true);
+    }
+
     return rr;
 }
 
@@ -145,12 +188,15 @@ void pl_renderer_destroy(pl_renderer *p_rr)
         return;
 
     // Free all intermediate FBOs
-    for (int i = 0; i < rr->fbos.num; i++)
-        pl_tex_destroy(rr->gpu, &rr->fbos.elem[i]);
+    pl_tex_pool_destroy(&rr->own_fbos);
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     for (int i = 0; i < rr->frame_fbos.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frame_fbos.elem[i]);
+    pl_tex_destroy(rr->gpu, &rr->prev_output);
+    pl_tex_destroy(rr->gpu, &rr->base_output);
+    for (int i = 0; i < rr->atlases.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->atlases.elem[i].tex);
 
     // Free all shader resource objects
     pl_shader_obj_destroy(&rr->tone_map_state);
@@ -178,6 +224,13 @@ void pl_renderer_destroy(pl_renderer *p_rr)
     pl_free_ptr(p_rr);
 }
 
+void pl_renderer_set_tex_pool(pl_renderer rr, pl_tex_pool pool)
+{
+    rr->fbos = PL_DEF(pool, rr->own_fbos);
+    if (pool)
+        pl_tex_pool_flush(rr->own_fbos);
+}
+
 size_t pl_renderer_save(pl_renderer rr, uint8_t *out)
 {
     return pl_cache_save(pl_gpu_cache(rr->gpu), out, out ? SIZE_MAX : 0);
@@ -193,6 +246,14 @@ void pl_renderer_flush_cache(pl_renderer rr)
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     rr->frames.num = 0;
+    pl_tex_destroy(rr->gpu, &rr->prev_output);
+    rr->prev_output_key = 0;
+    pl_tex_destroy(rr->gpu, &rr->base_output);
+    rr->base_key = 0;
+    for (int i = 0; i < rr->atlases.num; i++) {
+        pl_tex_destroy(rr->gpu, &rr->atlases.elem[i].tex);
+        rr->atlases.elem[i].entries.num = 0;
+    }
 
     pl_reset_detected_peak(rr->tone_map_state);
 }
@@ -262,6 +323,10 @@ struct img {
     enum pl_render_error err_enum;
     pl_tex err_tex;
 
+    // Intermediate texture sampled by `sh`, to be released as soon as `sh`
+    // has been dispatched (see `pass_state.alias_fbos`)
+    pl_tex consumed;
+
     // Current effective source area, will be sampled by the main scaler
     pl_rect2df rect;
 
@@ -349,6 +414,12 @@ struct pass_state {
     // Integer version of `target.crop`. Semantically identical.
     pl_rect2d dst_rect;
 
+    // If set, only this region of the target is rendered (see
+    // `output_tile_size`), and `src_full` holds the source rect of the
+    // entire (untiled) output, to which the tile's padding is clipped.
+    pl_rect2d tile;
+    pl_rect2df src_full;
+
     // Logical end-to-end rotation
     pl_rotation rotation;
 
@@ -364,11 +435,19 @@ struct pass_state {
     enum plane_type src_type[4];
     int src_ref, dst_ref; // index into `planes`
 
-    // Metadata for `rr->fbos`
+    // Intermediate textures acquired from `rr->fbos` by this pass
     pl_fmt fbofmt[5];
-    bool *fbos_used;
+    PL_ARRAY(pl_tex) fbos;
+    bool alias_fbos;    // release textures as soon as they're consumed
     bool need_peak_fbo; // need indirection for peak detection
 
+    // State for `pl_render_image_multi`
+    int num_shared;     // number of targets sharing the passes being dispatched
+    bool peak_done;     // peak detection was already run on the shared image
+
+    // If set, receives a copy of the output before any overlays are drawn
+    pl_tex pre_overlays;
+
     // Map of acquired frames
     struct {
         bool target, image, prev, next;
@@ -428,14 +507,81 @@ static void find_fbo_format(struct pass_state *pass)
     rr->errors |= PL_RENDER_ERR_FBO;
 }
 
+static inline uint64_t clock_ns(pl_renderer rr, pl_clock_t t)
+{
+    return pl_clock_diff(t, rr->epoch) * 1e9;
+}
+
+// Reports a span of CPU work lasting from `start` until now
+static void report_span(pl_renderer rr, const struct pl_render_params *params,
+                        enum pl_render_span_type type,
+                        enum pl_render_stage stage,
+                        const char *name, pl_clock_t start)
+{
+    if (!params->span_callback)
+        return;
+
+    pl_clock_t now = pl_clock_now();
+    params->span_callback(params->span_priv, &(struct pl_render_span) {
+        .name       = name,
+        .type       = type,
+        .stage      = stage,
+        .start      = clock_ns(rr, start),
+        .cpu_time   = pl_clock_diff(now, start) * 1e9,
+    });
+}
+
+static void report_pass_spans(struct pass_state *pass,
+                              const struct pl_dispatch_info *dinfo)
+{
+    const struct pl_render_params *params = pass->params;
+    const uint64_t now = clock_ns(pass->rr, pl_clock_now());
+    struct pl_render_span span = {
+        .name       = dinfo->shader->description,
+        .stage      = pass->info.stage,
+        .signature  = dinfo->signature,
+    };
+
+    // LUTs were generated before compiling, which happened right before
+    // executing the pass
+    uint64_t start = now - PL_MIN(now, dinfo->compile_time + dinfo->lut_time);
+    if (dinfo->lut_time) {
+        span.type = PL_RENDER_SPAN_LUT;
+        span.start = start;
+        span.cpu_time = dinfo->lut_time;
+        params->span_callback(params->span_priv, &span);
+        start += dinfo->lut_time;
+    }
+
+    if (dinfo->compile_time) {
+        span.type = PL_RENDER_SPAN_COMPILE;
+        span.start = start;
+        span.cpu_time = dinfo->compile_time;
+        params->span_callback(params->span_priv, &span);
+    }
+
+    span.type = PL_RENDER_SPAN_PASS;
+    span.start = now;
+    span.cpu_time = 0;
+    span.gpu_time = dinfo->last;
+    params->span_callback(params->span_priv, &span);
+}
+
 static void info_callback(void *priv, const struct pl_dispatch_info *dinfo)
 {
     struct pass_state *pass = priv;
     const struct pl_render_params *params = pass->params;
+    if (params->span_callback)
+        report_pass_spans(pass, dinfo);
     if (!params->info_callback)
         return;
 
     pass->info.pass = dinfo;
+    pass->info.time_saved = 0;
+    if (pass->num_shared > 1)
+        pass->info.time_saved = dinfo->last * (pass->num_shared - 1);
+    pass->info.frames_rendered = pass->rr->frames_rendered;
+    pass->info.frames_reused = pass->rr->frames_reused;
     params->info_callback(params->info_priv, &pass->info);
     pass->info.index++;
 }
@@ -460,38 +606,24 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
         .debug_tag  = debug_tag,
     };
 
-    int best_idx = -1;
-    int best_diff = 0;
-
-    // Find the best-fitting texture out of rr->fbos
-    for (int i = 0; i < rr->fbos.num; i++) {
-        if (pass->fbos_used[i])
-            continue;
-
-        // Orthogonal distance, with penalty for format mismatches
-        int diff = abs(rr->fbos.elem[i]->params.w - w) +
-                   abs(rr->fbos.elem[i]->params.h - h) +
-                   ((rr->fbos.elem[i]->params.format != fmt) ? 1000 : 0);
+    pl_tex tex = pl_tex_pool_acquire(rr->fbos, &params);
+    if (tex)
+        PL_ARRAY_APPEND(pass->tmp, pass->fbos, tex);
+    return tex;
+}
 
-        if (best_idx < 0 || diff < best_diff) {
-            best_idx = i;
-            best_diff = diff;
+// Return `tex` to the pool early, if it was acquired by this pass. Since it
+// may be handed out again immediately, the caller must ensure that all
+// shaders referencing it have already been dispatched.
+static void release_fbo(struct pass_state *pass, pl_tex tex)
+{
+    for (int i = 0; i < pass->fbos.num; i++) {
+        if (pass->fbos.elem[i] == tex) {
+            pl_tex_pool_release(pass->rr->fbos, &pass->fbos.elem[i]);
+            PL_ARRAY_REMOVE_AT(pass->fbos, i);
+            return;
         }
     }
-
-    // No texture found at all, add a new one
-    if (best_idx < 0) {
-        best_idx = rr->fbos.num;
-        PL_ARRAY_APPEND(rr, rr->fbos, NULL);
-        pl_grow(pass->tmp, &pass->fbos_used, rr->fbos.num * sizeof(bool));
-        pass->fbos_used[best_idx] = false;
-    }
-
-    if (!pl_tex_recreate(rr->gpu, &rr->fbos.elem[best_idx], &params))
-        return NULL;
-
-    pass->fbos_used[best_idx] = true;
-    return rr->fbos.elem[best_idx];
 }
 
 // Forcibly convert an img to `tex`, dispatching where necessary
@@ -527,6 +659,10 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
     img->err_enum = PL_RENDER_ERR_NONE;
     img->err_tex = NULL;
 
+    if (img->consumed && pass->alias_fbos)
+        release_fbo(pass, img->consumed);
+    img->consumed = NULL;
+
     if (!ok) {
         PL_ERR(rr, "%s", PL_DEF(err_msg, "Failed dispatching intermediate pass!"));
         rr->errors |= err_enum;
@@ -535,6 +671,7 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
         return img->tex;
     }
 
+    pass->info.passes_unfused++;
     img->tex = tex;
     return img->tex;
 }
@@ -800,26 +937,12 @@ static void swizzle_color(pl_shader sh, int comps, const int comp_map[4],
         GLSL("color.a = "$".a; \n", orig);
 }
 
-// `scale` adapts from `pass->dst_rect` to the plane being rendered to
-static void draw_overlays(struct pass_state *pass, pl_tex fbo,
-                          int comps, const int comp_map[4],
-                          const struct pl_overlay *overlays, int num,
-                          struct pl_color_space color, struct pl_color_repr repr,
-                          const pl_transform2x2 *output_shift)
+// Computes the transformation from the coordinates of `ol` to the coordinates
+// of the (unrotated) target frame. Returns false if the overlay is not visible
+static bool overlay_transform(const struct pass_state *pass,
+                              const struct pl_overlay *ol, bool is_target,
+                              pl_transform2x2 *out)
 {
-    pl_renderer rr = pass->rr;
-    if (num <= 0 || (rr->errors & PL_RENDER_ERR_OVERLAY))
-        return;
-
-    enum pl_fmt_caps caps = fbo->params.format->caps;
-    if (!(rr->errors & PL_RENDER_ERR_BLENDING) &&
-        !(caps & PL_FMT_CAP_BLENDABLE))
-    {
-        PL_WARN(rr, "Trying to draw an overlay to a non-blendable target. "
-                "Alpha blending is disabled, results may be incorrect!");
-        rr->errors |= PL_RENDER_ERR_BLENDING;
-    }
-
     const struct pl_frame *image = pass->src_ref >= 0 ? &pass->image : NULL;
     pl_transform2x2 src_to_dst;
     if (image) {
@@ -839,89 +962,328 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
         }
     }
 
-    const struct pl_frame *target = &pass->target;
-    pl_rect2df dst_crop = target->crop;
-    pl_rect2df_rotate(&dst_crop, -pass->rotation);
-    pl_rect2df_normalize(&dst_crop);
+    enum pl_overlay_coords coords = ol->coords;
+    if (!coords)
+        coords = is_target ? PL_OVERLAY_COORDS_DST_FRAME : PL_OVERLAY_COORDS_SRC_FRAME;
 
-    for (int n = 0; n < num; n++) {
-        struct pl_overlay ol = overlays[n];
-        if (!ol.num_parts)
-            continue;
+    pl_transform2x2 tf = pl_transform2x2_identity;
+    switch (coords) {
+        case PL_OVERLAY_COORDS_SRC_CROP:
+            if (!image)
+                return false;
+            tf.c[0] = image->crop.x0;
+            tf.c[1] = image->crop.y0;
+            // fall through
+        case PL_OVERLAY_COORDS_SRC_FRAME:
+            if (!image)
+                return false;
+            pl_transform2x2_rmul(&src_to_dst, &tf);
+            break;
+        case PL_OVERLAY_COORDS_DST_CROP:;
+            pl_rect2df dst_crop = pass->target.crop;
+            pl_rect2df_rotate(&dst_crop, -pass->rotation);
+            pl_rect2df_normalize(&dst_crop);
+            tf.c[0] = dst_crop.x0;
+            tf.c[1] = dst_crop.y0;
+            break;
+        case PL_OVERLAY_COORDS_DST_FRAME:
+            break;
+        case PL_OVERLAY_COORDS_AUTO:
+        case PL_OVERLAY_COORDS_COUNT:
+            pl_unreachable();
+    }
+
+    *out = tf;
+    return true;
+}
+
+#define ATLAS_MIN_SIZE 1024
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_PADDING  1
+
+static struct overlay_atlas *atlas_get(pl_renderer rr, pl_tex src)
+{
+    pl_fmt fmt = src->params.format;
+    int max_size = PL_MIN(rr->gpu->limits.max_tex_2d_dim, ATLAS_MAX_SIZE);
+    if (src->params.w > max_size / 4 || src->params.h > max_size / 4 || src->params.d)
+        return NULL; // big overlays gain little from batching
+
+    for (int i = 0; i < rr->atlases.num; i++) {
+        if (rr->atlases.elem[i].fmt == fmt)
+            return &rr->atlases.elem[i];
+    }
+
+    // The atlas needs to be cleared, and filled either by blitting or by
+    // rendering to it
+    enum pl_fmt_caps caps = PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_BLITTABLE;
+    if ((fmt->caps & caps) != caps || fmt->type == PL_FMT_UINT || fmt->type == PL_FMT_SINT)
+        return NULL;
+
+    PL_ARRAY_APPEND(rr, rr->atlases, (struct overlay_atlas) { .fmt = fmt });
+    return &rr->atlases.elem[rr->atlases.num - 1];
+}
 
-        if (!ol.coords) {
-            ol.coords = overlays == target->overlays
-                            ? PL_OVERLAY_COORDS_DST_FRAME
-                            : PL_OVERLAY_COORDS_SRC_FRAME;
+static int atlas_find(const struct overlay_atlas *atlas, pl_tex src)
+{
+    int lo = 0, hi = atlas->entries.num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if ((uintptr_t) atlas->entries.elem[mid].src < (uintptr_t) src) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
+    }
+    return lo;
+}
 
-        pl_transform2x2 tf = pl_transform2x2_identity;
-        switch (ol.coords) {
-            case PL_OVERLAY_COORDS_SRC_CROP:
-                if (!image)
-                    continue;
-                tf.c[0] = image->crop.x0;
-                tf.c[1] = image->crop.y0;
-                // fall through
-            case PL_OVERLAY_COORDS_SRC_FRAME:
-                if (!image)
-                    continue;
-                pl_transform2x2_rmul(&src_to_dst, &tf);
-                break;
-            case PL_OVERLAY_COORDS_DST_CROP:
-                tf.c[0] = dst_crop.x0;
-                tf.c[1] = dst_crop.y0;
-                break;
-            case PL_OVERLAY_COORDS_DST_FRAME:
+static const struct atlas_entry *atlas_lookup(const struct overlay_atlas *atlas,
+                                              pl_tex src)
+{
+    int idx = atlas_find(atlas, src);
+    if (idx < atlas->entries.num && atlas->entries.elem[idx].src == src)
+        return &atlas->entries.elem[idx];
+    return NULL;
+}
+
+// Drops all entries, (re)creating the atlas texture with the given size
+static bool atlas_reset(pl_renderer rr, struct overlay_atlas *atlas, int size)
+{
+    atlas->entries.num = 0;
+    atlas->shelf_x = atlas->shelf_y = atlas->shelf_h = 0;
+    bool ok = pl_tex_recreate(rr->gpu, &atlas->tex, pl_tex_params(
+        .w          = size,
+        .h          = size,
+        .format     = atlas->fmt,
+        .sampleable = true,
+        .renderable = atlas->fmt->caps & PL_FMT_CAP_RENDERABLE,
+        .blit_dst   = true,
+        .debug_tag  = PL_DEBUG_TAG,
+    ));
+    if (!ok)
+        return false;
+
+    // Ensures the padding between entries is transparent
+    pl_tex_clear_ex(rr->gpu, atlas->tex, (union pl_clear_color) {0});
+    return true;
+}
+
+// Adds `src` to the atlas, if it's not already present
+static bool atlas_add(struct pass_state *pass, struct overlay_atlas *atlas,
+                      pl_tex src)
+{
+    pl_renderer rr = pass->rr;
+    int idx = atlas_find(atlas, src);
+    if (idx < atlas->entries.num && atlas->entries.elem[idx].src == src)
+        return true;
+
+    if (!atlas->tex && !atlas_reset(rr, atlas, ATLAS_MIN_SIZE))
+        return false;
+
+    // Simple shelf packing, which works well for the typical case of many
+    // glyphs of similar height
+    const int w = src->params.w + ATLAS_PADDING, h = src->params.h + ATLAS_PADDING;
+    const int size = atlas->tex->params.w;
+    if (atlas->shelf_x + w > size) {
+        atlas->shelf_y += atlas->shelf_h;
+        atlas->shelf_x = atlas->shelf_h = 0;
+    }
+    if (atlas->shelf_y + h > size)
+        return false;
+
+    pl_rect2d rc = {
+        .x0 = atlas->shelf_x,
+        .y0 = atlas->shelf_y,
+        .x1 = atlas->shelf_x + src->params.w,
+        .y1 = atlas->shelf_y + src->params.h,
+    };
+
+    if (src->params.blit_src && src->params.format == atlas->fmt) {
+        pl_tex_blit(rr->gpu, pl_tex_blit_params(
+            .src = src,
+            .dst = atlas->tex,
+            .dst_rc = { rc.x0, rc.y0, 0, rc.x1, rc.y1, 1 },
+        ));
+    } else if (atlas->tex->params.renderable) {
+        pl_shader sh = pl_dispatch_begin(rr->dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+        bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = atlas->tex,
+            .rect   = rc,
+        ));
+        if (!ok)
+            return false;
+    } else {
+        return false;
+    }
+
+    atlas->shelf_x += w;
+    atlas->shelf_h = PL_MAX(atlas->shelf_h, h);
+    PL_ARRAY_INSERT_AT(rr, atlas->entries, idx, (struct atlas_entry) {
+        .src = src,
+        .rc  = rc,
+    });
+    return true;
+}
+
+// Ensures all overlay textures which can be batched are present in their
+// respective atlases, growing or flushing atlases as needed
+static void atlas_prepare(struct pass_state *pass,
+                          const struct pl_overlay *overlays, int num)
+{
+    pl_renderer rr = pass->rr;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        struct overlay_atlas *full = NULL;
+        for (int n = 0; n < num; n++) {
+            const struct pl_overlay *ol = &overlays[n];
+            struct overlay_atlas *atlas = ol->num_parts ? atlas_get(rr, ol->tex) : NULL;
+            if (atlas && !atlas_add(pass, atlas, ol->tex)) {
+                full = atlas;
                 break;
-            case PL_OVERLAY_COORDS_AUTO:
-            case PL_OVERLAY_COORDS_COUNT:
-                pl_unreachable();
+            }
+        }
+
+        if (!full)
+            return;
+
+        // Start over with an empty (and possibly larger) atlas
+        int size = full->tex ? full->tex->params.w : ATLAS_MIN_SIZE;
+        if (attempt > 0)
+            size = PL_MIN(size * 2, PL_MIN(rr->gpu->limits.max_tex_2d_dim, ATLAS_MAX_SIZE));
+        PL_TRACE(rr, "Overlay atlas full, resetting with size %d", size);
+        if (!atlas_reset(rr, full, size))
+            break;
+    }
+
+    // Give up, overlays not in the atlas are drawn individually
+    PL_TRACE(rr, "Failed packing overlay atlas, drawing unbatched");
+}
+
+// `scale` adapts from `pass->dst_rect` to the plane being rendered to
+static void draw_overlays(struct pass_state *pass, pl_tex fbo,
+                          int comps, const int comp_map[4],
+                          const struct pl_overlay *overlays, int num,
+                          struct pl_color_space color, struct pl_color_repr repr,
+                          const pl_transform2x2 *output_shift)
+{
+    pl_renderer rr = pass->rr;
+    if (num <= 0 || (rr->errors & PL_RENDER_ERR_OVERLAY))
+        return;
+
+    enum pl_fmt_caps caps = fbo->params.format->caps;
+    if (!(rr->errors & PL_RENDER_ERR_BLENDING) &&
+        !(caps & PL_FMT_CAP_BLENDABLE))
+    {
+        PL_WARN(rr, "Trying to draw an overlay to a non-blendable target. "
+                "Alpha blending is disabled, results may be incorrect!");
+        rr->errors |= PL_RENDER_ERR_BLENDING;
+    }
+
+    const struct pl_frame *target = &pass->target;
+    const bool is_target = overlays == target->overlays;
+    if (pass->params->batch_overlays)
+        atlas_prepare(pass, overlays, num);
+
+    for (int n = 0; n < num; ) {
+        struct pl_overlay ol = overlays[n];
+        if (!ol.num_parts) {
+            n++;
+            continue;
         }
 
-        if (output_shift)
-            pl_transform2x2_rmul(output_shift, &tf);
+        // Consecutive overlays with compatible parameters whose textures are
+        // all in the same atlas can be drawn in a single pass
+        const struct overlay_atlas *atlas = NULL;
+        if (pass->params->batch_overlays) {
+            atlas = atlas_get(rr, ol.tex);
+            if (atlas && !atlas_lookup(atlas, ol.tex))
+                atlas = NULL;
+        }
 
         // Construct vertex/index buffers
         rr->osd_vertices.num = 0;
         rr->osd_indices.num = 0;
-        for (int i = 0; i < ol.num_parts; i++) {
-            const struct pl_overlay_part *part = &ol.parts[i];
+        int end = n;
+        do {
+            const struct pl_overlay *cur = &overlays[end];
+            if (end > n) {
+                if (!cur->num_parts) {
+                    end++;
+                    continue;
+                }
+                if (!atlas || cur->mode != ol.mode ||
+                    !pl_color_repr_equal(&cur->repr, &ol.repr) ||
+                    !pl_color_space_equal(&cur->color, &ol.color) ||
+                    cur->tex->params.format != atlas->fmt)
+                {
+                    break;
+                }
+                // Indices are 16-bit
+                if (rr->osd_vertices.num + 4 * cur->num_parts > UINT16_MAX + 1)
+                    break;
+            }
+
+            const struct atlas_entry *entry = NULL;
+            if (atlas && !(entry = atlas_lookup(atlas, cur->tex)))
+                break;
+            end++;
+
+            pl_transform2x2 tf;
+            if (!overlay_transform(pass, cur, is_target, &tf))
+                continue;
+            if (output_shift)
+                pl_transform2x2_rmul(output_shift, &tf);
+
+            // Texture coordinates, relative to the atlas if used
+            pl_tex src_tex = atlas ? atlas->tex : cur->tex;
+            const float ox = entry ? entry->rc.x0 : 0.0f,
+                        oy = entry ? entry->rc.y0 : 0.0f;
+
+            for (int i = 0; i < cur->num_parts; i++) {
+                const struct pl_overlay_part *part = &cur->parts[i];
 
 #define EMIT_VERT(x, y)                                                         \
-            do {                                                                \
-                float pos[2] = { part->dst.x, part->dst.y };                    \
-                pl_transform2x2_apply(&tf, pos);                                \
-                PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) {     \
-                    .pos = {                                                    \
-                        2.0 * (pos[0] / fbo->params.w) - 1.0,                   \
-                        2.0 * (pos[1] / fbo->params.h) - 1.0,                   \
-                    },                                                          \
-                    .coord = {                                                  \
-                        part->src.x / ol.tex->params.w,                         \
-                        part->src.y / ol.tex->params.h,                         \
-                    },                                                          \
-                    .color = {                                                  \
-                        part->color[0], part->color[1],                         \
-                        part->color[2], part->color[3],                         \
-                    },                                                          \
-                });                                                             \
-            } while (0)
-
-            int idx_base = rr->osd_vertices.num;
-            EMIT_VERT(x0, y0); // idx 0: top left
-            EMIT_VERT(x1, y0); // idx 1: top right
-            EMIT_VERT(x0, y1); // idx 2: bottom left
-            EMIT_VERT(x1, y1); // idx 3: bottom right
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 0);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 3);
-        }
+                do {                                                            \
+                    float pos[2] = { part->dst.x, part->dst.y };                \
+                    pl_transform2x2_apply(&tf, pos);                            \
+                    PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) { \
+                        .pos = {                                                \
+                            2.0 * (pos[0] / fbo->params.w) - 1.0,               \
+                            2.0 * (pos[1] / fbo->params.h) - 1.0,               \
+                        },                                                      \
+                        .coord = {                                              \
+                            (ox + part->src.x) / src_tex->params.w,             \
+                            (oy + part->src.y) / src_tex->params.h,             \
+                        },                                                      \
+                        .color = {                                              \
+                            part->color[0], part->color[1],                     \
+                            part->color[2], part->color[3],                     \
+                        },                                                      \
+                    });                                                         \
+                } while (0)
+
+                int idx_base = rr->osd_vertices.num;
+                EMIT_VERT(x0, y0); // idx 0: top left
+                EMIT_VERT(x1, y0); // idx 1: top right
+                EMIT_VERT(x0, y1); // idx 2: bottom left
+                EMIT_VERT(x1, y1); // idx 3: bottom right
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 0);
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
+                PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 3);
+            }
+        } while (atlas && end < num);
+
+        pl_assert(end > n);
+        n = end;
+        if (!rr->osd_indices.num)
+            continue;
 
         // Draw parts
+        pl_tex src_tex = atlas ? atlas->tex : ol.tex;
         pl_shader sh = pl_dispatch_begin(rr->dp);
         ident_t tex = sh_desc(sh, (struct pl_shader_desc) {
             .desc = {
@@ -929,8 +1291,8 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
                 .type = PL_DESC_SAMPLED_TEX,
             },
             .binding = {
-                .object = ol.tex,
-                .sample_mode = (ol.tex->params.format->caps & PL_FMT_CAP_LINEAR)
+                .object = src_tex,
+                .sample_mode = (src_tex->params.format->caps & PL_FMT_CAP_LINEAR)
                     ? PL_TEX_SAMPLE_LINEAR
                     : PL_TEX_SAMPLE_NEAREST,
             },
@@ -956,11 +1318,12 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
             .gamut_mapping         = &pl_gamut_map_saturation,
         };
 
+        struct pl_color_space dst_color = color;
         sh->output = PL_SHADER_SIG_COLOR;
         pl_shader_decode_color(sh, &ol.repr, NULL);
         if (target->icc)
-            color.transfer = PL_COLOR_TRC_LINEAR;
-        pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(ol.color, color));
+            dst_color.transfer = PL_COLOR_TRC_LINEAR;
+        pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(ol.color, dst_color));
         if (target->icc)
             pl_icc_encode(sh, target->icc, &rr->icc_state[ICC_TARGET]);
 
@@ -1071,6 +1434,8 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
         }
 
         case PL_HOOK_SIG_COLOR:
+            if (img->sh)
+                pass->info.passes_fused++;
             hparams.sh = img_sh(pass, img);
             break;
 
@@ -1112,10 +1477,12 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
             };
             break;
 
-        case PL_HOOK_SIG_COLOR:
+        case PL_HOOK_SIG_COLOR: {
+            // Unsized shaders keep the size of the shader they were fused into
+            const int out_w = PL_DEF(res.sh->output_w, img->w),
+                      out_h = PL_DEF(res.sh->output_h, img->h);
             if (!resizable) {
-                if (res.sh->output_w != img->w ||
-                    res.sh->output_h != img->h ||
+                if (out_w != img->w || out_h != img->h ||
                     !pl_rect2d_eq(res.rect, img->rect))
                 {
                     PL_ERR(rr, "User hook tried resizing non-resizable stage!");
@@ -1129,14 +1496,15 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
                 .color    = res.color,
                 .comps    = res.components,
                 .rect     = res.rect,
-                .w        = res.sh->output_w,
-                .h        = res.sh->output_h,
+                .w        = out_w,
+                .h        = out_h,
                 .unique   = img->unique,
                 .err_enum = PL_RENDER_ERR_HOOKS,
                 .err_msg  = "Failed applying user hook",
                 .err_tex  = hparams.tex, // if any
             };
             break;
+        }
 
         case PL_HOOK_SIG_COUNT:
             pl_unreachable();
@@ -1163,6 +1531,8 @@ static void hdr_update_peak(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
     pl_renderer rr = pass->rr;
+    if (pass->peak_done)
+        return;
     if (!params->peak_detect_params || !pl_color_space_is_hdr(&pass->img.color))
         goto cleanup;
 
@@ -1237,6 +1607,7 @@ struct plane_state {
     struct img img; // for per-plane shaders
     pl_fmt fmt; // per-plane format after merge
     float plane_w, plane_h; // logical plane dimensions
+    pl_rect2d roi; // region of the plane texture contributing to the output
 };
 
 static const char *plane_type_names[] = {
@@ -1291,7 +1662,19 @@ static void log_plane_info(pl_renderer rr, const struct plane_state *st)
 }
 
 // Returns true if debanding was applied
-static bool plane_deband(struct pass_state *pass, struct img *img, float neutral[3])
+// Restricts an image covering an entire plane to the given region
+static void img_crop(struct img *img, pl_rect2d roi)
+{
+    img->w = pl_rect_w(roi);
+    img->h = pl_rect_h(roi);
+    img->rect.x0 -= roi.x0;
+    img->rect.y0 -= roi.y0;
+    img->rect.x1 -= roi.x0;
+    img->rect.y1 -= roi.y0;
+}
+
+static bool plane_deband(struct pass_state *pass, struct img *img, pl_rect2d roi,
+                         float neutral[3])
 {
     const struct pl_render_params *params = pass->params;
     const struct pl_frame *image = &pass->image;
@@ -1302,11 +1685,15 @@ static bool plane_deband(struct pass_state *pass, struct img *img, float neutral
         return false;
     }
 
+    // Only deband the region of interest, if any
     struct pl_color_repr repr = img->repr;
     struct pl_sample_src src = {
         .tex = img_tex(pass, img),
         .components = img->comps,
         .scale = pl_color_repr_normalize(&repr),
+        .new_w = pl_rect_w(roi),
+        .new_h = pl_rect_h(roi),
+        .rect = { roi.x0, roi.y0, roi.x1, roi.y1 },
     };
 
     // Divide the deband grain scale by the effective current colorspace nominal
@@ -1324,6 +1711,8 @@ static bool plane_deband(struct pass_state *pass, struct img *img, float neutral
     img->err_enum = PL_RENDER_ERR_DEBANDING;
     img->err_tex = src.tex;
     img->repr = repr;
+    if (pl_rect_w(roi))
+        img_crop(img, roi);
     return true;
 }
 
@@ -1520,8 +1909,148 @@ static bool want_merge(struct pass_state *pass,
     return false;
 }
 
+// Returns the amount of padding needed around `rounded` when rendering a
+// tile, so the main scaler sees the same neighbourhood of source pixels as it
+// would when rendering the entire frame. Clipped to the rounded `full` rect.
+static pl_rect2d tile_padding(struct pass_state *pass, pl_rect2df rc,
+                              pl_rect2d rounded, pl_rect2df full)
+{
+    const float off_x = rc.x0 - rounded.x0, off_y = rc.y0 - rounded.y0;
+    const struct pl_sample_src src = {
+        .new_w  = abs(pl_rect_w(pass->dst_rect)),
+        .new_h  = abs(pl_rect_h(pass->dst_rect)),
+        .rect   = { off_x, off_y, off_x + pl_rect_w(rc), off_y + pl_rect_h(rc) },
+    };
+
+    struct sampler_info info = sample_src_info(pass, &src, SAMPLER_MAIN);
+    if (info.dir == SAMPLER_NOOP)
+        return (pl_rect2d) {0};
+
+    // Downscaling stretches the filter kernel by the scaling ratio
+    float radius = info.config ? pl_filter_radius_bound(info.config) : 1.0f;
+    float ratio = fminf(src.new_w / pl_rect_w(src.rect),
+                        src.new_h / pl_rect_h(src.rect));
+    int pad = ceilf(radius * fmaxf(1.0f / ratio, 1.0f)) + 1;
+
+    pl_rect2d bounds;
+    bounds.x0 = truncf(full.x0);
+    bounds.y0 = truncf(full.y0);
+    bounds.x1 = bounds.x0 + roundf(pl_rect_w(full));
+    bounds.y1 = bounds.y0 + roundf(pl_rect_h(full));
+
+    return (pl_rect2d) {
+        .x0 = PL_CLAMP(rounded.x0 - bounds.x0, 0, pad),
+        .y0 = PL_CLAMP(rounded.y0 - bounds.y0, 0, pad),
+        .x1 = PL_CLAMP(bounds.x1 - rounded.x1, 0, pad),
+        .y1 = PL_CLAMP(bounds.y1 - rounded.y1, 0, pad),
+    };
+}
+
+// Rounds the reference rect to the integer rect of the image produced by
+// `pass_read_image`. For quality reasons, this explicitly drops subpixel
+// offsets from the ref rect (always rounding towards 0), and re-adds them as
+// part of `pass->img.rect`. Additionally, drops anamorphic subpixel mismatches.
+// Returns the padding needed for tiles in `pad`, which is not yet included.
+static pl_rect2d round_ref_rect(struct pass_state *pass, pl_rect2df ref_rc,
+                                pl_rect2d *pad)
+{
+    const struct pl_frame *image = &pass->image;
+    pl_rect2d rounded;
+    rounded.x0 = truncf(ref_rc.x0);
+    rounded.y0 = truncf(ref_rc.y0);
+    rounded.x1 = rounded.x0 + roundf(pl_rect_w(ref_rc));
+    rounded.y1 = rounded.y0 + roundf(pl_rect_h(ref_rc));
+
+    *pad = (pl_rect2d) {0};
+    if (pl_rect_w(pass->tile)) {
+        const pl_rect2df full = {
+            .x0 = ref_rc.x0 + pass->src_full.x0 - image->crop.x0,
+            .y0 = ref_rc.y0 + pass->src_full.y0 - image->crop.y0,
+            .x1 = ref_rc.x1 + pass->src_full.x1 - image->crop.x1,
+            .y1 = ref_rc.y1 + pass->src_full.y1 - image->crop.y1,
+        };
+
+        *pad = tile_padding(pass, ref_rc, rounded, full);
+    }
+
+    return rounded;
+}
+
+// Returns the rect of a plane corresponding to the (padded) integer rect of
+// the reference plane
+static pl_rect2df plane_sample_rect(const struct plane_state *st,
+                                    pl_rect2df ref_rc, pl_rect2d rounded)
+{
+    const float scale_x = pl_rect_w(st->img.rect) / pl_rect_w(ref_rc),
+                scale_y = pl_rect_h(st->img.rect) / pl_rect_h(ref_rc),
+                base_x = st->img.rect.x0 - scale_x * (ref_rc.x0 - rounded.x0),
+                base_y = st->img.rect.y0 - scale_y * (ref_rc.y0 - rounded.y0);
+
+    return (pl_rect2df) {
+        base_x,
+        base_y,
+        base_x + scale_x * pl_rect_w(rounded),
+        base_y + scale_y * pl_rect_h(rounded),
+    };
+}
+
+// Returns the region of a plane's texture which contributes to the output,
+// i.e. the sampled rect padded by the footprint of the plane scaler, or {0}
+// if the entire plane needs to be processed anyway. Only valid as long as the
+// plane's rect remains unchanged.
+static pl_rect2d plane_roi(struct pass_state *pass, const struct plane_state *st,
+                           const struct plane_state *ref)
+{
+    const struct pl_render_params *params = pass->params;
+    const struct pl_frame *image = &pass->image;
+    const pl_tex tex = st->plane.texture;
+
+    // Custom hooks and film grain operate on entire planes
+    if (!pass->fbofmt[4] || params->num_hooks || st->plane.flipped ||
+        st->plane.address_mode != PL_TEX_ADDRESS_CLAMP ||
+        image->film_grain.type != PL_FILM_GRAIN_NONE)
+    {
+        return (pl_rect2d) {0};
+    }
+
+    const pl_rect2df ref_rc = ref->img.rect;
+    pl_rect2d pad, rounded = round_ref_rect(pass, ref_rc, &pad);
+    rounded.x0 -= pad.x0;
+    rounded.y0 -= pad.y0;
+    rounded.x1 += pad.x1;
+    rounded.y1 += pad.y1;
+
+    const struct pl_sample_src src = {
+        .new_w  = pl_rect_w(rounded),
+        .new_h  = pl_rect_h(rounded),
+        .rect   = plane_sample_rect(st, ref_rc, rounded),
+    };
+
+    if (!src.new_w || !src.new_h)
+        return (pl_rect2d) {0};
+
+    struct sampler_info info = sample_src_info(pass, &src, SAMPLER_PLANE);
+    float radius = info.config ? pl_filter_radius_bound(info.config) : 1.0f;
+    float ratio = fminf(src.new_w / pl_rect_w(src.rect),
+                        src.new_h / pl_rect_h(src.rect));
+    int pad_px = ceilf(radius * fmaxf(1.0f / ratio, 1.0f)) + 1;
+
+    const pl_rect2d roi = {
+        .x0 = PL_MAX(floorf(src.rect.x0) - pad_px, 0),
+        .y0 = PL_MAX(floorf(src.rect.y0) - pad_px, 0),
+        .x1 = PL_MIN(ceilf(src.rect.x1) + pad_px, tex->params.w),
+        .y1 = PL_MIN(ceilf(src.rect.y1) + pad_px, tex->params.h),
+    };
+
+    if (pl_rect_w(roi) <= 0 || pl_rect_h(roi) <= 0)
+        return (pl_rect2d) {0};
+    if (pl_rect_w(roi) == tex->params.w && pl_rect_h(roi) == tex->params.h)
+        return (pl_rect2d) {0};
+    return roi;
+}
+
 // This scales and merges all of the source images, and initializes pass->img.
-static bool pass_read_image(struct pass_state *pass)
+static bool _pass_read_image(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
     struct pl_frame *image = &pass->image;
@@ -1585,41 +2114,97 @@ static bool pass_read_image(struct pass_state *pass)
     // Original ref texture, even after preprocessing
     pl_tex ref_tex = ref->plane.texture;
 
-    // Merge all compatible planes into 'combined' shaders
+    // Compute the sampling rc of each plane
     for (int i = 0; i < image->num_planes; i++) {
-        struct plane_state *sti = &planes[i];
-        if (!sti->type)
-            continue;
-        if (!want_merge(pass, sti, ref))
+        struct plane_state *st = &planes[i];
+        if (!st->type)
             continue;
 
-        bool did_merge = false;
-        for (int j = i+1; j < image->num_planes; j++) {
-            struct plane_state *stj = &planes[j];
-            bool merge = sti->type == stj->type &&
-                         sti->img.w == stj->img.w &&
-                         sti->img.h == stj->img.h &&
-                         sti->plane.shift_x == stj->plane.shift_x &&
-                         sti->plane.shift_y == stj->plane.shift_y;
-            if (!merge)
-                continue;
+        float rx = (float) st->plane.texture->params.w / ref_tex->params.w,
+              ry = (float) st->plane.texture->params.h / ref_tex->params.h;
 
-            pl_fmt fmt = merge_fmt(pass, &sti->img, &stj->img);
+        // Only accept integer scaling ratios. This accounts for the fact that
+        // fractionally subsampled planes get rounded up to the nearest integer
+        // size, which we want to discard.
+        float rrx = rx >= 1 ? roundf(rx) : 1.0 / roundf(1.0 / rx),
+              rry = ry >= 1 ? roundf(ry) : 1.0 / roundf(1.0 / ry);
+
+        float sx = st->plane.shift_x,
+              sy = st->plane.shift_y;
+
+        st->img.rect = (pl_rect2df) {
+            .x0 = (image->crop.x0 - sx) * rrx,
+            .y0 = (image->crop.y0 - sy) * rry,
+            .x1 = (image->crop.x1 - sx) * rrx,
+            .y1 = (image->crop.y1 - sy) * rry,
+        };
+
+        st->plane_w = ref_tex->params.w * rrx;
+        st->plane_h = ref_tex->params.h * rry;
+    }
+
+    // Figure out which parts of each plane actually contribute to the output,
+    // so that intermediate processing (plane merging, debanding) can skip
+    // the rest when the image is cropped
+    for (int i = 0; i < image->num_planes; i++) {
+        struct plane_state *st = &planes[i];
+        if (!st->type)
+            continue;
+        st->roi = plane_roi(pass, st, ref);
+        if (pl_rect_w(st->roi)) {
+            PL_TRACE(rr, "Plane %d region of interest: {%d %d %d %d}", i,
+                     st->roi.x0, st->roi.y0, st->roi.x1, st->roi.y1);
+        }
+    }
+
+    // Merge all compatible planes into 'combined' shaders
+    for (int i = 0; i < image->num_planes; i++) {
+        struct plane_state *sti = &planes[i];
+        if (!sti->type)
+            continue;
+        if (!want_merge(pass, sti, ref))
+            continue;
+
+        // Only merge the region of interest, if all planes are unprocessed
+        const pl_rect2d roi = sti->img.sh ? (pl_rect2d) {0} : sti->roi;
+        const struct pl_sample_src roi_src = {
+            .new_w = pl_rect_w(roi),
+            .new_h = pl_rect_h(roi),
+            .rect = { roi.x0, roi.y0, roi.x1, roi.y1 },
+        };
+
+        bool did_merge = false;
+        for (int j = i+1; j < image->num_planes; j++) {
+            struct plane_state *stj = &planes[j];
+            bool merge = sti->type == stj->type &&
+                         sti->img.w == stj->img.w &&
+                         sti->img.h == stj->img.h &&
+                         sti->plane.shift_x == stj->plane.shift_x &&
+                         sti->plane.shift_y == stj->plane.shift_y &&
+                         !(pl_rect_w(roi) && stj->img.sh);
+            if (!merge)
+                continue;
+
+            pl_fmt fmt = merge_fmt(pass, &sti->img, &stj->img);
             if (!fmt)
                 continue;
 
             PL_TRACE(rr, "Merging plane %d into plane %d", j, i);
             pl_shader sh = sti->img.sh;
             if (!sh) {
+                struct pl_sample_src src = roi_src;
+                src.tex = sti->img.tex;
                 sh = sti->img.sh = pl_dispatch_begin_ex(pass->rr->dp, true);
-                pl_shader_sample_direct(sh, pl_sample_src( .tex = sti->img.tex ));
+                pl_shader_sample_direct(sh, &src);
                 sti->img.tex = NULL;
             }
 
             pl_shader psh = NULL;
             if (!stj->img.sh) {
+                struct pl_sample_src src = roi_src;
+                src.tex = stj->img.tex;
                 psh = pl_dispatch_begin_ex(pass->rr->dp, true);
-                pl_shader_sample_direct(psh, pl_sample_src( .tex = stj->img.tex ));
+                pl_shader_sample_direct(psh, &src);
             }
 
             ident_t sub = sh_subpass(sh, psh ? psh : stj->img.sh);
@@ -1652,6 +2237,8 @@ static bool pass_read_image(struct pass_state *pass)
         if (!did_merge)
             continue;
 
+        if (pl_rect_w(roi))
+            img_crop(&sti->img, roi);
         if (!img_tex(pass, &sti->img)) {
             PL_ERR(rr, "Failed dispatching plane merging shader, disabling FBOs!");
             memset(pass->fbofmt, 0, sizeof(pass->fbofmt));
@@ -1668,34 +2255,12 @@ static bool pass_read_image(struct pass_state *pass)
     if (!pl_color_system_is_ycbcr_like(image->repr.sys))
         neutral_chroma = neutral_luma;
 
-    // Compute the sampling rc of each plane
+    // Process each plane
     for (int i = 0; i < image->num_planes; i++) {
         struct plane_state *st = &planes[i];
         if (!st->type)
             continue;
 
-        float rx = (float) st->plane.texture->params.w / ref_tex->params.w,
-              ry = (float) st->plane.texture->params.h / ref_tex->params.h;
-
-        // Only accept integer scaling ratios. This accounts for the fact that
-        // fractionally subsampled planes get rounded up to the nearest integer
-        // size, which we want to discard.
-        float rrx = rx >= 1 ? roundf(rx) : 1.0 / roundf(1.0 / rx),
-              rry = ry >= 1 ? roundf(ry) : 1.0 / roundf(1.0 / ry);
-
-        float sx = st->plane.shift_x,
-              sy = st->plane.shift_y;
-
-        st->img.rect = (pl_rect2df) {
-            .x0 = (image->crop.x0 - sx) * rrx,
-            .y0 = (image->crop.y0 - sy) * rry,
-            .x1 = (image->crop.x1 - sx) * rrx,
-            .y1 = (image->crop.y1 - sy) * rry,
-        };
-
-        st->plane_w = ref_tex->params.w * rrx;
-        st->plane_h = ref_tex->params.h * rry;
-
         PL_TRACE(rr, "Plane %d:", i);
         log_plane_info(rr, st);
 
@@ -1714,7 +2279,9 @@ static bool pass_read_image(struct pass_state *pass)
         // it's reduced in quality after e.g. plane scalers as well. It's also
         // made less effective by performing film grain synthesis first.
 
-        if (plane_deband(pass, &st->img, neutral)) {
+        const pl_rect2d roi = st->img.tex == st->plane.texture ? st->roi
+                                                               : (pl_rect2d) {0};
+        if (plane_deband(pass, &st->img, roi, neutral)) {
             PL_TRACE(rr, "After debanding:");
             log_plane_info(rr, st);
         }
@@ -1743,24 +2310,21 @@ static bool pass_read_image(struct pass_state *pass)
          "vec4 tmp;                                 \n",
          SH_FLOAT(neutral_luma), SH_FLOAT(neutral_chroma));
 
-    // For quality reasons, explicitly drop subpixel offsets from the ref rect
-    // and re-add them as part of `pass->img.rect`, always rounding towards 0.
-    // Additionally, drop anamorphic subpixel mismatches.
+    // When rendering a tile, include the surrounding pixels needed by the
+    // main scaler. The padding is excluded from `pass->img.rect` below.
     const pl_rect2df ref_rc = ref->img.rect;
-    pl_rect2d ref_rounded;
-    ref_rounded.x0 = truncf(ref_rc.x0);
-    ref_rounded.y0 = truncf(ref_rc.y0);
-    ref_rounded.x1 = ref_rounded.x0 + roundf(pl_rect_w(ref_rc));
-    ref_rounded.y1 = ref_rounded.y0 + roundf(pl_rect_h(ref_rc));
+    pl_rect2d pad, ref_rounded = round_ref_rect(pass, ref_rc, &pad);
+    ref_rounded.x0 -= pad.x0;
+    ref_rounded.y0 -= pad.y0;
+    ref_rounded.x1 += pad.x1;
+    ref_rounded.y1 += pad.y1;
 
     PL_TRACE(rr, "Rounded reference rect: {%d %d %d %d}",
              ref_rounded.x0, ref_rounded.y0,
              ref_rounded.x1, ref_rounded.y1);
 
-    float off_x = ref_rc.x0 - ref_rounded.x0,
-          off_y = ref_rc.y0 - ref_rounded.y0,
-          stretch_x = pl_rect_w(ref_rounded) / pl_rect_w(ref_rc),
-          stretch_y = pl_rect_h(ref_rounded) / pl_rect_h(ref_rc);
+    const float off_x = ref_rc.x0 - ref_rounded.x0,
+                off_y = ref_rc.y0 - ref_rounded.y0;
 
     for (int i = 0; i < image->num_planes; i++) {
         struct plane_state *st = &planes[i];
@@ -1768,23 +2332,13 @@ static bool pass_read_image(struct pass_state *pass)
         if (!st->type)
             continue;
 
-        float scale_x = pl_rect_w(st->img.rect) / pl_rect_w(ref_rc),
-              scale_y = pl_rect_h(st->img.rect) / pl_rect_h(ref_rc),
-              base_x = st->img.rect.x0 - scale_x * off_x,
-              base_y = st->img.rect.y0 - scale_y * off_y;
-
         struct pl_sample_src src = {
             .components = plane->components,
             .address_mode = plane->address_mode,
             .scale      = pl_color_repr_normalize(&st->img.repr),
             .new_w      = pl_rect_w(ref_rounded),
             .new_h      = pl_rect_h(ref_rounded),
-            .rect = {
-                base_x,
-                base_y,
-                base_x + stretch_x * pl_rect_w(st->img.rect),
-                base_y + stretch_y * pl_rect_h(st->img.rect),
-            },
+            .rect       = plane_sample_rect(st, ref_rc, ref_rounded),
         };
 
         if (plane->flipped) {
@@ -1908,7 +2462,16 @@ static bool pass_read_image(struct pass_state *pass)
     return true;
 }
 
-static bool pass_scale_main(struct pass_state *pass)
+static bool pass_read_image(struct pass_state *pass)
+{
+    pl_clock_t start = pl_clock_now();
+    bool ok = _pass_read_image(pass);
+    report_span(pass->rr, pass->params, PL_RENDER_SPAN_STEP, pass->info.stage,
+                "pass_read_image", start);
+    return ok;
+}
+
+static bool _pass_scale_main(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
     pl_renderer rr = pass->rr;
@@ -1949,27 +2512,34 @@ static bool pass_scale_main(struct pass_state *pass)
         hdr_update_peak(pass);
 
     // We need to enable the full rendering pipeline if there are any user
-    // shaders / hooks that might depend on it.
+    // shaders / hooks that might depend on it. Hooks operating purely on
+    // colors can be fused with the surrounding stages if no scaling is
+    // needed, and only require the main scaler to run otherwise.
     uint64_t scaling_hooks = PL_HOOK_PRE_KERNEL | PL_HOOK_POST_KERNEL;
     uint64_t linear_hooks = PL_HOOK_LINEAR | PL_HOOK_SIGMOID;
+    bool need_hooks = false;
 
     for (int i = 0; i < params->num_hooks; i++) {
-        if (params->hooks[i]->stages & (scaling_hooks | linear_hooks)) {
-            need_fbo = true;
-            if (params->hooks[i]->stages & linear_hooks)
+        const struct pl_hook *hook = params->hooks[i];
+        if (hook->stages & (scaling_hooks | linear_hooks)) {
+            need_hooks = true;
+            if (hook->input == PL_HOOK_SIG_TEX || info.dir != SAMPLER_NOOP)
+                need_fbo = true;
+            if (hook->stages & linear_hooks)
                 use_linear = true;
-            if (params->hooks[i]->stages & PL_HOOK_SIGMOID)
+            if (hook->stages & PL_HOOK_SIGMOID)
                 use_sigmoid = true;
         }
     }
 
-    if (info.dir == SAMPLER_NOOP && !need_fbo) {
+    if (info.dir == SAMPLER_NOOP && !need_fbo && !need_hooks) {
         pl_assert(src.new_w == img->w && src.new_h == img->h);
         PL_TRACE(rr, "Skipping main scaler (would be no-op)");
         goto done;
     }
 
-    if (info.type == SAMPLER_DIRECT && !need_fbo) {
+    // Free sampling doesn't account for the padding of tiles
+    if (info.type == SAMPLER_DIRECT && !need_fbo && !pl_rect_w(pass->tile)) {
         img->w = src.new_w;
         img->h = src.new_h;
         img->rect = new_rect;
@@ -2006,18 +2576,29 @@ static bool pass_scale_main(struct pass_state *pass)
 
     pass_hook(pass, img, PL_HOOK_PRE_KERNEL);
 
-    src.tex = img_tex(pass, img);
-    if (!src.tex)
-        return false;
-    pass->need_peak_fbo = false;
+    const bool fuse = !need_fbo && img->w == src.new_w && img->h == src.new_h &&
+                      img->rect.x0 == src.rect.x0 && img->rect.y0 == src.rect.y0 &&
+                      img->rect.x1 == src.rect.x1 && img->rect.y1 == src.rect.y1;
 
-    pl_shader sh = pl_dispatch_begin_ex(rr->dp, true);
-    dispatch_sampler(pass, sh, &rr->sampler_main, SAMPLER_MAIN, NULL, &src);
-    img->tex  = NULL;
-    img->sh   = sh;
-    img->w    = src.new_w;
-    img->h    = src.new_h;
-    img->rect = new_rect;
+    if (fuse) {
+        // 1:1 scaling is a no-op, so keep going in the same shader
+        PL_TRACE(rr, "Skipping main scaler (fused with hooks)");
+        pass->info.passes_fused++;
+    } else {
+        src.tex = img_tex(pass, img);
+        if (!src.tex)
+            return false;
+        pass->need_peak_fbo = false;
+
+        pl_shader sh = pl_dispatch_begin_ex(rr->dp, true);
+        dispatch_sampler(pass, sh, &rr->sampler_main, SAMPLER_MAIN, NULL, &src);
+        img->tex  = NULL;
+        img->sh   = sh;
+        img->consumed = src.tex;
+        img->w    = src.new_w;
+        img->h    = src.new_h;
+        img->rect = new_rect;
+    }
 
     pass_hook(pass, img, PL_HOOK_POST_KERNEL);
 
@@ -2031,6 +2612,15 @@ done:
     return true;
 }
 
+static bool pass_scale_main(struct pass_state *pass)
+{
+    pl_clock_t start = pl_clock_now();
+    bool ok = _pass_scale_main(pass);
+    report_span(pass->rr, pass->params, PL_RENDER_SPAN_STEP, pass->info.stage,
+                "pass_scale_main", start);
+    return ok;
+}
+
 static pl_tex get_feature_map(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
@@ -2099,7 +2689,7 @@ error:
 }
 
 // Transforms image into the output color space (tone-mapping, ICC 3DLUT, etc)
-static void pass_convert_colors(struct pass_state *pass)
+static void _pass_convert_colors(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
     const struct pl_frame *image = &pass->image;
@@ -2223,6 +2813,14 @@ static void pass_convert_colors(struct pass_state *pass)
     img->color = target->color;
 }
 
+static void pass_convert_colors(struct pass_state *pass)
+{
+    pl_clock_t start = pl_clock_now();
+    _pass_convert_colors(pass);
+    report_span(pass->rr, pass->params, PL_RENDER_SPAN_STEP, pass->info.stage,
+                "pass_convert_colors", start);
+}
+
 // Returns true if error diffusion was successfully performed
 static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
                                  int new_depth, int comps, int out_w, int out_h)
@@ -2314,7 +2912,7 @@ static void clear_target(pl_renderer rr, const struct pl_frame *target,
     }
 }
 
-static bool pass_output_target(struct pass_state *pass)
+static bool _pass_output_target(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
     const struct pl_frame *image = &pass->image;
@@ -2642,6 +3240,14 @@ static bool pass_output_target(struct pass_state *pass)
         if (!ok)
             return false;
 
+        if (pass->pre_overlays) {
+            pl_assert(target->num_planes == 1);
+            pl_tex_blit(rr->gpu, pl_tex_blit_params(
+                .src = plane->texture,
+                .dst = pass->pre_overlays,
+            ));
+        }
+
         if (pass->info.stage != PL_RENDER_STAGE_BLEND) {
             draw_overlays(pass, plane->texture, plane->components,
                           plane->component_mapping, image->overlays,
@@ -2659,6 +3265,15 @@ static bool pass_output_target(struct pass_state *pass)
     return true;
 }
 
+static bool pass_output_target(struct pass_state *pass)
+{
+    pl_clock_t start = pl_clock_now();
+    bool ok = _pass_output_target(pass);
+    report_span(pass->rr, pass->params, PL_RENDER_SPAN_STEP, pass->info.stage,
+                "pass_output_target", start);
+    return ok;
+}
+
 #define require(expr) pl_require(rr, expr)
 #define validate_plane(plane, param)                                            \
   do {                                                                          \
@@ -2832,6 +3447,21 @@ static void fix_refs_and_rects(struct pass_state *pass)
           base_x = src->x0,
           base_y = src->y0;
 
+    pass->src_full = (pl_rect2df) {
+        .x0 = base_x + (rx0 - dst->x0) * scale_x,
+        .x1 = base_x + (rx1 - dst->x0) * scale_x,
+        .y0 = base_y + (ry0 - dst->y0) * scale_y,
+        .y1 = base_y + (ry1 - dst->y0) * scale_y,
+    };
+
+    // Further restrict the output rect to the current tile, if any
+    if (pl_rect_w(pass->tile) && pl_rect_h(pass->tile)) {
+        rx0 = PL_CLAMP(rx0, pass->tile.x0, pass->tile.x1);
+        ry0 = PL_CLAMP(ry0, pass->tile.y0, pass->tile.y1);
+        rx1 = PL_CLAMP(rx1, pass->tile.x0, pass->tile.x1);
+        ry1 = PL_CLAMP(ry1, pass->tile.y0, pass->tile.y1);
+    }
+
     src->x0 = base_x + (rx0 - dst->x0) * scale_x;
     src->x1 = base_x + (rx1 - dst->x0) * scale_x;
     src->y0 = base_y + (ry0 - dst->y0) * scale_y;
@@ -2912,6 +3542,9 @@ static void pass_uninit(struct pass_state *pass)
 {
     pl_renderer rr = pass->rr;
     pl_dispatch_abort(rr->dp, &pass->img.sh);
+    for (int i = 0; i < pass->fbos.num; i++)
+        pl_tex_pool_release(rr->fbos, &pass->fbos.elem[i]);
+    pass->fbos.num = 0;
     release_frame(pass, &pass->next, &pass->acquired.next);
     release_frame(pass, &pass->prev, &pass->acquired.prev);
     release_frame(pass, &pass->image, &pass->acquired.image);
@@ -3080,142 +3713,13 @@ static void pass_begin_frame(struct pass_state *pass)
             params->hooks[i]->reset(params->hooks[i]->priv);
     }
 
-    size_t size = rr->fbos.num * sizeof(bool);
-    pass->fbos_used = pl_realloc(pass->tmp, pass->fbos_used, size);
-    memset(pass->fbos_used, 0, size);
-}
-
-static bool draw_empty_overlays(pl_renderer rr,
-                                const struct pl_frame *ptarget,
-                                const struct pl_render_params *params)
-{
-    clear_target(rr, ptarget, params);
-    if (!ptarget->num_overlays)
-        return true;
-
-    struct pass_state pass = {
-        .rr = rr,
-        .params = params,
-        .src_ref = -1,
-        .target = *ptarget,
-        .info.stage = PL_RENDER_STAGE_BLEND,
-        .info.count = 0,
-    };
-
-    if (!pass_init(&pass, false))
-        return false;
-
-    pass_begin_frame(&pass);
-    struct pl_frame *target = &pass.target;
-    pl_tex ref = target->planes[pass.dst_ref].texture;
-    for (int p = 0; p < target->num_planes; p++) {
-        const struct pl_plane *plane = &target->planes[p];
-        // Math replicated from `pass_output_target`
-        float rx = (float) plane->texture->params.w / ref->params.w,
-              ry = (float) plane->texture->params.h / ref->params.h;
-        float rrx = rx >= 1 ? roundf(rx) : 1.0 / roundf(1.0 / rx),
-              rry = ry >= 1 ? roundf(ry) : 1.0 / roundf(1.0 / ry);
-        float sx = plane->shift_x, sy = plane->shift_y;
-
-        pl_transform2x2 tscale = {
-            .mat = {{{ rrx, 0.0 }, { 0.0, rry }}},
-            .c = { -sx, -sy },
-        };
-
-        if (plane->flipped) {
-            tscale.mat.m[1][1] = -tscale.mat.m[1][1];
-            tscale.c[1] += plane->texture->params.h;
-        }
-
-        draw_overlays(&pass, plane->texture, plane->components,
-                      plane->component_mapping, target->overlays,
-                      target->num_overlays, target->color, target->repr,
-                      &tscale);
-    }
-
-    pass_uninit(&pass);
-    return true;
-}
-
-bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
-                     const struct pl_frame *ptarget,
-                     const struct pl_render_params *params)
-{
-    params = PL_DEF(params, &pl_render_default_params);
-    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
-    if (!pimage)
-        return draw_empty_overlays(rr, ptarget, params);
-
-    struct pass_state pass = {
-        .rr = rr,
-        .params = params,
-        .image = *pimage,
-        .target = *ptarget,
-        .info.stage = PL_RENDER_STAGE_FRAME,
-    };
-
-    if (!pass_init(&pass, true))
-        return false;
-
-    // No-op (empty crop)
-    if (!pl_rect_w(pass.dst_rect) || !pl_rect_h(pass.dst_rect)) {
-        pass_uninit(&pass);
-        return draw_empty_overlays(rr, ptarget, params);
-    }
-
-    pass_begin_frame(&pass);
-    if (!pass_read_image(&pass))
-        goto error;
-    if (!pass_scale_main(&pass))
-        goto error;
-    pass_convert_colors(&pass);
-    if (!pass_output_target(&pass))
-        goto error;
-
-    pass_uninit(&pass);
-    return true;
-
-error:
-    PL_ERR(rr, "Failed rendering image!");
-    pass_uninit(&pass);
-    return false;
-}
-
-const struct pl_frame *pl_frame_mix_current(const struct pl_frame_mix *mix)
-{
-    const struct pl_frame *cur = NULL;
-    for (int i = 0; i < mix->num_frames; i++) {
-        if (mix->timestamps[i] > 0.0f)
-            break;
-        cur = mix->frames[i];
-    }
-
-    return cur;
-}
-
-const struct pl_frame *pl_frame_mix_nearest(const struct pl_frame_mix *mix)
-{
-    if (!mix->num_frames)
-        return NULL;
-
-    const struct pl_frame *best = mix->frames[0];
-    float best_dist = fabsf(mix->timestamps[0]);
-    for (int i = 1; i < mix->num_frames; i++) {
-        float dist = fabsf(mix->timestamps[i]);
-        if (dist < best_dist) {
-            best = mix->frames[i];
-            best_dist = dist;
-            continue;
-        } else {
-            break;
-        }
-    }
-
-    return best;
+    // Hooks may hold on to intermediate textures, so disable aliasing
+    pass->alias_fbos = !params->num_hooks;
 }
 
 struct params_info {
     uint64_t hash;
+    uint64_t output_hash; // also includes params only affecting the output
     bool trivial;
 };
 
@@ -3284,10 +3788,37 @@ static struct params_info render_params_info(const struct pl_render_params *para
 
 #define CLEAR(field) field = (__typeof__(field)) {0}
 
+    // Hash the remaining params separately for `output_hash`, to detect
+    // redundant invocations of pl_render_image_mix
+    struct pl_render_params out = params;
+    const uint64_t hash = info.hash;
+    HASH_PTR(out.frame_mixer, NULL, true);
+    HASH_PTR(out.blend_params, NULL, true);
+    HASH_PTR(out.distort_params, NULL, true);
+    HASH_PTR(out.dither_params, NULL, true);
+    HASH_PTR(out.error_diffusion, NULL, true);
+    CLEAR(out.skip_caching_single_frame);
+    CLEAR(out.mixing_cache_max_bytes);
+    CLEAR(out.skip_redundant_frames);
+    CLEAR(out.partial_overlay_updates);
+    CLEAR(out.dynamic_constants);
+    CLEAR(out.info_callback);
+    CLEAR(out.info_priv);
+    CLEAR(out.span_callback);
+    CLEAR(out.span_priv);
+    CLEAR(out.output_tile_size);
+    pl_hash_merge(&info.hash, pl_var_hash(out));
+    info.output_hash = info.hash;
+    info.hash = hash;
+
     // Clear out fields only relevant to pl_render_image_mix
     CLEAR(params.frame_mixer);
     CLEAR(params.preserve_mixing_cache);
     CLEAR(params.skip_caching_single_frame);
+    CLEAR(params.mixing_cache_max_bytes);
+    CLEAR(params.mixing_cache_reduced_precision);
+    CLEAR(params.skip_redundant_frames);
+    CLEAR(params.partial_overlay_updates);
 
     // Clear out fields only relevant to pass_output_target
     CLEAR(params.background);
@@ -3309,28 +3840,928 @@ static struct params_info render_params_info(const struct pl_render_params *para
     CLEAR(params.dynamic_constants);
     CLEAR(params.info_callback);
     CLEAR(params.info_priv);
+    CLEAR(params.span_callback);
+    CLEAR(params.span_priv);
+    CLEAR(params.output_tile_size);
 
     pl_hash_merge(&info.hash, pl_var_hash(params));
     return info;
 }
 
-#define MAX_MIX_FRAMES 16
-
-bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
-                         const struct pl_frame *ptarget,
-                         const struct pl_render_params *params)
+// Whether the output written to `target` is fully determined by the inputs,
+// and can thus be saved and restored later
+static bool output_reusable(const struct pl_frame *target,
+                            const struct pl_render_params *params)
 {
-    if (!images->num_frames)
-        return pl_render_image(rr, NULL, ptarget, params);
+    if (params->num_hooks || params->blend_params)
+        return false;
+    if (params->dither_params && params->dither_params->temporal)
+        return false;
+    if (params->border == PL_CLEAR_SKIP || params->background == PL_CLEAR_SKIP ||
+        params->skip_target_clearing)
+        return false; // output depends on the previous target contents
+    if (target->num_planes != 1 || target->acquire || target->release)
+        return false;
 
-    params = PL_DEF(params, &pl_render_default_params);
-    struct params_info par_info = render_params_info(params);
-    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+    // Saved outputs are restored by blitting them to the target
+    return target->planes[0].texture->params.blit_dst;
+}
 
-    require(images->num_frames >= 1);
-    require(images->vsync_duration > 0.0);
-    for (int i = 0; i < images->num_frames - 1; i++)
-        require(images->timestamps[i] <= images->timestamps[i+1]);
+// If `by_geometry` is set, planes are hashed by their size and format rather
+// than the texture itself, so that e.g. rotating swapchain images still
+// produce matching keys
+static void hash_frame(uint64_t *key, const struct pl_frame *frame,
+                       bool by_geometry, bool overlays)
+{
+    for (int i = 0; i < frame->num_planes; i++) {
+        const struct pl_plane *plane = &frame->planes[i];
+        if (by_geometry) {
+            pl_tex tex = plane->texture;
+            pl_hash_merge(key, pl_var_hash(tex->params.w));
+            pl_hash_merge(key, pl_var_hash(tex->params.h));
+            pl_hash_merge(key, pl_var_hash(tex->params.d));
+            pl_hash_merge(key, (uintptr_t) tex->params.format);
+        } else {
+            pl_hash_merge(key, (uintptr_t) plane->texture);
+        }
+        pl_hash_merge(key, pl_var_hash(plane->address_mode));
+        pl_hash_merge(key, pl_var_hash(plane->flipped));
+        pl_hash_merge(key, pl_var_hash(plane->components));
+        pl_hash_merge(key, pl_var_hash(plane->component_mapping));
+        pl_hash_merge(key, pl_var_hash(plane->shift_x));
+        pl_hash_merge(key, pl_var_hash(plane->shift_y));
+    }
+
+    pl_hash_merge(key, pl_var_hash(frame->repr));
+    pl_hash_merge(key, pl_var_hash(frame->color));
+    pl_hash_merge(key, (uintptr_t) frame->icc);
+    pl_hash_merge(key, frame->profile.signature);
+    pl_hash_merge(key, frame->lut ? frame->lut->signature : 0);
+    pl_hash_merge(key, pl_var_hash(frame->lut_type));
+    pl_hash_merge(key, pl_var_hash(frame->crop));
+    pl_hash_merge(key, pl_var_hash(frame->rotation));
+    pl_hash_merge(key, pl_var_hash(frame->film_grain));
+    if (!overlays)
+        return;
+
+    for (int i = 0; i < frame->num_overlays; i++) {
+        const struct pl_overlay *ol = &frame->overlays[i];
+        pl_hash_merge(key, (uintptr_t) ol->tex);
+        pl_hash_merge(key, pl_var_hash(ol->mode));
+        pl_hash_merge(key, pl_var_hash(ol->coords));
+        pl_hash_merge(key, pl_var_hash(ol->repr));
+        pl_hash_merge(key, pl_var_hash(ol->color));
+        pl_hash_merge(key, pl_mem_hash(ol->parts, ol->num_parts * sizeof(ol->parts[0])));
+    }
+}
+
+static bool draw_empty_overlays(pl_renderer rr,
+                                const struct pl_frame *ptarget,
+                                const struct pl_render_params *params)
+{
+    clear_target(rr, ptarget, params);
+    if (!ptarget->num_overlays)
+        return true;
+
+    struct pass_state pass = {
+        .rr = rr,
+        .params = params,
+        .src_ref = -1,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_BLEND,
+        .info.count = 0,
+    };
+
+    if (!pass_init(&pass, false))
+        return false;
+
+    pass_begin_frame(&pass);
+    struct pl_frame *target = &pass.target;
+    pl_tex ref = target->planes[pass.dst_ref].texture;
+    for (int p = 0; p < target->num_planes; p++) {
+        const struct pl_plane *plane = &target->planes[p];
+        // Math replicated from `pass_output_target`
+        float rx = (float) plane->texture->params.w / ref->params.w,
+              ry = (float) plane->texture->params.h / ref->params.h;
+        float rrx = rx >= 1 ? roundf(rx) : 1.0 / roundf(1.0 / rx),
+              rry = ry >= 1 ? roundf(ry) : 1.0 / roundf(1.0 / ry);
+        float sx = plane->shift_x, sy = plane->shift_y;
+
+        pl_transform2x2 tscale = {
+            .mat = {{{ rrx, 0.0 }, { 0.0, rry }}},
+            .c = { -sx, -sy },
+        };
+
+        if (plane->flipped) {
+            tscale.mat.m[1][1] = -tscale.mat.m[1][1];
+            tscale.c[1] += plane->texture->params.h;
+        }
+
+        draw_overlays(&pass, plane->texture, plane->components,
+                      plane->component_mapping, target->overlays,
+                      target->num_overlays, target->color, target->repr,
+                      &tscale);
+    }
+
+    pass_uninit(&pass);
+    return true;
+}
+
+// Returns a key identifying the output of a pl_render_image invocation
+// before drawing overlays, or 0 if it can't be reused
+static uint64_t base_output_key(const struct pl_frame *image,
+                                const struct pl_frame *target,
+                                const struct pl_render_params *params)
+{
+    if (!params->partial_overlay_updates || !output_reusable(target, params))
+        return 0;
+    if (!target->planes[0].texture->params.blit_src)
+        return 0;
+    if (image->acquire || image->release || image->field != PL_FIELD_NONE)
+        return 0;
+
+    // The target is hashed by texture, since redrawing only the overlays
+    // relies on it still containing the previous output
+    uint64_t key = render_params_info(params).output_hash;
+    hash_frame(&key, image, false, false);
+    hash_frame(&key, target, false, false);
+    return PL_DEF(key, 1);
+}
+
+// Math replicated from `pass_output_target`, for single-plane targets
+static pl_transform2x2 single_plane_scale(const struct pl_plane *plane)
+{
+    pl_transform2x2 tscale = {
+        .mat = {{{ 1.0, 0.0 }, { 0.0, 1.0 }}},
+        .c = { -plane->shift_x, -plane->shift_y },
+    };
+
+    if (plane->flipped) {
+        tscale.mat.m[1][1] = -tscale.mat.m[1][1];
+        tscale.c[1] += plane->texture->params.h;
+    }
+
+    return tscale;
+}
+
+// Returns the region of the (single-plane) target covered by overlays
+static pl_rect2d overlay_bounds(const struct pass_state *pass)
+{
+    const struct pl_frame *target = &pass->target;
+    const struct pl_plane *plane = &target->planes[0];
+    const pl_transform2x2 tscale = single_plane_scale(plane);
+    pl_rect2df bounds = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+
+    const struct pl_overlay *sets[2] = { target->overlays, NULL };
+    int nums[2] = { target->num_overlays, 0 };
+    if (pass->src_ref >= 0) {
+        sets[1] = pass->image.overlays;
+        nums[1] = pass->image.num_overlays;
+    }
+
+    for (int s = 0; s < PL_ARRAY_SIZE(sets); s++) {
+        for (int n = 0; n < nums[s]; n++) {
+            const struct pl_overlay *ol = &sets[s][n];
+            pl_transform2x2 tf;
+            if (!ol->num_parts || !overlay_transform(pass, ol, s == 0, &tf))
+                continue;
+            pl_transform2x2_rmul(&tscale, &tf);
+            for (int i = 0; i < ol->num_parts; i++) {
+                pl_rect2df rc = pl_transform2x2_bounds(&tf, &ol->parts[i].dst);
+                bounds.x0 = fminf(bounds.x0, rc.x0);
+                bounds.y0 = fminf(bounds.y0, rc.y0);
+                bounds.x1 = fmaxf(bounds.x1, rc.x1);
+                bounds.y1 = fmaxf(bounds.y1, rc.y1);
+            }
+        }
+    }
+
+    pl_tex tex = plane->texture;
+    pl_rect2d rc = {
+        .x0 = PL_CLAMP(floorf(bounds.x0), 0, tex->params.w),
+        .y0 = PL_CLAMP(floorf(bounds.y0), 0, tex->params.h),
+        .x1 = PL_CLAMP(ceilf(bounds.x1),  0, tex->params.w),
+        .y1 = PL_CLAMP(ceilf(bounds.y1),  0, tex->params.h),
+    };
+
+    if (rc.x1 <= rc.x0 || rc.y1 <= rc.y0)
+        return (pl_rect2d) {0};
+    return rc;
+}
+
+// Restores the previous output in the region touched by either the old or
+// the new overlays, and redraws the new overlays on top of it
+static void redraw_overlays(struct pass_state *pass)
+{
+    pl_renderer rr = pass->rr;
+    const struct pl_frame *target = &pass->target;
+    const struct pl_plane *plane = &target->planes[0];
+    pl_rect2d dirty = overlay_bounds(pass), old = rr->base_dirty;
+    rr->base_dirty = dirty;
+
+    if (pl_rect_w(old) && pl_rect_h(old)) {
+        if (pl_rect_w(dirty) && pl_rect_h(dirty)) {
+            dirty.x0 = PL_MIN(dirty.x0, old.x0);
+            dirty.y0 = PL_MIN(dirty.y0, old.y0);
+            dirty.x1 = PL_MAX(dirty.x1, old.x1);
+            dirty.y1 = PL_MAX(dirty.y1, old.y1);
+        } else {
+            dirty = old;
+        }
+    }
+
+    if (!pl_rect_w(dirty) || !pl_rect_h(dirty)) {
+        PL_TRACE(rr, "No overlays changed, skipping frame");
+        return;
+    }
+
+    PL_TRACE(rr, "Redrawing overlays in {%d %d %d %d}",
+             dirty.x0, dirty.y0, dirty.x1, dirty.y1);
+
+    const pl_rect3d rc = { dirty.x0, dirty.y0, 0, dirty.x1, dirty.y1, 1 };
+    pl_tex_blit(rr->gpu, pl_tex_blit_params(
+        .src    = rr->base_output,
+        .dst    = plane->texture,
+        .src_rc = rc,
+        .dst_rc = rc,
+    ));
+
+    const pl_transform2x2 tscale = single_plane_scale(plane);
+    pass_begin_frame(pass);
+    draw_overlays(pass, plane->texture, plane->components,
+                  plane->component_mapping, pass->image.overlays,
+                  pass->image.num_overlays, target->color, target->repr,
+                  &tscale);
+    draw_overlays(pass, plane->texture, plane->components,
+                  plane->component_mapping, target->overlays,
+                  target->num_overlays, target->color, target->repr,
+                  &tscale);
+}
+
+// Returns whether the output should be split into tiles, which requires all
+// rendering steps to only depend on a bounded neighbourhood of each pixel
+static bool want_tiles(const struct pass_state *pass)
+{
+    const struct pl_render_params *params = pass->params;
+    const struct pl_frame *image = &pass->image;
+    const int size = params->output_tile_size;
+    if (!size || (abs(pl_rect_w(pass->dst_rect)) <= size &&
+                  abs(pl_rect_h(pass->dst_rect)) <= size))
+    {
+        return false;
+    }
+
+    const struct pl_color_map_params *cparams = params->color_map_params;
+    cparams = PL_DEF(cparams, &pl_color_map_default_params);
+    const bool hdr = pl_color_space_is_hdr(&image->color);
+
+    const char *reason = NULL;
+    if (!pass->fbofmt[4]) {
+        reason = "no FBOs";
+    } else if (pass->rotation) {
+        reason = "rotation";
+    } else if (pass->target.num_planes > 1) {
+        reason = "planar targets";
+    } else if (params->num_hooks) {
+        reason = "custom hooks";
+    } else if (params->error_diffusion || params->distort_params ||
+               params->corner_rounding > 0.0f)
+    {
+        reason = "error diffusion, distortion or corner rounding";
+    } else if (hdr && (params->peak_detect_params || cparams->contrast_recovery)) {
+        reason = "peak detection or contrast recovery";
+    } else if (image->film_grain.type != PL_FILM_GRAIN_NONE) {
+        reason = "film grain";
+    }
+
+    if (reason) {
+        PL_TRACE(pass->rr, "Rendering without tiles (unsupported with %s)", reason);
+        return false;
+    }
+
+    return true;
+}
+
+// Renders the output as a grid of independent tiles, each with intermediate
+// textures bounded by the tile size (plus the scaler's padding). Takes over
+// `pass`, which must have been initialized.
+static bool render_tiles(struct pass_state *pass, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget)
+{
+    const struct pl_render_params *params = pass->params;
+    pl_renderer rr = pass->rr;
+    pl_rect2d rc = pass->dst_rect;
+    pl_rect2d_normalize(&rc);
+
+    // Clearing the target and drawing overlays is done once for the entire
+    // output, rather than for every tile
+    if (pl_frame_is_cropped(&pass->target))
+        clear_target(rr, &pass->target, params);
+    pass_uninit(pass);
+
+    struct pl_render_params tparams = *params;
+    tparams.border = PL_CLEAR_SKIP;
+    struct pl_frame image = *pimage, target = *ptarget;
+    image.overlays = target.overlays = NULL;
+    image.num_overlays = target.num_overlays = 0;
+
+    const int size = params->output_tile_size;
+    PL_TRACE(rr, "Rendering {%d %d %d %d} in tiles of %dx%d",
+             rc.x0, rc.y0, rc.x1, rc.y1, size, size);
+
+    for (int y = rc.y0; y < rc.y1; y += size) {
+        for (int x = rc.x0; x < rc.x1; x += size) {
+            struct pass_state tile = {
+                .rr = rr,
+                .params = &tparams,
+                .image = image,
+                .target = target,
+                .info.stage = PL_RENDER_STAGE_FRAME,
+                .tile = { x, y, PL_MIN(x + size, rc.x1), PL_MIN(y + size, rc.y1) },
+            };
+
+            if (!pass_init(&tile, true))
+                return false;
+
+            pass_begin_frame(&tile);
+            bool ok = pass_read_image(&tile) && pass_scale_main(&tile);
+            if (ok) {
+                pass_convert_colors(&tile);
+                ok = pass_output_target(&tile);
+            }
+
+            pass_uninit(&tile);
+            if (!ok)
+                return false;
+        }
+    }
+
+    if (!pimage->num_overlays && !ptarget->num_overlays)
+        return true;
+
+    struct pass_state ov = {
+        .rr = rr,
+        .params = params,
+        .image = *pimage,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_FRAME,
+    };
+
+    if (!pass_init(&ov, true))
+        return false;
+
+    const struct pl_plane *plane = &ov.target.planes[0];
+    const pl_transform2x2 tscale = single_plane_scale(plane);
+    pass_begin_frame(&ov);
+    draw_overlays(&ov, plane->texture, plane->components,
+                  plane->component_mapping, ov.image.overlays,
+                  ov.image.num_overlays, ov.target.color, ov.target.repr,
+                  &tscale);
+    draw_overlays(&ov, plane->texture, plane->components,
+                  plane->component_mapping, ov.target.overlays,
+                  ov.target.num_overlays, ov.target.color, ov.target.repr,
+                  &tscale);
+    pass_uninit(&ov);
+    return true;
+}
+
+static bool render_image(pl_renderer rr, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params)
+{
+    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+    if (!pimage)
+        return draw_empty_overlays(rr, ptarget, params);
+
+    struct pass_state pass = {
+        .rr = rr,
+        .params = params,
+        .image = *pimage,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_FRAME,
+    };
+
+    if (!pass_init(&pass, true))
+        return false;
+
+    // No-op (empty crop)
+    if (!pl_rect_w(pass.dst_rect) || !pl_rect_h(pass.dst_rect)) {
+        pass_uninit(&pass);
+        return draw_empty_overlays(rr, ptarget, params);
+    }
+
+    if (want_tiles(&pass)) {
+        rr->base_key = 0;
+        if (render_tiles(&pass, pimage, ptarget))
+            return true;
+        PL_ERR(rr, "Failed rendering image!");
+        return false;
+    }
+
+    // Only redraw the overlays if nothing else changed
+    const uint64_t base_key = base_output_key(pimage, ptarget, params);
+    if (base_key && base_key == rr->base_key) {
+        redraw_overlays(&pass);
+        pass_uninit(&pass);
+        return true;
+    }
+
+    rr->base_key = 0;
+    if (base_key) {
+        pl_tex tex = pass.target.planes[0].texture;
+        bool ok = pl_tex_recreate(rr->gpu, &rr->base_output, pl_tex_params(
+            .w          = tex->params.w,
+            .h          = tex->params.h,
+            .format     = tex->params.format,
+            .blit_src   = true,
+            .blit_dst   = true,
+            .debug_tag  = PL_DEBUG_TAG,
+        ));
+        if (ok)
+            pass.pre_overlays = rr->base_output;
+    }
+
+    pass_begin_frame(&pass);
+    if (!pass_read_image(&pass))
+        goto error;
+    if (!pass_scale_main(&pass))
+        goto error;
+    pass_convert_colors(&pass);
+    if (!pass_output_target(&pass))
+        goto error;
+
+    if (pass.pre_overlays) {
+        rr->base_key = base_key;
+        rr->base_dirty = overlay_bounds(&pass);
+    }
+
+    pass_uninit(&pass);
+    return true;
+
+error:
+    PL_ERR(rr, "Failed rendering image!");
+    pass_uninit(&pass);
+    return false;
+}
+
+#define MAX_MULTI_TARGETS 16
+
+static inline bool multi_can_share(const struct pass_state *pass,
+                                   const struct pass_state *ref)
+{
+    return pl_rect_w(pass->dst_rect) && pl_rect_h(pass->dst_rect) &&
+           pl_rect2d_eq(pass->image.crop, ref->image.crop);
+}
+
+bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
+                     const struct pl_frame *ptarget,
+                     const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    pl_clock_t start = pl_clock_now();
+    bool ok = render_image(rr, pimage, ptarget, params);
+    report_span(rr, params, PL_RENDER_SPAN_FRAME, PL_RENDER_STAGE_FRAME,
+                "pl_render_image", start);
+    return ok;
+}
+
+static bool render_image_multi(pl_renderer rr, const struct pl_frame *pimage,
+                               const struct pl_frame *targets, int num_targets,
+                               const struct pl_render_params *params)
+{
+    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+
+    struct pass_state passes[MAX_MULTI_TARGETS];
+    bool shared[MAX_MULTI_TARGETS] = {0};
+    int order[MAX_MULTI_TARGETS], num_shared = 0;
+    bool ok = true;
+    require(num_targets >= 0 && num_targets <= MAX_MULTI_TARGETS);
+
+    if (!pimage || num_targets < 2 || params->disable_fbos ||
+        (rr->errors & PL_RENDER_ERR_FBO))
+    {
+        goto fallback;
+    }
+
+    // The first target determines the region of the image to read
+    passes[0] = (struct pass_state) {
+        .rr = rr,
+        .params = params,
+        .image = *pimage,
+        .target = targets[0],
+        .info.stage = PL_RENDER_STAGE_FRAME,
+    };
+
+    if (!pass_init(&passes[0], true))
+        return false;
+    const pl_rect2d *dst0 = &passes[0].dst_rect;
+    if (!passes[0].fbofmt[4] || !pl_rect_w(*dst0) || !pl_rect_h(*dst0)) {
+        pass_uninit(&passes[0]);
+        goto fallback;
+    }
+
+    shared[0] = true;
+    order[num_shared++] = 0;
+    for (int i = 1; i < num_targets; i++) {
+        passes[i] = (struct pass_state) {
+            .rr = rr,
+            .params = params,
+            .image = *pimage,
+            .target = targets[i],
+            .info.stage = PL_RENDER_STAGE_FRAME,
+        };
+
+        memcpy(passes[i].fbofmt, passes[0].fbofmt, sizeof(passes[0].fbofmt));
+        if (!pass_init(&passes[i], false)) {
+            ok = false;
+            continue;
+        }
+
+        shared[i] = multi_can_share(&passes[i], &passes[0]);
+        if (shared[i]) {
+            order[num_shared++] = i;
+        } else {
+            pass_uninit(&passes[i]);
+        }
+    }
+
+    // Render the largest targets first, so that smaller targets can be
+    // downscaled from their intermediate results
+    for (int i = 1; i < num_shared; i++) {
+        for (int j = i; j > 0; j--) {
+            const pl_rect2d *a = &passes[order[j - 1]].dst_rect,
+                            *b = &passes[order[j]].dst_rect;
+            if (abs(pl_rect_w(*a) * pl_rect_h(*a)) >= abs(pl_rect_w(*b) * pl_rect_h(*b)))
+                break;
+            PL_SWAP(order[j - 1], order[j]);
+        }
+    }
+
+    // Hooks may depend on the scaling ratio, so don't cascade through them
+    const uint64_t scaling_hooks = PL_HOOK_PRE_KERNEL | PL_HOOK_POST_KERNEL |
+                                   PL_HOOK_SCALED | PL_HOOK_LINEAR |
+                                   PL_HOOK_SIGMOID;
+    bool use_pyramid = true;
+    for (int i = 0; i < params->num_hooks; i++)
+        use_pyramid &= !(params->hooks[i]->stages & scaling_hooks);
+
+    // Read the image once, and materialize the result for all targets
+    struct pass_state *lead = &passes[0];
+    lead->num_shared = num_shared;
+    pass_begin_frame(lead);
+    lead->alias_fbos = false; // the source image must outlive this target
+    if (!pass_read_image(lead))
+        goto error;
+    hdr_update_peak(lead);
+    if (!img_tex(lead, &lead->img))
+        goto error;
+    lead->num_shared = 0;
+
+    const struct img source = lead->img;
+    const pl_rect2df source_ref = lead->ref_rect;
+    struct img levels[MAX_MULTI_TARGETS];
+    int num_levels = 0;
+
+    for (int n = 0; n < num_shared; n++) {
+        struct pass_state *pass = &passes[order[n]];
+        if (pass != lead) {
+            pl_dispatch_callback(rr->dp, pass, info_callback);
+            pass->alias_fbos = !params->num_hooks;
+        }
+
+        // Intermediates stay acquired by their respective passes until the
+        // end, so they can't be handed out to other targets in the meantime
+        pass->peak_done = true;
+
+        // Start from the smallest available image that is at least as large
+        // as this target, i.e. the nearest level of the pyramid
+        const int out_w = abs(pl_rect_w(pass->dst_rect)),
+                  out_h = abs(pl_rect_h(pass->dst_rect));
+        pass->img = source;
+        pass->ref_rect = source_ref;
+        float best_w = fabsf(pl_rect_w(source.rect)),
+              best_h = fabsf(pl_rect_h(source.rect));
+        for (int i = 0; i < num_levels; i++) {
+            const struct img *lvl = &levels[i];
+            if (lvl->w < out_w || lvl->h < out_h)
+                continue;
+            if (lvl->w * lvl->h < best_w * best_h) {
+                pass->img = *lvl;
+                pass->ref_rect = lvl->rect;
+                best_w = lvl->w;
+                best_h = lvl->h;
+            }
+        }
+
+        if (!pass_scale_main(pass))
+            goto error;
+
+        // Keep this result around if it's a useful level for smaller targets
+        bool want_level = false;
+        if (use_pyramid && out_w < best_w && out_h < best_h) {
+            for (int m = n + 1; m < num_shared; m++) {
+                const pl_rect2d *rc = &passes[order[m]].dst_rect;
+                want_level |= abs(pl_rect_w(*rc)) <= out_w &&
+                              abs(pl_rect_h(*rc)) <= out_h;
+            }
+        }
+
+        if (want_level) {
+            img_sh(pass, &pass->img); // force a new texture at the output size
+            if (!img_tex(pass, &pass->img))
+                goto error;
+            levels[num_levels++] = pass->img;
+        }
+
+        pass_convert_colors(pass);
+        if (!pass_output_target(pass))
+            goto error;
+    }
+
+    for (int n = 0; n < num_shared; n++)
+        pass_uninit(&passes[order[n]]);
+
+    // Render all remaining targets individually
+    for (int i = 1; i < num_targets; i++) {
+        if (!shared[i])
+            ok &= pl_render_image(rr, pimage, &targets[i], params);
+    }
+
+    return ok;
+
+error:
+    PL_ERR(rr, "Failed rendering image!");
+    for (int n = 0; n < num_shared; n++)
+        pass_uninit(&passes[order[n]]);
+    return false;
+
+fallback:
+    for (int i = 0; i < num_targets; i++)
+        ok &= pl_render_image(rr, pimage, &targets[i], params);
+    return ok;
+}
+
+const struct pl_frame *pl_frame_mix_current(const struct pl_frame_mix *mix)
+{
+    const struct pl_frame *cur = NULL;
+    for (int i = 0; i < mix->num_frames; i++) {
+        if (mix->timestamps[i] > 0.0f)
+            break;
+        cur = mix->frames[i];
+    }
+
+    return cur;
+}
+
+const struct pl_frame *pl_frame_mix_nearest(const struct pl_frame_mix *mix)
+{
+    if (!mix->num_frames)
+        return NULL;
+
+    const struct pl_frame *best = mix->frames[0];
+    float best_dist = fabsf(mix->timestamps[0]);
+    for (int i = 1; i < mix->num_frames; i++) {
+        float dist = fabsf(mix->timestamps[i]);
+        if (dist < best_dist) {
+            best = mix->frames[i];
+            best_dist = dist;
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    return best;
+}
+
+#define MAX_MIX_FRAMES 16
+
+// Picks the format used to store a frame with `comps` components in the frame
+// mixing cache
+static pl_fmt mix_cache_fmt(const struct pass_state *pass, int comps)
+{
+    pl_fmt fbofmt = pass->fbofmt[4];
+    if (!pass->params->mixing_cache_reduced_precision)
+        return fbofmt;
+
+    // Unorm formats would clip out-of-range values, which only happens to be
+    // harmless if the target is going to clip them anyway
+    pl_tex target = pass->target.planes[0].texture;
+    bool want_unorm = comps < 4 && target->params.format->type != PL_FMT_FLOAT;
+    const enum pl_fmt_caps caps = PL_FMT_CAP_SAMPLEABLE |
+                                  PL_FMT_CAP_RENDERABLE |
+                                  PL_FMT_CAP_LINEAR;
+
+    pl_gpu gpu = pass->rr->gpu;
+    pl_fmt best = fbofmt;
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n];
+        if (fmt->num_components != 4 || (fmt->caps & caps) != caps)
+            continue;
+        if (fmt->texel_size >= best->texel_size)
+            continue;
+
+        switch (fmt->type) {
+        case PL_FMT_UNORM:
+            // Alpha channel is irrelevant for opaque frames
+            if (!want_unorm || fmt->component_depth[0] < 10 ||
+                fmt->component_depth[1] < 10 || fmt->component_depth[2] < 10)
+                continue;
+            break;
+        case PL_FMT_FLOAT:
+            if (fmt->component_depth[0] < 16 || fmt->component_depth[3] < 16)
+                continue;
+            break;
+        default:
+            continue;
+        }
+
+        best = fmt;
+    }
+
+    return best;
+}
+
+static inline size_t mix_cache_size(pl_tex tex)
+{
+    return (size_t) tex->params.w * tex->params.h * tex->params.format->texel_size;
+}
+
+// Evicts frames no longer needed from the frame mixing cache, keeping as many
+// of the most recently used ones as fit into `mixing_cache_max_bytes`
+static void mix_cache_evict(pl_renderer rr, const struct pl_render_params *params)
+{
+    const size_t max_bytes = params->mixing_cache_max_bytes;
+    if (!max_bytes) {
+        for (int i = 0; i < rr->frames.num; ) {
+            if (rr->frames.elem[i].evict) {
+                PL_TRACE(rr, "Evicting frame with signature %llx from cache",
+                         (unsigned long long) rr->frames.elem[i].signature);
+                PL_ARRAY_APPEND(rr, rr->frame_fbos, rr->frames.elem[i].tex);
+                PL_ARRAY_REMOVE_AT(rr->frames, i);
+                continue;
+            } else {
+                i++;
+            }
+        }
+        return;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < rr->frames.num; i++) {
+        if (rr->frames.elem[i].tex)
+            total += mix_cache_size(rr->frames.elem[i].tex);
+    }
+    for (int i = 0; i < rr->frame_fbos.num; i++)
+        total += mix_cache_size(rr->frame_fbos.elem[i]);
+
+    // Spare textures go first, since they hold no cached frames
+    while (total > max_bytes && rr->frame_fbos.num) {
+        pl_tex tex = rr->frame_fbos.elem[--rr->frame_fbos.num];
+        total -= mix_cache_size(tex);
+        pl_tex_destroy(rr->gpu, &tex);
+    }
+
+    while (total > max_bytes) {
+        int lru = -1;
+        for (int i = 0; i < rr->frames.num; i++) {
+            const struct cached_frame *f = &rr->frames.elem[i];
+            if (f->evict && (lru < 0 || f->last_used < rr->frames.elem[lru].last_used))
+                lru = i;
+        }
+        if (lru < 0)
+            break; // all remaining frames are in use
+
+        struct cached_frame *f = &rr->frames.elem[lru];
+        PL_TRACE(rr, "Evicting frame with signature %llx from cache",
+                 (unsigned long long) f->signature);
+        if (f->tex) {
+            total -= mix_cache_size(f->tex);
+            pl_tex_destroy(rr->gpu, &f->tex);
+        }
+        PL_ARRAY_REMOVE_AT(rr->frames, lru);
+    }
+}
+
+bool pl_render_image_multi(pl_renderer rr, const struct pl_frame *pimage,
+                           const struct pl_frame *targets, int num_targets,
+                           const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    pl_clock_t start = pl_clock_now();
+    bool ok = render_image_multi(rr, pimage, targets, num_targets, params);
+    report_span(rr, params, PL_RENDER_SPAN_FRAME, PL_RENDER_STAGE_FRAME,
+                "pl_render_image_multi", start);
+    return ok;
+}
+
+// Frames with a smaller (absolute) weight are left out of the mix
+#define MIX_WEIGHT_CUTOFF 1e-3f
+
+// Blurs the frame mixer according to the vsync ratio (source / display)
+static void mix_blur_mixer(const struct pl_frame_mix *images,
+                           const struct pl_render_params *params,
+                           struct pl_filter_config *mixer)
+{
+    if (!params->frame_mixer)
+        return;
+
+    *mixer = *params->frame_mixer;
+    mixer->blur = PL_DEF(mixer->blur, 1.0);
+    for (int i = 1; i < images->num_frames; i++) {
+        if (images->timestamps[i] >= 0.0 && images->timestamps[i - 1] < 0) {
+            float frame_dur = images->timestamps[i] - images->timestamps[i - 1];
+            if (images->vsync_duration > frame_dur && !params->skip_anti_aliasing)
+                mixer->blur *= images->vsync_duration / frame_dur;
+            break;
+        }
+    }
+}
+
+// Computes the mixing weight of frame `i`, before normalization. Returns false
+// if the frame does not contribute to the mix at all.
+static bool mix_frame_weight(pl_log log, const struct pl_frame_mix *images,
+                             int i, const struct pl_frame *refimg,
+                             const struct pl_filter_config *mixer,
+                             bool single_frame, float *weight)
+{
+    float rts = images->timestamps[i];
+    const struct pl_frame *img = images->frames[i];
+    pl_trace(log, "Considering image with signature 0x%llx, rts %f",
+             (unsigned long long) images->signatures[i], rts);
+
+    // Combining images with different rotations is basically unfeasible
+    if (pl_rotation_normalize(img->rotation - refimg->rotation)) {
+        pl_trace(log, "  -> Skipping: incompatible rotation");
+        return false;
+    }
+
+    if (single_frame) {
+
+        // Only render the refimg, ignore others
+        if (img != refimg) {
+            pl_trace(log, "  -> Skipping: no frame mixer");
+            return false;
+        }
+
+        *weight = 1.0;
+
+    // For backwards compatibility, treat !kernel as oversample
+    } else if (!mixer->kernel || mixer->kernel == &pl_filter_function_oversample) {
+
+        // Compute the visible interval [rts, end] of this frame
+        float end = i+1 < images->num_frames ? images->timestamps[i+1] : INFINITY;
+        if (rts > images->vsync_duration || end < 0.0) {
+            pl_trace(log, "  -> Skipping: no intersection with vsync");
+            return false;
+        } else {
+            rts = PL_MAX(rts, 0.0);
+            end = PL_MIN(end, images->vsync_duration);
+            pl_assert(end >= rts);
+        }
+
+        // Weight is the fraction of vsync interval that frame is visible
+        *weight = (end - rts) / images->vsync_duration;
+        pl_trace(log, "  -> Frame [%f, %f] intersects [%f, %f] = weight %f",
+                 rts, end, 0.0, images->vsync_duration, *weight);
+
+        if (*weight < mixer->kernel->params[0]) {
+            pl_trace(log, "     (culling due to threshold)");
+            *weight = 0.0;
+        }
+
+    } else {
+
+        const float radius = pl_filter_radius_bound(mixer);
+        if (fabsf(rts) >= radius) {
+            pl_trace(log, "  -> Skipping: outside filter radius (%f)", radius);
+            return false;
+        }
+
+        // Weight is directly sampled from the filter
+        *weight = pl_filter_sample(mixer, rts);
+        pl_trace(log, "  -> Filter offset %f = weight %f", rts, *weight);
+
+    }
+
+    return true;
+}
+
+static bool render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                             const struct pl_frame *ptarget,
+                             const struct pl_render_params *params)
+{
+    if (!images->num_frames)
+        return pl_render_image(rr, NULL, ptarget, params);
+
+    params = PL_DEF(params, &pl_render_default_params);
+    struct params_info par_info = render_params_info(params);
+    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+
+    require(images->num_frames >= 1);
+    require(images->vsync_duration > 0.0);
+    for (int i = 0; i < images->num_frames - 1; i++)
+        require(images->timestamps[i] <= images->timestamps[i+1]);
 
     const struct pl_frame *refimg = pl_frame_mix_nearest(images);
     struct pass_state pass = {
@@ -3363,92 +4794,26 @@ bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
     // not determined to still be required
     for (int i = 0; i < rr->frames.num; i++)
         rr->frames.elem[i].evict = true;
-
-    // Blur frame mixer according to vsync ratio (source / display)
-    struct pl_filter_config mixer;
-    if (params->frame_mixer) {
-        mixer = *params->frame_mixer;
-        mixer.blur = PL_DEF(mixer.blur, 1.0);
-        for (int i = 1; i < images->num_frames; i++) {
-            if (images->timestamps[i] >= 0.0 && images->timestamps[i - 1] < 0) {
-                float frame_dur = images->timestamps[i] - images->timestamps[i - 1];
-                if (images->vsync_duration > frame_dur && !params->skip_anti_aliasing)
-                    mixer.blur *= images->vsync_duration / frame_dur;
-                break;
-            }
-        }
-    }
+    rr->frame_tick++;
 
     // Traverse the input frames and determine/prepare the ones we need
+    struct pl_filter_config mixer;
+    mix_blur_mixer(images, params, &mixer);
     bool single_frame = !params->frame_mixer || images->num_frames == 1;
 retry:
     for (int i = 0; i < images->num_frames; i++) {
         uint64_t sig = images->signatures[i];
-        float rts = images->timestamps[i];
         const struct pl_frame *img = images->frames[i];
-        PL_TRACE(rr, "Considering image with signature 0x%llx, rts %f",
-                 (unsigned long long) sig, rts);
-
-        // Combining images with different rotations is basically unfeasible
-        if (pl_rotation_normalize(img->rotation - refimg->rotation)) {
-            PL_TRACE(rr, "  -> Skipping: incompatible rotation");
-            continue;
-        }
-
         float weight;
-        if (single_frame) {
-
-            // Only render the refimg, ignore others
-            if (img == refimg) {
-                weight = 1.0;
-            } else {
-                PL_TRACE(rr, "  -> Skipping: no frame mixer");
-                continue;
-            }
-
-        // For backwards compatibility, treat !kernel as oversample
-        } else if (!mixer.kernel || mixer.kernel == &pl_filter_function_oversample) {
-
-            // Compute the visible interval [rts, end] of this frame
-            float end = i+1 < images->num_frames ? images->timestamps[i+1] : INFINITY;
-            if (rts > images->vsync_duration || end < 0.0) {
-                PL_TRACE(rr, "  -> Skipping: no intersection with vsync");
-                continue;
-            } else {
-                rts = PL_MAX(rts, 0.0);
-                end = PL_MIN(end, images->vsync_duration);
-                pl_assert(end >= rts);
-            }
-
-            // Weight is the fraction of vsync interval that frame is visible
-            weight = (end - rts) / images->vsync_duration;
-            PL_TRACE(rr, "  -> Frame [%f, %f] intersects [%f, %f] = weight %f",
-                     rts, end, 0.0, images->vsync_duration, weight);
-
-            if (weight < mixer.kernel->params[0]) {
-                PL_TRACE(rr, "     (culling due to threshold)");
-                weight = 0.0;
-            }
-
-        } else {
-
-            const float radius = pl_filter_radius_bound(&mixer);
-            if (fabsf(rts) >= radius) {
-                PL_TRACE(rr, "  -> Skipping: outside filter radius (%f)", radius);
-                continue;
-            }
-
-            // Weight is directly sampled from the filter
-            weight = pl_filter_sample(&mixer, rts);
-            PL_TRACE(rr, "  -> Filter offset %f = weight %f", rts, weight);
-
-        }
+        if (!mix_frame_weight(rr->log, images, i, refimg, &mixer, single_frame, &weight))
+            continue;
 
         struct cached_frame *f = NULL;
         for (int j = 0; j < rr->frames.num; j++) {
             if (rr->frames.elem[j].signature == sig) {
                 f = &rr->frames.elem[j];
                 f->evict = false;
+                f->last_used = rr->frame_tick;
                 break;
             }
         }
@@ -3457,10 +4822,9 @@ retry:
         // above to make sure these frames don't get evicted just yet, and
         // also exclude the reference image from this optimization to ensure
         // that we always have at least one frame.
-        const float cutoff = 1e-3;
-        if (fabsf(weight) <= cutoff && img != refimg) {
+        if (fabsf(weight) <= MIX_WEIGHT_CUTOFF && img != refimg) {
             PL_TRACE(rr, "   -> Skipping: weight (%f) below threshold (%f)",
-                     weight, cutoff);
+                     weight, MIX_WEIGHT_CUTOFF);
             continue;
         }
 
@@ -3477,6 +4841,7 @@ retry:
             f = &rr->frames.elem[rr->frames.num++];
             *f = (struct cached_frame) {
                 .signature = sig,
+                .last_used = rr->frame_tick,
             };
         }
 
@@ -3488,6 +4853,7 @@ retry:
         if (can_reuse && strict_reuse) {
             can_reuse = f->tex->params.w == out_w &&
                         f->tex->params.h == out_h &&
+                        f->tex->params.format == mix_cache_fmt(&pass, f->comps) &&
                         pl_rect2d_eq(f->crop, img->crop) &&
                         f->params_hash == par_info.hash &&
                         pl_color_space_equal(&f->color, &target->color) &&
@@ -3502,28 +4868,6 @@ retry:
         if (!can_reuse) {
             // If we can't reuse the entry, we need to re-render this frame
             PL_TRACE(rr, "  -> Cached texture missing or invalid.. (re)creating");
-            if (!f->tex) {
-                if (PL_ARRAY_POP(rr->frame_fbos, &f->tex))
-                    pl_tex_invalidate(rr->gpu, f->tex);
-            }
-
-            bool ok = pl_tex_recreate(rr->gpu, &f->tex, pl_tex_params(
-                .w = out_w,
-                .h = out_h,
-                .format = pass.fbofmt[4],
-                .sampleable = true,
-                .renderable = true,
-                .blit_dst = pass.fbofmt[4]->caps & PL_FMT_CAP_BLITTABLE,
-                .storable = pass.fbofmt[4]->caps & PL_FMT_CAP_STORABLE,
-            ));
-
-            if (!ok) {
-                PL_ERR(rr, "Could not create intermediate texture for "
-                       "frame mixing.. disabling!");
-                rr->errors |= PL_RENDER_ERR_FRAME_MIXING;
-                goto fallback;
-            }
-
             struct pass_state inter_pass = {
                 .rr = rr,
                 .params = pass.params,
@@ -3538,6 +4882,7 @@ retry:
             if (!pass_init(&inter_pass, true))
                 goto fail;
 
+            bool ok;
             pass_begin_frame(&inter_pass);
             if (!(ok = pass_read_image(&inter_pass)))
                 goto inter_pass_error;
@@ -3552,6 +4897,33 @@ retry:
             pl_assert(inter_pass.img.w == out_w &&
                       inter_pass.img.h == out_h);
 
+            // The storage format depends on the number of components, so only
+            // (re)create the texture once those are known
+            if (!f->tex) {
+                if (PL_ARRAY_POP(rr->frame_fbos, &f->tex))
+                    pl_tex_invalidate(rr->gpu, f->tex);
+            }
+
+            pl_fmt fmt = mix_cache_fmt(&pass, inter_pass.img.comps);
+            ok = pl_tex_recreate(rr->gpu, &f->tex, pl_tex_params(
+                .w = out_w,
+                .h = out_h,
+                .format = fmt,
+                .sampleable = true,
+                .renderable = true,
+                .blit_dst = fmt->caps & PL_FMT_CAP_BLITTABLE,
+                .storable = fmt->caps & PL_FMT_CAP_STORABLE,
+            ));
+
+            if (!ok) {
+                PL_ERR(rr, "Could not create intermediate texture for "
+                       "frame mixing.. disabling!");
+                rr->errors |= PL_RENDER_ERR_FRAME_MIXING;
+                inter_pass.acquired.target = false; // don't release target
+                pass_uninit(&inter_pass);
+                goto fallback;
+            }
+
             ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
                 .shader = &inter_pass.img.sh,
                 .target = f->tex,
@@ -3604,17 +4976,7 @@ inter_pass_error:
     }
 
     // Evict the frames we *don't* need
-    for (int i = 0; i < rr->frames.num; ) {
-        if (rr->frames.elem[i].evict) {
-            PL_TRACE(rr, "Evicting frame with signature %llx from cache",
-                     (unsigned long long) rr->frames.elem[i].signature);
-            PL_ARRAY_APPEND(rr, rr->frame_fbos, rr->frames.elem[i].tex);
-            PL_ARRAY_REMOVE_AT(rr->frames, i);
-            continue;
-        } else {
-            i++;
-        }
-    }
+    mix_cache_evict(rr, params);
 
     // If we got back no frames, retry with ZOH semantics
     if (!fidx) {
@@ -3710,6 +5072,126 @@ error: // for parameter validation failures
     return false;
 }
 
+// Returns a key identifying the output of a pl_render_image_mix invocation,
+// or 0 if the output can't be reused
+static uint64_t mix_output_key(pl_renderer rr, const struct pl_frame_mix *images,
+                               const struct pl_frame *target,
+                               const struct pl_render_params *params)
+{
+    if (!params->skip_redundant_frames || !images->num_frames)
+        return 0;
+    if (!output_reusable(target, params))
+        return 0;
+
+    // Hash the frames and weights actually selected by `render_image_mix`,
+    // rather than the raw timestamps, which shift on every vsync even when
+    // the result stays the same
+    uint64_t key = render_params_info(params).output_hash;
+    pl_hash_merge(&key, rr->errors);
+    const struct pl_frame *refimg = pl_frame_mix_nearest(images);
+    struct pl_filter_config mixer;
+    mix_blur_mixer(images, params, &mixer);
+    bool single_frame = !params->frame_mixer || images->num_frames == 1;
+    int num_frames = 0;
+retry:
+    for (int i = 0; i < images->num_frames; i++) {
+        const struct pl_frame *img = images->frames[i];
+        float weight;
+        if (!mix_frame_weight(NULL, images, i, refimg, &mixer, single_frame, &weight))
+            continue;
+        if (fabsf(weight) <= MIX_WEIGHT_CUTOFF && img != refimg)
+            continue;
+        pl_hash_merge(&key, images->signatures[i]);
+        pl_hash_merge(&key, pl_var_hash(weight));
+        pl_hash_merge(&key, pl_var_hash(img->crop));
+        pl_hash_merge(&key, pl_var_hash(img->rotation));
+        num_frames++;
+    }
+
+    if (!num_frames && !single_frame) {
+        single_frame = true;
+        goto retry;
+    }
+
+    hash_frame(&key, target, true, true);
+    return PL_DEF(key, 1);
+}
+
+static bool render_mix_or_reuse(pl_renderer rr, const struct pl_frame_mix *images,
+                                const struct pl_frame *target,
+                                const struct pl_render_params *params)
+{
+    const uint64_t key = mix_output_key(rr, images, target, params);
+    pl_tex tex = key ? target->planes[0].texture : NULL;
+
+    if (key && key == rr->prev_output_key) {
+        pl_assert(rr->prev_output);
+        PL_TRACE(rr, "Frame mix identical to previous call, reusing output");
+        pl_tex_blit(rr->gpu, pl_tex_blit_params(
+            .src = rr->prev_output,
+            .dst = tex,
+        ));
+        rr->frames_reused++;
+        return true;
+    }
+
+    rr->prev_output_key = 0;
+    rr->frames_rendered++;
+    if (!key)
+        return render_image_mix(rr, images, target, params);
+
+    // Keep a copy of the output around for the next call. Targets that can't
+    // be copied from (e.g. swapchain images) are rendered into the copy first
+    const bool direct = tex->params.blit_src;
+    bool ok = pl_tex_recreate(rr->gpu, &rr->prev_output, pl_tex_params(
+        .w          = tex->params.w,
+        .h          = tex->params.h,
+        .d          = tex->params.d,
+        .format     = tex->params.format,
+        .renderable = !direct && tex->params.renderable,
+        .storable   = !direct && tex->params.storable,
+        .blit_src   = true,
+        .blit_dst   = true,
+        .debug_tag  = PL_DEBUG_TAG,
+    ));
+
+    if (!ok)
+        return render_image_mix(rr, images, target, params);
+
+    if (direct) {
+        if (!render_image_mix(rr, images, target, params))
+            return false;
+        pl_tex_blit(rr->gpu, pl_tex_blit_params(
+            .src = tex,
+            .dst = rr->prev_output,
+        ));
+    } else {
+        struct pl_frame inter = *target;
+        inter.planes[0].texture = rr->prev_output;
+        if (!render_image_mix(rr, images, &inter, params))
+            return false;
+        pl_tex_blit(rr->gpu, pl_tex_blit_params(
+            .src = rr->prev_output,
+            .dst = tex,
+        ));
+    }
+
+    rr->prev_output_key = key;
+    return true;
+}
+
+bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                         const struct pl_frame *target,
+                         const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    pl_clock_t start = pl_clock_now();
+    bool ok = render_mix_or_reuse(rr, images, target, params);
+    report_span(rr, params, PL_RENDER_SPAN_FRAME, PL_RENDER_STAGE_BLEND,
+                "pl_render_image_mix", start);
+    return ok;
+}
+
 void pl_frames_infer_mix(pl_renderer rr, const struct pl_frame_mix *mix,
                          struct pl_frame *target, struct pl_frame *out_ref)
 {
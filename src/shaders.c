@@ -62,6 +62,7 @@ static struct sh_info *sh_info_recycle(struct sh_info *info)
     pl_rc_ref(&info->rc);
     info->desc.len = 0;
     info->steps.num = 0;
+    info->lut_time = 0;
     return info;
 }
 
@@ -725,6 +726,8 @@ ident_t sh_subpass(pl_shader sh, pl_shader sub)
     // Steal the shader steps array (and allocations)
     pl_assert(pl_rc_count(&sub->info->rc) == 1);
     PL_ARRAY_CONCAT(sh->info, sh->info->steps, sub->info->steps);
+    sh->info->lut_time += sub->info->lut_time;
+    sub->info->lut_time = 0;
     pl_steal(sh->info->tmp, sub->info->tmp);
     sub->info->tmp = pl_tmp(sub->info);
     sub->info->steps.num = 0; // sanity
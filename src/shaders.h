@@ -80,6 +80,7 @@ struct sh_info {
     pl_rc_t rc;
     pl_str desc;
     PL_ARRAY(const char *) steps;
+    uint64_t lut_time; // CPU time spent generating LUTs, in nanoseconds
 };
 
 struct pl_shader_t {
@@ -60,6 +60,45 @@ struct shexp {
     } val;
 };
 
+// Compiled form of `struct shexp`, with all names resolved to indices
+enum shexp_opc {
+    SHEXP_OPC_CONST,    // Push `cval`
+    SHEXP_OPC_PARAM,    // Push the value of hook parameter `idx`
+    SHEXP_OPC_TEX_W,    // Push the width/height of saved texture `idx`
+    SHEXP_OPC_TEX_H,
+    SHEXP_OPC_HOOKED_W, // Push the width/height of the hooked texture
+    SHEXP_OPC_HOOKED_H,
+    SHEXP_OPC_NATIVE_W, // Push the width/height of the cropped source
+    SHEXP_OPC_NATIVE_H,
+    SHEXP_OPC_OUTPUT_W, // Push the width/height of the output rect
+    SHEXP_OPC_OUTPUT_H,
+    SHEXP_OPC_ADD,      // Dyadic operators, replace the top two elements
+    SHEXP_OPC_SUB,
+    SHEXP_OPC_MUL,
+    SHEXP_OPC_DIV,
+    SHEXP_OPC_MOD,
+    SHEXP_OPC_GT,
+    SHEXP_OPC_LT,
+    SHEXP_OPC_EQ,
+    SHEXP_OPC_NOT,      // Monadic operator, replaces the top element
+};
+
+struct shexp_insn {
+    uint8_t opc;
+    uint16_t idx;
+    float cval;
+};
+
+struct shexp_prog {
+    struct shexp_insn code[MAX_SHEXP_SIZE];
+    int len;
+
+    // If set, evaluating this program fails with the corresponding warning.
+    // Stack depth is validated at compile time, so evaluation is unchecked.
+    const char *error;
+    pl_str error_var;
+};
+
 struct custom_shader_hook {
     // Variable/literal names of textures
     pl_str pass_desc;
@@ -302,6 +341,42 @@ static bool parse_hook(pl_log log, pl_str *body, struct custom_shader_hook *out)
     return true;
 }
 
+// Decodes embedded hex data, which can be slow for large payloads. The decoded
+// result is cached in the GPU's `pl_cache`, keyed by the hash of the hex data.
+//
+// Note: Only the decoded payloads are cached, not the parsed hook set itself.
+// The parsed result is mostly pointers into the source string plus GPU
+// objects, neither of which can be serialized, and re-parsing the headers is
+// cheap compared to decoding the embedded data.
+static bool decode_hex(pl_gpu gpu, void *alloc, pl_str hex, pl_str *out)
+{
+    pl_cache cache = pl_gpu_cache(gpu);
+    pl_cache_obj obj = { .key = CACHE_KEY_USER_DATA };
+    if (cache) {
+        pl_hash_merge(&obj.key, pl_str_hash(hex));
+        if (pl_cache_get(cache, &obj)) {
+            PL_DEBUG(gpu, "Re-using cached shader data (0x%"PRIx64") with "
+                     "size %zu", obj.key, obj.size);
+            *out = pl_strdup(alloc, (pl_str) { obj.data, obj.size });
+            pl_cache_set(cache, &obj);
+            return true;
+        }
+    }
+
+    pl_clock_t start = pl_clock_now();
+    if (!pl_str_decode_hex(alloc, hex, out))
+        return false;
+    pl_log_cpu_time(gpu->log, start, pl_clock_now(), "decoding shader data");
+
+    if (cache && out->len) {
+        obj.data = out->buf;
+        obj.size = out->len;
+        pl_cache_set(cache, &obj); // makes an internal copy
+    }
+
+    return true;
+}
+
 static bool parse_tex(pl_gpu gpu, void *alloc, pl_str *body,
                       struct pl_shader_desc *out)
 {
@@ -467,7 +542,7 @@ static bool parse_tex(pl_gpu gpu, void *alloc, pl_str *body,
     // Decode the rest of the section (up to the next //! marker) as raw hex
     // data for the texture
     pl_str tex, hexdata = split_magic(body);
-    if (!pl_str_decode_hex(NULL, pl_str_strip(hexdata), &tex)) {
+    if (!decode_hex(gpu, NULL, pl_str_strip(hexdata), &tex)) {
         PL_ERR(gpu, "Error while parsing TEXTURE body: must be a valid "
                     "hexadecimal sequence!");
         return false;
@@ -584,7 +659,7 @@ static bool parse_buf(pl_gpu gpu, void *alloc, pl_str *body,
     // Decode the rest of the section (up to the next //! marker) as raw hex
     // data for the buffer
     pl_str data, hexdata = split_magic(body);
-    if (!pl_str_decode_hex(tmp, pl_str_strip(hexdata), &data)) {
+    if (!decode_hex(gpu, tmp, pl_str_strip(hexdata), &data)) {
         PL_ERR(gpu, "Error while parsing BUFFER body: must be a valid "
                     "hexadecimal sequence!");
         return false;
@@ -904,10 +979,15 @@ static pl_str pl_stage_to_mp(enum pl_hook_stage stage)
 struct hook_pass {
     enum pl_hook_stage exec_stages;
     struct custom_shader_hook hook;
+
+    // Compiled expressions and resolved texture names
+    struct shexp_prog width, height, cond;
+    int save_id;
 };
 
 struct pass_tex {
     pl_str name;
+    int id; // index into `hook_priv.tex_names`
     pl_tex tex;
 
     // Metadata
@@ -928,6 +1008,13 @@ struct hook_priv {
     // Fixed (for shader-local resources)
     PL_ARRAY(struct pl_shader_desc) descriptors;
 
+    // Interned texture names, referenced by index from compiled expressions
+    PL_ARRAY(pl_str) tex_names;
+    int stage_ids[16]; // indexed by log2(pl_hook_stage)
+
+    // If set, all passes are pointwise and get fused into the hooked shader
+    bool fused;
+
     // Dynamic per pass
     enum pl_hook_stage save_stages;
     PL_ARRAY(struct pass_tex) pass_textures;
@@ -951,173 +1038,222 @@ struct hook_ctx {
     struct pass_tex hooked;
 };
 
-static bool lookup_tex(struct hook_ctx *ctx, pl_str var, float size[2])
+static int tex_id(struct hook_priv *p, pl_str name)
 {
-    struct hook_priv *p = ctx->priv;
-    const struct pl_hook_params *params = ctx->params;
-
-    if (pl_str_equals0(var, "HOOKED")) {
-        pl_assert(ctx->hooked.tex);
-        size[0] = ctx->hooked.tex->params.w;
-        size[1] = ctx->hooked.tex->params.h;
-        return true;
-    }
-
-    if (pl_str_equals0(var, "NATIVE_CROPPED")) {
-        size[0] = fabs(pl_rect_w(params->src_rect));
-        size[1] = fabs(pl_rect_h(params->src_rect));
-        return true;
-    }
-
-    if (pl_str_equals0(var, "OUTPUT")) {
-        size[0] = abs(pl_rect_w(params->dst_rect));
-        size[1] = abs(pl_rect_h(params->dst_rect));
-        return true;
-    }
-
-    if (pl_str_equals0(var, "MAIN"))
-        var = pl_str0("MAINPRESUB");
+    if (pl_str_equals0(name, "MAIN"))
+        name = pl_str0("MAINPRESUB");
 
-    for (int i = 0; i < p->pass_textures.num; i++) {
-        if (pl_str_equals(var, p->pass_textures.elem[i].name)) {
-            pl_tex tex = p->pass_textures.elem[i].tex;
-            size[0] = tex->params.w;
-            size[1] = tex->params.h;
-            return true;
-        }
+    for (int i = 0; i < p->tex_names.num; i++) {
+        if (pl_str_equals(name, p->tex_names.elem[i]))
+            return i;
     }
 
-    return false;
+    PL_ARRAY_APPEND(p->alloc, p->tex_names, name);
+    return p->tex_names.num - 1;
 }
 
-static bool lookup_var(struct hook_ctx *ctx, pl_str var, float *val)
+static inline int stage_id(const struct hook_priv *p, enum pl_hook_stage stage)
 {
-    struct hook_priv *p = ctx->priv;
-    for (int i = 0; i < p->hook_params.num; i++) {
-        const struct pl_hook_par *hp = &p->hook_params.elem[i];
-        if (pl_str_equals0(var, hp->name)) {
-            switch (hp->type) {
-            case PL_VAR_SINT:  *val = hp->data->i; return true;
-            case PL_VAR_UINT:  *val = hp->data->u; return true;
-            case PL_VAR_FLOAT: *val = hp->data->f; return true;
-            case PL_VAR_INVALID:
-            case PL_VAR_TYPE_COUNT:
-                break;
-            }
-
-            pl_unreachable();
-        }
-
-        if (hp->names) {
-            for (int j = hp->minimum.i; j <= hp->maximum.i; j++) {
-                if (pl_str_equals0(var, hp->names[j])) {
-                    *val = j;
-                    return true;
-                }
-            }
-        }
-    }
-
-    PL_WARN(p, "Variable '%.*s' not found in RPN expression!", PL_STR_FMT(var));
-    return false;
+    return p->stage_ids[__builtin_ctz(stage)];
 }
 
-// Returns whether successful. 'result' is left untouched on failure
-static bool eval_shexpr(struct hook_ctx *ctx,
-                        const struct shexp expr[MAX_SHEXP_SIZE],
-                        float *result)
+// Resolves all names in `expr` and validates the stack depth
+static void compile_shexpr(struct hook_priv *p,
+                           const struct shexp expr[MAX_SHEXP_SIZE],
+                           struct shexp_prog *out)
 {
-    struct hook_priv *p = ctx->priv;
-    float stack[MAX_SHEXP_SIZE] = {0};
-    int idx = 0; // points to next element to push
+    *out = (struct shexp_prog) {0};
+    int depth = 0;
 
-    for (int i = 0; i < MAX_SHEXP_SIZE; i++) {
+    for (int i = 0; i < MAX_SHEXP_SIZE && expr[i].tag != SHEXP_END; i++) {
+        struct shexp_insn *insn = &out->code[out->len++];
         switch (expr[i].tag) {
         case SHEXP_END:
-            goto done;
+            pl_unreachable();
 
         case SHEXP_CONST:
-            // Since our SHEXPs are bound by MAX_SHEXP_SIZE, it should be
-            // impossible to overflow the stack
-            assert(idx < MAX_SHEXP_SIZE);
-            stack[idx++] = expr[i].val.cval;
+            insn->opc = SHEXP_OPC_CONST;
+            insn->cval = expr[i].val.cval;
+            depth++;
             continue;
 
         case SHEXP_OP1:
-            if (idx < 1) {
-                PL_WARN(p, "Stack underflow in RPN expression!");
-                return false;
-            }
-
-            switch (expr[i].val.op) {
-            case SHEXP_OP_NOT: stack[idx-1] = !stack[idx-1]; break;
-            default: pl_unreachable();
+            if (depth < 1) {
+                out->error = "Stack underflow in RPN expression!";
+                return;
             }
+            insn->opc = SHEXP_OPC_NOT;
             continue;
 
         case SHEXP_OP2:
-            if (idx < 2) {
-                PL_WARN(p, "Stack underflow in RPN expression!");
-                return false;
+            if (depth < 2) {
+                out->error = "Stack underflow in RPN expression!";
+                return;
             }
-
-            // Pop the operands in reverse order
-            float op2 = stack[--idx];
-            float op1 = stack[--idx];
-            float res = 0.0;
             switch (expr[i].val.op) {
-            case SHEXP_OP_ADD: res = op1 + op2; break;
-            case SHEXP_OP_SUB: res = op1 - op2; break;
-            case SHEXP_OP_MUL: res = op1 * op2; break;
-            case SHEXP_OP_DIV: res = op1 / op2; break;
-            case SHEXP_OP_MOD: res = fmodf(op1, op2); break;
-            case SHEXP_OP_GT:  res = op1 > op2; break;
-            case SHEXP_OP_LT:  res = op1 < op2; break;
-            case SHEXP_OP_EQ:  res = fabsf(op1 - op2) <= 1e-6 * fmaxf(op1, op2); break;
+            case SHEXP_OP_ADD: insn->opc = SHEXP_OPC_ADD; break;
+            case SHEXP_OP_SUB: insn->opc = SHEXP_OPC_SUB; break;
+            case SHEXP_OP_MUL: insn->opc = SHEXP_OPC_MUL; break;
+            case SHEXP_OP_DIV: insn->opc = SHEXP_OPC_DIV; break;
+            case SHEXP_OP_MOD: insn->opc = SHEXP_OPC_MOD; break;
+            case SHEXP_OP_GT:  insn->opc = SHEXP_OPC_GT;  break;
+            case SHEXP_OP_LT:  insn->opc = SHEXP_OPC_LT;  break;
+            case SHEXP_OP_EQ:  insn->opc = SHEXP_OPC_EQ;  break;
             case SHEXP_OP_NOT: pl_unreachable();
             }
-
-            if (!isfinite(res)) {
-                PL_WARN(p, "Illegal operation in RPN expression!");
-                return false;
-            }
-
-            stack[idx++] = res;
+            depth--;
             continue;
 
         case SHEXP_TEX_W:
         case SHEXP_TEX_H: {
             pl_str name = expr[i].val.varname;
-            float size[2];
-
-            if (!lookup_tex(ctx, name, size)) {
-                PL_WARN(p, "Variable '%.*s' not found in RPN expression!",
-                        PL_STR_FMT(name));
-                return false;
+            bool w = expr[i].tag == SHEXP_TEX_W;
+            if (pl_str_equals0(name, "HOOKED")) {
+                insn->opc = w ? SHEXP_OPC_HOOKED_W : SHEXP_OPC_HOOKED_H;
+            } else if (pl_str_equals0(name, "NATIVE_CROPPED")) {
+                insn->opc = w ? SHEXP_OPC_NATIVE_W : SHEXP_OPC_NATIVE_H;
+            } else if (pl_str_equals0(name, "OUTPUT")) {
+                insn->opc = w ? SHEXP_OPC_OUTPUT_W : SHEXP_OPC_OUTPUT_H;
+            } else {
+                insn->opc = w ? SHEXP_OPC_TEX_W : SHEXP_OPC_TEX_H;
+                insn->idx = tex_id(p, name);
             }
-
-            stack[idx++] = (expr[i].tag == SHEXP_TEX_W) ? size[0] : size[1];
+            depth++;
             continue;
         }
 
         case SHEXP_VAR: {
             pl_str name = expr[i].val.varname;
-            float val;
-            if (!lookup_var(ctx, name, &val))
-                return false;
-            stack[idx++] = val;
+            for (int n = 0; n < p->hook_params.num; n++) {
+                const struct pl_hook_par *hp = &p->hook_params.elem[n];
+                if (pl_str_equals0(name, hp->name)) {
+                    insn->opc = SHEXP_OPC_PARAM;
+                    insn->idx = n;
+                    goto found;
+                }
+
+                if (hp->names) {
+                    for (int j = hp->minimum.i; j <= hp->maximum.i; j++) {
+                        if (pl_str_equals0(name, hp->names[j])) {
+                            insn->opc = SHEXP_OPC_CONST;
+                            insn->cval = j;
+                            goto found;
+                        }
+                    }
+                }
+            }
+
+            out->error_var = name;
+            return;
+
+found:
+            depth++;
             continue;
         }
         }
     }
 
-done:
-    // Return the single stack element
-    if (idx != 1) {
-        PL_WARN(p, "Malformed stack after RPN expression!");
+    if (depth != 1)
+        out->error = "Malformed stack after RPN expression!";
+}
+
+static bool lookup_tex(struct hook_ctx *ctx, int id, float size[2])
+{
+    struct hook_priv *p = ctx->priv;
+    for (int i = 0; i < p->pass_textures.num; i++) {
+        if (p->pass_textures.elem[i].id == id) {
+            pl_tex tex = p->pass_textures.elem[i].tex;
+            size[0] = tex->params.w;
+            size[1] = tex->params.h;
+            return true;
+        }
+    }
+
+    PL_WARN(p, "Variable '%.*s' not found in RPN expression!",
+            PL_STR_FMT(p->tex_names.elem[id]));
+    return false;
+}
+
+static inline float param_value(const struct pl_hook_par *hp)
+{
+    switch (hp->type) {
+    case PL_VAR_SINT:  return hp->data->i;
+    case PL_VAR_UINT:  return hp->data->u;
+    case PL_VAR_FLOAT: return hp->data->f;
+    case PL_VAR_INVALID:
+    case PL_VAR_TYPE_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
+// Returns whether successful. 'result' is left untouched on failure
+static bool eval_shexpr(struct hook_ctx *ctx, const struct shexp_prog *prog,
+                        float *result)
+{
+    struct hook_priv *p = ctx->priv;
+    const struct pl_hook_params *params = ctx->params;
+    if (prog->error_var.len) {
+        PL_WARN(p, "Variable '%.*s' not found in RPN expression!",
+                PL_STR_FMT(prog->error_var));
+        return false;
+    } else if (prog->error) {
+        PL_WARN(p, "%s", prog->error);
         return false;
     }
 
+    float stack[MAX_SHEXP_SIZE];
+    int idx = 0; // points to next element to push
+    for (const struct shexp_insn *insn = prog->code; insn < &prog->code[prog->len]; insn++) {
+        const enum shexp_opc opc = insn->opc;
+        float size[2];
+        switch (opc) {
+        case SHEXP_OPC_CONST:    stack[idx++] = insn->cval; continue;
+        case SHEXP_OPC_PARAM:    stack[idx++] = param_value(&p->hook_params.elem[insn->idx]); continue;
+        case SHEXP_OPC_HOOKED_W: stack[idx++] = ctx->hooked.tex->params.w; continue;
+        case SHEXP_OPC_HOOKED_H: stack[idx++] = ctx->hooked.tex->params.h; continue;
+        case SHEXP_OPC_NATIVE_W: stack[idx++] = fabs(pl_rect_w(params->src_rect)); continue;
+        case SHEXP_OPC_NATIVE_H: stack[idx++] = fabs(pl_rect_h(params->src_rect)); continue;
+        case SHEXP_OPC_OUTPUT_W: stack[idx++] = abs(pl_rect_w(params->dst_rect)); continue;
+        case SHEXP_OPC_OUTPUT_H: stack[idx++] = abs(pl_rect_h(params->dst_rect)); continue;
+        case SHEXP_OPC_TEX_W:
+        case SHEXP_OPC_TEX_H:
+            if (!lookup_tex(ctx, insn->idx, size))
+                return false;
+            stack[idx++] = size[opc == SHEXP_OPC_TEX_H];
+            continue;
+        case SHEXP_OPC_NOT:
+            stack[idx-1] = !stack[idx-1];
+            continue;
+        default:
+            break;
+        }
+
+        // Pop the operands in reverse order
+        float op2 = stack[--idx];
+        float op1 = stack[idx-1];
+        float res = 0.0;
+        switch (opc) {
+        case SHEXP_OPC_ADD: res = op1 + op2; break;
+        case SHEXP_OPC_SUB: res = op1 - op2; break;
+        case SHEXP_OPC_MUL: res = op1 * op2; break;
+        case SHEXP_OPC_DIV: res = op1 / op2; break;
+        case SHEXP_OPC_MOD: res = fmodf(op1, op2); break;
+        case SHEXP_OPC_GT:  res = op1 > op2; break;
+        case SHEXP_OPC_LT:  res = op1 < op2; break;
+        case SHEXP_OPC_EQ:  res = fabsf(op1 - op2) <= 1e-6 * fmaxf(op1, op2); break;
+        default: pl_unreachable();
+        }
+
+        if (!isfinite(res)) {
+            PL_WARN(p, "Illegal operation in RPN expression!");
+            return false;
+        }
+
+        stack[idx-1] = res;
+    }
+
     *result = stack[0];
     return true;
 }
@@ -1219,7 +1355,7 @@ static void save_pass_tex(struct hook_priv *p, struct pass_tex ptex)
 {
 
     for (int i = 0; i < p->pass_textures.num; i++) {
-        if (!pl_str_equals(p->pass_textures.elem[i].name, ptex.name))
+        if (p->pass_textures.elem[i].id != ptex.id)
             continue;
 
         p->pass_textures.elem[i] = ptex;
@@ -1230,6 +1366,285 @@ static void save_pass_tex(struct hook_priv *p, struct pass_tex ptex)
     PL_ARRAY_APPEND(p->alloc, p->pass_textures, ptex);
 }
 
+// Set up the input variables and custom parameters
+static void bind_vars(struct hook_priv *p, pl_shader sh,
+                      const struct pl_hook_params *params)
+{
+    p->frame_count++;
+    GLSLH("#define frame "$" \n", sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_int("frame"),
+        .data = &p->frame_count,
+        .dynamic = true,
+    }));
+
+    float random = prng_step(p->prng_state);
+    GLSLH("#define random "$" \n", sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_float("random"),
+        .data = &random,
+        .dynamic = true,
+    }));
+
+    float src_size[2] = { pl_rect_w(params->src_rect), pl_rect_h(params->src_rect) };
+    GLSLH("#define input_size "$" \n", sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_vec2("input_size"),
+        .data = src_size,
+    }));
+
+    float dst_size[2] = { pl_rect_w(params->dst_rect), pl_rect_h(params->dst_rect) };
+    GLSLH("#define target_size "$" \n", sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_vec2("target_size"),
+        .data = dst_size,
+    }));
+
+    float tex_off[2] = { params->src_rect.x0, params->src_rect.y0 };
+    GLSLH("#define tex_offset "$" \n", sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_vec2("tex_offset"),
+        .data = tex_off,
+    }));
+
+    // Custom parameters
+    for (int i = 0; i < p->hook_params.num; i++) {
+        const struct pl_hook_par *hp = &p->hook_params.elem[i];
+        switch (hp->mode) {
+        case PL_HOOK_PAR_VARIABLE:
+        case PL_HOOK_PAR_DYNAMIC:
+            GLSLH("#define %s "$" \n", hp->name,
+                  sh_var(sh, (struct pl_shader_var) {
+                    .var = {
+                        .name = hp->name,
+                        .type = hp->type,
+                        .dim_v = 1,
+                        .dim_m = 1,
+                        .dim_a = 1,
+                    },
+                    .data = hp->data,
+                    .dynamic = hp->mode == PL_HOOK_PAR_DYNAMIC,
+            }));
+            break;
+
+        case PL_HOOK_PAR_CONSTANT:
+            GLSLH("#define %s "$" \n", hp->name,
+                  sh_const(sh, (struct pl_shader_const) {
+                    .name = hp->name,
+                    .type = hp->type,
+                    .data = hp->data,
+                    .compile_time = true,
+            }));
+            break;
+
+        case PL_HOOK_PAR_DEFINE:
+            GLSLH("#define %s %d \n", hp->name, hp->data->i);
+            break;
+
+        case PL_HOOK_PAR_MODE_COUNT:
+            pl_unreachable();
+        }
+
+        if (hp->names) {
+            for (int j = hp->minimum.i; j <= hp->maximum.i; j++)
+                GLSLH("#define %s %d \n", hp->names[j], j);
+        }
+    }
+}
+
+// Undoes `bind_vars`, for passes sharing a shader with other code
+static void unbind_vars(struct hook_priv *p, pl_shader sh)
+{
+    GLSLH("#undef frame \n"
+          "#undef random \n"
+          "#undef input_size \n"
+          "#undef target_size \n"
+          "#undef tex_offset \n");
+
+    for (int i = 0; i < p->hook_params.num; i++) {
+        const struct pl_hook_par *hp = &p->hook_params.elem[i];
+        GLSLH("#undef %s \n", hp->name);
+        if (hp->names) {
+            for (int j = hp->minimum.i; j <= hp->maximum.i; j++)
+                GLSLH("#undef %s \n", hp->names[j]);
+        }
+    }
+}
+
+// Appends a pointwise pass directly to the hooked shader, reading the
+// current pixel's color instead of sampling from a texture
+static void fuse_pass(struct hook_ctx *ctx, const struct custom_shader_hook *hook)
+{
+    struct hook_priv *p = ctx->priv;
+    const struct pl_hook_params *params = ctx->params;
+    pl_shader sh = params->sh;
+
+    struct pl_color_repr repr = ctx->hooked.repr;
+    ident_t scale = SH_FLOAT(pl_color_repr_normalize(&repr));
+    ident_t hooked = sh_fresh(sh, "hooked");
+    ident_t fn = sh_fresh(sh, "hook");
+
+    GLSLH("vec4 "$"; \n", hooked);
+    GLSLH("#define HOOKED_tex(pos) "$" \n", hooked);
+    GLSLH("#define HOOKED_texOff(off) "$" \n", hooked);
+    GLSLH("#define hook "$" \n", fn);
+    bind_vars(p, sh, params);
+    sh_append_str(sh, SH_BUF_HEADER, hook->pass_body);
+    unbind_vars(p, sh);
+    GLSLH("#undef HOOKED_tex \n"
+          "#undef HOOKED_texOff \n"
+          "#undef hook \n");
+    sh_describef(sh, "%.*s", PL_STR_FMT(hook->pass_desc));
+
+    GLSL(""$" = "$" * color; \n"
+         "color = "$"(); \n",
+         hooked, scale, fn);
+
+    ctx->hooked.repr = repr;
+    ctx->hooked.comps = PL_DEF(hook->comps, ctx->hooked.comps);
+}
+
+// Returns whether a pass body consists of nothing but the `hook` function.
+// Fused passes share a single shader, so any other top-level declarations
+// (helper functions, constants, globals or macros) could collide with those
+// of other passes, or with another instance of the same pass.
+static bool body_is_hook_only(pl_str body)
+{
+    int depth = 0, num_funcs = 0;
+    size_t decl_end = 0; // end of the text preceding the current declaration
+    for (size_t i = 0; i < body.len; i++) {
+        const char c = body.buf[i];
+        const char next = i + 1 < body.len ? body.buf[i + 1] : '\0';
+        if (c == '/' && next == '/') {
+            while (i < body.len && body.buf[i] != '\n')
+                i++;
+            continue;
+        } else if (c == '/' && next == '*') {
+            i += 2;
+            while (i + 1 < body.len && !(body.buf[i] == '*' && body.buf[i + 1] == '/'))
+                i++;
+            i++;
+            continue;
+        }
+
+        switch (c) {
+        case '#':
+        case ';':
+            if (!depth)
+                return false;
+            break;
+        case '{':
+            if (!depth) {
+                // The function name is the identifier right before the last
+                // opening parenthesis of the declaration
+                pl_str decl = pl_str_strip((pl_str) {
+                    .buf = body.buf + decl_end,
+                    .len = i - decl_end,
+                });
+                int paren = -1;
+                for (int n = decl.len - 1; n >= 0 && paren < 0; n--)
+                    paren = decl.buf[n] == '(' ? n : -1;
+                if (paren < 0 || num_funcs++)
+                    return false;
+                decl = pl_str_strip(pl_str_take(decl, paren));
+                if (!pl_str_endswith0(decl, "hook"))
+                    return false;
+                decl = pl_str_take(decl, decl.len - 4);
+                if (decl.len && !pl_isspace(decl.buf[decl.len - 1]))
+                    return false; // e.g. `myhook`
+            }
+            depth++;
+            break;
+        case '}':
+            if (!depth--)
+                return false;
+            if (!depth)
+                decl_end = i + 1;
+            break;
+        }
+    }
+
+    return !depth && num_funcs == 1;
+}
+
+// Returns whether a pass only ever reads the hooked texture at the current
+// pixel, without resizing or saving it, and can therefore be fused into the
+// shader which produced it
+static bool pass_is_pointwise(const struct hook_pass *pass)
+{
+    const struct custom_shader_hook *hook = &pass->hook;
+    if (hook->is_compute || hook->save_tex.len || hook->offset_align ||
+        hook->offset[0] || hook->offset[1])
+    {
+        return false;
+    }
+
+    if (!pl_str_equals0(hook->bind_tex[0], "HOOKED") || hook->bind_tex[1].len)
+        return false;
+
+    // Output size must be the default, i.e. the size of the hooked texture
+    if (pass->width.len != 1 || pass->width.code[0].opc != SHEXP_OPC_HOOKED_W ||
+        pass->height.len != 1 || pass->height.code[0].opc != SHEXP_OPC_HOOKED_H)
+    {
+        return false;
+    }
+
+    // Conditions may not depend on texture sizes, which are unknown
+    for (int i = 0; i < pass->cond.len; i++) {
+        switch ((enum shexp_opc) pass->cond.code[i].opc) {
+        case SHEXP_OPC_TEX_W:
+        case SHEXP_OPC_TEX_H:
+        case SHEXP_OPC_HOOKED_W:
+        case SHEXP_OPC_HOOKED_H:
+            return false;
+        default:
+            continue;
+        }
+    }
+
+    // Reject anything depending on the pixel position or on neighbouring
+    // pixels, as well as the `(de)linearize` helper sub-shaders
+    static const char *const forbidden[] = {
+        "gl_FragCoord", "gl_GlobalInvocationID", "dFdx", "dFdy", "fwidth",
+        "linearize",
+    };
+
+    pl_str body = hook->pass_body;
+    if (!body_is_hook_only(body))
+        return false;
+
+    for (int i = 0; i < PL_ARRAY_SIZE(forbidden); i++) {
+        if (pl_str_find(body, pl_str0(forbidden[i])) >= 0)
+            return false;
+    }
+
+    static const char *const reads[] = {
+        "HOOKED_tex(HOOKED_pos)", "HOOKED_texOff(0)",
+        "HOOKED_texOff(vec2(0))", "HOOKED_texOff(vec2(0.0))",
+    };
+
+    // Binding HOOKED also defines aliases named after the hooked stage
+    for (enum pl_hook_stage st = 1; st <= PL_HOOK_OUTPUT; st <<= 1) {
+        if (!(pass->exec_stages & st))
+            continue;
+        char alias[32];
+        pl_str name = pl_stage_to_mp(st);
+        snprintf(alias, sizeof(alias), "%.*s_", PL_STR_FMT(name));
+        if (pl_str_find(body, pl_str0(alias)) >= 0)
+            return false;
+    }
+
+    int pos;
+    while ((pos = pl_str_find(body, pl_str0("HOOKED_"))) >= 0) {
+        body = pl_str_drop(body, pos);
+        for (int i = 0; i < PL_ARRAY_SIZE(reads); i++) {
+            if (pl_str_startswith0(body, reads[i])) {
+                body = pl_str_drop(body, strlen(reads[i]));
+                goto next;
+            }
+        }
+        return false;
+next: ;
+    }
+
+    return true;
+}
+
 static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *params)
 {
     struct hook_priv *p = priv;
@@ -1242,6 +1657,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         .params = params,
         .hooked = {
             .name  = stage,
+            .id    = stage_id(p, params->stage),
             .tex   = params->tex,
             .rect  = params->rect,
             .repr  = params->repr,
@@ -1251,7 +1667,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
     };
 
     // Save the input texture if needed
-    if (p->save_stages & params->stage) {
+    if (!p->fused && (p->save_stages & params->stage)) {
         PL_TRACE(p, "Saving input texture '%.*s' for binding",
                  PL_STR_FMT(ctx.hooked.name));
         save_pass_tex(p, ctx.hooked);
@@ -1268,7 +1684,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
 
         // Test for execution condition
         float run = 0;
-        if (!eval_shexpr(&ctx, hook->cond, &run))
+        if (!eval_shexpr(&ctx, &pass->cond, &run))
             goto error;
 
         if (!run) {
@@ -1276,6 +1692,19 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
             continue;
         }
 
+        if (p->fused) {
+            fuse_pass(&ctx, hook);
+            res = (struct pl_hook_res) {
+                .output     = PL_HOOK_SIG_COLOR,
+                .sh         = params->sh,
+                .repr       = ctx.hooked.repr,
+                .color      = ctx.hooked.color,
+                .components = ctx.hooked.comps,
+                .rect       = params->rect,
+            };
+            continue;
+        }
+
         // Generate a new shader object
         sh = pl_dispatch_begin(params->dispatch);
 
@@ -1359,82 +1788,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
     next_bind: ; // outer 'continue'
         }
 
-        // Set up the input variables
-        p->frame_count++;
-        GLSLH("#define frame "$" \n", sh_var(sh, (struct pl_shader_var) {
-            .var = pl_var_int("frame"),
-            .data = &p->frame_count,
-            .dynamic = true,
-        }));
-
-        float random = prng_step(p->prng_state);
-        GLSLH("#define random "$" \n", sh_var(sh, (struct pl_shader_var) {
-            .var = pl_var_float("random"),
-            .data = &random,
-            .dynamic = true,
-        }));
-
-        float src_size[2] = { pl_rect_w(params->src_rect), pl_rect_h(params->src_rect) };
-        GLSLH("#define input_size "$" \n", sh_var(sh, (struct pl_shader_var) {
-            .var = pl_var_vec2("input_size"),
-            .data = src_size,
-        }));
-
-        float dst_size[2] = { pl_rect_w(params->dst_rect), pl_rect_h(params->dst_rect) };
-        GLSLH("#define target_size "$" \n", sh_var(sh, (struct pl_shader_var) {
-            .var = pl_var_vec2("target_size"),
-            .data = dst_size,
-        }));
-
-        float tex_off[2] = { params->src_rect.x0, params->src_rect.y0 };
-        GLSLH("#define tex_offset "$" \n", sh_var(sh, (struct pl_shader_var) {
-            .var = pl_var_vec2("tex_offset"),
-            .data = tex_off,
-        }));
-
-        // Custom parameters
-        for (int i = 0; i < p->hook_params.num; i++) {
-            const struct pl_hook_par *hp = &p->hook_params.elem[i];
-            switch (hp->mode) {
-            case PL_HOOK_PAR_VARIABLE:
-            case PL_HOOK_PAR_DYNAMIC:
-                GLSLH("#define %s "$" \n", hp->name,
-                      sh_var(sh, (struct pl_shader_var) {
-                        .var = {
-                            .name = hp->name,
-                            .type = hp->type,
-                            .dim_v = 1,
-                            .dim_m = 1,
-                            .dim_a = 1,
-                        },
-                        .data = hp->data,
-                        .dynamic = hp->mode == PL_HOOK_PAR_DYNAMIC,
-                }));
-                break;
-
-            case PL_HOOK_PAR_CONSTANT:
-                GLSLH("#define %s "$" \n", hp->name,
-                      sh_const(sh, (struct pl_shader_const) {
-                        .name = hp->name,
-                        .type = hp->type,
-                        .data = hp->data,
-                        .compile_time = true,
-                }));
-                break;
-
-            case PL_HOOK_PAR_DEFINE:
-                GLSLH("#define %s %d \n", hp->name, hp->data->i);
-                break;
-
-            case PL_HOOK_PAR_MODE_COUNT:
-                pl_unreachable();
-            }
-
-            if (hp->names) {
-                for (int j = hp->minimum.i; j <= hp->maximum.i; j++)
-                    GLSLH("#define %s %d \n", hp->names[j], j);
-            }
-        }
+        bind_vars(p, sh, params);
 
         // Helper sub-shaders
         uint64_t sh_id = SH_PARAMS(sh).id;
@@ -1458,8 +1812,8 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
 
         // Resolve output size and create framebuffer
         float out_size[2] = {0};
-        if (!eval_shexpr(&ctx, hook->width,  &out_size[0]) ||
-            !eval_shexpr(&ctx, hook->height, &out_size[1]))
+        if (!eval_shexpr(&ctx, &pass->width,  &out_size[0]) ||
+            !eval_shexpr(&ctx, &pass->height, &out_size[1]))
         {
             goto error;
         }
@@ -1553,6 +1907,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         // Save the result of this shader invocation
         struct pass_tex ptex = {
             .name  = hook->save_tex.len ? hook->save_tex : stage,
+            .id    = hook->save_tex.len ? pass->save_id : ctx.hooked.id,
             .tex   = fbo,
             .repr  = ctx.hooked.repr,
             .color = ctx.hooked.color,
@@ -1569,7 +1924,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         save_pass_tex(p, ptex);
 
         // Update the result object, unless we saved to a different name
-        if (pl_str_equals(ptex.name, stage)) {
+        if (ptex.id == ctx.hooked.id) {
             ctx.hooked = ptex;
             res = (struct pl_hook_res) {
                 .output     = PL_HOOK_SIG_TEX,
@@ -1715,6 +2070,29 @@ const struct pl_hook *pl_mpv_user_shader_parse(pl_gpu gpu,
     for (int i = 0; i < p->hook_passes.num; i++)
         hook->stages |= p->hook_passes.elem[i].exec_stages;
 
+    // Resolve all texture and variable names now that all parameters are known
+    pl_static_assert(PL_HOOK_OUTPUT == 1 << (PL_ARRAY_SIZE(p->stage_ids) - 1));
+    for (int i = 0; i < PL_ARRAY_SIZE(p->stage_ids); i++)
+        p->stage_ids[i] = tex_id(p, pl_stage_to_mp(1 << i));
+    for (int i = 0; i < p->hook_passes.num; i++) {
+        struct hook_pass *pass = &p->hook_passes.elem[i];
+        compile_shexpr(p, pass->hook.width,  &pass->width);
+        compile_shexpr(p, pass->hook.height, &pass->height);
+        compile_shexpr(p, pass->hook.cond,   &pass->cond);
+        if (pass->hook.save_tex.len)
+            pass->save_id = tex_id(p, pass->hook.save_tex);
+    }
+
+    // Shaders consisting only of pointwise passes can be applied directly to
+    // the hooked shader, avoiding an intermediate texture per pass
+    p->fused = p->hook_passes.num > 0 && !p->descriptors.num;
+    for (int i = 0; i < p->hook_passes.num; i++)
+        p->fused &= pass_is_pointwise(&p->hook_passes.elem[i]);
+    if (p->fused) {
+        PL_DEBUG(gpu, "All hook passes are pointwise, fusing into hooked shader");
+        hook->input = PL_HOOK_SIG_COLOR;
+    }
+
     hook->parameters = p->hook_params.elem;
     hook->num_parameters = p->hook_params.num;
 
@@ -19,6 +19,7 @@
 #include <ctype.h>
 
 #include "shaders.h"
+#include "pl_thread.h"
 
 #include <libplacebo/shaders/lut.h>
 
@@ -32,6 +33,125 @@ void pl_lut_free(struct pl_custom_lut **lut)
     pl_free_ptr(lut);
 }
 
+enum {
+    MAX_WORKERS     = 16,
+    MIN_CHUNK_SIZE  = 1 << 18, // bytes of .cube text per worker
+};
+
+struct parse_args {
+    pl_str chunk;   // input text, updated to point at the first unparsed byte
+    float *values;  // allocated by the worker, NULL on OOM
+    size_t num;     // number of values successfully parsed
+};
+
+static PL_THREAD_VOID parse_chunk(void *priv)
+{
+    struct parse_args *args = priv;
+    pl_str chunk = args->chunk;
+
+    // Values are at least two bytes apart, but typical .cube files use about
+    // eight bytes per value, so start there and grow as needed
+    size_t size = chunk.len / 8 + 16;
+    float *values = pl_alloc(NULL, size * sizeof(float));
+    size_t num = 0;
+
+    for (;;) {
+        num += pl_str_parse_floats(&chunk, &values[num], size - num);
+        if (num < size)
+            break;
+        size = size * 3 / 2;
+        values = pl_realloc(NULL, values, size * sizeof(float));
+    }
+
+    args->chunk = pl_str_strip(chunk);
+    args->values = values;
+    args->num = num;
+    PL_THREAD_RETURN();
+}
+
+// Parses `num` whitespace-separated values into `out`, rescaling each color
+// channel from [min, max] to [0, 1]. Large inputs are split at whitespace
+// boundaries into chunks which are parsed in parallel.
+static bool parse_body(pl_log log, pl_str str, float *out, size_t num,
+                       const float min[3], const float max[3])
+{
+    struct parse_args args[MAX_WORKERS] = {0};
+    const size_t chunk_size = PL_MAX(PL_DIV_UP(str.len, MAX_WORKERS), MIN_CHUNK_SIZE);
+
+    int num_workers = 0;
+    do {
+        size_t len = PL_MIN(chunk_size, str.len);
+        if (num_workers == MAX_WORKERS - 1)
+            len = str.len;
+        while (len < str.len && !pl_isspace(str.buf[len]))
+            len++;
+        args[num_workers++].chunk = (pl_str) { str.buf, len };
+        str.buf += len;
+        str.len -= len;
+    } while (str.len);
+
+    pl_thread workers[MAX_WORKERS] = {0};
+    for (int i = 1; i < num_workers; i++) {
+        if (pl_thread_create(&workers[i], parse_chunk, &args[i]) != 0)
+            parse_chunk(&args[i]); // fallback
+    }
+
+    parse_chunk(&args[0]);
+    for (int i = 1; i < num_workers; i++) {
+        if (!workers[i])
+            continue;
+        if (pl_thread_join(workers[i]) != 0)
+            parse_chunk(&args[i]); // fallback
+    }
+
+    // Merge results in order, stopping at the first parse failure
+    const float scale[3] = {
+        1.0f / (max[0] - min[0]),
+        1.0f / (max[1] - min[1]),
+        1.0f / (max[2] - min[2]),
+    };
+
+    bool ok = true;
+    size_t pos = 0, extra = 0;
+    pl_str garbage = {0};
+    for (int i = 0; i < num_workers; i++) {
+        const size_t count = PL_MIN(args[i].num, num - pos);
+        for (size_t n = 0; n < count; n++) {
+            const int c = (pos + n) % 3;
+            out[pos + n] = (args[i].values[n] - min[c]) * scale[c];
+        }
+        pos += count;
+        extra += args[i].num - count;
+
+        if (!args[i].chunk.len)
+            continue;
+        if (pos < num) {
+            pl_err(log, "Failed parsing LUT: Unexpected '%c', expected digit",
+                   args[i].chunk.buf[0]);
+            ok = false;
+            break;
+        }
+        if (!garbage.len)
+            garbage = args[i].chunk;
+    }
+
+    if (ok && pos < num) {
+        pl_err(log, "Failed parsing LUT: Unexpected EOF, expected %zu entries, "
+               "got %zu", num, pos);
+        ok = false;
+    } else if (ok && (extra || garbage.len)) {
+        if (garbage.len) {
+            pl_warn(log, "Extra data after LUT?... ignoring '%c'", garbage.buf[0]);
+        } else {
+            pl_warn(log, "Extra data after LUT?... ignoring %zu values", extra);
+        }
+    }
+
+    for (int i = 0; i < num_workers; i++)
+        pl_free(args[i].values);
+    return ok;
+}
+
 struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cstr_len)
 {
     struct pl_custom_lut *lut = pl_zalloc_ptr(NULL, lut);
@@ -138,46 +258,225 @@ struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cst
 
     // Parse LUT body
     pl_clock_t start = pl_clock_now();
-    for (int n = 0; n < entries; n++) {
-        for (int c = 0; c < 3; c++) {
-            static const char * const digits = "0123456789.-+e";
-
-            // Extract valid digit sequence
-            size_t len = pl_strspn(str, digits);
-            pl_str entry = (pl_str) { str.buf, len };
-            str.buf += len;
-            str.len -= len;
-
-            if (!entry.len) {
-                if (!str.len) {
-                    pl_err(log, "Failed parsing LUT: Unexpected EOF, expected "
-                           "%d entries, got %d", entries * 3, n * 3 + c + 1);
-                } else {
-                    pl_err(log, "Failed parsing LUT: Unexpected '%c', expected "
-                           "digit", str.buf[0]);
-                }
-                goto error;
-            }
+    if (!parse_body(log, str, data, entries * 3, min, max))
+        goto error;
 
-            float num;
-            if (!pl_str_parse_float(entry, &num)) {
-                pl_err(log, "Failed parsing float value '%.*s'", PL_STR_FMT(entry));
-                goto error;
-            }
+    pl_log_cpu_time(log, start, pl_clock_now(), "parsing .cube LUT");
+    return lut;
 
-            // Rescale to range 0.0 - 1.0
-            *data++ = (num - min[c]) / (max[c] - min[c]);
+error:
+    pl_free(lut);
+    return NULL;
+}
+
+// --- Binary serialization
+
+#define LUT_MAGIC   "pl_lut\0\0"
+#define LUT_VERSION PL_API_VER
+
+enum {
+    LUT_HALF = 1 << 0, // data is stored as IEEE 754 binary16
+};
+
+struct __attribute__((__packed__)) lut_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    int32_t  size[3];
+    uint32_t reserved;
+    uint64_t signature;
+};
+
+struct lut_meta {
+    pl_matrix3x3 shaper_in, shaper_out;
+    struct pl_color_repr repr_in, repr_out;
+    struct pl_color_space color_in, color_out;
+};
 
-            // Skip whitespace between digits
-            str = pl_str_strip(str);
+#define LUT_DATA_OFFSET PL_ALIGN2(sizeof(struct lut_header) + sizeof(struct lut_meta), 16)
+
+static inline uint16_t float_to_half(float x)
+{
+    union { float f; uint32_t u; } v = { .f = x };
+    const uint32_t sign = (v.u >> 16) & 0x8000;
+    const uint32_t absu = v.u & 0x7FFFFFFF;
+
+    if (absu >= 0x7F800000) // inf or nan
+        return sign | 0x7C00 | (absu > 0x7F800000 ? 0x200 : 0);
+    if (absu >= 0x477FF000) // overflows after rounding
+        return sign | 0x7C00;
+    if (absu < 0x38800000) { // subnormal or zero
+        v.u = absu;
+        v.f += 0.5f; // shift mantissa into place, rounding to nearest even
+        return sign | (v.u - 0x3F000000);
+    }
+
+    const uint32_t odd = (absu >> 13) & 1;
+    return sign | ((absu + 0xC8000FFF + odd) >> 13);
+}
+
+static inline float half_to_float(uint16_t h)
+{
+    const uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    const uint32_t exp = (h >> 10) & 0x1F;
+    const uint32_t mant = h & 0x3FF;
+
+    union { float f; uint32_t u; } v;
+    if (exp == 0x1F) {
+        v.u = sign | 0x7F800000 | (mant << 13);
+    } else if (exp) {
+        v.u = sign | ((exp + 112) << 23) | (mant << 13);
+    } else {
+        v.f = mant * 0x1p-24f;
+        v.u |= sign;
+    }
+    return v.f;
+}
+
+static int lut_entries(const struct pl_custom_lut *lut)
+{
+    if (lut->size[0] > 0 && lut->size[1] > 0 && lut->size[2] > 0)
+        return lut->size[0] * lut->size[1] * lut->size[2];
+    if (lut->size[0] > 0 && !lut->size[1] && !lut->size[2])
+        return lut->size[0];
+    return 0;
+}
+
+// Total size of the serialized LUT, or 0 on overflow
+static size_t lut_file_size(size_t entries, bool half)
+{
+    const size_t texel_size = 4 * (half ? sizeof(uint16_t) : sizeof(float));
+    if (entries > (SIZE_MAX - LUT_DATA_OFFSET) / texel_size)
+        return 0;
+    return LUT_DATA_OFFSET + entries * texel_size;
+}
+
+size_t pl_lut_save(const struct pl_custom_lut *lut, bool half, uint8_t *out)
+{
+    const int entries = lut_entries(lut);
+    if (!entries || (!lut->data && !lut->data_rgba))
+        return 0;
+
+    const size_t size = lut_file_size(entries, half);
+    if (!size || !out)
+        return size;
+
+    memset(out, 0, LUT_DATA_OFFSET);
+    memcpy(out, &(struct lut_header) {
+        .magic      = LUT_MAGIC,
+        .version    = LUT_VERSION,
+        .flags      = half ? LUT_HALF : 0,
+        .size       = { lut->size[0], lut->size[1], lut->size[2] },
+        .signature  = lut->signature,
+    }, sizeof(struct lut_header));
+
+    struct lut_meta meta;
+    memset(&meta, 0, sizeof(meta)); // clear padding
+    meta.shaper_in  = lut->shaper_in;
+    meta.shaper_out = lut->shaper_out;
+    meta.repr_in    = lut->repr_in;
+    meta.repr_out   = lut->repr_out;
+    meta.color_in   = lut->color_in;
+    meta.color_out  = lut->color_out;
+    meta.repr_in.dovi = meta.repr_out.dovi = NULL;
+    memcpy(out + sizeof(struct lut_header), &meta, sizeof(meta));
+
+    uint8_t *data = out + LUT_DATA_OFFSET;
+    for (int i = 0; i < entries; i++) {
+        float texel[4] = {0};
+        if (lut->data_rgba) {
+            memcpy(texel, &lut->data_rgba[i * 4], sizeof(texel));
+        } else {
+            memcpy(texel, &lut->data[i * 3], sizeof(float[3]));
+        }
+
+        if (half) {
+            uint16_t htexel[4];
+            for (int c = 0; c < 4; c++)
+                htexel[c] = float_to_half(texel[c]);
+            memcpy(data, htexel, sizeof(htexel));
+            data += sizeof(htexel);
+        } else {
+            memcpy(data, texel, sizeof(texel));
+            data += sizeof(texel);
         }
     }
 
-    str = pl_str_strip(str);
-    if (str.len)
-        pl_warn(log, "Extra data after LUT?... ignoring '%c'", str.buf[0]);
+    return size;
+}
+
+struct pl_custom_lut *pl_lut_load(pl_log log, const uint8_t *data, size_t size)
+{
+    struct lut_header header;
+    if (size < LUT_DATA_OFFSET) {
+        pl_err(log, "Failed loading LUT: data seems empty or truncated");
+        return NULL;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LUT_MAGIC, sizeof(header.magic)) != 0) {
+        pl_err(log, "Failed loading LUT: invalid magic bytes");
+        return NULL;
+    }
+    if (header.version != LUT_VERSION) {
+        pl_info(log, "Failed loading LUT: wrong version... skipping");
+        return NULL;
+    }
+
+    struct pl_custom_lut *lut = pl_zalloc_ptr(NULL, lut);
+    lut->signature = header.signature;
+    for (int i = 0; i < 3; i++)
+        lut->size[i] = header.size[i];
+
+    // Same limits as for .cube files, which also keeps `entries` in range
+    const bool is_3d = lut->size[1] || lut->size[2];
+    const int max_size = is_3d ? 1024 : 65536;
+    for (int i = 0; i < 3; i++) {
+        if (lut->size[i] < 0 || lut->size[i] > max_size) {
+            pl_err(log, "Failed loading LUT: invalid dimensions %dx%dx%d",
+                   lut->size[0], lut->size[1], lut->size[2]);
+            goto error;
+        }
+    }
+
+    const int entries = lut_entries(lut);
+    const bool half = header.flags & LUT_HALF;
+    if (!entries) {
+        pl_err(log, "Failed loading LUT: invalid dimensions %dx%dx%d",
+               lut->size[0], lut->size[1], lut->size[2]);
+        goto error;
+    }
+
+    const size_t expected = lut_file_size(entries, half);
+    if (!expected || size != expected) {
+        pl_err(log, "Failed loading LUT: size mismatch, expected %d entries",
+               entries);
+        goto error;
+    }
+
+    struct lut_meta meta;
+    memcpy(&meta, data + sizeof(header), sizeof(meta));
+    lut->shaper_in  = meta.shaper_in;
+    lut->shaper_out = meta.shaper_out;
+    lut->repr_in    = meta.repr_in;
+    lut->repr_out   = meta.repr_out;
+    lut->color_in   = meta.color_in;
+    lut->color_out  = meta.color_out;
+    lut->repr_in.dovi = lut->repr_out.dovi = NULL;
+
+    float *rgba = pl_alloc(lut, entries * sizeof(float[4]));
+    lut->data_rgba = rgba;
+    data += LUT_DATA_OFFSET;
+    if (half) {
+        for (size_t i = 0; i < (size_t) entries * 4; i++) {
+            uint16_t h;
+            memcpy(&h, &data[i * sizeof(h)], sizeof(h));
+            rgba[i] = half_to_float(h);
+        }
+    } else {
+        memcpy(rgba, data, entries * sizeof(float[4]));
+    }
 
-    pl_log_cpu_time(log, start, pl_clock_now(), "parsing .cube LUT");
     return lut;
 
 error:
@@ -194,6 +493,11 @@ static void fill_lut(void *datap, const struct sh_lut_params *params)
     int dim_b = PL_DEF(params->depth, 1);
 
     float *data = datap;
+    if (lut->data_rgba) {
+        memcpy(data, lut->data_rgba, dim_r * dim_g * dim_b * sizeof(float[4]));
+        return;
+    }
+
     for (int b = 0; b < dim_b; b++) {
         for (int g = 0; g < dim_g; g++) {
             for (int r = 0; r < dim_r; r++) {
@@ -238,6 +542,7 @@ void pl_shader_custom_lut(pl_shader sh, const struct pl_custom_lut *lut,
         .depth      = lut->size[2],
         .comps      = 4, // for better texel alignment
         .signature  = lut->signature,
+        .cache      = lut->signature ? SH_CACHE(sh) : NULL,
         .fill       = fill_lut,
         .priv       = (void *) lut,
     ));
@@ -481,9 +786,11 @@ next_dim: ; // `continue` out of the inner loop
         } else {
             PL_DEBUG(sh, "LUT invalidated, regenerating..");
             pl_cache_obj_resize(NULL, &obj, buf_size);
-            pl_clock_t start = pl_clock_now();
+            pl_clock_t start = pl_clock_now(), stop;
             params->fill(obj.data, params);
-            pl_log_cpu_time(sh->log, start, pl_clock_now(), "generating shader LUT");
+            stop = pl_clock_now();
+            pl_log_cpu_time(sh->log, start, stop, "generating shader LUT");
+            sh->info->lut_time += pl_clock_diff(stop, start) * 1e9;
         }
 
         pl_assert(obj.data && obj.size);
@@ -0,0 +1,514 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "suballoc.h"
+#include "pl_thread.h"
+
+// Number of second-level subdivisions per power of two (log2)
+#define SL_LOG2  4
+#define SL_COUNT (1 << SL_LOG2)
+#define FL_COUNT (64 - SL_LOG2 + 1)
+
+#define DEFAULT_GRANULARITY    16
+#define DEFAULT_MIN_BLOCK_SIZE (1LLU << 18)
+#define DEFAULT_MAX_BLOCK_SIZE (1LLU << 28)
+
+struct block;
+
+// A contiguous range of a block, either free or allocated. Segments of each
+// block form a linked list in address order, and free segments are
+// additionally linked into the free list of their size class.
+struct seg {
+    struct block *block;
+    size_t offset;
+    size_t size;
+    struct seg *prev, *next;           // physical neighbours
+    struct seg *prev_free, *next_free; // free list links (or spare list)
+    bool free;
+    bool moved;                        // contents relocated, free pending
+};
+
+struct block {
+    void *handle;
+    size_t size;
+    size_t used;
+    int num_allocs;
+    int num_moved;      // allocations marked as relocated
+    uint64_t age;       // timestamp of last use
+    struct seg *first;  // segment at offset 0
+    bool evacuate;      // excluded from the free lists, see pl_suballoc_defrag
+};
+
+struct pl_suballoc_t {
+    pl_log log;
+    pl_mutex lock;
+    struct pl_suballoc_params params;
+    PL_ARRAY(struct block *) blocks;
+    size_t total_size;
+    uint64_t age;
+
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    struct seg *free[FL_COUNT][SL_COUNT];
+    struct seg *spare; // recycled segment structs
+};
+
+static inline int ilog2(uint64_t x)
+{
+    return 63 - __builtin_clzll(x);
+}
+
+// Maps a size to the size class containing it
+static void mapping(uint64_t size, int *fl, int *sl)
+{
+    int l = ilog2(size);
+    if (l < SL_LOG2) {
+        *fl = 0;
+        *sl = size;
+    } else {
+        *fl = l - SL_LOG2 + 1;
+        *sl = (size >> (l - SL_LOG2)) - SL_COUNT;
+    }
+}
+
+// Maps a size to the smallest size class whose segments all fit it
+static void mapping_search(uint64_t size, int *fl, int *sl)
+{
+    int l = ilog2(size);
+    if (l >= SL_LOG2) {
+        uint64_t round = (1LLU << (l - SL_LOG2)) - 1;
+        size = size + round < size ? UINT64_MAX : size + round;
+    }
+    mapping(size, fl, sl);
+}
+
+static void insert_free(pl_suballoc sa, struct seg *seg)
+{
+    int fl, sl;
+    mapping(seg->size, &fl, &sl);
+    seg->free = true;
+    seg->prev_free = NULL;
+    if (seg->block->evacuate) {
+        // Free space in evacuating blocks is never handed out again
+        seg->next_free = NULL;
+        return;
+    }
+
+    seg->next_free = sa->free[fl][sl];
+    if (seg->next_free)
+        seg->next_free->prev_free = seg;
+    sa->free[fl][sl] = seg;
+    sa->fl_bitmap |= 1LLU << fl;
+    sa->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void remove_free(pl_suballoc sa, struct seg *seg)
+{
+    int fl, sl;
+    mapping(seg->size, &fl, &sl);
+    if (seg->prev_free)
+        seg->prev_free->next_free = seg->next_free;
+    if (seg->next_free)
+        seg->next_free->prev_free = seg->prev_free;
+    if (sa->free[fl][sl] == seg) {
+        sa->free[fl][sl] = seg->next_free;
+        if (!seg->next_free) {
+            sa->sl_bitmap[fl] &= ~(1U << sl);
+            if (!sa->sl_bitmap[fl])
+                sa->fl_bitmap &= ~(1LLU << fl);
+        }
+    }
+    seg->free = false;
+    seg->prev_free = seg->next_free = NULL;
+}
+
+// Returns a free segment of at least `size` bytes, or NULL
+static struct seg *find_free(pl_suballoc sa, size_t size)
+{
+    int fl, sl;
+    mapping_search(size, &fl, &sl);
+    if (fl >= FL_COUNT)
+        return NULL;
+
+    uint32_t sl_map = sa->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        uint64_t fl_map = sa->fl_bitmap & (~0LLU << (fl + 1));
+        if (!fl_map)
+            return NULL;
+        fl = __builtin_ctzll(fl_map);
+        sl_map = sa->sl_bitmap[fl];
+    }
+
+    return sa->free[fl][__builtin_ctz(sl_map)];
+}
+
+static struct seg *seg_new(pl_suballoc sa)
+{
+    struct seg *seg = sa->spare;
+    if (seg) {
+        sa->spare = seg->next_free;
+    } else {
+        seg = pl_alloc_ptr(sa, seg);
+    }
+    *seg = (struct seg) {0};
+    return seg;
+}
+
+static void seg_recycle(pl_suballoc sa, struct seg *seg)
+{
+    seg->next_free = sa->spare;
+    sa->spare = seg;
+}
+
+// Splits off the first `size` bytes of `seg` into a new segment preceding it
+static struct seg *seg_split(pl_suballoc sa, struct seg *seg, size_t size)
+{
+    struct seg *head = seg_new(sa);
+    *head = (struct seg) {
+        .block  = seg->block,
+        .offset = seg->offset,
+        .size   = size,
+        .prev   = seg->prev,
+        .next   = seg,
+    };
+
+    if (head->prev)
+        head->prev->next = head;
+    if (seg->block->first == seg)
+        seg->block->first = head;
+    seg->prev = head;
+    seg->offset += size;
+    seg->size -= size;
+    return head;
+}
+
+// Merges `seg->next` into `seg`
+static void seg_merge_next(pl_suballoc sa, struct seg *seg)
+{
+    struct seg *next = seg->next;
+    seg->size += next->size;
+    seg->next = next->next;
+    if (seg->next)
+        seg->next->prev = seg;
+    seg_recycle(sa, next);
+}
+
+pl_suballoc pl_suballoc_create(pl_log log, const struct pl_suballoc_params *params)
+{
+    pl_suballoc sa = pl_zalloc_ptr(NULL, sa);
+    sa->log = log;
+    sa->params = *params;
+    sa->params.granularity = PL_DEF(sa->params.granularity, DEFAULT_GRANULARITY);
+    sa->params.min_block_size = PL_DEF(sa->params.min_block_size, DEFAULT_MIN_BLOCK_SIZE);
+    sa->params.max_block_size = PL_DEF(sa->params.max_block_size, DEFAULT_MAX_BLOCK_SIZE);
+    sa->params.max_block_size = PL_MAX(sa->params.max_block_size,
+                                       sa->params.min_block_size);
+    pl_assert(PL_ISPOT(sa->params.granularity));
+    pl_mutex_init(&sa->lock);
+    return sa;
+}
+
+static void block_free(pl_suballoc sa, struct block *block)
+{
+    if (block->used) {
+        PL_WARN(sa, "Leaked %zu bytes (%d allocations) from block of size %zu!",
+                block->used, block->num_allocs, block->size);
+    }
+
+    sa->params.free_block(sa->params.priv, block->handle);
+    sa->total_size -= block->size;
+    pl_free(block);
+}
+
+void pl_suballoc_destroy(pl_suballoc *psa)
+{
+    pl_suballoc sa = *psa;
+    if (!sa)
+        return;
+
+    for (int i = 0; i < sa->blocks.num; i++)
+        block_free(sa, sa->blocks.elem[i]);
+
+    pl_mutex_destroy(&sa->lock);
+    pl_free_ptr(psa);
+}
+
+// Allocates a new block with room for at least `size` bytes, and adds it to
+// the free lists. Temporarily releases the lock.
+static struct seg *block_new(pl_suballoc sa, size_t size)
+{
+    const struct pl_suballoc_params *params = &sa->params;
+
+    // Grow geometrically with the total amount of memory held
+    size_t block_size = PL_MAX(params->min_block_size, sa->total_size);
+    block_size = PL_MIN(block_size, params->max_block_size);
+    block_size = PL_MAX(block_size, size);
+    block_size = PL_ALIGN2(block_size, params->granularity);
+
+    // Don't hold the lock while allocating the block, because it can be a
+    // potentially very costly operation.
+    pl_mutex_unlock(&sa->lock);
+    void *handle = params->alloc_block(params->priv, &block_size);
+    pl_mutex_lock(&sa->lock);
+    if (!handle)
+        return NULL;
+
+    block_size &= ~(params->granularity - 1);
+    pl_assert(block_size >= size);
+
+    struct block *block = pl_alloc_ptr(NULL, block);
+    *block = (struct block) {
+        .handle = handle,
+        .size = block_size,
+        .age = sa->age,
+    };
+
+    struct seg *seg = block->first = seg_new(sa);
+    seg->block = block;
+    seg->size = block_size;
+    insert_free(sa, seg);
+
+    PL_ARRAY_APPEND(sa, sa->blocks, block);
+    sa->total_size += block_size;
+    return seg;
+}
+
+bool pl_suballoc_alloc(pl_suballoc sa, size_t size, size_t align,
+                       struct pl_suballoc_region *out)
+{
+    const size_t gran = sa->params.granularity;
+    align = align ? pl_lcm(align, gran) : gran;
+    size = PL_ALIGN(PL_MAX(size, 1), align);
+
+    // Since all offsets are multiples of the granularity, this is the
+    // worst-case amount of space needed to fit an aligned region
+    const size_t needed = size + align - gran;
+
+    pl_mutex_lock(&sa->lock);
+    struct seg *seg = find_free(sa, needed);
+    if (!seg)
+        seg = block_new(sa, needed);
+    if (!seg) {
+        pl_mutex_unlock(&sa->lock);
+        *out = (struct pl_suballoc_region) {0};
+        return false;
+    }
+
+    remove_free(sa, seg);
+    size_t pad = PL_ALIGN(seg->offset, align) - seg->offset;
+    if (pad)
+        insert_free(sa, seg_split(sa, seg, pad));
+    if (seg->size > size) {
+        struct seg *head = seg_split(sa, seg, size);
+        insert_free(sa, seg);
+        seg = head;
+    }
+
+    struct block *block = seg->block;
+    block->used += size;
+    block->num_allocs++;
+    block->age = sa->age;
+
+    *out = (struct pl_suballoc_region) {
+        .block  = block->handle,
+        .offset = seg->offset,
+        .size   = size,
+        .priv   = seg,
+    };
+
+    pl_mutex_unlock(&sa->lock);
+    pl_assert(out->offset % align == 0);
+    return true;
+}
+
+void pl_suballoc_free(pl_suballoc sa, struct pl_suballoc_region *region)
+{
+    struct seg *seg = region->priv;
+    if (!seg)
+        return;
+
+    pl_mutex_lock(&sa->lock);
+    pl_assert(!seg->free && seg->size == region->size);
+    struct block *block = seg->block;
+    block->used -= seg->size;
+    block->num_allocs--;
+    block->num_moved -= seg->moved;
+    block->age = sa->age;
+    seg->moved = false;
+
+    if (seg->next && seg->next->free) {
+        remove_free(sa, seg->next);
+        seg_merge_next(sa, seg);
+    }
+
+    if (seg->prev && seg->prev->free) {
+        struct seg *prev = seg->prev;
+        remove_free(sa, prev);
+        seg_merge_next(sa, prev);
+        seg = prev;
+    }
+
+    insert_free(sa, seg);
+    pl_mutex_unlock(&sa->lock);
+    *region = (struct pl_suballoc_region) {0};
+}
+
+// Adds or removes all free segments of a block to/from the free lists
+static void block_set_evacuate(pl_suballoc sa, struct block *block, bool evacuate)
+{
+    if (block->evacuate == evacuate)
+        return;
+
+    block->evacuate = false;
+    for (struct seg *seg = block->first; seg; seg = seg->next) {
+        if (!seg->free)
+            continue;
+        if (evacuate) {
+            remove_free(sa, seg);
+            seg->free = true;
+        } else {
+            insert_free(sa, seg);
+        }
+    }
+    block->evacuate = evacuate;
+}
+
+static int cmp_usage(const void *pa, const void *pb)
+{
+    const struct block *a = *(const struct block **) pa;
+    const struct block *b = *(const struct block **) pb;
+    double ua = (double) a->used / a->size, ub = (double) b->used / b->size;
+    return PL_CMP(ua, ub);
+}
+
+int pl_suballoc_defrag(pl_suballoc sa, float threshold)
+{
+    pl_mutex_lock(&sa->lock);
+    struct block **sparse = pl_calloc_ptr(NULL, sa->blocks.num, sparse);
+    int num_sparse = 0, num_marked = 0;
+    size_t avail = 0;
+
+    for (int i = 0; i < sa->blocks.num; i++) {
+        struct block *block = sa->blocks.elem[i];
+        block_set_evacuate(sa, block, false);
+        if (block->num_allocs && block->used < threshold * block->size) {
+            sparse[num_sparse++] = block;
+        } else {
+            avail += block->size - block->used;
+        }
+    }
+
+    // Evacuate the sparsest blocks first, but only as long as their contents
+    // still fit into the free space of the blocks that remain
+    qsort(sparse, num_sparse, sizeof(sparse[0]), cmp_usage);
+    for (int i = 0; i < num_sparse; i++) {
+        struct block *block = sparse[i];
+        if (block->used > avail) {
+            avail += block->size - block->used;
+            continue;
+        }
+
+        PL_DEBUG(sa, "Evacuating block of size %zu (%zu bytes used, %d allocations)",
+                 block->size, block->used, block->num_allocs);
+        block_set_evacuate(sa, block, true);
+        avail -= block->used;
+        num_marked++;
+    }
+
+    pl_free(sparse);
+    pl_mutex_unlock(&sa->lock);
+    return num_marked;
+}
+
+bool pl_suballoc_is_evacuating(pl_suballoc sa, const struct pl_suballoc_region *region)
+{
+    const struct seg *seg = region->priv;
+    if (!seg)
+        return false;
+
+    pl_mutex_lock(&sa->lock);
+    bool ret = seg->block->evacuate && !seg->moved;
+    pl_mutex_unlock(&sa->lock);
+    return ret;
+}
+
+void pl_suballoc_mark_moved(pl_suballoc sa, const struct pl_suballoc_region *region)
+{
+    struct seg *seg = region->priv;
+    pl_mutex_lock(&sa->lock);
+    pl_assert(seg && !seg->free && !seg->moved);
+    seg->moved = true;
+    seg->block->num_moved++;
+    pl_mutex_unlock(&sa->lock);
+}
+
+int pl_suballoc_gc(pl_suballoc sa)
+{
+    int num_freed = 0;
+    pl_mutex_lock(&sa->lock);
+    sa->age++;
+
+    for (int i = 0; i < sa->blocks.num; i++) {
+        struct block *block = sa->blocks.elem[i];
+        if (block->num_allocs)
+            continue;
+        if (!block->evacuate && sa->age - block->age <= sa->params.max_age)
+            continue;
+
+        // Empty blocks consist of only a single free segment
+        pl_assert(block->first->free && !block->first->next);
+        remove_free(sa, block->first);
+        seg_recycle(sa, block->first);
+        PL_DEBUG(sa, "Garbage collected block of size %zu", block->size);
+        block_free(sa, block);
+        PL_ARRAY_REMOVE_AT(sa->blocks, i--);
+        num_freed++;
+    }
+
+    pl_mutex_unlock(&sa->lock);
+    return num_freed;
+}
+
+struct pl_suballoc_stats pl_suballoc_get_stats(pl_suballoc sa)
+{
+    struct pl_suballoc_stats stats = {0};
+    pl_mutex_lock(&sa->lock);
+    stats.size = sa->total_size;
+    stats.num_blocks = sa->blocks.num;
+    for (int i = 0; i < sa->blocks.num; i++) {
+        const struct block *block = sa->blocks.elem[i];
+        stats.used += block->used;
+        stats.num_allocs += block->num_allocs;
+        if (block->evacuate) {
+            stats.evacuating += block->size;
+            if (block->num_moved == block->num_allocs)
+                stats.reclaimable += block->size;
+        }
+    }
+
+    for (int fl = 0; fl < FL_COUNT; fl++) {
+        for (int sl = 0; sl < SL_COUNT; sl++) {
+            for (const struct seg *seg = sa->free[fl][sl]; seg; seg = seg->next_free) {
+                stats.largest_free = PL_MAX(stats.largest_free, seg->size);
+                stats.num_free++;
+            }
+        }
+    }
+
+    pl_mutex_unlock(&sa->lock);
+    return stats;
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+
+// Generic suballocator, which serves variably sized allocations out of a set
+// of large backing blocks (e.g. device memory allocations). The blocks
+// themselves are allocated and freed by user callbacks, so this does not
+// depend on any particular GPU API.
+//
+// Free space is tracked using two-level segregated fit (TLSF) free lists, so
+// both allocation and freeing take constant time, and adjacent free regions
+// are merged immediately.
+//
+// Thread-safety: Safe
+typedef struct pl_suballoc_t *pl_suballoc;
+
+struct pl_suballoc_params {
+    // Allocate a new backing block of at least `*size` bytes. May update
+    // `*size` to reflect the actual size of the block. Returns NULL on
+    // failure. Called without any internal locks held.
+    void *(*alloc_block)(void *priv, size_t *size);
+    void (*free_block)(void *priv, void *block);
+    void *priv;
+
+    // All offsets and sizes are rounded up to multiples of this. Must be a
+    // power of two. If 0, defaults to 16.
+    size_t granularity;
+
+    // Minimum/maximum size of new blocks. The size of new blocks grows with
+    // the total amount of memory held by the suballocator, until the maximum
+    // is reached. Allocations larger than the maximum get a block of their
+    // own. If 0, defaults to 256 KB and 256 MB, respectively.
+    size_t min_block_size;
+    size_t max_block_size;
+
+    // Empty blocks are freed after this many calls to `pl_suballoc_gc`.
+    int max_age;
+};
+
+#define pl_suballoc_params(...) (&(struct pl_suballoc_params) { __VA_ARGS__ })
+
+pl_suballoc pl_suballoc_create(pl_log log, const struct pl_suballoc_params *params);
+
+// Frees all blocks, including those still holding allocations.
+void pl_suballoc_destroy(pl_suballoc *sa);
+
+struct pl_suballoc_region {
+    void *block;    // backing block, as returned by `alloc_block`
+    size_t offset;  // offset of the region within `block`
+    size_t size;    // size of the region, rounded up to the alignment
+    void *priv;     // internal state, must not be touched
+};
+
+// Allocates a region of `size` bytes, with an offset aligned to a multiple of
+// `align` (which need not be a power of two). Returns false on failure.
+bool pl_suballoc_alloc(pl_suballoc sa, size_t size, size_t align,
+                       struct pl_suballoc_region *out);
+
+// Releases a region previously returned by `pl_suballoc_alloc`, and resets
+// it to {0}. Does nothing for empty regions.
+void pl_suballoc_free(pl_suballoc sa, struct pl_suballoc_region *region);
+
+// Advances the age counter, and frees empty blocks exceeding `max_age`, as
+// well as empty blocks marked for evacuation. Returns the number of blocks
+// freed.
+int pl_suballoc_gc(pl_suballoc sa);
+
+// Marks blocks whose utilization is below `threshold` (as a fraction of the
+// block size) for evacuation, sparsest first, for as long as their contents
+// would still fit into the free space of the remaining blocks. Marks from
+// previous calls are cleared first. Marked blocks no longer serve new
+// allocations, so the user can compact memory by reallocating and moving all
+// regions for which `pl_suballoc_is_evacuating` returns true. Returns the
+// number of blocks marked.
+int pl_suballoc_defrag(pl_suballoc sa, float threshold);
+
+// Returns true if `region` lives in a block marked for evacuation, and has not
+// yet been marked as moved.
+bool pl_suballoc_is_evacuating(pl_suballoc sa, const struct pl_suballoc_region *region);
+
+// Records that the contents of `region` have been relocated, and that the
+// region itself will be freed once no longer in use.
+void pl_suballoc_mark_moved(pl_suballoc sa, const struct pl_suballoc_region *region);
+
+struct pl_suballoc_stats {
+    size_t size;            // total size of all blocks
+    size_t used;            // total size of all allocated regions
+    size_t largest_free;    // size of the largest contiguous free region
+    int num_blocks;         // number of backing blocks
+    int num_allocs;         // number of allocated regions
+    int num_free;           // number of (non-adjacent) free regions
+    size_t evacuating;      // total size of blocks marked for evacuation
+    size_t reclaimable;     // ... of which all regions have been moved
+};
+
+struct pl_suballoc_stats pl_suballoc_get_stats(pl_suballoc sa);
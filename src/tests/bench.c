@@ -1,9 +1,14 @@
 #include "utils.h"
+#include "vulkan/command.h"
+#include "vulkan/gpu.h"
 
 #include <libplacebo/dispatch.h>
+#include <libplacebo/filters.h>
+#include <libplacebo/renderer.h>
 #include <libplacebo/vulkan.h>
 #include <libplacebo/shaders/colorspace.h>
 #include <libplacebo/shaders/deinterlacing.h>
+#include <libplacebo/shaders/lut.h>
 #include <libplacebo/shaders/sampling.h>
 
 enum {
@@ -69,6 +74,9 @@ struct bench {
                    pl_tex src);
 
     void (*run_tex)(pl_gpu gpu, pl_tex tex);
+
+    // Number of times `run_sh` is dispatched per frame (defaults to 1)
+    int passes;
 };
 
 static void run_bench(pl_gpu gpu, pl_dispatch dp,
@@ -79,14 +87,16 @@ static void run_bench(pl_gpu gpu, pl_dispatch dp,
     REQUIRE(bench);
     REQUIRE(bench->run_sh || bench->run_tex);
     if (bench->run_sh) {
-        pl_shader sh = pl_dispatch_begin(dp);
-        bench->run_sh(sh, state, src);
-
-        pl_dispatch_finish(dp, pl_dispatch_params(
-            .shader = &sh,
-            .target = fbo,
-            .timer = timer,
-        ));
+        for (int i = 0; i < PL_DEF(bench->passes, 1); i++) {
+            pl_shader sh = pl_dispatch_begin(dp);
+            bench->run_sh(sh, state, src);
+
+            pl_dispatch_finish(dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = fbo,
+                .timer = timer,
+            ));
+        }
     } else {
         bench->run_tex(gpu, fbo);
     }
@@ -135,6 +145,9 @@ static void benchmark(pl_gpu gpu, const char *name,
     unsigned long gputime_count = 0;
     uint64_t gputime;
 
+    struct vk_ctx *vk = ((struct pl_vk *) PL_PRIV(gpu))->vk;
+    struct vk_submit_stats stats_start = {0};
+
     start_warmup = pl_clock_now();
     do {
         const int idx = frames % NUM_TEX;
@@ -158,6 +171,7 @@ static void benchmark(pl_gpu gpu, const char *name,
         } else if (pl_clock_diff(now, start_warmup) > WARMUP_MS * 1e-3) {
             start_test = now;
             frames_warmup = frames;
+            stats_start = vk_get_submit_stats(vk);
         }
     } while (true);
 
@@ -172,11 +186,14 @@ static void benchmark(pl_gpu gpu, const char *name,
 
     frames -= frames_warmup;
     double secs = pl_clock_diff(stop, start_test);
+    struct vk_submit_stats stats = vk_get_submit_stats(vk);
     printf("'%s':\t%4lu frames in %1.6f seconds => %2.6f ms/frame (%5.2f FPS)",
           name, frames, secs, 1000 * secs / frames, frames / secs);
     if (gputime_count)
         printf(", gpu time: %2.6f ms", 1e-6 * gputime_total / gputime_count);
-    printf("\n");
+    printf(", submits: %1.2f/frame (%1.2f cmds/frame)\n",
+           (double) (stats.submits - stats_start.submits) / frames,
+           (double) (stats.cmds - stats_start.cmds) / frames);
 
     pl_timer_destroy(gpu, &timer);
     pl_shader_obj_destroy(&state);
@@ -202,6 +219,17 @@ static void bench_deband_heavy(pl_shader sh, pl_shader_obj *state, pl_tex src)
     ));
 }
 
+// Cycles through a few sets of specialization constants, to measure the cost
+// of switching between them
+static void bench_deband_respec(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    static const float radii[] = { 8.0, 12.0, 16.0, 20.0 };
+    static int frame;
+    pl_shader_deband(sh, pl_sample_src( .tex = src ), pl_deband_params(
+        .radius = radii[frame++ % PL_ARRAY_SIZE(radii)],
+    ));
+}
+
 static void bench_bilinear(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     REQUIRE(pl_shader_sample_bilinear(sh, pl_sample_src( .tex = src )));
@@ -477,6 +505,242 @@ static void bench_upload_async(pl_gpu gpu, pl_tex tex)
     )));
 }
 
+// CPU-side benchmarks, which don't require any GPU
+enum {
+    CPU_TEST_MS   = 100,
+    CPU_WARMUP_MS = 20,
+};
+
+static void benchmark_cpu(const char *name, void (*run)(const void *priv),
+                          const void *priv)
+{
+    pl_clock_t start_warmup = pl_clock_now(), start_test = 0;
+    unsigned long iters = 0, iters_warmup = 0;
+
+    do {
+        run(priv);
+        iters++;
+
+        pl_clock_t now = pl_clock_now();
+        if (start_test) {
+            if (pl_clock_diff(now, start_test) > CPU_TEST_MS * 1e-3)
+                break;
+        } else if (pl_clock_diff(now, start_warmup) > CPU_WARMUP_MS * 1e-3) {
+            start_test = now;
+            iters_warmup = iters;
+        }
+    } while (true);
+
+    iters -= iters_warmup;
+    double secs = pl_clock_diff(pl_clock_now(), start_test);
+    printf("'%s':\t%6lu iterations in %1.6f seconds => %4.3f us/iter\n",
+           name, iters, secs, 1e6 * secs / iters);
+}
+
+static void bench_filter_generate(const void *priv)
+{
+    pl_filter flt = pl_filter_generate(NULL, priv);
+    REQUIRE(flt);
+    pl_filter_free(&flt);
+}
+
+static void benchmark_filters(void)
+{
+    for (int i = 0; i < pl_num_filter_configs; i++) {
+        const struct pl_filter_config *conf = pl_filter_configs[i];
+        if (conf->kernel->opaque)
+            continue;
+
+        // Parameters mirror those used by pl_shader_sample_ortho2/polar
+        struct pl_filter_params ortho = {
+            .config           = *conf,
+            .lut_entries      = 256,
+            .row_stride_align = 4,
+        };
+        ortho.config.polar = false;
+
+        struct pl_filter_params polar = {
+            .config      = *conf,
+            .lut_entries = 256,
+            .cutoff      = 1e-3,
+        };
+        polar.config.polar = true;
+
+        char name[64];
+        snprintf(name, sizeof(name), "filter_generate %s (ortho)", conf->name);
+        benchmark_cpu(name, bench_filter_generate, &ortho);
+        snprintf(name, sizeof(name), "filter_generate %s (polar)", conf->name);
+        benchmark_cpu(name, bench_filter_generate, &polar);
+    }
+}
+
+struct lut_data {
+    uint8_t *buf;
+    size_t len;
+};
+
+static void bench_lut_parse(const void *priv)
+{
+    const struct lut_data *cube = priv;
+    struct pl_custom_lut *lut = pl_lut_parse_cube(NULL, (char *) cube->buf, cube->len);
+    REQUIRE(lut);
+    pl_lut_free(&lut);
+}
+
+static void bench_lut_load(const void *priv)
+{
+    const struct lut_data *bin = priv;
+    struct pl_custom_lut *lut = pl_lut_load(NULL, bin->buf, bin->len);
+    REQUIRE(lut);
+    pl_lut_free(&lut);
+}
+
+static void benchmark_luts(void)
+{
+    static const int sizes[] = { 33, 65, 129 };
+    for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+        const int size = sizes[i];
+        const size_t max_len = 32 * (size_t) size * size * size + 32;
+        struct lut_data cube = { .buf = malloc(max_len) };
+        REQUIRE(cube.buf);
+
+        char *pos = (char *) cube.buf;
+        pos += sprintf(pos, "LUT_3D_SIZE %d\n", size);
+        for (int b = 0; b < size; b++) {
+            for (int g = 0; g < size; g++) {
+                for (int r = 0; r < size; r++) {
+                    pos += sprintf(pos, "%.6f %.6f %.6f\n", r / (size - 1.0),
+                                   g / (size - 1.0), b / (size - 1.0));
+                }
+            }
+        }
+        cube.len = pos - (char *) cube.buf;
+
+        char name[64];
+        snprintf(name, sizeof(name), "lut_parse_cube %dx%dx%d", size, size, size);
+        benchmark_cpu(name, bench_lut_parse, &cube);
+
+        struct pl_custom_lut *lut;
+        lut = pl_lut_parse_cube(NULL, (char *) cube.buf, cube.len);
+        REQUIRE(lut);
+        for (int half = 0; half <= 1; half++) {
+            struct lut_data bin = { .len = pl_lut_save(lut, half, NULL) };
+            bin.buf = malloc(bin.len);
+            REQUIRE(bin.buf);
+            pl_lut_save(lut, half, bin.buf);
+            snprintf(name, sizeof(name), "lut_load %dx%dx%d (%s)",
+                     size, size, size, half ? "half" : "float");
+            benchmark_cpu(name, bench_lut_load, &bin);
+            free(bin.buf);
+        }
+
+        pl_lut_free(&lut);
+        free(cube.buf);
+    }
+}
+
+struct overlay_bench {
+    pl_gpu gpu;
+    pl_renderer rr;
+    struct pl_frame target;
+    struct pl_render_params params;
+};
+
+static void bench_overlays(const void *priv)
+{
+    const struct overlay_bench *b = priv;
+    REQUIRE(pl_render_image(b->rr, NULL, &b->target, &b->params));
+    pl_gpu_finish(b->gpu);
+}
+
+static void benchmark_overlays(pl_gpu gpu)
+{
+    enum { MAX_OVERLAYS = 1000, OL_W = 12, OL_H = 16 };
+    pl_fmt ol_fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 1, 8, 8, PL_FMT_CAP_LINEAR);
+    pl_fmt fbo_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, COMPS, DEPTH, 32,
+                                 PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_BLENDABLE |
+                                 PL_FMT_CAP_BLITTABLE);
+    if (!ol_fmt || !fbo_fmt)
+        return;
+
+    // Synthetic glyph-sized monochrome overlays, laid out like text
+    static uint8_t glyph[OL_W * OL_H];
+    static pl_tex textures[MAX_OVERLAYS];
+    static struct pl_overlay overlays[MAX_OVERLAYS];
+    static struct pl_overlay_part parts[MAX_OVERLAYS];
+    for (int i = 0; i < MAX_OVERLAYS; i++) {
+        for (int n = 0; n < PL_ARRAY_SIZE(glyph); n++)
+            glyph[n] = (n * 31 + i * 17) & 0xFF;
+        textures[i] = pl_tex_create(gpu, pl_tex_params(
+            .w              = OL_W,
+            .h              = OL_H,
+            .format         = ol_fmt,
+            .sampleable     = true,
+            .initial_data   = glyph,
+        ));
+        REQUIRE(textures[i]);
+
+        const float x = (i % 150) * OL_W, y = (i / 150) * OL_H * 1.5f;
+        parts[i] = (struct pl_overlay_part) {
+            .src = {0, 0, OL_W, OL_H},
+            .dst = {x, y, x + OL_W, y + OL_H},
+            .color = {1.0, 1.0, 1.0, 1.0},
+        };
+        overlays[i] = (struct pl_overlay) {
+            .tex        = textures[i],
+            .mode       = PL_OVERLAY_MONOCHROME,
+            .repr       = pl_color_repr_rgb,
+            .color      = pl_color_space_srgb,
+            .parts      = &parts[i],
+            .num_parts  = 1,
+        };
+    }
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .format     = fbo_fmt,
+        .w          = WIDTH,
+        .h          = HEIGHT,
+        .renderable = true,
+        .blit_dst   = true,
+    ));
+    REQUIRE(fbo);
+
+    struct overlay_bench b = {
+        .gpu = gpu,
+        .rr = pl_renderer_create(gpu->log, gpu),
+        .target = {
+            .num_planes = 1,
+            .planes[0] = {
+                .texture            = fbo,
+                .components         = COMPS,
+                .component_mapping  = {0, 1, 2, 3},
+            },
+            .repr   = pl_color_repr_rgb,
+            .color  = pl_color_space_srgb,
+        },
+    };
+
+    static const int counts[] = { 1, 10, 100, 1000 };
+    for (int i = 0; i < PL_ARRAY_SIZE(counts); i++) {
+        for (int batch = 0; batch <= 1; batch++) {
+            b.target.overlays = overlays;
+            b.target.num_overlays = counts[i];
+            b.params = pl_render_default_params;
+            b.params.batch_overlays = batch;
+
+            char name[64];
+            snprintf(name, sizeof(name), "overlays %d%s", counts[i],
+                     batch ? " (batched)" : "");
+            benchmark_cpu(name, bench_overlays, &b);
+        }
+    }
+
+    pl_renderer_destroy(&b.rr);
+    pl_tex_destroy(gpu, &fbo);
+    for (int i = 0; i < MAX_OVERLAYS; i++)
+        pl_tex_destroy(gpu, &textures[i]);
+}
+
 int main()
 {
     setbuf(stdout, NULL);
@@ -494,6 +758,10 @@ int main()
         .queue_count    = NUM_QUEUES,
     ));
 
+    printf("= Running CPU benchmarks =\n");
+    benchmark_filters();
+    benchmark_luts();
+
     if (!vk)
         return SKIP;
 
@@ -506,11 +774,16 @@ int main()
     benchmark(vk->gpu, "tex_upload ptr", BENCH_TEX(bench_upload));
     benchmark(vk->gpu, "tex_upload ptr async", BENCH_TEX(bench_upload_async));
     benchmark(vk->gpu, "bilinear", BENCH_SH(bench_bilinear));
+    benchmark(vk->gpu, "bilinear x16", &(struct bench) {
+        .run_sh = bench_bilinear,
+        .passes = 16,
+    });
     benchmark(vk->gpu, "bicubic", BENCH_SH(bench_bicubic));
     benchmark(vk->gpu, "hermite", BENCH_SH(bench_hermite));
     benchmark(vk->gpu, "gaussian", BENCH_SH(bench_gaussian));
     benchmark(vk->gpu, "deband", BENCH_SH(bench_deband));
     benchmark(vk->gpu, "deband_heavy", BENCH_SH(bench_deband_heavy));
+    benchmark(vk->gpu, "deband_respec", BENCH_SH(bench_deband_respec));
 
     // Deinterlacing
     benchmark(vk->gpu, "weave", BENCH_SH(bench_weave));
@@ -544,6 +817,9 @@ int main()
     benchmark(vk->gpu, "reshape_poly", BENCH_SH(bench_reshape_poly));
     benchmark(vk->gpu, "reshape_mmr", BENCH_SH(bench_reshape_mmr));
 
+    // Rendering overlays, with and without batching
+    benchmark_overlays(vk->gpu);
+
     pl_vulkan_destroy(&vk);
     pl_log_destroy(&log);
     return 0;
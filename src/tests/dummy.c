@@ -2,6 +2,56 @@
 
 #include <libplacebo/dummy.h>
 #include <libplacebo/renderer.h>
+#include <libplacebo/shaders/custom.h>
+
+static pl_tex no_tex(void *priv, int width, int height)
+{
+    bool *ran = priv;
+    *ran = true;
+    return NULL;
+}
+
+// Runs the LUMA stage of a user shader, returning whether the pass would have
+// been executed (as opposed to being skipped, or failing to evaluate)
+static bool user_shader_runs(pl_gpu gpu, pl_dispatch dp, pl_tex tex,
+                             const char *shader)
+{
+    const struct pl_hook *hook = pl_mpv_user_shader_parse(gpu, shader, strlen(shader));
+    REQUIRE(hook);
+
+    // Pointwise shaders are fused into the given shader instead
+    pl_shader sh = NULL;
+    if (hook->input == PL_HOOK_SIG_COLOR) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = tex ));
+    }
+
+    bool ran = false;
+    const struct pl_color_space csp = pl_color_space_srgb;
+    struct pl_hook_res res = hook->hook(hook->priv, &(struct pl_hook_params) {
+        .gpu        = gpu,
+        .dispatch   = dp,
+        .get_tex    = no_tex,
+        .priv       = &ran,
+        .stage      = PL_HOOK_LUMA_INPUT,
+        .sh         = sh,
+        .tex        = sh ? NULL : tex,
+        .rect       = { 0, 0, tex->params.w, tex->params.h },
+        .repr       = pl_color_repr_unknown,
+        .color      = csp,
+        .components = 1,
+        .orig_repr  = &pl_color_repr_unknown,
+        .orig_color = &csp,
+        .src_rect   = { 0, 0, tex->params.w, tex->params.h },
+        .dst_rect   = { 0, 0, 2 * tex->params.w, 2 * tex->params.h },
+    });
+
+    if (res.output == PL_HOOK_SIG_COLOR)
+        ran = true;
+    pl_dispatch_abort(dp, &sh);
+    pl_mpv_user_shader_destroy(&hook);
+    return ran;
+}
 
 int main()
 {
@@ -63,6 +113,144 @@ int main()
     REQUIRE((res = pl_shader_finalize(sh)));
     REQUIRE_CMP(res->input, ==, PL_SHADER_SIG_SAMPLER, "u");
 
+    // Test user shader expression evaluation
+    static const struct {
+        const char *when;
+        bool run;
+    } exprs[] = {
+        { "HOOKED.w 100 =",                 true  },
+        { "HOOKED.w 100 >",                 false },
+        { "LUMA.width 50 > HOOKED.h 100 = *", true },
+        { "OUTPUT.w NATIVE_CROPPED.w / 2 =",  true },
+        { "MAIN.w 1 >",                     false }, // not saved, fails
+        { "STRENGTH 0.5 >",                 true  },
+        { "STRENGTH 0.5 > !",               false },
+        { "MODE FAST =",                    true  },
+        { "MODE SLOW =",                    false },
+        { "UNKNOWN 1 >",                    false }, // unknown variable
+        { "1 +",                            false }, // stack underflow
+        { "1 2",                            false }, // malformed stack
+        { "1 0 /",                          false }, // illegal operation
+    };
+
+    pl_dispatch dp = pl_dispatch_create(log, gpu);
+    for (int i = 0; i < PL_ARRAY_SIZE(exprs); i++) {
+        char *shader = pl_asprintf(NULL,
+            "//!PARAM STRENGTH\n"
+            "//!TYPE float\n"
+            "0.75\n"
+            "//!HOOK LUMA\n"
+            "//!BIND HOOKED\n"
+            "//!WHEN %s\n"
+            "vec4 hook() { return HOOKED_tex(HOOKED_pos); }\n"
+            "//!PARAM MODE\n"
+            "//!TYPE ENUM int\n"
+            "FAST\n"
+            "SLOW\n",
+            exprs[i].when);
+        printf("- testing WHEN %s\n", exprs[i].when);
+        bool ran = user_shader_runs(gpu, dp, dummy, shader);
+        REQUIRE_CMP(ran, ==, exprs[i].run, "d");
+        pl_free(shader);
+    }
+
+    // Test caching of decoded user shader TEXTURE data
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    pl_gpu_set_cache(gpu, cache);
+    static const char *tex_shader =
+        "//!TEXTURE LUT\n"
+        "//!SIZE 2 2\n"
+        "//!FORMAT rgba8\n"
+        "//!FILTER NEAREST\n"
+        "00112233 44556677\n"
+        "8899aabb ccddeeff\n";
+
+    for (int i = 0; i < 2; i++) {
+        const struct pl_hook *hook;
+        hook = pl_mpv_user_shader_parse(gpu, tex_shader, strlen(tex_shader));
+        REQUIRE(hook);
+        REQUIRE_CMP(pl_cache_objects(cache), ==, 1, "d");
+        pl_mpv_user_shader_destroy(&hook);
+    }
+
+    pl_gpu_set_cache(gpu, NULL);
+    pl_cache_destroy(&cache);
+
+    // Test detection of pointwise user shaders, which can be fused
+    static const struct {
+        const char *body;
+        bool fused;
+    } pointwise[] = {
+        { "return HOOKED_tex(HOOKED_pos);",                 true },
+        { "return vec4(1.0) - HOOKED_texOff(0);",           true },
+        { "return HOOKED_texOff(vec2(1.0, 0.0));",          false },
+        { "return HOOKED_tex(HOOKED_pos + HOOKED_pt);",     false },
+        { "return LUMA_tex(LUMA_pos);",                     false },
+        { "return linearize(HOOKED_texOff(0));",            false },
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(pointwise); i++) {
+        char *shader = pl_asprintf(NULL, "//!HOOK LUMA\n//!BIND HOOKED\n"
+                                   "vec4 hook() { %s }\n", pointwise[i].body);
+        printf("- testing pointwise: %s\n", pointwise[i].body);
+        const struct pl_hook *hook;
+        hook = pl_mpv_user_shader_parse(gpu, shader, strlen(shader));
+        REQUIRE(hook);
+        enum pl_hook_sig input = pointwise[i].fused ? PL_HOOK_SIG_COLOR
+                                                    : PL_HOOK_SIG_TEX;
+        REQUIRE_CMP(hook->input, ==, input, "d");
+
+        if (pointwise[i].fused) {
+            pl_shader psh = pl_dispatch_begin(dp);
+            pl_shader_sample_direct(psh, pl_sample_src( .tex = dummy ));
+            const struct pl_color_space csp = pl_color_space_srgb;
+            struct pl_hook_res hres = hook->hook(hook->priv, &(struct pl_hook_params) {
+                .gpu        = gpu,
+                .dispatch   = dp,
+                .stage      = PL_HOOK_LUMA_INPUT,
+                .sh         = psh,
+                .rect       = { 0, 0, dummy->params.w, dummy->params.h },
+                .repr       = pl_color_repr_unknown,
+                .color      = csp,
+                .components = 1,
+                .orig_repr  = &pl_color_repr_unknown,
+                .orig_color = &csp,
+                .src_rect   = { 0, 0, dummy->params.w, dummy->params.h },
+                .dst_rect   = { 0, 0, dummy->params.w, dummy->params.h },
+            });
+            REQUIRE(!hres.failed);
+            REQUIRE_CMP(hres.output, ==, PL_HOOK_SIG_COLOR, "d");
+            REQUIRE(hres.sh == psh);
+            pl_dispatch_abort(dp, &psh);
+        }
+
+        pl_mpv_user_shader_destroy(&hook);
+        pl_free(shader);
+    }
+
+    // Top-level declarations besides `hook` could collide once fused
+    static const char *const helpers[] = {
+        "float gain() { return 0.5; }\n"
+        "vec4 hook() { return gain() * HOOKED_texOff(0); }\n",
+        "const float gain = 0.5;\n"
+        "vec4 hook() { return gain * HOOKED_texOff(0); }\n",
+        "#define gain 0.5\n"
+        "vec4 hook() { return gain * HOOKED_texOff(0); }\n",
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(helpers); i++) {
+        char *shader = pl_asprintf(NULL, "//!HOOK LUMA\n//!BIND HOOKED\n"
+                                   "// comment { with braces; }\n%s", helpers[i]);
+        printf("- testing pointwise with helpers:\n%s", helpers[i]);
+        const struct pl_hook *hook;
+        hook = pl_mpv_user_shader_parse(gpu, shader, strlen(shader));
+        REQUIRE(hook);
+        REQUIRE_CMP(hook->input, ==, PL_HOOK_SIG_TEX, "d");
+        pl_mpv_user_shader_destroy(&hook);
+        pl_free(shader);
+    }
+
+    pl_dispatch_destroy(&dp);
     pl_shader_free(&sh);
     pl_shader_obj_destroy(&lut);
     pl_tex_destroy(gpu, &dummy);
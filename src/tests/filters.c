@@ -23,6 +23,16 @@ int main()
         // Gaussian technically never reaches 0 even at its preconfigured radius.
         if (fun->radius > 1.0 && fun != &pl_filter_function_gaussian)
             REQUIRE_FEQ(fun->weight(&ctx, fun->radius), 0.0, 1e-7);
+
+        // Ensure the batched version matches the scalar version
+        if (fun->weight_n) {
+            double x[100], w[100];
+            for (int n = 0; n < PL_ARRAY_SIZE(x); n++)
+                x[n] = fun->radius * n / (PL_ARRAY_SIZE(x) - 1);
+            fun->weight_n(&ctx, x, w, PL_ARRAY_SIZE(x));
+            for (int n = 0; n < PL_ARRAY_SIZE(x); n++)
+                REQUIRE_FEQ(w[n], fun->weight(&ctx, x[n]), 1e-12);
+        }
     }
 
     for (int c = 0; c < pl_num_filter_configs; c++) {
@@ -31,6 +41,16 @@ int main()
             continue;
 
         printf("Testing filter config '%s'\n", conf->name);
+
+        // Ensure batched sampling matches scalar sampling, including values
+        // outside of the filter radius
+        double x[201], w[201];
+        for (int n = 0; n < PL_ARRAY_SIZE(x); n++)
+            x[n] = (n - 100) * 0.05;
+        pl_filter_sample_n(conf, x, w, PL_ARRAY_SIZE(x));
+        for (int n = 0; n < PL_ARRAY_SIZE(x); n++)
+            REQUIRE_FEQ(w[n], pl_filter_sample(conf, x[n]), 1e-12);
+
         pl_filter flt = pl_filter_generate(log, pl_filter_params(
             .config      = *conf,
             .lut_entries = 256,
@@ -75,6 +95,35 @@ int main()
         }
 
         pl_filter_free(&flt);
+
+        // Generate a LUT large enough to be split across multiple threads,
+        // and make sure the result is unaffected
+        flt = pl_filter_generate(log, pl_filter_params(
+            .config      = *conf,
+            .lut_entries = 8192,
+            .cutoff      = 1e-3,
+        ));
+        REQUIRE(flt);
+
+        if (conf->polar) {
+            for (int i = 0; i < flt->params.lut_entries; i++) {
+                double ref = pl_filter_sample(conf, flt->radius * i / (flt->params.lut_entries - 1));
+                REQUIRE_FEQ(flt->weights[i], ref, 1e-6);
+            }
+        } else {
+            for (int i = 0; i < flt->params.lut_entries; i += 97) {
+                const float *row = flt->weights + i * flt->row_stride;
+                const double center = flt->row_size / 2 - 1 + i / (flt->params.lut_entries - 1.0);
+                double ref[256], sum = 0.0;
+                REQUIRE_CMP(flt->row_size, <=, PL_ARRAY_SIZE(ref), "d");
+                for (int n = 0; n < flt->row_size; n++)
+                    sum += ref[n] = pl_filter_sample(conf, n - center);
+                for (int n = 0; n < flt->row_size; n++)
+                    REQUIRE_FEQ(row[n], ref[n] / sum, 1e-6);
+            }
+        }
+
+        pl_filter_free(&flt);
     }
 
     pl_log_destroy(&log);
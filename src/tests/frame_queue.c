@@ -0,0 +1,227 @@
+#include "utils.h"
+#include "pl_thread.h"
+
+#include <libplacebo/dummy.h>
+#include <libplacebo/utils/frame_queue.h>
+
+#define NUM_FRAMES 5000
+#define FRAME_DURATION (1.0 / 240.0)
+#define MAP_LATENCY 0.01
+#define NUM_ASYNC_FRAMES 200
+
+static atomic_int num_mapped, num_unmapped, num_discarded;
+
+static bool map_frame(pl_gpu gpu, pl_tex *tex, const struct pl_source_frame *src,
+                      struct pl_frame *out_frame)
+{
+    *out_frame = (struct pl_frame) {0};
+    atomic_fetch_add(&num_mapped, 1);
+    return true;
+}
+
+static bool map_frame_slow(pl_gpu gpu, pl_tex *tex, const struct pl_source_frame *src,
+                           struct pl_frame *out_frame)
+{
+    pl_thread_sleep(MAP_LATENCY);
+    return map_frame(gpu, tex, src, out_frame);
+}
+
+static void unmap_frame(pl_gpu gpu, struct pl_frame *frame,
+                        const struct pl_source_frame *src)
+{
+    atomic_fetch_add(&num_unmapped, 1);
+}
+
+static void discard_frame(const struct pl_source_frame *src)
+{
+    atomic_fetch_add(&num_discarded, 1);
+}
+
+static struct pl_source_frame make_frame(int idx)
+{
+    return (struct pl_source_frame) {
+        .pts        = idx * FRAME_DURATION,
+        .duration   = FRAME_DURATION,
+        .map        = map_frame,
+        .unmap      = unmap_frame,
+        .discard    = discard_frame,
+    };
+}
+
+struct producer {
+    pl_queue queue;
+    double latency[NUM_FRAMES];
+};
+
+static PL_THREAD_VOID produce(void *priv)
+{
+    struct producer *prod = priv;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        struct pl_source_frame frame = make_frame(i);
+        pl_clock_t start = pl_clock_now();
+        pl_queue_push(prod->queue, &frame);
+        prod->latency[i] = pl_clock_diff(pl_clock_now(), start);
+    }
+
+    pl_queue_push(prod->queue, NULL);
+    PL_THREAD_RETURN();
+}
+
+struct blocking_push {
+    pl_queue queue;
+    int idx;
+};
+
+// Pushes one more frame, blocking until there is room, followed by EOF
+static PL_THREAD_VOID push_blocking(void *priv)
+{
+    struct blocking_push *push = priv;
+    struct pl_source_frame frame = make_frame(push->idx);
+    REQUIRE(pl_queue_push_block(push->queue, UINT64_MAX, &frame));
+    pl_queue_push(push->queue, NULL);
+    PL_THREAD_RETURN();
+}
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    double a = *(const double *) pa, b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
+
+static void consume(pl_queue queue)
+{
+    struct pl_queue_params qparams = {
+        .vsync_duration = FRAME_DURATION,
+        .timeout = UINT64_MAX,
+    };
+
+    uint64_t last_sig = 0;
+    enum pl_queue_status ret;
+    struct pl_frame_mix mix;
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        if (mix.num_frames) {
+            REQUIRE_CMP(mix.signatures[0], >=, last_sig, PRIu64);
+            last_sig = mix.signatures[0];
+        }
+        qparams.pts += qparams.vsync_duration;
+    }
+}
+
+static void check_frames(int num_frames)
+{
+    REQUIRE_CMP(atomic_load(&num_mapped), ==, atomic_load(&num_unmapped), "d");
+    REQUIRE_CMP(atomic_load(&num_unmapped) + atomic_load(&num_discarded),
+                ==, num_frames, "d");
+    atomic_store(&num_mapped, 0);
+    atomic_store(&num_unmapped, 0);
+    atomic_store(&num_discarded, 0);
+}
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    pl_log_level_update(log, PL_LOG_INFO);
+    pl_gpu gpu = pl_gpu_dummy_create(log, NULL);
+
+    // One producer, one consumer
+    struct producer *prod = malloc(sizeof(*prod));
+    REQUIRE(prod);
+    prod->queue = pl_queue_create(gpu);
+
+    pl_thread thread;
+    REQUIRE_CMP(pl_thread_create(&thread, produce, prod), ==, 0, "d");
+    consume(prod->queue);
+    REQUIRE_CMP(pl_thread_join(thread), ==, 0, "d");
+    pl_queue_destroy(&prod->queue);
+    check_frames(NUM_FRAMES);
+
+    qsort(prod->latency, NUM_FRAMES, sizeof(double), cmp_double);
+    printf("pl_queue_push latency over %d frames: p50 %.3f us, p90 %.3f us, "
+           "p99 %.3f us, p99.9 %.3f us, max %.3f us\n", NUM_FRAMES,
+           1e6 * prod->latency[NUM_FRAMES / 2],
+           1e6 * prod->latency[NUM_FRAMES * 9 / 10],
+           1e6 * prod->latency[NUM_FRAMES * 99 / 100],
+           1e6 * prod->latency[NUM_FRAMES * 999 / 1000],
+           1e6 * prod->latency[NUM_FRAMES - 1]);
+    free(prod);
+
+    // Batched pushes, overflowing the internal ring
+    pl_queue queue = pl_queue_create(gpu);
+    struct pl_source_frame batch[100];
+    for (int i = 0; i < NUM_FRAMES; i += PL_ARRAY_SIZE(batch)) {
+        for (int j = 0; j < PL_ARRAY_SIZE(batch); j++)
+            batch[j] = make_frame(i + j);
+        pl_queue_push_n(queue, batch, PL_ARRAY_SIZE(batch));
+    }
+    REQUIRE_CMP(pl_queue_num_frames(queue), ==, NUM_FRAMES, "d");
+    pl_queue_push(queue, NULL);
+    consume(queue);
+    pl_queue_destroy(&queue);
+    check_frames(NUM_FRAMES);
+
+    // Frames pushed after EOF must be discarded, frames pushed before a reset
+    // must be culled
+    queue = pl_queue_create(gpu);
+    struct pl_source_frame frame = make_frame(0);
+    pl_queue_push(queue, &frame);
+    pl_queue_reset(queue);
+    REQUIRE_CMP(pl_queue_num_frames(queue), ==, 0, "d");
+    REQUIRE_CMP(atomic_load(&num_discarded), ==, 1, "d");
+    pl_queue_push(queue, NULL);
+    pl_queue_push(queue, &frame);
+    REQUIRE_CMP(pl_queue_num_frames(queue), ==, 0, "d");
+    REQUIRE_CMP(atomic_load(&num_discarded), ==, 2, "d");
+    pl_queue_destroy(&queue);
+    atomic_store(&num_discarded, 0);
+
+    // Asynchronous mapping should start as soon as frames are pushed, and
+    // grow the prefetch depth to cover the map latency
+    queue = pl_queue_create(gpu);
+    pl_queue_set_map_threads(queue, 4);
+    REQUIRE_CMP(pl_queue_prefetch_frames(queue), ==, 2, "d");
+    for (int i = 0; i < NUM_ASYNC_FRAMES; i++) {
+        frame = make_frame(i);
+        frame.map = map_frame_slow;
+        pl_queue_push(queue, &frame);
+    }
+    pl_queue_push(queue, NULL);
+    for (int i = 0; i < 100 && atomic_load(&num_mapped) < 2; i++)
+        pl_thread_sleep(MAP_LATENCY);
+    REQUIRE_CMP(atomic_load(&num_mapped), >=, 2, "d");
+    consume(queue);
+    int prefetch = pl_queue_prefetch_frames(queue);
+    REQUIRE_CMP(prefetch, >, 2, "d");
+    printf("Adaptive prefetch depth with %.1f ms map latency: %d frames\n",
+           1e3 * MAP_LATENCY, prefetch);
+    pl_queue_destroy(&queue);
+    check_frames(NUM_ASYNC_FRAMES);
+
+    // Map threads must only map the prefetch window, and must not defeat the
+    // back-pressure applied by `pl_queue_push_block`
+    for (int threads = 0; threads <= 2; threads += 2) {
+        queue = pl_queue_create(gpu);
+        pl_queue_set_map_threads(queue, threads);
+        int accepted = 0;
+        frame = make_frame(0);
+        while (accepted < NUM_ASYNC_FRAMES &&
+               pl_queue_push_block(queue, 10000000, &frame)) // 10 ms
+        {
+            frame = make_frame(++accepted);
+            pl_thread_sleep(1e-3); // give the map threads a chance to run
+        }
+        REQUIRE_CMP(accepted, ==, pl_queue_prefetch_frames(queue), "d");
+        REQUIRE_CMP(atomic_load(&num_mapped), <=, accepted, "d");
+
+        // A blocked producer must wake up as soon as frames are consumed
+        struct blocking_push push = { .queue = queue, .idx = accepted };
+        REQUIRE_CMP(pl_thread_create(&thread, push_blocking, &push), ==, 0, "d");
+        consume(queue);
+        REQUIRE_CMP(pl_thread_join(thread), ==, 0, "d");
+        pl_queue_destroy(&queue);
+        check_frames(accepted + 1);
+    }
+
+    pl_gpu_dummy_destroy(&gpu);
+    pl_log_destroy(&log);
+}
@@ -982,6 +982,60 @@ static const char *user_shader_tests[] = {
     "vec4 hook() { return vec4(0.0); }                                      \n"
 };
 
+// Equivalent pointwise shaders, the first of which defines the same helper
+// function in both passes, and therefore can't be fused
+static const char *helper_shaders[2] = {
+    "//!HOOK MAIN                                                           \n"
+    "//!BIND HOOKED                                                         \n"
+    "float f(float x) { return 1.0 - x; }                                   \n"
+    "vec4 hook() { vec4 c = HOOKED_tex(HOOKED_pos);                         \n"
+    "              return vec4(f(c.r), f(c.g), f(c.b), c.a); }              \n"
+    "                                                                       \n"
+    "//!HOOK MAIN                                                           \n"
+    "//!BIND HOOKED                                                         \n"
+    "float f(float x) { return 0.5 * x; }                                   \n"
+    "vec4 hook() { vec4 c = HOOKED_texOff(0);                               \n"
+    "              return vec4(f(c.r), f(c.g), f(c.b), c.a); }              \n",
+
+    "//!HOOK MAIN                                                           \n"
+    "//!BIND HOOKED                                                         \n"
+    "vec4 hook() { vec4 c = HOOKED_tex(HOOKED_pos);                         \n"
+    "              return vec4(vec3(1.0) - c.rgb, c.a); }                   \n"
+    "                                                                       \n"
+    "//!HOOK MAIN                                                           \n"
+    "//!BIND HOOKED                                                         \n"
+    "vec4 hook() { vec4 c = HOOKED_texOff(0);                               \n"
+    "              return vec4(0.5 * c.rgb, c.a); }                         \n",
+};
+
+// Only reads the hooked texture at the current pixel, so it can be fused
+static const char *pointwise_shader =
+    "//!PARAM gain                                                          \n"
+    "//!TYPE DYNAMIC float                                                  \n"
+    "//!MINIMUM 0.0                                                         \n"
+    "0.5                                                                    \n"
+    "                                                                       \n"
+    "//!HOOK PREKERNEL                                                      \n"
+    "//!HOOK MAIN                                                           \n"
+    "//!DESC invert                                                         \n"
+    "//!BIND HOOKED                                                         \n"
+    "                                                                       \n"
+    "vec4 hook()                                                            \n"
+    "{                                                                      \n"
+    "    return vec4(1.0) - HOOKED_tex(HOOKED_pos);                         \n"
+    "}                                                                      \n"
+    "                                                                       \n"
+    "//!HOOK MAIN                                                           \n"
+    "//!DESC scale                                                          \n"
+    "//!BIND HOOKED                                                         \n"
+    "//!WHEN gain 0 >                                                       \n"
+    "                                                                       \n"
+    "vec4 hook()                                                            \n"
+    "{                                                                      \n"
+    "    vec4 color = HOOKED_texOff(0);                                     \n"
+    "    return vec4(gain * color.rgb, color.a);                            \n"
+    "}                                                                      \n";
+
 static const char *compute_shader_tests[] = {
     // Test use of storage/buffer resources
     "//!HOOK MAIN                                                           \n"
@@ -1058,6 +1112,35 @@ static void render_info_cb(void *priv, const struct pl_render_info *info)
            info->pass->shader->description);
 }
 
+struct pass_counter {
+    int passes;
+    struct pl_render_info last;
+};
+
+static void count_info_cb(void *priv, const struct pl_render_info *info)
+{
+    struct pass_counter *counter = priv;
+    counter->passes++;
+    counter->last = *info;
+}
+
+// Makes the creation of the next texture with the given size fail, as if the
+// GPU had run out of memory
+static struct {
+    __typeof__(pl_tex_create) *tex_create;
+    int w, h;
+} fail_tex;
+
+static pl_tex fail_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
+{
+    if (params->w != fail_tex.w || params->h != fail_tex.h)
+        return fail_tex.tex_create(gpu, params);
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    impl->tex_create = fail_tex.tex_create; // only fail once
+    return NULL;
+}
+
 static void pl_render_tests(pl_gpu gpu)
 {
     pl_tex img_tex = NULL, fbo = NULL;
@@ -1254,6 +1337,55 @@ static void pl_render_tests(pl_gpu gpu)
         pl_mpv_user_shader_destroy(&hook);
     }
 
+    // Test fusion of pointwise user shaders
+    {
+        printf("- testing pointwise user shader fusion\n");
+        const struct pl_hook *hook;
+        hook = pl_mpv_user_shader_parse(gpu, pointwise_shader, strlen(pointwise_shader));
+        REQUIRE(hook);
+        REQUIRE_CMP(hook->input, ==, PL_HOOK_SIG_COLOR, "d");
+
+        struct pass_counter counter = {0};
+        params.hooks = &hook;
+        params.num_hooks = 1;
+        params.info_callback = count_info_cb;
+        params.info_priv = &counter;
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE_CMP(counter.last.passes_fused, >=, 2, "d");
+        REQUIRE_CMP(counter.last.passes_unfused, ==, 0, "d");
+
+        pl_mpv_user_shader_destroy(&hook);
+        params = pl_render_default_params;
+    }
+
+    // Passes with helper functions must render the same as fused passes
+    if (fbo->params.host_readable) {
+        printf("- testing user shaders with helper functions\n");
+        static float helper_out[2][width * height];
+        for (int i = 0; i < PL_ARRAY_SIZE(helper_shaders); i++) {
+            const struct pl_hook *hook;
+            hook = pl_mpv_user_shader_parse(gpu, helper_shaders[i],
+                                            strlen(helper_shaders[i]));
+            REQUIRE(hook);
+            REQUIRE_CMP(hook->input, ==, i ? PL_HOOK_SIG_COLOR : PL_HOOK_SIG_TEX, "d");
+
+            params.hooks = &hook;
+            params.num_hooks = 1;
+            REQUIRE(pl_render_image(rr, &image, &target, &params));
+            REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = fbo,
+                .ptr = helper_out[i],
+            )));
+            pl_mpv_user_shader_destroy(&hook);
+        }
+
+        for (int i = 0; i < width * height; i++)
+            REQUIRE_FEQ(helper_out[0][i], helper_out[1][i], 1e-4);
+        params = pl_render_default_params;
+    }
+
     if (gpu->glsl.compute && gpu->limits.max_ssbo_size) {
         for (int i = 0; i < PL_ARRAY_SIZE(compute_shader_tests); i++) {
             printf("- testing user shader:\n\n%s\n", compute_shader_tests[i]);
@@ -1363,6 +1495,173 @@ static void pl_render_tests(pl_gpu gpu)
     REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     target.num_overlays = 0;
 
+    // Changing only the overlays should only redraw the affected region, with
+    // results identical to rendering the whole frame
+    printf("- testing partial overlay updates\n");
+    pl_fmt partial_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32,
+                                     PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_BLENDABLE |
+                                     PL_FMT_CAP_BLITTABLE | PL_FMT_CAP_HOST_READABLE);
+    if (partial_fmt) {
+        pl_tex partial_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = width,
+            .h              = height,
+            .format         = partial_fmt,
+            .renderable     = true,
+            .blit_src       = true,
+            .blit_dst       = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(partial_tex);
+        struct pl_frame partial_target = target;
+        partial_target.planes[0].texture = partial_tex;
+
+        const struct pl_overlay ol_a = {
+            .tex = img_plane.texture,
+            .mode = PL_OVERLAY_NORMAL,
+            .num_parts = 1,
+            .parts = &(struct pl_overlay_part) {
+                .src = {0, 0, 10, 10},
+                .dst = {5, 5, 15, 15},
+            },
+        };
+
+        const struct pl_overlay ol_b = {
+            .tex = img_plane.texture,
+            .mode = PL_OVERLAY_MONOCHROME,
+            .num_parts = 1,
+            .parts = &(struct pl_overlay_part) {
+                .src = {5, 5, 20, 15},
+                .dst = {20, 30, 35, 40.5},
+                .color = {0.0, 0.5, 1.0, 0.5},
+            },
+        };
+
+        struct pass_counter counter = {0};
+        params = pl_render_default_params;
+        params.partial_overlay_updates = true;
+        params.info_callback = count_info_cb;
+        params.info_priv = &counter;
+
+        struct pl_frame partial_image = image;
+        partial_image.num_overlays = 1;
+        partial_image.overlays = &ol_a;
+        partial_target.num_overlays = 1;
+        partial_target.overlays = &ol_b;
+        REQUIRE(pl_render_image(rr, &partial_image, &partial_target, &params));
+
+        // Move the image overlay, and drop the target overlay
+        partial_image.overlays = &ol_b;
+        partial_target.num_overlays = 0;
+        counter.passes = 0;
+        REQUIRE(pl_render_image(rr, &partial_image, &partial_target, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE_CMP(counter.passes, ==, 1, "d");
+
+        static float partial_out[width * height * 4], partial_ref[width * height * 4];
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = partial_tex,
+            .ptr = partial_out,
+        )));
+
+        params.partial_overlay_updates = false;
+        REQUIRE(pl_render_image(rr, &partial_image, &partial_target, &params));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = partial_tex,
+            .ptr = partial_ref,
+        )));
+
+        for (int n = 0; n < width * height * 4; n++)
+            REQUIRE_FEQ(partial_out[n], partial_ref[n], 1e-6);
+        pl_tex_destroy(gpu, &partial_tex);
+        params = pl_render_default_params;
+    }
+
+    // Batching overlays through the atlas must not affect the result, but
+    // should reduce the number of passes
+    printf("- testing batched overlays\n");
+    pl_fmt ol_fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8,
+                                PL_FMT_CAP_LINEAR | PL_FMT_CAP_BLITTABLE);
+    if (partial_fmt && ol_fmt) {
+        enum { NUM_OL = 20, OL_SIZE = 8 };
+        pl_tex ol_tex[NUM_OL];
+        struct pl_overlay ols[NUM_OL];
+        struct pl_overlay_part ol_parts[NUM_OL];
+        static uint8_t ol_data[OL_SIZE * OL_SIZE * 4];
+        for (int i = 0; i < NUM_OL; i++) {
+            for (int n = 0; n < sizeof(ol_data); n++)
+                ol_data[n] = RANDOM_U8;
+            ol_tex[i] = pl_tex_create(gpu, pl_tex_params(
+                .w              = OL_SIZE,
+                .h              = OL_SIZE,
+                .format         = ol_fmt,
+                .sampleable     = true,
+                .blit_src       = i % 2, // test both upload paths
+                .initial_data   = ol_data,
+            ));
+            REQUIRE(ol_tex[i]);
+
+            const float x = (i * 7) % (width - OL_SIZE), y = (i * 13) % (height - OL_SIZE);
+            ol_parts[i] = (struct pl_overlay_part) {
+                .src = {0, 0, OL_SIZE, OL_SIZE},
+                .dst = {x, y, x + OL_SIZE, y + OL_SIZE},
+                .color = {1.0, 0.5, 0.25, 0.75},
+            };
+            ols[i] = (struct pl_overlay) {
+                .tex = ol_tex[i],
+                .mode = i < NUM_OL / 2 ? PL_OVERLAY_NORMAL : PL_OVERLAY_MONOCHROME,
+                .repr = pl_color_repr_rgb,
+                .color = pl_color_space_srgb,
+                .num_parts = 1,
+                .parts = &ol_parts[i],
+            };
+        }
+
+        pl_tex batch_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = width,
+            .h              = height,
+            .format         = partial_fmt,
+            .renderable     = true,
+            .blit_dst       = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(batch_tex);
+        struct pl_frame batch_target = target;
+        batch_target.planes[0].texture = batch_tex;
+        batch_target.overlays = ols;
+        batch_target.num_overlays = NUM_OL;
+
+        static float batch_out[width * height * 4], batch_ref[width * height * 4];
+        struct pass_counter counter = {0};
+        params = pl_render_default_params;
+        params.info_callback = count_info_cb;
+        params.info_priv = &counter;
+        REQUIRE(pl_render_image(rr, NULL, &batch_target, &params));
+        REQUIRE_CMP(counter.passes, ==, NUM_OL, "d");
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = batch_tex,
+            .ptr = batch_ref,
+        )));
+
+        // Once the atlas is populated, each mode only needs a single pass
+        params.batch_overlays = true;
+        REQUIRE(pl_render_image(rr, NULL, &batch_target, &params));
+        counter.passes = 0;
+        REQUIRE(pl_render_image(rr, NULL, &batch_target, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE_CMP(counter.passes, ==, 2, "d");
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = batch_tex,
+            .ptr = batch_out,
+        )));
+
+        for (int n = 0; n < width * height * 4; n++)
+            REQUIRE_FEQ(batch_out[n], batch_ref[n], 1e-3);
+        for (int i = 0; i < NUM_OL; i++)
+            pl_tex_destroy(gpu, &ol_tex[i]);
+        pl_tex_destroy(gpu, &batch_tex);
+        params = pl_render_default_params;
+    }
+
     // Test rotation
     for (pl_rotation rot = 0; rot < PL_ROTATION_360; rot += PL_ROTATION_90) {
         image.rotation = rot;
@@ -1370,6 +1669,242 @@ static void pl_render_tests(pl_gpu gpu)
         REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     }
 
+    // Render to multiple targets at once, and compare against rendering each
+    // target individually. Only the largest target is rendered directly from
+    // the source, the others are downscaled from the next larger result, so
+    // the reference for those is rendered separately from the reference of
+    // the previous (larger) target instead.
+    printf("- testing multi-target rendering\n");
+    image.rotation = PL_ROTATION_0;
+    pl_fmt multi_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32,
+                                   PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE |
+                                   PL_FMT_CAP_HOST_READABLE);
+    if (multi_fmt) {
+        static const int sizes[] = { 40, 20, 9 };
+        static float multi_data[40 * 40 * 4], ref_data[40 * 40 * 4];
+        pl_tex multi_tex[PL_ARRAY_SIZE(sizes)] = {0};
+        pl_tex ref_tex[PL_ARRAY_SIZE(sizes)] = {0};
+        struct pl_frame multi_targets[PL_ARRAY_SIZE(sizes)];
+        struct pl_frame ref_targets[PL_ARRAY_SIZE(sizes)];
+        for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+            const struct pl_tex_params tex_params = {
+                .w              = sizes[i],
+                .h              = sizes[i],
+                .format         = multi_fmt,
+                .sampleable     = true,
+                .renderable     = true,
+                .host_readable  = true,
+            };
+            multi_tex[i] = pl_tex_create(gpu, &tex_params);
+            ref_tex[i] = pl_tex_create(gpu, &tex_params);
+            REQUIRE(multi_tex[i] && ref_tex[i]);
+            multi_targets[i] = target;
+            multi_targets[i].planes[0].texture = multi_tex[i];
+            ref_targets[i] = target;
+            ref_targets[i].planes[0].texture = ref_tex[i];
+        }
+
+        params = pl_render_default_params;
+        REQUIRE(pl_render_image_multi(rr, &image, multi_targets,
+                                      PL_ARRAY_SIZE(sizes), &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+        for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+            const struct pl_frame *src = i ? &ref_targets[i - 1] : &image;
+            REQUIRE(pl_render_image(rr, src, &ref_targets[i], &params));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = multi_tex[i],
+                .ptr = multi_data,
+            )));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = ref_tex[i],
+                .ptr = ref_data,
+            )));
+
+            // The alpha channel is not written to, so only compare RGB
+            for (int n = 0; n < sizes[i] * sizes[i] * 4; n++) {
+                if (n % 4 < 3)
+                    REQUIRE_FEQ(multi_data[n], ref_data[n], 1e-3);
+            }
+        }
+
+        for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+            pl_tex_destroy(gpu, &multi_tex[i]);
+            pl_tex_destroy(gpu, &ref_tex[i]);
+        }
+    }
+
+    // Render in tiles, and compare against rendering the whole image at once
+    printf("- testing tiled rendering\n");
+    if (multi_fmt && (multi_fmt->caps & PL_FMT_CAP_BLITTABLE)) {
+        static const struct { int size, tile; const struct pl_filter_config *filter; } tiled[] = {
+            { 100, 32, &pl_filter_spline36 },
+            { 100, 48, &pl_filter_ewa_lanczos },
+            {  25,  8, &pl_filter_mitchell },
+        };
+
+        static float tiled_data[100 * 100 * 4], ref_data[100 * 100 * 4];
+        for (int i = 0; i < PL_ARRAY_SIZE(tiled); i++) {
+            const int size = tiled[i].size;
+            pl_tex tiled_tex = pl_tex_create(gpu, pl_tex_params(
+                .w              = size,
+                .h              = size,
+                .format         = multi_fmt,
+                .renderable     = true,
+                .blit_dst       = true,
+                .host_readable  = true,
+            ));
+            REQUIRE(tiled_tex);
+            struct pl_frame tiled_target = target;
+            tiled_target.planes[0].texture = tiled_tex;
+
+            struct pass_counter counter = {0};
+            params = pl_render_default_params;
+            params.upscaler = params.downscaler = tiled[i].filter;
+            params.disable_builtin_scalers = true;
+            params.info_callback = count_info_cb;
+            params.info_priv = &counter;
+            REQUIRE(pl_render_image(rr, &image, &tiled_target, &params));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = tiled_tex,
+                .ptr = ref_data,
+            )));
+
+            // Each tile is rendered using separate passes. Skip clearing the
+            // target, so that any tile not rendered keeps the sentinel color.
+            const int untiled_passes = counter.passes;
+            counter.passes = 0;
+            params.output_tile_size = tiled[i].tile;
+            params.border = PL_CLEAR_SKIP;
+            const float sentinel = -1234.0f;
+            pl_tex_clear(gpu, tiled_tex, (float[4]) { sentinel, sentinel,
+                                                      sentinel, sentinel });
+            REQUIRE(pl_render_image(rr, &image, &tiled_target, &params));
+            REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+            REQUIRE_CMP(counter.passes, >, untiled_passes, "d");
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = tiled_tex,
+                .ptr = tiled_data,
+            )));
+
+            for (int n = 0; n < size * size * 4; n++) {
+                REQUIRE_CMP(tiled_data[n], !=, sentinel, "f");
+                REQUIRE_FEQ(tiled_data[n], ref_data[n], 1e-3);
+            }
+            pl_tex_destroy(gpu, &tiled_tex);
+        }
+        params = pl_render_default_params;
+    }
+
+    // Render a cropped region of a subsampled image, and compare against the
+    // corresponding region of the full image
+    printf("- testing cropped rendering\n");
+    if (multi_fmt) {
+        enum { crop_w = 20, crop_h = 16, crop_x = 14, crop_y = 22 };
+        pl_tex chroma_tex[2] = {0};
+        struct pl_frame yuv = {
+            .num_planes     = 3,
+            .repr = {
+                .sys        = PL_COLOR_SYSTEM_BT_709,
+                .levels     = PL_COLOR_LEVELS_FULL,
+            },
+            .color          = pl_color_space_srgb,
+        };
+
+        yuv.planes[0] = img_plane;
+        for (int i = 0; i < 2; i++) {
+            struct pl_plane_data chroma_data = plane_data;
+            chroma_data.width = width / 2;
+            chroma_data.height = height / 2;
+            chroma_data.row_stride = width * sizeof(float);
+            chroma_data.pixels = &data[i][0];
+            REQUIRE(pl_upload_plane(gpu, &yuv.planes[i+1], &chroma_tex[i], &chroma_data));
+            yuv.planes[i+1].component_mapping[0] = i + 1;
+        }
+        pl_chroma_location_offset(PL_CHROMA_LEFT, &yuv.planes[1].shift_x,
+                                  &yuv.planes[1].shift_y);
+        yuv.planes[2].shift_x = yuv.planes[1].shift_x;
+        yuv.planes[2].shift_y = yuv.planes[1].shift_y;
+
+        pl_tex full_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = width,
+            .h              = height,
+            .format         = multi_fmt,
+            .renderable     = true,
+            .host_readable  = true,
+        ));
+        pl_tex crop_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = crop_w,
+            .h              = crop_h,
+            .format         = multi_fmt,
+            .renderable     = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(full_tex && crop_tex);
+
+        static float full_data[width * height * 4], crop_data[crop_w * crop_h * 4];
+        struct pl_frame out = target;
+        out.planes[0].texture = full_tex;
+        params = pl_render_default_params;
+        params.deband_params = NULL; // randomized per pixel
+        params.dither_params = NULL;
+        REQUIRE(pl_render_image(rr, &yuv, &out, &params));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = full_tex,
+            .ptr = full_data,
+        )));
+
+        yuv.crop = (pl_rect2df) { crop_x, crop_y, crop_x + crop_w, crop_y + crop_h };
+        out.planes[0].texture = crop_tex;
+        REQUIRE(pl_render_image(rr, &yuv, &out, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = crop_tex,
+            .ptr = crop_data,
+        )));
+
+        for (int y = 0; y < crop_h; y++) {
+            for (int x = 0; x < crop_w * 4; x++) {
+                REQUIRE_FEQ(crop_data[y * crop_w * 4 + x],
+                            full_data[(crop_y + y) * width * 4 + crop_x * 4 + x],
+                            1e-3);
+            }
+        }
+
+        // The region of interest must actually shrink the intermediates. Plane
+        // address modes other than clamp disable it, without affecting the
+        // (interior) crop, so compare the intermediate memory of both
+        pl_tex_pool pool = pl_tex_pool_create(gpu, NULL);
+        REQUIRE(pool);
+        pl_renderer_set_tex_pool(rr, pool);
+        size_t roi_bytes[2];
+        for (int i = 0; i < 2; i++) {
+            for (int p = 1; p < yuv.num_planes; p++)
+                yuv.planes[p].address_mode = i ? PL_TEX_ADDRESS_REPEAT
+                                               : PL_TEX_ADDRESS_CLAMP;
+            pl_tex_pool_flush(pool);
+            REQUIRE(pl_render_image(rr, &yuv, &out, &params));
+            REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+            roi_bytes[i] = pl_tex_pool_get_stats(pool).bytes_held;
+        }
+        REQUIRE_CMP(roi_bytes[0], <, roi_bytes[1], "zu");
+        for (int p = 1; p < yuv.num_planes; p++)
+            yuv.planes[p].address_mode = PL_TEX_ADDRESS_CLAMP;
+        pl_renderer_set_tex_pool(rr, NULL);
+        pl_tex_pool_destroy(&pool);
+
+        // Debanding only the region of interest
+        params.deband_params = &pl_deband_default_params;
+        REQUIRE(pl_render_image(rr, &yuv, &out, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+        pl_tex_destroy(gpu, &full_tex);
+        pl_tex_destroy(gpu, &crop_tex);
+        pl_tex_destroy(gpu, &chroma_tex[0]);
+        pl_tex_destroy(gpu, &chroma_tex[1]);
+        params = pl_render_default_params;
+    }
+
     // Attempt frame mixing, using the mixer queue helper
     printf("- testing frame mixing\n");
     struct pl_render_params mix_params = {
@@ -1469,6 +2004,244 @@ static void pl_render_tests(pl_gpu gpu)
     pl_queue_reset(queue);
     REQUIRE(pl_queue_update(queue, &mix, &qparams) == PL_QUEUE_EOF);
 
+    // Frames stored in the mixing cache at reduced precision must stay within
+    // the documented error bound of the full precision result, for both float
+    // (half float cache) and unorm (10-bit cache) targets
+    printf("- testing reduced precision frame mixing\n");
+    for (int i = 0; i < 2; i++) {
+        const enum pl_fmt_caps caps = PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE;
+        pl_fmt mix_fmt = i ? pl_find_fmt(gpu, PL_FMT_UNORM, 4, 16, 16, caps)
+                           : pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, caps);
+        if (!mix_fmt)
+            continue;
+
+        pl_tex mix_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = width,
+            .h              = height,
+            .format         = mix_fmt,
+            .renderable     = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(mix_tex);
+        struct pl_frame mix_target = target;
+        mix_target.planes[0].texture = mix_tex;
+
+        mix = (struct pl_frame_mix) {
+            .num_frames = 2,
+            .frames = (const struct pl_frame *[]) { &image, &image },
+            .signatures = (uint64_t[]) { 0x1000 + i, 0x2000 + i },
+            .timestamps = (float[]) { -0.5, 0.5 },
+            .vsync_duration = 1.0,
+        };
+
+        static float mix_ref[width * height * 4], mix_out[width * height * 4];
+        mix_params = pl_render_default_params;
+        mix_params.frame_mixer = &pl_oversample_frame_mixer;
+        pl_renderer_flush_cache(rr);
+        REQUIRE(pl_render_image_mix(rr, &mix, &mix_target, &mix_params));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = mix_tex,
+            .ptr = mix_ref,
+        )));
+
+        // Use a cache limit too small to hold even a single frame, which must
+        // still keep all frames required for the current mix
+        mix_params.mixing_cache_reduced_precision = true;
+        mix_params.mixing_cache_max_bytes = 1;
+        pl_renderer_flush_cache(rr);
+        REQUIRE(pl_render_image_mix(rr, &mix, &mix_target, &mix_params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = mix_tex,
+            .ptr = mix_out,
+        )));
+
+        const float bound = 1.0f / 2046 + 1.0f / 65535; // cache + target rounding
+        for (int n = 0; n < width * height * 4; n++) {
+            float ref = i ? ((uint16_t *) mix_ref)[n] / 65535.0f : mix_ref[n];
+            float out = i ? ((uint16_t *) mix_out)[n] / 65535.0f : mix_out[n];
+            REQUIRE_FEQ(out, ref, bound);
+        }
+
+        // Moving on to new frames evicts the old ones down to the limit
+        mix.signatures = (uint64_t[]) { 0x3000 + i, 0x4000 + i };
+        REQUIRE(pl_render_image_mix(rr, &mix, &mix_target, &mix_params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        pl_tex_destroy(gpu, &mix_tex);
+    }
+
+    // Failing to allocate a frame in the mixing cache should disable frame
+    // mixing, but still render the frame without it
+    printf("- testing frame mixing fallback\n");
+    pl_fmt fallback_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32,
+                                      PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE);
+    if (fallback_fmt) {
+        enum { fb_w = 37, fb_h = 29 }; // distinct from all other textures
+        pl_tex fb_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = fb_w,
+            .h              = fb_h,
+            .format         = fallback_fmt,
+            .renderable     = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(fb_tex);
+        struct pl_frame fb_target = target;
+        fb_target.planes[0].texture = fb_tex;
+
+        static float fb_ref[fb_w * fb_h * 4], fb_out[fb_w * fb_h * 4];
+        mix_params = pl_render_default_params;
+        REQUIRE(pl_render_image(rr, &image, &fb_target, &mix_params));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fb_tex,
+            .ptr = fb_ref,
+        )));
+
+        mix = (struct pl_frame_mix) {
+            .num_frames = 2,
+            .frames = (const struct pl_frame *[]) { &image, &image },
+            .signatures = (uint64_t[]) { 0x5000, 0x6000 },
+            .timestamps = (float[]) { -0.5, 0.5 },
+            .vsync_duration = 1.0,
+        };
+
+        struct pl_gpu_fns *impl = PL_PRIV(gpu);
+        fail_tex.tex_create = impl->tex_create;
+        fail_tex.w = fb_w;
+        fail_tex.h = fb_h;
+        impl->tex_create = fail_tex_create;
+
+        mix_params.frame_mixer = &pl_oversample_frame_mixer;
+        pl_renderer_flush_cache(rr);
+        bool fb_ok = pl_render_image_mix(rr, &mix, &fb_target, &mix_params);
+        bool fb_triggered = impl->tex_create != fail_tex_create;
+        impl->tex_create = fail_tex.tex_create;
+        REQUIRE(fb_ok);
+        REQUIRE(fb_triggered);
+
+        const struct pl_render_errors rr_err = pl_renderer_get_errors(rr);
+        REQUIRE(rr_err.errors == PL_RENDER_ERR_FRAME_MIXING);
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fb_tex,
+            .ptr = fb_out,
+        )));
+        for (int n = 0; n < fb_w * fb_h * 4; n++)
+            REQUIRE_FEQ(fb_out[n], fb_ref[n], 1e-3);
+
+        pl_renderer_reset_errors(rr, &rr_err);
+        pl_tex_destroy(gpu, &fb_tex);
+    }
+
+    // Identical invocations of the frame mixer should reuse the output
+    printf("- testing redundant frame skipping\n");
+    pl_fmt skip_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32,
+                                  PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_BLITTABLE |
+                                  PL_FMT_CAP_HOST_READABLE);
+    if (skip_fmt) {
+        pl_tex skip_tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = width,
+            .h              = height,
+            .format         = skip_fmt,
+            .renderable     = true,
+            .blit_src       = true,
+            .blit_dst       = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(skip_tex);
+        struct pl_frame skip_target = target;
+        skip_target.planes[0].texture = skip_tex;
+
+        struct pass_counter counter = {0};
+        mix_params = pl_render_default_params;
+        mix_params.frame_mixer = &pl_oversample_frame_mixer;
+        mix_params.skip_redundant_frames = true;
+        mix_params.info_callback = count_info_cb;
+        mix_params.info_priv = &counter;
+        mix = (struct pl_frame_mix) {
+            .num_frames = 2,
+            .frames = (const struct pl_frame *[]) { &image, &image },
+            .signatures = (uint64_t[]) { 0x5000, 0x6000 },
+            .timestamps = (float[]) { -0.5, 0.5 },
+            .vsync_duration = 1.0,
+        };
+
+        static float skip_ref[width * height * 4], skip_out[width * height * 4];
+        REQUIRE(pl_render_image_mix(rr, &mix, &skip_target, &mix_params));
+        REQUIRE_CMP(counter.passes, >, 0, "d");
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = skip_tex,
+            .ptr = skip_ref,
+        )));
+
+        pl_tex_clear(gpu, skip_tex, (float[4]) {0});
+        counter.passes = 0;
+        REQUIRE(pl_render_image_mix(rr, &mix, &skip_target, &mix_params));
+        REQUIRE_CMP(counter.passes, ==, 0, "d");
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = skip_tex,
+            .ptr = skip_out,
+        )));
+        REQUIRE(memcmp(skip_ref, skip_out, sizeof(skip_ref)) == 0);
+
+        // Any change to the frame mix must re-render
+        mix.timestamps = (float[]) { -0.25, 0.75 };
+        REQUIRE(pl_render_image_mix(rr, &mix, &skip_target, &mix_params));
+        REQUIRE_CMP(counter.passes, >, 0, "d");
+        REQUIRE_CMP(counter.last.frames_reused, >=, 1, PRIu64);
+        REQUIRE_CMP(counter.last.frames_rendered, >=, 2, PRIu64);
+
+        // Low framerate content on a high refresh rate display, rendered to
+        // rotating targets without `blit_src` (like swapchain images). The
+        // timestamps shift on every vsync, but the weights stay the same.
+        pl_tex swap_tex[2];
+        for (int i = 0; i < PL_ARRAY_SIZE(swap_tex); i++) {
+            swap_tex[i] = pl_tex_create(gpu, pl_tex_params(
+                .w              = width,
+                .h              = height,
+                .format         = skip_fmt,
+                .renderable     = true,
+                .blit_dst       = true,
+                .host_readable  = true,
+            ));
+            REQUIRE(swap_tex[i]);
+        }
+
+        float timestamps[2];
+        mix.timestamps = timestamps;
+        for (int vsync = 0; vsync < 4; vsync++) {
+            timestamps[0] = -0.5f - vsync;
+            timestamps[1] = 3.5f - vsync;
+            pl_tex swap = swap_tex[vsync % 2];
+            skip_target.planes[0].texture = swap;
+            if (vsync == 0) {
+                mix_params.skip_redundant_frames = false;
+                REQUIRE(pl_render_image_mix(rr, &mix, &skip_target, &mix_params));
+                REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                    .tex = swap_tex[0],
+                    .ptr = skip_ref,
+                )));
+                mix_params.skip_redundant_frames = true;
+            }
+
+            pl_tex_clear(gpu, swap, (float[4]) {0});
+            counter.passes = 0;
+            REQUIRE(pl_render_image_mix(rr, &mix, &skip_target, &mix_params));
+            if (vsync == 0) {
+                REQUIRE_CMP(counter.passes, >, 0, "d");
+            } else {
+                REQUIRE_CMP(counter.passes, ==, 0, "d");
+            }
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = swap,
+                .ptr = skip_out,
+            )));
+            REQUIRE(memcmp(skip_ref, skip_out, sizeof(skip_ref)) == 0);
+        }
+
+        for (int i = 0; i < PL_ARRAY_SIZE(swap_tex); i++)
+            pl_tex_destroy(gpu, &swap_tex[i]);
+        pl_tex_destroy(gpu, &skip_tex);
+    }
+
     // Test deinterlacing
     pl_queue_reset(queue);
     printf("- testing deinterlacing\n");
@@ -1735,6 +2508,69 @@ static void pl_test_host_ptr(pl_gpu gpu)
     REQUIRE_MEMEQ(data + offset, buf->data, slice);
 
     pl_buf_destroy(gpu, &buf);
+
+    // Simulate a decoder recycling a small pool of frames, uploading each of
+    // them from registered memory (at an unaligned offset)
+    printf("- testing registered host memory\n");
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8, PL_FMT_CAP_HOST_READABLE);
+    pl_tex tex = fmt ? pl_tex_create(gpu, pl_tex_params(
+        .w = 256,
+        .h = 256,
+        .format = fmt,
+        .host_writable = true,
+        .host_readable = true,
+    )) : NULL;
+
+    if (tex && pl_gpu_register_host_mem(gpu, data + offset, size - offset)) {
+        enum { NUM_FRAMES = 4 };
+        const size_t frame_size = 256 * 256 * fmt->texel_size;
+        REQUIRE_CMP(NUM_FRAMES * frame_size, <=, size - offset, "zu");
+        uint8_t *out = malloc(frame_size);
+        const uint64_t hits = pl_gpu_host_mem_hits(gpu);
+
+        bool ran_cb = false;
+        for (int i = 0; i < 2 * NUM_FRAMES; i++) {
+            uint8_t *frame = data + offset + (i % NUM_FRAMES) * frame_size;
+            for (int n = 0; n < frame_size; n++)
+                frame[n] = (uint8_t) (n + i);
+
+            const bool async = gpu->limits.callbacks && (i & 1);
+            REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params(
+                .tex = tex,
+                .ptr = frame,
+                .callback = async ? test_cb : NULL,
+                .priv = &ran_cb,
+            )));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = tex,
+                .ptr = out,
+            )));
+            REQUIRE_MEMEQ(frame, out, frame_size);
+            if (async) {
+                pl_gpu_finish(gpu);
+                REQUIRE(ran_cb);
+                ran_cb = false;
+            }
+        }
+
+        REQUIRE_CMP(pl_gpu_host_mem_hits(gpu) - hits, ==, 2 * NUM_FRAMES, PRIu64);
+
+        // After unregistering, uploads must go through the regular path again
+        pl_gpu_unregister_host_mem(gpu, data + offset, size - offset);
+        REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params(
+            .tex = tex,
+            .ptr = data + offset,
+        )));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = tex,
+            .ptr = out,
+        )));
+        REQUIRE_MEMEQ(data + offset, out, frame_size);
+        REQUIRE_CMP(pl_gpu_host_mem_hits(gpu) - hits, ==, 2 * NUM_FRAMES, PRIu64);
+        free(out);
+    }
+
+    pl_tex_destroy(gpu, &tex);
     free(data);
 
 #endif // unix
@@ -79,6 +79,98 @@ int main()
         pl_lut_free(&lut);
     }
 
+    // Large LUT, to exercise the parallel parsing path
+    const int size = 65;
+    const int entries = size * size * size;
+    pl_str cube = {0};
+    pl_str_append_asprintf(NULL, &cube, "LUT_3D_SIZE %d\n", size);
+    for (int i = 0; i < entries; i++) {
+        pl_str_append_asprintf(NULL, &cube, "%f %f %f\n",
+                               (i % size) / (size - 1.0),
+                               (i / size % size) / (size - 1.0),
+                               (i / size / size) / (size - 1.0));
+    }
+
+    struct pl_custom_lut *lut;
+    lut = pl_lut_parse_cube(log, (char *) cube.buf, cube.len);
+    REQUIRE(lut);
+    REQUIRE_CMP(lut->size[2], ==, size, "d");
+    for (int i = 0; i < entries; i++) {
+        const float r = (i % size) / (size - 1.0),
+                    g = (i / size % size) / (size - 1.0),
+                    b = (i / size / size) / (size - 1.0);
+        REQUIRE_FEQ(lut->data[i * 3 + 0], r, 1e-6);
+        REQUIRE_FEQ(lut->data[i * 3 + 1], g, 1e-6);
+        REQUIRE_FEQ(lut->data[i * 3 + 2], b, 1e-6);
+    }
+
+    // Truncated data and garbage in the middle of the data must fail
+    REQUIRE(!pl_lut_parse_cube(log, (char *) cube.buf, cube.len - 1000));
+    size_t mid = cube.len / 2;
+    while (cube.buf[mid] != '\n')
+        mid++;
+    cube.buf[mid + 1] = 'x';
+    REQUIRE(!pl_lut_parse_cube(log, (char *) cube.buf, cube.len));
+    pl_free(cube.buf);
+
+    // Binary serialization round-trip
+    for (int half = 0; half <= 1; half++) {
+        size_t lut_size = pl_lut_save(lut, half, NULL);
+        REQUIRE(lut_size);
+        uint8_t *buf = malloc(lut_size + 1);
+        REQUIRE_CMP(pl_lut_save(lut, half, buf), ==, lut_size, "zu");
+
+        struct pl_custom_lut *loaded = pl_lut_load(log, buf, lut_size);
+        REQUIRE(loaded);
+        REQUIRE_CMP(loaded->signature, ==, lut->signature, PRIu64);
+        REQUIRE_CMP(loaded->size[2], ==, size, "d");
+        REQUIRE(loaded->data_rgba);
+        for (int i = 0; i < entries; i++) {
+            for (int c = 0; c < 3; c++) {
+                float ref = lut->data[i * 3 + c];
+                float val = loaded->data_rgba[i * 4 + c];
+                if (half) {
+                    REQUIRE_FEQ(val, ref, 0x1p-11 * fabsf(ref) + 0x1p-25);
+                } else {
+                    REQUIRE_CMP(val, ==, ref, "f");
+                }
+            }
+            REQUIRE_CMP(loaded->data_rgba[i * 4 + 3], ==, 0.0f, "f");
+        }
+
+        // Must be usable as-is
+        pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+        pl_shader_custom_lut(sh, loaded, &obj);
+        REQUIRE(pl_shader_finalize(sh));
+        pl_lut_free(&loaded);
+
+        // Corrupt data must be rejected
+        REQUIRE(!pl_lut_load(log, buf, lut_size - 1));
+        REQUIRE(!pl_lut_load(log, buf, lut_size + 1));
+
+        // Dimensions whose payload size overflows to match a tiny payload
+        const size_t texel_size = half ? 8 : 16;
+        const size_t data_offset = lut_size - entries * texel_size;
+        const int32_t huge[3] = { 1, (1 << (half ? 29 : 28)) + 1, 1 };
+        const size_t dims_offset = 16; // after magic, version and flags
+        int32_t dims[3];
+        memcpy(dims, buf + dims_offset, sizeof(dims));
+        memcpy(buf + dims_offset, huge, sizeof(huge));
+        REQUIRE(!pl_lut_load(log, buf, data_offset + texel_size));
+        REQUIRE(!pl_lut_load(log, buf, lut_size));
+        const int32_t oversized[3] = { 2048, 2, 2 };
+        memcpy(buf + dims_offset, oversized, sizeof(oversized));
+        REQUIRE(!pl_lut_load(log, buf, lut_size));
+        memcpy(buf + dims_offset, dims, sizeof(dims));
+        loaded = pl_lut_load(log, buf, lut_size);
+        REQUIRE(loaded);
+        pl_lut_free(&loaded);
+        buf[0] = 'x';
+        REQUIRE(!pl_lut_load(log, buf, lut_size));
+        free(buf);
+    }
+
+    pl_lut_free(&lut);
     pl_shader_obj_destroy(&obj);
     pl_shader_free(&sh);
     pl_gpu_dummy_destroy(&gpu);
@@ -1,4 +1,6 @@
 #include "gpu_tests.h"
+#include "dispatch.h"
+#include "opengl/gpu.h"
 #include "opengl/utils.h"
 
 #include <libplacebo/opengl.h>
@@ -41,6 +43,217 @@ static void opengl_interop_tests(pl_gpu gpu)
     pl_tex_destroy(gpu, &export);
 }
 
+static void count_cb(void *priv)
+{
+    int *count = priv;
+    (*count)++;
+}
+
+static void opengl_transfer_tests(pl_gpu gpu)
+{
+    pl_fmt fmt = pl_find_named_fmt(gpu, "r8");
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_HOST_READABLE) || !gpu->limits.callbacks)
+        return;
+    printf("opengl_transfer_tests:\n");
+
+    static const struct { const char *name; int w, h; } sizes[] = {
+        { "1080p", 1920, 1080 },
+        { "4K",    3840, 2160 },
+    };
+
+    enum { NUM_ITERS = 16 };
+    struct pl_gl *p = PL_PRIV(gpu);
+    const bool has_buf_storage = p->has_buf_storage;
+    for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+        const int w = sizes[i].w, h = sizes[i].h;
+        pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+            .w = w,
+            .h = h,
+            .format = fmt,
+            .host_writable = true,
+            .host_readable = true,
+        ));
+        REQUIRE(tex);
+
+        uint8_t *src = malloc(w * h), *dst = calloc(w, h);
+        REQUIRE(src && dst);
+        for (int n = 0; n < w * h; n++)
+            src[n] = n * 7 + i;
+
+        // Compare the direct path against the staging ring, if available
+        for (int ring = 0; ring <= has_buf_storage; ring++) {
+            p->has_buf_storage = ring;
+
+            int done = 0;
+            pl_clock_t start = pl_clock_now();
+            for (int n = 0; n < NUM_ITERS; n++) {
+                REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params(
+                    .tex = tex,
+                    .ptr = src,
+                    .callback = count_cb,
+                    .priv = &done,
+                )));
+            }
+            pl_gpu_finish(gpu);
+            double ul = pl_clock_diff(pl_clock_now(), start);
+            REQUIRE_CMP(done, ==, NUM_ITERS, "d");
+
+            done = 0;
+            start = pl_clock_now();
+            for (int n = 0; n < NUM_ITERS; n++) {
+                REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                    .tex = tex,
+                    .ptr = dst,
+                    .callback = count_cb,
+                    .priv = &done,
+                )));
+            }
+            pl_gpu_finish(gpu);
+            double dl = pl_clock_diff(pl_clock_now(), start);
+            REQUIRE_CMP(done, ==, NUM_ITERS, "d");
+            REQUIRE_MEMEQ(src, dst, w * h);
+            memset(dst, 0, w * h);
+
+            printf("  %s (%s): upload %.3f ms, download %.3f ms\n",
+                   sizes[i].name, ring ? "staging ring" : "direct",
+                   1e3 * ul / NUM_ITERS, 1e3 * dl / NUM_ITERS);
+        }
+
+        p->has_buf_storage = has_buf_storage;
+        pl_tex_destroy(gpu, &tex);
+        free(src);
+        free(dst);
+    }
+
+    // Staging buffers must not stay sized for the largest transfer ever seen
+    if (has_buf_storage && gpu->limits.max_tex_2d_dim >= 8192) {
+        static const struct { int w, h; } shrink[] = {
+            { 8192, 4096 },
+            {  256,  256 },
+        };
+
+        for (int i = 0; i < PL_ARRAY_SIZE(shrink); i++) {
+            const int w = shrink[i].w, h = shrink[i].h;
+            pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+                .w = w,
+                .h = h,
+                .format = fmt,
+                .host_writable = true,
+            ));
+            REQUIRE(tex);
+            uint8_t *src = calloc(w, h);
+            REQUIRE(src);
+            for (int n = 0; n < GL_XFER_SLOTS; n++) {
+                REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params(
+                    .tex = tex,
+                    .ptr = src,
+                )));
+            }
+            pl_gpu_finish(gpu);
+            pl_tex_destroy(gpu, &tex);
+            free(src);
+        }
+
+        for (int n = 0; n < GL_XFER_SLOTS; n++) {
+            REQUIRE(p->xfer[n].buf);
+            REQUIRE_CMP(p->xfer[n].buf->params.size, <, 8192 * 4096, "zu");
+        }
+    }
+}
+
+static void opengl_uniform_tests(pl_gpu gpu)
+{
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_RENDERABLE) ||
+        !(fmt->caps & PL_FMT_CAP_HOST_READABLE))
+        return;
+    if (gpu->glsl.version < 440 || !gpu->limits.max_ubo_size)
+        return;
+    printf("opengl_uniform_tests:\n");
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .renderable = true,
+        .host_readable = true,
+    ));
+    REQUIRE(fbo);
+
+    // Many passes with many dynamic variables each, similar to a frame with
+    // lots of user shader hooks
+    enum { NUM_VARS = 16, NUM_PASSES = 32, NUM_FRAMES = 64 };
+    char names[NUM_VARS][16];
+    float vals[NUM_VARS];
+    struct pl_shader_var vars[NUM_VARS];
+    char body[NUM_VARS * 16 + 64] = "color = vec4(0.0";
+    for (int i = 0; i < NUM_VARS; i++) {
+        snprintf(names[i], sizeof(names[i]), "var%d", i);
+        vars[i] = (struct pl_shader_var) {
+            .var = pl_var_float(names[i]),
+            .data = &vals[i],
+            .dynamic = true,
+        };
+        strcat(body, " + ");
+        strcat(body, names[i]);
+    }
+    strcat(body, ", 0.0, 0.0, 1.0);");
+
+    uint64_t calls[2];
+    for (int batch = 0; batch <= 1; batch++) {
+        pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
+        pl_dispatch_batch_uniforms(dp, batch);
+
+        pl_clock_t start = pl_clock_now();
+        float expected = 0.0;
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            expected = 0.0;
+            for (int i = 0; i < NUM_VARS; i++)
+                expected += vals[i] = (frame + i) / 4096.0f;
+
+            for (int n = 0; n < NUM_PASSES; n++) {
+                char header[32];
+                snprintf(header, sizeof(header), "// pass %d\n", n);
+                pl_shader sh = pl_dispatch_begin(dp);
+                REQUIRE(pl_shader_custom(sh, &(struct pl_custom_shader) {
+                    .header = header,
+                    .body = body,
+                    .input = PL_SHADER_SIG_NONE,
+                    .output = PL_SHADER_SIG_COLOR,
+                    .num_variables = NUM_VARS,
+                    .variables = vars,
+                }));
+                REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+                    .shader = &sh,
+                    .target = fbo,
+                )));
+            }
+            pl_dispatch_reset_frame(dp);
+        }
+        pl_gpu_finish(gpu);
+        double elapsed = pl_clock_diff(pl_clock_now(), start);
+
+        uint8_t pixels[16 * 16 * 4];
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fbo,
+            .ptr = pixels,
+        )));
+        REQUIRE_FEQ(pixels[0] / 255.0, expected, 1.0 / 255);
+
+        struct pl_dispatch_stats stats = pl_dispatch_get_stats(dp);
+        calls[batch] = stats.var_updates + stats.ubo_writes;
+        printf("  %s: %.3f ms/frame, %.1f uniform updates and %.1f UBO "
+               "writes per frame\n", batch ? "batched" : "direct",
+               1e3 * elapsed / NUM_FRAMES,
+               (double) stats.var_updates / NUM_FRAMES,
+               (double) stats.ubo_writes / NUM_FRAMES);
+        pl_dispatch_destroy(&dp);
+    }
+
+    REQUIRE_CMP(calls[1], <, calls[0], PRIu64);
+    pl_tex_destroy(gpu, &fbo);
+}
+
 #define PBUFFER_WIDTH 640
 #define PBUFFER_HEIGHT 480
 
@@ -223,6 +436,8 @@ int main()
         gpu_shader_tests(gpu);
         gpu_interop_tests(gpu);
         opengl_interop_tests(gpu);
+        opengl_transfer_tests(gpu);
+        opengl_uniform_tests(gpu);
         opengl_swapchain_tests(gl, dpy, surf);
 
         // Reduce log spam after first successful test
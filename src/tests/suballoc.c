@@ -0,0 +1,256 @@
+#include "utils.h"
+
+#include "suballoc.h"
+
+struct blocks {
+    int num_allocs;
+    int num_frees;
+    size_t held;
+};
+
+static void *alloc_block(void *priv, size_t *size)
+{
+    struct blocks *blocks = priv;
+    blocks->num_allocs++;
+    blocks->held += *size;
+    return malloc(*size);
+}
+
+static void free_block(void *priv, void *block)
+{
+    struct blocks *blocks = priv;
+    blocks->num_frees++;
+    free(block);
+}
+
+struct live {
+    struct pl_suballoc_region region;
+    uint8_t tag;
+};
+
+static void fill(struct live *live, uint8_t tag)
+{
+    live->tag = tag;
+    memset((uint8_t *) live->region.block + live->region.offset, tag,
+           live->region.size);
+}
+
+// Make sure no other allocation has overwritten this region
+static void check(const struct live *live)
+{
+    const uint8_t *data = (uint8_t *) live->region.block + live->region.offset;
+    for (size_t i = 0; i < live->region.size; i++)
+        REQUIRE_CMP(data[i], ==, live->tag, "u");
+}
+
+static uint64_t xorshift(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+enum { TRACE_LEN = 20000, TRACE_LIVE = 256 };
+
+struct trace_op {
+    int slot;       // index into the set of live allocations
+    size_t size;    // 0 for frees
+    size_t align;
+};
+
+// Generates a synthetic allocation trace resembling the mix of small uniform
+// buffers and large textures typically seen by a renderer
+static void gen_trace(struct trace_op *ops, uint64_t seed)
+{
+    bool used[TRACE_LIVE] = {0};
+    for (int i = 0; i < TRACE_LEN; i++) {
+        int slot = xorshift(&seed) % TRACE_LIVE;
+        if (used[slot]) {
+            ops[i] = (struct trace_op) { .slot = slot };
+        } else {
+            static const size_t aligns[] = { 1, 16, 256, 4096, 48 };
+            int log2 = 8 + xorshift(&seed) % 15; // 256 B - 4 MB
+            size_t size = (1LLU << log2) + xorshift(&seed) % (1LLU << log2);
+            ops[i] = (struct trace_op) {
+                .slot = slot,
+                .size = size,
+                .align = aligns[xorshift(&seed) % PL_ARRAY_SIZE(aligns)],
+            };
+        }
+        used[slot] = !used[slot];
+    }
+}
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    struct blocks blocks = {0};
+    const struct pl_suballoc_params params = {
+        .alloc_block    = alloc_block,
+        .free_block     = free_block,
+        .priv           = &blocks,
+        .granularity    = 64,
+        .min_block_size = 1 << 16,
+        .max_block_size = 1 << 24,
+        .max_age        = 2,
+    };
+
+    // Basic allocations, with alignment and rounding
+    pl_suballoc sa = pl_suballoc_create(log, &params);
+    struct live a, b, c;
+    REQUIRE(pl_suballoc_alloc(sa, 100, 0, &a.region));
+    REQUIRE(pl_suballoc_alloc(sa, 1000, 48, &b.region));
+    REQUIRE(pl_suballoc_alloc(sa, 1, 4096, &c.region));
+    REQUIRE_CMP(a.region.size, ==, 128, "zu");
+    REQUIRE_CMP(b.region.offset, ==, PL_ALIGN(b.region.offset, 48), "zu");
+    REQUIRE_CMP(b.region.size, ==, PL_ALIGN(b.region.size, 48), "zu");
+    REQUIRE_CMP(b.region.size, >=, 1000, "zu");
+    REQUIRE_CMP(c.region.offset, ==, PL_ALIGN(c.region.offset, 4096), "zu");
+    REQUIRE_CMP(c.region.size, ==, 4096, "zu");
+    REQUIRE(a.region.block == b.region.block && b.region.block == c.region.block);
+    fill(&a, 1);
+    fill(&b, 2);
+    fill(&c, 3);
+    check(&a);
+    check(&b);
+    check(&c);
+
+    struct pl_suballoc_stats stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.num_blocks, ==, 1, "d");
+    REQUIRE_CMP(stats.num_allocs, ==, 3, "d");
+    REQUIRE_CMP(stats.size, ==, 1 << 16, "zu");
+    REQUIRE_CMP(stats.used, ==, a.region.size + b.region.size + c.region.size, "zu");
+
+    // Freeing merges adjacent free regions
+    pl_suballoc_free(sa, &b.region);
+    REQUIRE(!b.region.priv);
+    pl_suballoc_free(sa, &a.region);
+    pl_suballoc_free(sa, &c.region);
+    stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.used, ==, 0, "zu");
+    REQUIRE_CMP(stats.num_free, ==, 1, "d");
+    REQUIRE_CMP(stats.largest_free, ==, 1 << 16, "zu");
+
+    // Freed space is reused
+    REQUIRE(pl_suballoc_alloc(sa, 1 << 15, 0, &a.region));
+    REQUIRE(pl_suballoc_alloc(sa, 1 << 15, 0, &b.region));
+    REQUIRE_CMP(blocks.num_allocs, ==, 1, "d");
+
+    // New blocks grow with the total size, and oversized allocations get a
+    // block of their own
+    REQUIRE(pl_suballoc_alloc(sa, 1, 0, &c.region));
+    REQUIRE_CMP(blocks.num_allocs, ==, 2, "d");
+    REQUIRE_CMP(blocks.held, ==, 2 << 16, "zu");
+    struct live big;
+    REQUIRE(pl_suballoc_alloc(sa, (1 << 24) + 1, 0, &big.region));
+    REQUIRE_CMP(big.region.offset, ==, 0, "zu");
+    REQUIRE_CMP(blocks.num_allocs, ==, 3, "d");
+
+    // Empty blocks are garbage collected after `max_age`
+    pl_suballoc_free(sa, &big.region);
+    pl_suballoc_free(sa, &c.region);
+    for (int i = 0; i < params.max_age; i++)
+        REQUIRE_CMP(pl_suballoc_gc(sa), ==, 0, "d");
+    REQUIRE_CMP(pl_suballoc_gc(sa), ==, 2, "d");
+    REQUIRE_CMP(blocks.num_frees, ==, 2, "d");
+    pl_suballoc_free(sa, &a.region);
+    pl_suballoc_free(sa, &b.region);
+    pl_suballoc_destroy(&sa);
+    REQUIRE_CMP(blocks.num_frees, ==, 3, "d");
+
+    // Sparse blocks are evacuated into the free space of other blocks
+    blocks = (struct blocks) {0};
+    sa = pl_suballoc_create(log, &params);
+    struct live frag[16];
+    for (int i = 0; i < PL_ARRAY_SIZE(frag); i++)
+        REQUIRE(pl_suballoc_alloc(sa, 1 << 13, 0, &frag[i].region));
+    REQUIRE_CMP(blocks.num_allocs, ==, 2, "d");
+    void *dense_block = frag[8].region.block;
+    REQUIRE(frag[0].region.block != dense_block);
+    for (int i = 1; i < 8; i++)
+        pl_suballoc_free(sa, &frag[i].region);
+    REQUIRE_CMP(pl_suballoc_defrag(sa, 0.5), ==, 0, "d"); // no room to move to
+    for (int i = 8; i < 11; i++)
+        pl_suballoc_free(sa, &frag[i].region);
+    REQUIRE_CMP(pl_suballoc_defrag(sa, 0.5), ==, 1, "d");
+    REQUIRE(pl_suballoc_is_evacuating(sa, &frag[0].region));
+    REQUIRE(!pl_suballoc_is_evacuating(sa, &frag[11].region));
+    stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.evacuating, ==, 1 << 16, "zu");
+    REQUIRE_CMP(stats.reclaimable, ==, 0, "zu");
+
+    // Relocate the remaining allocation, which must not land in the block
+    // being evacuated
+    REQUIRE(pl_suballoc_alloc(sa, 1 << 13, 0, &frag[1].region));
+    REQUIRE(frag[1].region.block == dense_block);
+    pl_suballoc_mark_moved(sa, &frag[0].region);
+    REQUIRE(!pl_suballoc_is_evacuating(sa, &frag[0].region));
+    stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.reclaimable, ==, 1 << 16, "zu");
+    REQUIRE_CMP(pl_suballoc_gc(sa), ==, 0, "d");
+    pl_suballoc_free(sa, &frag[0].region);
+    REQUIRE_CMP(pl_suballoc_gc(sa), ==, 1, "d");
+    REQUIRE_CMP(blocks.num_frees, ==, 1, "d");
+    stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.num_blocks, ==, 1, "d");
+    REQUIRE_CMP(stats.evacuating, ==, 0, "zu");
+    for (int i = 1; i < PL_ARRAY_SIZE(frag); i++)
+        pl_suballoc_free(sa, &frag[i].region);
+    pl_suballoc_destroy(&sa);
+
+    // Replay an allocation trace, checking for overlap and measuring both
+    // throughput and fragmentation
+    static struct trace_op ops[TRACE_LEN];
+    static struct live live[TRACE_LIVE];
+    gen_trace(ops, 0x1234567890abcdefLLU);
+    blocks = (struct blocks) {0};
+    sa = pl_suballoc_create(log, &params);
+
+    pl_clock_t start = pl_clock_now();
+    size_t live_bytes = 0, peak_bytes = 0;
+    for (int i = 0; i < TRACE_LEN; i++) {
+        struct live *l = &live[ops[i].slot];
+        if (ops[i].size) {
+            REQUIRE(pl_suballoc_alloc(sa, ops[i].size, ops[i].align, &l->region));
+            const size_t offset = l->region.offset;
+            REQUIRE_CMP(offset, ==, PL_ALIGN(offset, ops[i].align), "zu");
+            REQUIRE_CMP(l->region.size, >=, ops[i].size, "zu");
+            live_bytes += l->region.size;
+            peak_bytes = PL_MAX(peak_bytes, live_bytes);
+        } else {
+            live_bytes -= l->region.size;
+            pl_suballoc_free(sa, &l->region);
+        }
+    }
+    double elapsed = pl_clock_diff(pl_clock_now(), start);
+
+    stats = pl_suballoc_get_stats(sa);
+    printf("Replayed %d operations in %.3f ms (%.1f ns/op), %d blocks, "
+           "peak live %zu bytes, held %zu bytes (%.1f%% overhead), "
+           "%d free regions\n", TRACE_LEN, 1e3 * elapsed,
+           1e9 * elapsed / TRACE_LEN, blocks.num_allocs - blocks.num_frees,
+           peak_bytes, blocks.held, 100.0 * blocks.held / peak_bytes - 100.0,
+           stats.num_free);
+    REQUIRE_CMP(blocks.held, <=, 3 * peak_bytes, "zu");
+
+    // Verify the contents separately, to avoid skewing the timing
+    for (int i = 0; i < TRACE_LIVE; i++) {
+        if (live[i].region.priv)
+            fill(&live[i], i);
+    }
+    for (int i = 0; i < TRACE_LIVE; i++) {
+        if (live[i].region.priv) {
+            check(&live[i]);
+            pl_suballoc_free(sa, &live[i].region);
+        }
+    }
+
+    stats = pl_suballoc_get_stats(sa);
+    REQUIRE_CMP(stats.used, ==, 0, "zu");
+    REQUIRE_CMP(stats.num_free, ==, stats.num_blocks, "d");
+    pl_suballoc_destroy(&sa);
+    REQUIRE_CMP(blocks.num_frees, ==, blocks.num_allocs, "d");
+    pl_log_destroy(&log);
+}
@@ -0,0 +1,121 @@
+#include "utils.h"
+
+#include <libplacebo/dummy.h>
+#include <libplacebo/utils/tex_pool.h>
+
+static pl_tex acquire(pl_tex_pool pool, pl_fmt fmt, int w, int h)
+{
+    pl_tex tex = pl_tex_pool_acquire(pool, pl_tex_params(
+        .w          = w,
+        .h          = h,
+        .format     = fmt,
+        .sampleable = true,
+        .renderable = true,
+    ));
+    REQUIRE(tex);
+    REQUIRE_CMP(tex->params.w, ==, w, "d");
+    REQUIRE_CMP(tex->params.h, ==, h, "d");
+    return tex;
+}
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    pl_gpu gpu = pl_gpu_dummy_create(log, NULL);
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    REQUIRE(fmt);
+    const size_t size = 64 * 64 * fmt->texel_size;
+
+    // Idle textures with matching params are reused
+    pl_tex_pool pool = pl_tex_pool_create(gpu, NULL);
+    pl_tex a = acquire(pool, fmt, 64, 64);
+    pl_tex b = acquire(pool, fmt, 64, 64);
+    REQUIRE(a != b);
+    pl_tex first = a;
+    pl_tex_pool_release(pool, &a);
+    REQUIRE(!a);
+    a = acquire(pool, fmt, 64, 64);
+    REQUIRE(a == first);
+
+    struct pl_tex_pool_stats stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.hits, ==, 1, PRIu64);
+    REQUIRE_CMP(stats.allocs, ==, 2, PRIu64);
+    REQUIRE_CMP(stats.num_textures, ==, 2, "d");
+    REQUIRE_CMP(stats.num_used, ==, 2, "d");
+    REQUIRE_CMP(stats.bytes_held, ==, 2 * size, "zu");
+    REQUIRE_CMP(stats.bytes_used, ==, 2 * size, "zu");
+
+    // Mismatched sizes don't reuse textures
+    pl_tex_pool_release(pool, &b);
+    pl_tex c = acquire(pool, fmt, 32, 32);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.allocs, ==, 3, PRIu64);
+    REQUIRE_CMP(stats.num_used, ==, 2, "d");
+    pl_tex_pool_release(pool, &a);
+    pl_tex_pool_release(pool, &c);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.bytes_used, ==, 0, "zu");
+
+    // Flushing frees all idle textures
+    pl_tex_pool_flush(pool);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.num_textures, ==, 0, "d");
+    REQUIRE_CMP(stats.bytes_held, ==, 0, "zu");
+    REQUIRE_CMP(stats.evictions, ==, 3, PRIu64);
+
+    // Textures going unused for a long time are eventually freed
+    a = acquire(pool, fmt, 16, 16);
+    pl_tex_pool_release(pool, &a);
+    for (int i = 0; i < 1000; i++) {
+        b = acquire(pool, fmt, 64, 64);
+        pl_tex_pool_release(pool, &b);
+    }
+    b = acquire(pool, fmt, 48, 48); // evictions only happen on misses
+    pl_tex_pool_release(pool, &b);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.num_textures, ==, 2, "d");
+    pl_tex_pool_destroy(&pool);
+
+    // Budget is respected by evicting or reallocating idle textures
+    pool = pl_tex_pool_create(gpu, pl_tex_pool_params( .max_bytes = 2 * size ));
+    a = acquire(pool, fmt, 64, 64);
+    b = acquire(pool, fmt, 64, 64);
+    pl_tex_pool_release(pool, &b);
+    c = pl_tex_pool_acquire(pool, pl_tex_params(
+        .w          = 64,
+        .h          = 64,
+        .format     = fmt,
+        .sampleable = true, // different usage, same size class
+    ));
+    REQUIRE(c);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.reallocs, ==, 1, PRIu64);
+    REQUIRE_CMP(stats.num_textures, ==, 2, "d");
+    REQUIRE_CMP(stats.bytes_held, <=, 2 * size, "zu");
+    pl_tex_pool_release(pool, &c);
+
+    pl_tex d = acquire(pool, fmt, 16, 16); // different size class
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.evictions, ==, 1, PRIu64);
+    REQUIRE_CMP(stats.bytes_held, <=, 2 * size, "zu");
+
+    // Textures in use are never evicted, even when exceeding the budget
+    pl_tex e = acquire(pool, fmt, 64, 64);
+    pl_tex f = acquire(pool, fmt, 64, 64);
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.num_used, ==, 4, "d");
+    REQUIRE_CMP(stats.bytes_held, >, 2 * size, "zu");
+    pl_tex_pool_release(pool, &a);
+    pl_tex_pool_release(pool, &d);
+    pl_tex_pool_release(pool, &e);
+    pl_tex_pool_release(pool, &f);
+
+    // Lowering the budget evicts immediately
+    pl_tex_pool_set_params(pool, pl_tex_pool_params( .max_bytes = size ));
+    stats = pl_tex_pool_get_stats(pool);
+    REQUIRE_CMP(stats.bytes_held, <=, size, "zu");
+    pl_tex_pool_destroy(&pool);
+
+    pl_gpu_dummy_destroy(&gpu);
+    pl_log_destroy(&log);
+}
@@ -0,0 +1,65 @@
+#include "utils.h"
+
+#include <libplacebo/utils/trace.h>
+
+static void add_span(pl_trace trace, const char *name,
+                     enum pl_render_span_type type, uint64_t start)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s", name); // names are only borrowed
+    pl_trace_span_cb(trace, &(struct pl_render_span) {
+        .name       = buf,
+        .type       = type,
+        .stage      = PL_RENDER_STAGE_FRAME,
+        .signature  = type == PL_RENDER_SPAN_PASS ? 0xABCD : 0,
+        .start      = start,
+        .cpu_time   = type == PL_RENDER_SPAN_PASS ? 0 : 1500,
+        .gpu_time   = type == PL_RENDER_SPAN_PASS ? 2000 : 0,
+    });
+    memset(buf, 0, sizeof(buf));
+}
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    pl_trace trace = pl_trace_create(log, pl_trace_params( .max_spans = 4 ));
+    REQUIRE_CMP(pl_trace_num_spans(trace), ==, 0, "d");
+
+    add_span(trace, "frame \"0\"", PL_RENDER_SPAN_FRAME, 1000);
+    add_span(trace, "pass_scale_main", PL_RENDER_SPAN_STEP, 2000);
+    add_span(trace, "pass_scale_main", PL_RENDER_SPAN_STEP, 3000);
+    add_span(trace, "scaling", PL_RENDER_SPAN_PASS, 4000);
+    REQUIRE_CMP(pl_trace_num_spans(trace), ==, 4, "d");
+
+    // Required size is reported for empty buffers
+    size_t size = pl_trace_save(trace, NULL, 0);
+    REQUIRE_CMP(size, >, 0, "zu");
+    char *json = malloc(size + 1);
+    REQUIRE_CMP(pl_trace_save(trace, (uint8_t *) json, size), ==, size, "zu");
+    json[size] = '\0';
+
+    pl_str str = pl_str0(json);
+    REQUIRE(pl_str_startswith0(str, "{\"displayTimeUnit\":\"ms\""));
+    REQUIRE(pl_str_endswith0(str, "]}\n"));
+    REQUIRE(strstr(json, "\"name\":\"frame \\\"0\\\"\""));
+    REQUIRE(strstr(json, "\"ts\":1.000,\"dur\":1.500"));
+    REQUIRE(strstr(json, "\"tid\":2,\"ts\":4.000,\"dur\":2.000"));
+    REQUIRE(strstr(json, "\"signature\":\"0x000000000000abcd\""));
+    free(json);
+
+    // The ring buffer drops the oldest spans
+    add_span(trace, "overflow", PL_RENDER_SPAN_STEP, 5000);
+    REQUIRE_CMP(pl_trace_num_spans(trace), ==, 4, "d");
+    size = pl_trace_save(trace, NULL, 0);
+    json = malloc(size + 1);
+    pl_trace_save(trace, (uint8_t *) json, size);
+    json[size] = '\0';
+    REQUIRE(!strstr(json, "frame \\\"0"));
+    REQUIRE(strstr(json, "pass_scale_main") < strstr(json, "overflow"));
+    free(json);
+
+    pl_trace_reset(trace);
+    REQUIRE_CMP(pl_trace_num_spans(trace), ==, 0, "d");
+    pl_trace_destroy(&trace);
+    pl_log_destroy(&log);
+}
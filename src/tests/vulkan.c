@@ -112,9 +112,459 @@ static void vulkan_swapchain_tests(pl_vulkan vk, VkSurfaceKHR surf)
     pl_swapchain_destroy(&sw);
 }
 
+static void vulkan_defrag_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_HOST_READABLE))
+        return;
+
+    // Fill up a number of slabs, then free most textures again to leave
+    // behind only sparsely used slabs
+    enum { NUM_TEX = 256, SIZE = 64, KEEP = 8 };
+    static uint8_t data[SIZE * SIZE * 4];
+    pl_tex tex[NUM_TEX];
+    for (int i = 0; i < NUM_TEX; i++) {
+        tex[i] = pl_tex_create(gpu, pl_tex_params(
+            .w              = SIZE,
+            .h              = SIZE,
+            .format         = fmt,
+            .sampleable     = true,
+            .host_writable  = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(tex[i]);
+    }
+
+    for (int i = 0; i < NUM_TEX; i++) {
+        if (i % KEEP) {
+            pl_tex_destroy(gpu, &tex[i]);
+            continue;
+        }
+
+        memset(data, i, sizeof(data));
+        REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params(
+            .tex = tex[i],
+            .ptr = data,
+        )));
+    }
+
+    // Relocation only considers idle textures
+    pl_gpu_finish(gpu);
+    size_t reclaimed = pl_vulkan_defrag(gpu);
+    printf("defragmentation reclaimed %zu bytes\n", reclaimed);
+    REQUIRE_CMP(reclaimed, >, 0, "zu");
+
+    // The contents must survive being moved
+    for (int i = 0; i < NUM_TEX; i += KEEP) {
+        memset(data, 0, sizeof(data));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = tex[i],
+            .ptr = data,
+        )));
+        for (int n = 0; n < sizeof(data); n++)
+            REQUIRE_CMP(data[n], ==, (uint8_t) i, "u");
+        pl_tex_destroy(gpu, &tex[i]);
+    }
+
+    pl_gpu_finish(gpu);
+    pl_gpu_flush(gpu);
+}
+
+static void vulkan_descriptor_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    if (!gpu->glsl.compute || !gpu->limits.max_ssbo_size)
+        return;
+
+    // Many passes sharing the same layout, each incrementing its own counter
+    enum { NUM_PASSES = 8, NUM_RUNS = 64, NUM_BUFS = 2 };
+    pl_pass pass[NUM_PASSES];
+    for (int i = 0; i < NUM_PASSES; i++) {
+        char shader[256];
+        snprintf(shader, sizeof(shader),
+            "#version 450                                       \n"
+            "layout(local_size_x = 1) in;                       \n"
+            "layout(std430, binding = 0) buffer data {          \n"
+            "    uint counts[];                                 \n"
+            "};                                                 \n"
+            "void main() {                                      \n"
+            "    counts[%d] += 1u;                              \n"
+            "}", i);
+
+        pass[i] = pl_pass_create(gpu, pl_pass_params(
+            .type = PL_PASS_COMPUTE,
+            .glsl_shader = shader,
+            .num_descriptors = 1,
+            .descriptors = &(struct pl_desc) {
+                .name = "data",
+                .type = PL_DESC_BUF_STORAGE,
+                .binding = 0,
+                .access = PL_DESC_ACCESS_READWRITE,
+            },
+        ));
+        REQUIRE(pass[i]);
+    }
+
+    static const uint32_t zero[NUM_PASSES] = {0};
+    pl_buf buf[NUM_BUFS];
+    for (int i = 0; i < NUM_BUFS; i++) {
+        buf[i] = pl_buf_create(gpu, pl_buf_params(
+            .size = sizeof(zero),
+            .storable = true,
+            .host_readable = true,
+            .initial_data = zero,
+        ));
+        REQUIRE(buf[i]);
+    }
+
+    // Keep far more descriptor sets in flight than fit into a single pool
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_desc_stats before = vk_desc_alloc_get_stats(p->da);
+    for (int n = 0; n < NUM_RUNS; n++) {
+        for (int i = 0; i < NUM_PASSES; i++) {
+            pl_pass_run(gpu, pl_pass_run_params(
+                .pass = pass[i],
+                .desc_bindings = &(struct pl_desc_binding) {
+                    .object = buf[n % NUM_BUFS],
+                },
+                .compute_groups = {1, 1, 1},
+            ));
+        }
+    }
+
+    for (int i = 0; i < NUM_BUFS; i++) {
+        uint32_t counts[NUM_PASSES];
+        REQUIRE(pl_buf_read(gpu, buf[i], 0, counts, sizeof(counts)));
+        for (int n = 0; n < NUM_PASSES; n++)
+            REQUIRE_CMP(counts[n], ==, NUM_RUNS / NUM_BUFS, "u");
+    }
+
+    // With descriptor sets, all passes share a single layout, and each set
+    // only needs to be written once, since its contents never change
+    struct vk_desc_stats stats = vk_desc_alloc_get_stats(p->da);
+    if (!p->max_push_descriptors) {
+        REQUIRE_CMP(stats.num_layouts - before.num_layouts, <=, 1, "d");
+        REQUIRE_CMP(stats.updates - before.updates, ==, NUM_BUFS, PRIu64);
+        REQUIRE_CMP(stats.hits - before.hits, ==,
+                    NUM_PASSES * NUM_RUNS - NUM_BUFS, PRIu64);
+    }
+
+    for (int i = 0; i < NUM_PASSES; i++)
+        pl_pass_destroy(gpu, &pass[i]);
+    for (int i = 0; i < NUM_BUFS; i++)
+        pl_buf_destroy(gpu, &buf[i]);
+    pl_gpu_finish(gpu);
+}
+
+static void vulkan_specialization_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    if (!gpu->glsl.compute || !gpu->limits.max_constants || !gpu->limits.max_ssbo_size)
+        return;
+
+    uint32_t value = 1;
+    pl_pass pass = pl_pass_create(gpu, pl_pass_params(
+        .type = PL_PASS_COMPUTE,
+        .glsl_shader =
+            "#version 450                                       \n"
+            "layout(local_size_x = 1) in;                       \n"
+            "layout(constant_id = 0) const uint value = 0u;     \n"
+            "layout(std430, binding = 0) buffer data {          \n"
+            "    uint result;                                   \n"
+            "};                                                 \n"
+            "void main() {                                      \n"
+            "    result = value;                                \n"
+            "}",
+        .num_descriptors = 1,
+        .descriptors = &(struct pl_desc) {
+            .name = "data",
+            .type = PL_DESC_BUF_STORAGE,
+            .binding = 0,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+        .num_constants = 1,
+        .constants = &(struct pl_constant) {
+            .type = PL_VAR_UINT,
+            .id = 0,
+        },
+        .constant_data = &value,
+    ));
+    REQUIRE(pass);
+
+    pl_buf buf = pl_buf_create(gpu, pl_buf_params(
+        .size = sizeof(uint32_t),
+        .storable = true,
+        .host_readable = true,
+    ));
+    REQUIRE(buf);
+
+    // Cycle through more sets of constants than are kept around, and make
+    // sure every run uses the matching specialization
+    static const uint32_t values[] = { 1, 2, 3, 1, 4, 5, 6, 7, 2, 1, 7 };
+    for (int i = 0; i < PL_ARRAY_SIZE(values); i++) {
+        value = values[i];
+        pl_pass_run(gpu, pl_pass_run_params(
+            .pass = pass,
+            .constant_data = &value,
+            .desc_bindings = &(struct pl_desc_binding) { .object = buf },
+            .compute_groups = {1, 1, 1},
+        ));
+
+        uint32_t result = 0;
+        REQUIRE(pl_buf_read(gpu, buf, 0, &result, sizeof(result)));
+        REQUIRE_CMP(result, ==, value, "u");
+    }
+
+    pl_pass_destroy(gpu, &pass);
+    pl_buf_destroy(gpu, &buf);
+}
+
+static void vulkan_submit_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    if (!gpu->glsl.compute || !gpu->limits.max_ssbo_size)
+        return;
+
+    pl_pass pass = pl_pass_create(gpu, pl_pass_params(
+        .type = PL_PASS_COMPUTE,
+        .glsl_shader =
+            "#version 450                                       \n"
+            "layout(local_size_x = 1) in;                       \n"
+            "layout(std430, binding = 0) buffer data {          \n"
+            "    uint count;                                    \n"
+            "};                                                 \n"
+            "void main() {                                      \n"
+            "    count += 1u;                                   \n"
+            "}",
+        .num_descriptors = 1,
+        .descriptors = &(struct pl_desc) {
+            .name = "data",
+            .type = PL_DESC_BUF_STORAGE,
+            .binding = 0,
+            .access = PL_DESC_ACCESS_READWRITE,
+        },
+    ));
+    REQUIRE(pass);
+
+    static const uint32_t zero = 0;
+    pl_buf buf = pl_buf_create(gpu, pl_buf_params(
+        .size = sizeof(zero),
+        .storable = true,
+        .host_readable = true,
+        .initial_data = &zero,
+    ));
+    REQUIRE(buf);
+
+    // Every pass run ends its own command buffer, but these should all be
+    // batched together into a few submissions per frame
+    enum { NUM_RUNS = 32 };
+    struct vk_ctx *vk_ctx = ((struct pl_vk *) PL_PRIV(gpu))->vk;
+    pl_gpu_flush(gpu);
+    struct vk_submit_stats before = vk_get_submit_stats(vk_ctx);
+    for (int i = 0; i < NUM_RUNS; i++) {
+        pl_pass_run(gpu, pl_pass_run_params(
+            .pass = pass,
+            .desc_bindings = &(struct pl_desc_binding) { .object = buf },
+            .compute_groups = {1, 1, 1},
+        ));
+    }
+    pl_gpu_flush(gpu);
+
+    struct vk_submit_stats stats = vk_get_submit_stats(vk_ctx);
+    REQUIRE_CMP(stats.frame_cmds, >=, NUM_RUNS, "d");
+    REQUIRE_CMP(stats.frame_submits, <=, stats.frame_cmds / 2, "d");
+    REQUIRE_CMP(stats.cmds - before.cmds, ==, stats.frame_cmds, PRIu64);
+    REQUIRE_CMP(stats.submits - before.submits, ==, stats.frame_submits, PRIu64);
+
+    uint32_t count = 0;
+    REQUIRE(pl_buf_read(gpu, buf, 0, &count, sizeof(count)));
+    REQUIRE_CMP(count, ==, NUM_RUNS, "u");
+
+    pl_pass_destroy(gpu, &pass);
+    pl_buf_destroy(gpu, &buf);
+}
+
+static void count_cb(void *priv)
+{
+    int *count = priv;
+    (*count)++;
+}
+
+// Exercises the per-queue read tracking of `vk_sem_barrier` directly, using
+// fake commands on fake queues, so it doesn't depend on the device actually
+// exposing multiple queues
+static void vulkan_sem_tests(void)
+{
+    enum { QUEUE_A, QUEUE_B, NUM_QUEUES };
+    struct vk_cmd *cmds[NUM_QUEUES];
+    for (int i = 0; i < NUM_QUEUES; i++) {
+        cmds[i] = pl_zalloc_ptr(NULL, cmds[i]);
+        cmds[i]->queue = (VkQueue) (uintptr_t) (i + 1);
+        cmds[i]->sync.sem = (VkSemaphore) (uintptr_t) (i + 1);
+    }
+
+    static const VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    static const VkAccessFlags2 access_read = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    static const VkAccessFlags2 access_write = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+    struct vk_sem sem = {0};
+    struct vk_cmd *a = cmds[QUEUE_A], *b = cmds[QUEUE_B];
+    a->sync.value = 1;
+    vk_sem_barrier(a, &sem, stage, access_write, false);
+    REQUIRE_CMP(sem.num_reads, ==, 0, "d");
+
+    // The first read on each queue waits for the write (if on another queue)
+    b->sync.value = 1;
+    vk_sem_barrier(b, &sem, stage, access_read, false);
+    REQUIRE_CMP(b->deps.num, ==, 1, "d");
+    a->sync.value = 2;
+    vk_sem_barrier(a, &sem, stage, access_read, false);
+    REQUIRE_CMP(a->deps.num, ==, 0, "d");
+    REQUIRE_CMP(sem.num_reads, ==, 2, "d");
+
+    // Further reads on either queue need no synchronization at all
+    for (int i = 0; i < 4; i++) {
+        struct vk_cmd *cmd = cmds[i % NUM_QUEUES];
+        cmd->deps.num = 0;
+        cmd->sync.value++;
+        struct vk_sync_scope last = vk_sem_barrier(cmd, &sem, stage, access_read, false);
+        REQUIRE_CMP(cmd->deps.num, ==, 0, "d");
+        REQUIRE_CMP(last.access, ==, 0, PRIu64);
+        REQUIRE_CMP(sem.num_reads, ==, 2, "d");
+    }
+
+    // A write waits for the readers on other queues, and needs a pipeline
+    // barrier against the ones on its own queue
+    a->deps.num = 0;
+    a->sync.value++;
+    struct vk_sync_scope last = vk_sem_barrier(a, &sem, stage, access_write, false);
+    REQUIRE_CMP(a->deps.num, ==, 1, "d");
+    REQUIRE(a->deps.elem[0].semaphore == b->sync.sem);
+    REQUIRE_CMP(a->deps.elem[0].value, ==, b->sync.value, PRIu64);
+    REQUIRE_CMP(last.access, ==, access_read, PRIu64);
+    REQUIRE_CMP(sem.num_reads, ==, 0, "d");
+
+    for (int i = 0; i < NUM_QUEUES; i++)
+        pl_free(cmds[i]);
+}
+
+static void vulkan_read_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    pl_fmt fmt = pl_find_named_fmt(gpu, "r8");
+    if (!fmt || !gpu->glsl.compute || !gpu->limits.max_ssbo_size)
+        return;
+    if (!(fmt->caps & PL_FMT_CAP_SAMPLEABLE) || !(fmt->caps & PL_FMT_CAP_HOST_READABLE))
+        return;
+
+    enum { SIZE = 64, NUM_ITERS = 32 };
+    static uint8_t src[SIZE * SIZE], dst[NUM_ITERS][SIZE * SIZE];
+    for (int i = 0; i < SIZE * SIZE; i++)
+        src[i] = i * 3;
+
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w = SIZE,
+        .h = SIZE,
+        .format = fmt,
+        .sampleable = true,
+        .host_readable = true,
+        .initial_data = src,
+    ));
+    REQUIRE(tex);
+
+    pl_pass pass = pl_pass_create(gpu, pl_pass_params(
+        .type = PL_PASS_COMPUTE,
+        .glsl_shader =
+            "#version 450                                       \n"
+            "layout(local_size_x = 1) in;                       \n"
+            "layout(binding = 0) uniform sampler2D tex;         \n"
+            "layout(std430, binding = 1) buffer data {          \n"
+            "    float sum;                                     \n"
+            "};                                                 \n"
+            "void main() {                                      \n"
+            "    sum += texelFetch(tex, ivec2(1, 0), 0).r;      \n"
+            "}",
+        .num_descriptors = 2,
+        .descriptors = (struct pl_desc[]) {{
+            .name = "tex",
+            .type = PL_DESC_SAMPLED_TEX,
+            .binding = 0,
+        }, {
+            .name = "data",
+            .type = PL_DESC_BUF_STORAGE,
+            .binding = 1,
+            .access = PL_DESC_ACCESS_READWRITE,
+        }},
+    ));
+    REQUIRE(pass);
+
+    static const float zero = 0.0f;
+    pl_buf buf = pl_buf_create(gpu, pl_buf_params(
+        .size = sizeof(zero),
+        .storable = true,
+        .host_readable = true,
+        .initial_data = &zero,
+    ));
+    REQUIRE(buf);
+
+    // Alternate between sampling the texture (on the compute or graphics
+    // queue) and downloading it (on the transfer queue, if any). Since both
+    // only read from it, neither should have to wait for the other
+    struct vk_ctx *vk_ctx = ((struct pl_vk *) PL_PRIV(gpu))->vk;
+    pl_gpu_flush(gpu);
+    struct vk_submit_stats before = vk_get_submit_stats(vk_ctx);
+    int done = 0;
+    for (int i = 0; i < NUM_ITERS; i++) {
+        pl_pass_run(gpu, pl_pass_run_params(
+            .pass = pass,
+            .desc_bindings = (struct pl_desc_binding[]) {
+                { .object = tex },
+                { .object = buf },
+            },
+            .compute_groups = {1, 1, 1},
+        ));
+
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = tex,
+            .ptr = dst[i],
+            .callback = count_cb,
+            .priv = &done,
+        )));
+    }
+    pl_gpu_flush(gpu);
+
+    // Without a separate transfer queue, both reads happen on the same queue,
+    // which never needed semaphores in the first place
+    struct vk_submit_stats stats = vk_get_submit_stats(vk_ctx);
+    const uint64_t waits = stats.sem_waits - before.sem_waits;
+    if (vk_ctx->pool_transfer != vk_ctx->pool_compute) {
+        printf("vulkan_read_tests: %"PRIu64" semaphore waits over %d iterations\n",
+               waits, NUM_ITERS);
+        REQUIRE_CMP(waits, <=, NUM_ITERS / 4, PRIu64);
+    } else {
+        printf("vulkan_read_tests: no separate transfer queue, skipping "
+               "semaphore wait count\n");
+    }
+
+    pl_gpu_finish(gpu);
+    REQUIRE_CMP(done, ==, NUM_ITERS, "d");
+    for (int i = 0; i < NUM_ITERS; i++)
+        REQUIRE_MEMEQ(dst[i], src, sizeof(src));
+
+    float sum = 0.0f;
+    REQUIRE(pl_buf_read(gpu, buf, 0, &sum, sizeof(sum)));
+    REQUIRE_FEQ(sum, NUM_ITERS * src[1] / 255.0, 1e-3);
+
+    pl_pass_destroy(gpu, &pass);
+    pl_buf_destroy(gpu, &buf);
+    pl_tex_destroy(gpu, &tex);
+}
+
 int main()
 {
     pl_log log = pl_test_logger();
+    vulkan_sem_tests();
     pl_vk_inst inst = pl_vk_inst_create(log, pl_vk_inst_params(
         .debug = true,
         .debug_extra = true,
@@ -198,6 +648,10 @@ int main()
             continue;
 
         gpu_shader_tests(vk->gpu);
+        vulkan_descriptor_tests(vk);
+        vulkan_specialization_tests(vk);
+        vulkan_submit_tests(vk);
+        vulkan_read_tests(vk);
         vulkan_swapchain_tests(vk, surf);
 
         // Print heap statistics
@@ -249,6 +703,25 @@ int main()
         gpu_interop_tests(vk->gpu);
         pl_vulkan_destroy(&vk);
 
+        // Test memory defragmentation, which requires a dedicated context
+        params.defrag_threshold = 0.5;
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        REQUIRE_CMP(pl_vulkan_defrag(vk->gpu), ==, 0, "zu");
+        vulkan_defrag_tests(vk);
+        gpu_shader_tests(vk->gpu);
+        pl_vulkan_destroy(&vk);
+
+        // Test the descriptor set code path, even on devices supporting
+        // push descriptors
+        params.defrag_threshold = 0;
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        ((struct pl_vk *) PL_PRIV(vk->gpu))->max_push_descriptors = 0;
+        vulkan_descriptor_tests(vk);
+        gpu_shader_tests(vk->gpu);
+        pl_vulkan_destroy(&vk);
+
         // Reduce log spam after first tested device
         pl_log_level_update(log, PL_LOG_INFO);
     }
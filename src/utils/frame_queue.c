@@ -20,6 +20,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "pl_clock.h"
 #include "pl_thread.h"
 
 #include <libplacebo/utils/frame_queue.h>
@@ -36,6 +37,8 @@ struct entry {
     struct pl_frame frame;
     uint64_t signature;
     bool mapped;
+    bool mapping; // currently being mapped by a worker thread
+    bool prefetched; // mapped by a worker thread, but not yet used
     bool ok;
 
     // for interlaced frames
@@ -60,6 +63,31 @@ struct entry {
 // Maximum number of not-yet-mapped frames to allow queueing in advance
 #define PREFETCH_FRAMES 2
 
+// Upper bound on the adaptive prefetch depth used with map threads
+#define MAX_PREFETCH_FRAMES 16
+
+// Upper bound on the number of map threads
+#define MAX_MAP_THREADS 16
+
+// Capacity of the lock-free ring used by `pl_queue_push`, must be a power of
+// two. Frames pushed while the ring is full go through the locked path.
+#define RING_SIZE 64
+
+// Bounded multi-producer, single-consumer ring. Each slot's sequence number
+// indicates whether it is free for the producer at that position (seq == pos)
+// or holds a frame ready for the consumer (seq == pos + 1).
+struct ring_slot {
+    atomic_size_t seq;
+    struct pl_source_frame src;
+    bool eof;
+};
+
+struct frame_ring {
+    struct ring_slot slots[RING_SIZE];
+    atomic_size_t head; // next position to write (producers)
+    size_t tail;        // next position to read (consumer, under `lock_weak`)
+};
+
 struct pool {
     float samples[MAX_SAMPLES];
     float estimate;
@@ -69,6 +97,17 @@ struct pool {
     int total;
 };
 
+// Worker threads mapping upcoming frames ahead of time. All state is guarded
+// by `lock_weak`, except for `idle`, which is also read by producers.
+struct map_workers {
+    pl_thread threads[MAX_MAP_THREADS];
+    int num;
+    bool shutdown;
+    atomic_int idle;    // number of workers blocked on `wakeup`
+    pl_cond wakeup;     // signalled on new work, finished maps and shutdown
+    struct pool latency; // measured `map` callback duration
+};
+
 struct pl_queue_t {
     pl_gpu gpu;
     pl_log log;
@@ -85,11 +124,18 @@ struct pl_queue_t {
     pl_mutex lock_weak;
     pl_cond wakeup;
 
+    // Frames pushed by `pl_queue_push` without taking any lock. These are
+    // moved into `queue` by whichever function next holds `lock_weak`.
+    struct frame_ring *ring;
+
+    // Frame mapping thread pool, see `pl_queue_set_map_threads`
+    struct map_workers *workers;
+
     // Frame queue and state
     PL_ARRAY(struct entry *) queue;
     uint64_t signature;
     int threshold_frames;
-    bool want_frame;
+    atomic_bool want_frame;
     bool eof;
 
     // Average vsync/frame fps estimation state
@@ -114,11 +160,18 @@ pl_queue pl_queue_create(pl_gpu gpu)
     *p = (struct pl_queue_t) {
         .gpu = gpu,
         .log = gpu->log,
+        .ring = pl_zalloc_ptr(p, p->ring),
+        .workers = pl_zalloc_ptr(p, p->workers),
     };
 
+    for (size_t i = 0; i < RING_SIZE; i++)
+        atomic_init(&p->ring->slots[i].seq, i);
+
     pl_mutex_init(&p->lock_strong);
     pl_mutex_init(&p->lock_weak);
     int ret = pl_cond_init(&p->wakeup);
+    if (!ret)
+        ret = pl_cond_init(&p->workers->wakeup);
     if (ret) {
         PL_ERR(p, "Failed to init conditional variable: %d", ret);
         return NULL;
@@ -126,6 +179,10 @@ pl_queue pl_queue_create(pl_gpu gpu)
     return p;
 }
 
+static void stop_workers(pl_queue p);
+
+static void drain_ring(pl_queue p);
+
 static void recycle_cache(pl_queue p, struct cache_entry *cache, bool recycle)
 {
     bool has_textures = false;
@@ -192,6 +249,8 @@ void pl_queue_destroy(pl_queue *queue)
     if (!p)
         return;
 
+    stop_workers(p);
+    drain_ring(p);
     for (int n = 0; n < p->queue.num; n++)
         entry_cull(p, p->queue.elem[n], false);
     for (int n = 0; n < p->cache.num; n++) {
@@ -199,6 +258,7 @@ void pl_queue_destroy(pl_queue *queue)
             pl_tex_destroy(p->gpu, &p->cache.elem[n].tex[i]);
     }
 
+    pl_cond_destroy(&p->workers->wakeup);
     pl_cond_destroy(&p->wakeup);
     pl_mutex_destroy(&p->lock_weak);
     pl_mutex_destroy(&p->lock_strong);
@@ -211,6 +271,7 @@ void pl_queue_reset(pl_queue p)
     pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
 
+    drain_ring(p);
     for (int i = 0; i < p->queue.num; i++)
         entry_cull(p, p->queue.elem[i], false);
 
@@ -218,10 +279,12 @@ void pl_queue_reset(pl_queue p)
         .gpu = p->gpu,
         .log = p->log,
 
-        // Reuse lock objects
+        // Reuse lock objects, the (now empty) push ring and map threads
         .lock_strong = p->lock_strong,
         .lock_weak = p->lock_weak,
         .wakeup = p->wakeup,
+        .ring = p->ring,
+        .workers = p->workers,
 
         // Explicitly preserve allocations
         .queue.elem = p->queue.elem,
@@ -285,11 +348,13 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
     }
 
     pl_cond_signal(&p->wakeup);
+    if (p->workers->num)
+        pl_cond_broadcast(&p->workers->wakeup);
 
     if (!src) {
         PL_TRACE(p, "Received EOF, draining frame queue...");
         p->eof = true;
-        p->want_frame = false;
+        atomic_store(&p->want_frame, false);
         return;
     }
 
@@ -399,35 +464,150 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
         }
     }
 
-    p->want_frame = false;
+    atomic_store(&p->want_frame, false);
 }
 
-void pl_queue_push(pl_queue p, const struct pl_source_frame *frame)
+// Moves all frames from the push ring into the queue. Must hold `lock_weak`.
+static void drain_ring(pl_queue p)
+{
+    struct frame_ring *ring = p->ring;
+    for (;;) {
+        struct ring_slot *slot = &ring->slots[ring->tail % RING_SIZE];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != ring->tail + 1)
+            break; // empty, or producer not done writing yet
+
+        struct pl_source_frame src = slot->src;
+        bool eof = slot->eof;
+        atomic_store_explicit(&slot->seq, ring->tail + RING_SIZE, memory_order_release);
+        ring->tail++;
+        queue_push(p, eof ? NULL : &src);
+    }
+}
+
+// Tries pushing a frame into the ring without blocking. Returns false if full.
+static bool ring_push(pl_queue p, const struct pl_source_frame *frame)
+{
+    struct frame_ring *ring = p->ring;
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;) {
+        struct ring_slot *slot = &ring->slots[pos % RING_SIZE];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff < 0)
+            return false; // full
+
+        if (diff > 0) {
+            // Another producer claimed this position, retry with the new head
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            continue;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        {
+            slot->src = frame ? *frame : (struct pl_source_frame) {0};
+            slot->eof = !frame;
+            atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+            return true;
+        }
+    }
+}
+
+// Called after pushing to the ring, to wake up a consumer or map thread that
+// may be blocked waiting for new frames
+static void ring_wakeup(pl_queue p)
 {
+    // Pairs with the fences in `get_frame` and `map_worker`, ensuring that
+    // either we see the waiter, or the waiter sees our frame before sleeping
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&p->want_frame, memory_order_relaxed) &&
+        !atomic_load_explicit(&p->workers->idle, memory_order_relaxed))
+        return;
+
     pl_mutex_lock(&p->lock_weak);
-    queue_push(p, frame);
+    drain_ring(p);
+    pl_cond_signal(&p->wakeup);
     pl_mutex_unlock(&p->lock_weak);
 }
 
+void pl_queue_push(pl_queue p, const struct pl_source_frame *frame)
+{
+    if (!ring_push(p, frame)) {
+        // Ring is full, fall back to pushing directly
+        pl_mutex_lock(&p->lock_weak);
+        drain_ring(p);
+        queue_push(p, frame);
+        pl_mutex_unlock(&p->lock_weak);
+    }
+
+    ring_wakeup(p);
+}
+
+void pl_queue_push_n(pl_queue p, const struct pl_source_frame *frames, int num)
+{
+    int i = 0;
+    while (i < num && ring_push(p, &frames[i]))
+        i++;
+
+    if (i < num) {
+        // Ring is full, fall back to pushing the rest directly
+        pl_mutex_lock(&p->lock_weak);
+        drain_ring(p);
+        for (; i < num; i++)
+            queue_push(p, &frames[i]);
+        pl_mutex_unlock(&p->lock_weak);
+    }
+
+    if (num)
+        ring_wakeup(p);
+}
+
+// Whether a frame has been mapped for use by `pl_queue_update`. Frames mapped
+// ahead of time by worker threads don't count, since they still occupy a slot
+// in the prefetch window.
 static inline bool entry_mapped(struct entry *entry)
 {
-    return entry->mapped || (entry->primary && entry->primary->mapped);
+    entry = PL_DEF(entry->primary, entry);
+    return entry->mapped && !entry->prefetched;
+}
+
+// Number of not-yet-mapped frames to keep queued ahead. With map threads,
+// this grows to cover the measured `map` latency in units of vsyncs, so that
+// frames are mapped by the time they're needed.
+static int prefetch_frames(pl_queue p)
+{
+    int frames = PREFETCH_FRAMES;
+    const struct map_workers *w = p->workers;
+    if (w->num && w->latency.estimate && p->vps.estimate) {
+        frames += ceilf(w->latency.estimate / p->vps.estimate);
+        frames = PL_MIN(frames, MAX_PREFETCH_FRAMES);
+    }
+
+    return frames;
+}
+
+static int wanted_frames(pl_queue p)
+{
+    int frames = prefetch_frames(p);
+    if (p->fps.estimate && p->vps.estimate && p->vps.estimate <= 1.0f / MIN_FPS)
+        frames += ceilf(p->vps.estimate / p->fps.estimate) - 1;
+    return frames;
 }
 
 static bool queue_has_room(pl_queue p)
 {
-    if (p->want_frame)
+    if (atomic_load(&p->want_frame))
         return true;
 
-    int wanted_frames = PREFETCH_FRAMES;
-    if (p->fps.estimate && p->vps.estimate && p->vps.estimate <= 1.0f / MIN_FPS)
-        wanted_frames += ceilf(p->vps.estimate / p->fps.estimate) - 1;
+    int wanted = wanted_frames(p);
 
     // Examine the queue tail
     for (int i = p->queue.num - 1; i >= 0; i--) {
         if (entry_mapped(p->queue.elem[i]))
             return true;
-        if (p->queue.num - i >= wanted_frames)
+        if (p->queue.num - i >= wanted)
             return false;
     }
 
@@ -438,6 +618,7 @@ bool pl_queue_push_block(pl_queue p, uint64_t timeout,
                          const struct pl_source_frame *frame)
 {
     pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
     if (!timeout || !frame || p->eof)
         goto skip_blocking;
 
@@ -446,6 +627,7 @@ bool pl_queue_push_block(pl_queue p, uint64_t timeout,
             pl_mutex_unlock(&p->lock_weak);
             return false;
         }
+        drain_ring(p);
     }
 
 skip_blocking:
@@ -486,55 +668,195 @@ static enum pl_queue_status get_frame(pl_queue p, const struct pl_queue_params *
         if (!params->timeout)
             return PL_QUEUE_MORE;
 
-        p->want_frame = true;
+        atomic_store(&p->want_frame, true);
         pl_cond_signal(&p->wakeup);
 
-        while (p->want_frame) {
+        // Pairs with the fence in `ring_wakeup`
+        atomic_thread_fence(memory_order_seq_cst);
+        drain_ring(p);
+        while (atomic_load(&p->want_frame)) {
             if (pl_cond_timedwait(&p->wakeup, &p->lock_weak, params->timeout) == ETIMEDOUT)
                 return PL_QUEUE_MORE;
+            drain_ring(p);
         }
 
         return p->eof ? PL_QUEUE_EOF : PL_QUEUE_OK;
     }
 
     // Don't hold the weak mutex while calling into `get_frame`, to allow
-    // `pl_queue_push` to run concurrently while we're waiting for frames
+    // `pl_queue_push_block` to run concurrently while we're waiting for frames
     pl_mutex_unlock(&p->lock_weak);
 
     struct pl_source_frame src;
-    enum pl_queue_status ret;
-    switch ((ret = params->get_frame(&src, params))) {
+    enum pl_queue_status ret = params->get_frame(&src, params);
+
+    pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
+    switch (ret) {
     case PL_QUEUE_OK:
-        pl_queue_push(p, &src);
+        queue_push(p, &src);
         break;
     case PL_QUEUE_EOF:
-        pl_queue_push(p, NULL);
+        queue_push(p, NULL);
         break;
     case PL_QUEUE_MORE:
     case PL_QUEUE_ERR:
         break;
     }
 
-    pl_mutex_lock(&p->lock_weak);
     return ret;
 }
 
+// Runs the `map` callback. Must hold `lock_weak`, which is released for the
+// duration of the callback if `unlock` is set.
+static void do_map(pl_queue p, struct entry *entry, bool unlock)
+{
+    PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f",
+             entry->signature, entry->pts);
+
+    if (unlock)
+        pl_mutex_unlock(&p->lock_weak);
+    pl_clock_t start = pl_clock_now();
+    bool ok = entry->src.map(p->gpu, entry->cache.tex, &entry->src, &entry->frame);
+    double duration = pl_clock_diff(pl_clock_now(), start);
+    if (unlock)
+        pl_mutex_lock(&p->lock_weak);
+
+    entry->ok = ok;
+    if (!ok) {
+        PL_ERR(p, "Failed mapping frame id %"PRIu64" with PTS %f",
+               entry->signature, entry->pts);
+    } else if (p->workers->num) {
+        update_estimate(&p->workers->latency, duration);
+    }
+}
+
 static inline bool map_frame(pl_queue p, struct entry *entry)
 {
+    // Wait for any in-flight map on a worker thread to finish
+    while (entry->mapping)
+        pl_cond_wait(&p->workers->wakeup, &p->lock_weak);
+
+    entry->prefetched = false;
     if (!entry->mapped) {
-        PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f",
-                 entry->signature, entry->pts);
         entry->mapped = true;
-        entry->ok = entry->src.map(p->gpu, entry->cache.tex,
-                                   &entry->src, &entry->frame);
-        if (!entry->ok)
-            PL_ERR(p, "Failed mapping frame id %"PRIu64" with PTS %f",
-                   entry->signature, entry->pts);
+        do_map(p, entry, false);
     }
 
     return entry->ok;
 }
 
+// Finds the next frame within the prefetch window that is not yet mapped. The
+// window covers the first `wanted_frames` frames not yet used by
+// `pl_queue_update`, the same frames that `queue_has_room` allows queueing in
+// advance. Must hold `lock_weak`.
+static struct entry *next_unmapped(pl_queue p)
+{
+    int wanted = wanted_frames(p), pending = 0;
+    for (int i = 0; i < p->queue.num; i++) {
+        if (entry_mapped(p->queue.elem[i]))
+            continue;
+        if (++pending > wanted)
+            break;
+        struct entry *entry = PL_DEF(p->queue.elem[i]->primary, p->queue.elem[i]);
+        if (!entry->mapped)
+            return entry;
+    }
+
+    return NULL;
+}
+
+static PL_THREAD_VOID map_worker(void *arg)
+{
+    pl_queue p = arg;
+    struct map_workers *w = p->workers;
+    pl_mutex_lock(&p->lock_weak);
+
+    while (!w->shutdown) {
+        drain_ring(p);
+        struct entry *entry = next_unmapped(p);
+        if (!entry) {
+            atomic_fetch_add(&w->idle, 1);
+            // Pairs with the fence in `ring_wakeup`
+            atomic_thread_fence(memory_order_seq_cst);
+            drain_ring(p);
+            entry = next_unmapped(p);
+            if (!entry && !w->shutdown)
+                pl_cond_wait(&w->wakeup, &p->lock_weak);
+            atomic_fetch_sub(&w->idle, 1);
+            if (!entry)
+                continue;
+        }
+
+        // Hold a reference so the entry survives being culled in the meantime
+        entry_ref(entry);
+        entry->mapped = entry->mapping = entry->prefetched = true;
+        do_map(p, entry, true);
+        entry->mapping = false;
+        entry_deref(p, &entry, true);
+        pl_cond_broadcast(&w->wakeup);
+        pl_cond_broadcast(&p->wakeup);
+    }
+
+    pl_mutex_unlock(&p->lock_weak);
+    PL_THREAD_RETURN();
+}
+
+// Must not hold any locks
+static void stop_workers(pl_queue p)
+{
+    struct map_workers *w = p->workers;
+    if (!w->num)
+        return;
+
+    pl_mutex_lock(&p->lock_weak);
+    w->shutdown = true;
+    pl_cond_broadcast(&w->wakeup);
+    pl_mutex_unlock(&p->lock_weak);
+
+    for (int i = 0; i < w->num; i++)
+        pl_thread_join(w->threads[i]);
+
+    pl_mutex_lock(&p->lock_weak);
+    w->num = 0;
+    w->shutdown = false;
+    w->latency = (struct pool) {0};
+    pl_mutex_unlock(&p->lock_weak);
+}
+
+void pl_queue_set_map_threads(pl_queue p, int num_threads)
+{
+    pl_mutex_lock(&p->lock_strong);
+    stop_workers(p);
+
+    num_threads = PL_CLAMP(num_threads, 0, MAX_MAP_THREADS);
+    if (num_threads && !p->gpu->limits.thread_safe) {
+        PL_WARN(p, "Asynchronous frame mapping requires a thread-safe `pl_gpu`, "
+                "falling back to synchronous mapping!");
+        num_threads = 0;
+    }
+
+    struct map_workers *w = p->workers;
+    pl_mutex_lock(&p->lock_weak);
+    for (int i = 0; i < num_threads; i++) {
+        if (pl_thread_create(&w->threads[w->num], map_worker, p)) {
+            PL_WARN(p, "Failed creating map thread, using %d threads", w->num);
+            break;
+        }
+        w->num++;
+    }
+    pl_mutex_unlock(&p->lock_weak);
+    pl_mutex_unlock(&p->lock_strong);
+}
+
+int pl_queue_prefetch_frames(pl_queue p)
+{
+    pl_mutex_lock(&p->lock_weak);
+    int frames = prefetch_frames(p);
+    pl_mutex_unlock(&p->lock_weak);
+    return frames;
+}
+
 static bool map_entry(pl_queue p, struct entry *entry)
 {
     bool ok = map_frame(p, entry->primary ? entry->primary : entry);
@@ -933,6 +1255,7 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
     struct pl_queue_params fixed;
     pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
     default_estimate(&p->vps, params->vsync_duration);
 
     float delta = params->pts - p->prev_pts;
@@ -1009,6 +1332,8 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
     }
 
     pl_cond_signal(&p->wakeup);
+    if (p->workers->num)
+        pl_cond_broadcast(&p->workers->wakeup); // prefetch window moved
     pl_mutex_unlock(&p->lock_weak);
     pl_mutex_unlock(&p->lock_strong);
     return ret;
@@ -1017,6 +1342,7 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
 float pl_queue_estimate_fps(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
     float estimate = p->fps.estimate;
     pl_mutex_unlock(&p->lock_weak);
     return estimate ? 1.0f / estimate : 0.0f;
@@ -1033,6 +1359,7 @@ float pl_queue_estimate_vps(pl_queue p)
 int pl_queue_num_frames(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
     int count = p->queue.num;
     pl_mutex_unlock(&p->lock_weak);
     return count;
@@ -1049,6 +1376,7 @@ double pl_queue_pts_offset(pl_queue p)
 bool pl_queue_peek(pl_queue p, int idx, struct pl_source_frame *out)
 {
     pl_mutex_lock(&p->lock_weak);
+    drain_ring(p);
     bool ok = idx >= 0 && idx < p->queue.num;
     if (ok)
         *out = p->queue.elem[idx]->src;
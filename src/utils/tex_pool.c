@@ -0,0 +1,293 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "log.h"
+#include "pl_thread.h"
+
+#include <libplacebo/utils/tex_pool.h>
+
+// Textures are bucketed by the base 2 logarithm of their texel count
+#define NUM_CLASSES 32
+
+// Idle textures not reused within this many acquisitions are freed
+#define MAX_IDLE_AGE 256
+
+struct pool_tex {
+    pl_tex tex;
+    size_t size;
+    uint64_t last_used;
+    bool in_use;
+};
+
+struct pl_tex_pool_t {
+    pl_gpu gpu;
+    pl_log log;
+    pl_mutex lock;
+    struct pl_tex_pool_params params;
+    PL_ARRAY(struct pool_tex) classes[NUM_CLASSES];
+    struct pl_tex_pool_stats stats;
+    uint64_t tick;
+};
+
+static int size_class(const struct pl_tex_params *params)
+{
+    uint64_t texels = (uint64_t) PL_MAX(params->w, 1) * PL_MAX(params->h, 1) *
+                      PL_MAX(params->d, 1);
+    int cls = 0;
+    while (texels >>= 1)
+        cls++;
+    return PL_MIN(cls, NUM_CLASSES - 1);
+}
+
+static size_t tex_size(const struct pl_tex_params *params)
+{
+    return (size_t) PL_MAX(params->w, 1) * PL_MAX(params->h, 1) *
+           PL_MAX(params->d, 1) * params->format->texel_size;
+}
+
+static bool params_equal(const struct pl_tex_params *a, const struct pl_tex_params *b)
+{
+    return a->w == b->w && a->h == b->h && a->d == b->d &&
+           a->format == b->format &&
+           a->sampleable == b->sampleable &&
+           a->renderable == b->renderable &&
+           a->storable == b->storable &&
+           a->blit_src == b->blit_src &&
+           a->blit_dst == b->blit_dst &&
+           a->host_writable == b->host_writable &&
+           a->host_readable == b->host_readable;
+}
+
+pl_tex_pool pl_tex_pool_create(pl_gpu gpu, const struct pl_tex_pool_params *params)
+{
+    pl_tex_pool pool = pl_zalloc_ptr(NULL, pool);
+    pool->gpu = gpu;
+    pool->log = gpu->log;
+    pool->params = params ? *params : (struct pl_tex_pool_params) {0};
+    pl_mutex_init(&pool->lock);
+    return pool;
+}
+
+static void evict(pl_tex_pool pool, int cls, int idx)
+{
+    struct pool_tex *entry = &pool->classes[cls].elem[idx];
+    pl_assert(!entry->in_use);
+    PL_TRACE(pool, "Evicting idle %dx%d texture (%zu bytes)",
+             entry->tex->params.w, entry->tex->params.h, entry->size);
+    pool->stats.bytes_held -= entry->size;
+    pool->stats.num_textures--;
+    pool->stats.evictions++;
+    pl_tex_destroy(pool->gpu, &entry->tex);
+    PL_ARRAY_REMOVE_AT(pool->classes[cls], idx);
+}
+
+// Evicts idle textures in LRU order until `extra` additional bytes fit into
+// the budget, and unconditionally evicts textures older than `min_tick`
+static void evict_lru(pl_tex_pool pool, size_t extra, uint64_t min_tick)
+{
+    for (;;) {
+        int best_cls = -1, best_idx = -1;
+        uint64_t best_tick = UINT64_MAX;
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            for (int i = 0; i < pool->classes[c].num; i++) {
+                const struct pool_tex *entry = &pool->classes[c].elem[i];
+                if (!entry->in_use && entry->last_used < best_tick) {
+                    best_cls = c;
+                    best_idx = i;
+                    best_tick = entry->last_used;
+                }
+            }
+        }
+
+        if (best_cls < 0)
+            return;
+
+        const size_t max_bytes = pool->params.max_bytes;
+        bool over_budget = max_bytes && pool->stats.bytes_held + extra > max_bytes;
+        if (!over_budget && best_tick >= min_tick)
+            return;
+
+        evict(pool, best_cls, best_idx);
+    }
+}
+
+void pl_tex_pool_destroy(pl_tex_pool *ppool)
+{
+    pl_tex_pool pool = *ppool;
+    if (!pool)
+        return;
+
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        for (int i = 0; i < pool->classes[c].num; i++) {
+            struct pool_tex *entry = &pool->classes[c].elem[i];
+            if (entry->in_use)
+                PL_WARN(pool, "Destroying texture pool with textures in use!");
+            pl_tex_destroy(pool->gpu, &entry->tex);
+        }
+    }
+
+    pl_mutex_destroy(&pool->lock);
+    pl_free_ptr(ppool);
+}
+
+void pl_tex_pool_set_params(pl_tex_pool pool, const struct pl_tex_pool_params *params)
+{
+    pl_mutex_lock(&pool->lock);
+    pool->params = params ? *params : (struct pl_tex_pool_params) {0};
+    evict_lru(pool, 0, 0);
+    pl_mutex_unlock(&pool->lock);
+}
+
+pl_tex pl_tex_pool_acquire(pl_tex_pool pool, const struct pl_tex_params *params)
+{
+    pl_require(pool, params->format);
+    pl_require(pool, !params->export_handle && !params->import_handle);
+
+    pl_mutex_lock(&pool->lock);
+    const uint64_t tick = ++pool->tick;
+    const int cls = size_class(params);
+    const size_t size = tex_size(params);
+    struct pool_tex *entry = NULL;
+
+    // Look for an idle texture with identical parameters
+    for (int i = 0; i < pool->classes[cls].num; i++) {
+        struct pool_tex *e = &pool->classes[cls].elem[i];
+        if (!e->in_use && params_equal(&e->tex->params, params)) {
+            entry = e;
+            break;
+        }
+    }
+
+    if (entry) {
+        pool->stats.hits++;
+        goto done;
+    }
+
+    // Free textures that have gone unused for too long
+    uint64_t min_tick = tick > MAX_IDLE_AGE ? tick - MAX_IDLE_AGE : 0;
+    evict_lru(pool, 0, min_tick);
+
+    // If a new texture would exceed the budget, prefer recreating the least
+    // recently used idle texture of the same size class, and otherwise evict
+    // idle textures of any size class to make room
+    const size_t max_bytes = pool->params.max_bytes;
+    if (max_bytes && pool->stats.bytes_held + size > max_bytes) {
+        for (int i = 0; i < pool->classes[cls].num; i++) {
+            struct pool_tex *e = &pool->classes[cls].elem[i];
+            if (!e->in_use && (!entry || e->last_used < entry->last_used))
+                entry = e;
+        }
+
+        if (!entry)
+            evict_lru(pool, size, 0);
+    }
+
+    if (entry) {
+        struct pl_tex_params new_params = *params;
+        new_params.initial_data = NULL;
+        if (!pl_tex_recreate(pool->gpu, &entry->tex, &new_params)) {
+            pool->stats.bytes_held -= entry->size;
+            pool->stats.num_textures--;
+            PL_ARRAY_REMOVE_AT(pool->classes[cls], entry - pool->classes[cls].elem);
+            goto error_unlock;
+        }
+        pool->stats.bytes_held += size - entry->size;
+        pool->stats.reallocs++;
+        entry->size = size;
+        goto done;
+    }
+
+    struct pl_tex_params new_params = *params;
+    new_params.initial_data = NULL;
+    pl_tex tex = pl_tex_create(pool->gpu, &new_params);
+    if (!tex)
+        goto error_unlock;
+
+    PL_ARRAY_APPEND(pool, pool->classes[cls], (struct pool_tex) {
+        .tex = tex,
+        .size = size,
+    });
+    entry = &pool->classes[cls].elem[pool->classes[cls].num - 1];
+    pool->stats.bytes_held += size;
+    pool->stats.num_textures++;
+    pool->stats.allocs++;
+    // fall through
+
+done:
+    entry->in_use = true;
+    entry->last_used = tick;
+    pool->stats.bytes_used += entry->size;
+    pool->stats.num_used++;
+    pl_tex tex_out = entry->tex;
+    pl_mutex_unlock(&pool->lock);
+    return tex_out;
+
+error_unlock:
+    pl_mutex_unlock(&pool->lock);
+    // fall through
+error:
+    return NULL;
+}
+
+void pl_tex_pool_release(pl_tex_pool pool, pl_tex *ptex)
+{
+    pl_tex tex = *ptex;
+    if (!tex)
+        return;
+
+    pl_mutex_lock(&pool->lock);
+    const int cls = size_class(&tex->params);
+    for (int i = 0; i < pool->classes[cls].num; i++) {
+        struct pool_tex *entry = &pool->classes[cls].elem[i];
+        if (entry->tex != tex)
+            continue;
+
+        pl_assert(entry->in_use);
+        entry->in_use = false;
+        entry->last_used = ++pool->tick;
+        pool->stats.bytes_used -= entry->size;
+        pool->stats.num_used--;
+        pl_mutex_unlock(&pool->lock);
+        *ptex = NULL;
+        return;
+    }
+
+    pl_mutex_unlock(&pool->lock);
+    PL_ERR(pool, "Released texture %p not belonging to this pool!", (void *) tex);
+    *ptex = NULL;
+}
+
+void pl_tex_pool_flush(pl_tex_pool pool)
+{
+    pl_mutex_lock(&pool->lock);
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        for (int i = pool->classes[c].num - 1; i >= 0; i--) {
+            if (!pool->classes[c].elem[i].in_use)
+                evict(pool, c, i);
+        }
+    }
+    pl_mutex_unlock(&pool->lock);
+}
+
+struct pl_tex_pool_stats pl_tex_pool_get_stats(pl_tex_pool pool)
+{
+    pl_mutex_lock(&pool->lock);
+    struct pl_tex_pool_stats stats = pool->stats;
+    pl_mutex_unlock(&pool->lock);
+    return stats;
+}
@@ -0,0 +1,249 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "log.h"
+#include "pl_thread.h"
+
+#include <libplacebo/utils/trace.h>
+
+#define DEFAULT_MAX_SPANS 65536
+
+// Spans with `name` referring to an interned copy, since the original name
+// is only valid for the duration of the callback
+struct trace_span {
+    const char *name;
+    enum pl_render_span_type type;
+    enum pl_render_stage stage;
+    uint64_t signature;
+    uint64_t start;
+    uint64_t cpu_time;
+    uint64_t gpu_time;
+};
+
+struct pl_trace_t {
+    pl_log log;
+    pl_mutex lock;
+    struct trace_span *spans; // ring buffer
+    int max_spans;
+    int num_spans;
+    int idx; // next position to write to
+
+    // Interned span names. Names are mostly static strings or shader
+    // descriptions, so there are only ever a handful of distinct values.
+    PL_ARRAY(const char *) names;
+};
+
+pl_trace pl_trace_create(pl_log log, const struct pl_trace_params *params)
+{
+    pl_trace trace = pl_zalloc_ptr(NULL, trace);
+    trace->log = log;
+    trace->max_spans = params && params->max_spans ? params->max_spans
+                                                   : DEFAULT_MAX_SPANS;
+    trace->spans = pl_calloc_ptr(trace, trace->max_spans, trace->spans);
+    pl_mutex_init(&trace->lock);
+    return trace;
+}
+
+void pl_trace_destroy(pl_trace *ptrace)
+{
+    pl_trace trace = *ptrace;
+    if (!trace)
+        return;
+
+    pl_mutex_destroy(&trace->lock);
+    pl_free_ptr(ptrace);
+}
+
+static const char *intern_name(pl_trace trace, const char *name)
+{
+    name = PL_DEF(name, "(unknown)");
+    for (int i = trace->names.num - 1; i >= 0; i--) {
+        const char *cur = trace->names.elem[i];
+        if (cur == name || strcmp(cur, name) == 0)
+            return cur;
+    }
+
+    const char *copy = pl_strdup0(trace, pl_str0(name));
+    PL_ARRAY_APPEND(trace, trace->names, copy);
+    return copy;
+}
+
+void pl_trace_span_cb(void *priv, const struct pl_render_span *span)
+{
+    pl_trace trace = priv;
+    pl_mutex_lock(&trace->lock);
+    trace->spans[trace->idx] = (struct trace_span) {
+        .name       = intern_name(trace, span->name),
+        .type       = span->type,
+        .stage      = span->stage,
+        .signature  = span->signature,
+        .start      = span->start,
+        .cpu_time   = span->cpu_time,
+        .gpu_time   = span->gpu_time,
+    };
+    trace->idx = (trace->idx + 1) % trace->max_spans;
+    trace->num_spans = PL_MIN(trace->num_spans + 1, trace->max_spans);
+    pl_mutex_unlock(&trace->lock);
+}
+
+void pl_trace_reset(pl_trace trace)
+{
+    pl_mutex_lock(&trace->lock);
+    trace->num_spans = trace->idx = 0;
+    pl_mutex_unlock(&trace->lock);
+}
+
+int pl_trace_num_spans(pl_trace trace)
+{
+    pl_mutex_lock(&trace->lock);
+    int num = trace->num_spans;
+    pl_mutex_unlock(&trace->lock);
+    return num;
+}
+
+static const char *span_types[PL_RENDER_SPAN_TYPE_COUNT] = {
+    [PL_RENDER_SPAN_FRAME]      = "frame",
+    [PL_RENDER_SPAN_STEP]       = "step",
+    [PL_RENDER_SPAN_LUT]        = "lut",
+    [PL_RENDER_SPAN_COMPILE]    = "compile",
+    [PL_RENDER_SPAN_PASS]       = "pass",
+};
+
+static const char *stages[PL_RENDER_STAGE_COUNT] = {
+    [PL_RENDER_STAGE_FRAME]     = "frame",
+    [PL_RENDER_STAGE_BLEND]     = "blend",
+};
+
+enum {
+    TID_CPU = 1,
+    TID_GPU = 2,
+};
+
+static void append_json_str(void *alloc, pl_str *out, const char *str)
+{
+    pl_str_append(alloc, out, pl_str0("\""));
+    for (const char *c = str; *c; c++) {
+        switch (*c) {
+        case '"':  pl_str_append(alloc, out, pl_str0("\\\"")); break;
+        case '\\': pl_str_append(alloc, out, pl_str0("\\\\")); break;
+        case '\n': pl_str_append(alloc, out, pl_str0("\\n")); break;
+        case '\t': pl_str_append(alloc, out, pl_str0("\\t")); break;
+        default:
+            if ((unsigned char) *c < 0x20) {
+                pl_str_append_asprintf(alloc, out, "\\u%04x", (unsigned) *c);
+            } else {
+                pl_str_append_raw(alloc, out, c, 1);
+            }
+            break;
+        }
+    }
+    pl_str_append(alloc, out, pl_str0("\""));
+}
+
+// Chrome trace timestamps are in microseconds, printed as fixed point to
+// avoid depending on the locale
+static void append_us(void *alloc, pl_str *out, uint64_t ns)
+{
+    pl_str_append_asprintf(alloc, out, "%llu.%03u",
+                           (unsigned long long) (ns / 1000),
+                           (unsigned) (ns % 1000));
+}
+
+static void append_event(void *alloc, pl_str *out, const struct trace_span *span,
+                         int tid, uint64_t dur)
+{
+    pl_str_append(alloc, out, pl_str0(",\n{\"name\":"));
+    append_json_str(alloc, out, span->name);
+    pl_str_append_asprintf(alloc, out, ",\"cat\":\"%s\",\"ph\":\"X\","
+                           "\"pid\":1,\"tid\":%d,\"ts\":",
+                           span_types[span->type], tid);
+    append_us(alloc, out, span->start);
+    pl_str_append(alloc, out, pl_str0(",\"dur\":"));
+    append_us(alloc, out, dur);
+    pl_str_append_asprintf(alloc, out, ",\"args\":{\"stage\":\"%s\"",
+                           stages[span->stage]);
+    if (span->signature) {
+        pl_str_append_asprintf(alloc, out, ",\"signature\":\"0x%016"PRIx64"\"",
+                               span->signature);
+    }
+    pl_str_append(alloc, out, pl_str0("}}"));
+}
+
+int pl_trace_save_ex(pl_trace trace,
+                     void (*write)(void *priv, size_t size, const void *ptr),
+                     void *priv)
+{
+    static const char header[] =
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+        "\"args\":{\"name\":\"CPU\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"name\":\"GPU\"}}";
+    static const char footer[] = "\n]}\n";
+
+    void *tmp = pl_tmp(NULL);
+    pl_str buf = {0};
+
+    pl_mutex_lock(&trace->lock);
+    pl_clock_t start = pl_clock_now();
+    const int num_spans = trace->num_spans;
+    write(priv, sizeof(header) - 1, header);
+
+    int idx = (trace->idx - num_spans + trace->max_spans) % trace->max_spans;
+    for (int i = 0; i < num_spans; i++) {
+        const struct trace_span *span = &trace->spans[idx];
+        idx = (idx + 1) % trace->max_spans;
+
+        buf.len = 0;
+        if (span->type == PL_RENDER_SPAN_PASS) {
+            append_event(tmp, &buf, span, TID_GPU, span->gpu_time);
+        } else {
+            append_event(tmp, &buf, span, TID_CPU, span->cpu_time);
+        }
+        write(priv, buf.len, buf.buf);
+    }
+
+    write(priv, sizeof(footer) - 1, footer);
+    pl_mutex_unlock(&trace->lock);
+    pl_log_cpu_time(trace->log, start, pl_clock_now(), "saving trace");
+
+    pl_free(tmp);
+    return num_spans;
+}
+
+struct ptr_ctx {
+    uint8_t *data; // base pointer
+    size_t size;   // total size
+    size_t pos;    // write index
+};
+
+static void write_ptr(void *priv, size_t size, const void *ptr)
+{
+    struct ptr_ctx *ctx = priv;
+    size_t end = PL_MIN(ctx->pos + size, ctx->size);
+    if (end > ctx->pos)
+        memcpy(ctx->data + ctx->pos, ptr, end - ctx->pos);
+    ctx->pos += size;
+}
+
+size_t pl_trace_save(pl_trace trace, uint8_t *data, size_t size)
+{
+    struct ptr_ctx ctx = { data, size };
+    pl_trace_save_ex(trace, write_ptr, &ctx);
+    return ctx.pos;
+}
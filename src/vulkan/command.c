@@ -18,6 +18,10 @@
 #include "command.h"
 #include "utils.h"
 
+// Maximum number of commands queued up by `vk_cmd_submit` before they are
+// implicitly flushed, to avoid starving the GPU between flush points
+#define MAX_QUEUED_CMDS 8
+
 // returns VK_SUCCESS (completed), VK_TIMEOUT (not yet completed) or an error
 static VkResult vk_cmd_poll(struct vk_cmd *cmd, uint64_t timeout)
 {
@@ -111,7 +115,10 @@ void vk_dev_callback(struct vk_ctx *vk, vk_cb callback,
                      const void *priv, const void *arg)
 {
     pl_mutex_lock(&vk->lock);
-    if (vk->cmds_pending.num > 0) {
+    if (vk->cmds_queued.num > 0) {
+        struct vk_cmd *last_cmd = vk->cmds_queued.elem[vk->cmds_queued.num - 1];
+        vk_cmd_callback(last_cmd, callback, priv, arg);
+    } else if (vk->cmds_pending.num > 0) {
         struct vk_cmd *last_cmd = vk->cmds_pending.elem[vk->cmds_pending.num - 1];
         vk_cmd_callback(last_cmd, callback, priv, arg);
     } else {
@@ -133,6 +140,16 @@ void vk_cmd_callback(struct vk_cmd *cmd, vk_cb callback,
 
 void vk_cmd_dep(struct vk_cmd *cmd, VkPipelineStageFlags2 stage, pl_vulkan_sem dep)
 {
+    for (int i = 0; i < cmd->deps.num; i++) {
+        VkSemaphoreSubmitInfo *info = &cmd->deps.elem[i];
+        if (info->semaphore == dep.sem) {
+            // Waiting for the highest value of a semaphore implies all others
+            info->value = PL_MAX(info->value, dep.value);
+            info->stageMask |= stage;
+            return;
+        }
+    }
+
     PL_ARRAY_APPEND(cmd, cmd->deps, (VkSemaphoreSubmitInfo) {
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
         .semaphore  = dep.sem,
@@ -250,15 +267,33 @@ struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
 {
     bool is_write = (access & vk_access_write) || is_trans;
 
-    // Writes need to be synchronized against the last *read* (which is
-    // transitively synchronized against the last write), reads only
+    // Find the read scope of this queue, if any
+    struct vk_sync_scope *read = NULL;
+    for (int i = 0; i < sem->num_reads; i++) {
+        if (sem->read[i].queue == cmd->queue)
+            read = &sem->read[i];
+    }
+
+    // Writes need to be synchronized against all reads since the last write
+    // (which are transitively synchronized against that write), reads only
     // need to be synchronized against the last write.
     struct vk_sync_scope last = sem->write;
-    if (is_write && sem->read.access)
-        last = sem->read;
-
-    if (last.queue != cmd->queue) {
-        if (!is_write && sem->read.queue == cmd->queue) {
+    if (is_write && sem->num_reads) {
+        last = (struct vk_sync_scope) { .queue = cmd->queue };
+        for (int i = 0; i < sem->num_reads; i++) {
+            const struct vk_sync_scope *r = &sem->read[i];
+            if (r->queue == cmd->queue) {
+                last.stage |= r->stage;
+                last.access |= r->access;
+            } else if (r->sync.sem) {
+                // Image barrier still needs to depend on this stage for
+                // implicit ordering guarantees to apply properly
+                vk_cmd_dep(cmd, stage, r->sync);
+                last.stage |= stage;
+            }
+        }
+    } else if (last.queue != cmd->queue) {
+        if (read) {
             // No semaphore needed in this case because the implicit submission
             // order execution dependencies already transitively imply a wait
             // for the previous write
@@ -273,9 +308,8 @@ struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
         last.access = 0;
     }
 
-    if (!is_write && sem->read.queue == cmd->queue &&
-        (sem->read.stage & stage) == stage &&
-        (sem->read.access & access) == access)
+    if (!is_write && read && (read->stage & stage) == stage &&
+        (read->access & access) == access)
     {
         // A past pipeline barrier already covers this access transitively, so
         // we don't need to emit another pipeline barrier at all
@@ -290,18 +324,24 @@ struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
             .access = access,
         };
 
-        sem->read = (struct vk_sync_scope) {
-            .sync = cmd->sync,
-            .queue = cmd->queue,
-            // no stage or access scope, because no reads happened yet
-        };
-    } else if (sem->read.queue == cmd->queue) {
+        sem->num_reads = 0; // no reads happened yet
+    } else if (read) {
         // Coalesce multiple same-queue reads into a single access scope
-        sem->read.sync = cmd->sync;
-        sem->read.stage |= stage;
-        sem->read.access |= access;
+        read->sync = cmd->sync;
+        read->stage |= stage;
+        read->access |= access;
     } else {
-        sem->read = (struct vk_sync_scope) {
+        if (sem->num_reads == VK_SEM_MAX_READS) {
+            // Out of read scopes, so make this access wait for the oldest
+            // one instead, which it then transitively covers
+            if (sem->read[0].sync.sem)
+                vk_cmd_dep(cmd, stage, sem->read[0].sync);
+            memmove(&sem->read[0], &sem->read[1],
+                    (VK_SEM_MAX_READS - 1) * sizeof(sem->read[0]));
+            sem->num_reads--;
+        }
+
+        sem->read[sem->num_reads++] = (struct vk_sync_scope) {
             .sync = cmd->sync,
             .queue = cmd->queue,
             .stage = stage,
@@ -314,6 +354,26 @@ struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
     return last;
 }
 
+bool vk_sem_shared(const struct vk_sem *sem, VkQueue queue)
+{
+    if (sem->write.queue && sem->write.queue != queue)
+        return true;
+
+    for (int i = 0; i < sem->num_reads; i++) {
+        if (sem->read[i].queue != queue)
+            return true;
+    }
+
+    return false;
+}
+
+void vk_sem_forget_queues(struct vk_sem *sem)
+{
+    sem->write.queue = NULL;
+    for (int i = 0; i < sem->num_reads; i++)
+        sem->read[i].queue = NULL;
+}
+
 struct vk_cmdpool *vk_cmdpool_create(struct vk_ctx *vk, int qf, int qnum,
                                      VkQueueFamilyProperties props)
 {
@@ -323,6 +383,7 @@ struct vk_cmdpool *vk_cmdpool_create(struct vk_ctx *vk, int qf, int qnum,
         .props      = props,
         .qf         = qf,
         .queues     = pl_calloc(pool, qnum, sizeof(VkQueue)),
+        .queue_load = pl_calloc(pool, qnum, sizeof(int)),
         .num_queues = qnum,
     };
 
@@ -402,58 +463,64 @@ error:
     return NULL;
 }
 
-static VkResult vk_queue_submit2(struct vk_ctx *vk, VkQueue queue,
-                                 const VkSubmitInfo2 *info2, VkFence fence)
+static VkResult vk_queue_submit2(struct vk_ctx *vk, VkQueue queue, int count,
+                                 const VkSubmitInfo2 *infos2, VkFence fence)
 {
     if (vk->QueueSubmit2KHR)
-        return vk->QueueSubmit2KHR(queue, 1, info2, fence);
-
-    const uint32_t num_deps = info2->waitSemaphoreInfoCount;
-    const uint32_t num_sigs = info2->signalSemaphoreInfoCount;
-    const uint32_t num_cmds = info2->commandBufferInfoCount;
+        return vk->QueueSubmit2KHR(queue, count, infos2, fence);
 
     void *tmp = pl_tmp(NULL);
-    VkSemaphore *deps           = pl_calloc_ptr(tmp, num_deps, deps);
-    VkPipelineStageFlags *masks = pl_calloc_ptr(tmp, num_deps, masks);
-    uint64_t *depvals           = pl_calloc_ptr(tmp, num_deps, depvals);
-    VkSemaphore *sigs           = pl_calloc_ptr(tmp, num_sigs, sigs);
-    uint64_t *sigvals           = pl_calloc_ptr(tmp, num_sigs, sigvals);
-    VkCommandBuffer *cmds       = pl_calloc_ptr(tmp, num_cmds, cmds);
-
-    for (int i = 0; i < num_deps; i++) {
-        deps[i] = info2->pWaitSemaphoreInfos[i].semaphore;
-        masks[i] = info2->pWaitSemaphoreInfos[i].stageMask;
-        depvals[i] = info2->pWaitSemaphoreInfos[i].value;
-    }
-    for (int i = 0; i < num_sigs; i++) {
-        sigs[i] = info2->pSignalSemaphoreInfos[i].semaphore;
-        sigvals[i] = info2->pSignalSemaphoreInfos[i].value;
-    }
-    for (int i = 0; i < num_cmds; i++)
-        cmds[i] = info2->pCommandBufferInfos[i].commandBuffer;
-
-    const VkTimelineSemaphoreSubmitInfo tinfo = {
-        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
-        .pNext = info2->pNext,
-        .waitSemaphoreValueCount = num_deps,
-        .pWaitSemaphoreValues = depvals,
-        .signalSemaphoreValueCount = num_sigs,
-        .pSignalSemaphoreValues = sigvals,
-    };
+    VkSubmitInfo *infos = pl_calloc_ptr(tmp, count, infos);
+    VkTimelineSemaphoreSubmitInfo *tinfos = pl_calloc_ptr(tmp, count, tinfos);
+
+    for (int n = 0; n < count; n++) {
+        const VkSubmitInfo2 *info2 = &infos2[n];
+        const uint32_t num_deps = info2->waitSemaphoreInfoCount;
+        const uint32_t num_sigs = info2->signalSemaphoreInfoCount;
+        const uint32_t num_cmds = info2->commandBufferInfoCount;
+
+        VkSemaphore *deps           = pl_calloc_ptr(tmp, num_deps, deps);
+        VkPipelineStageFlags *masks = pl_calloc_ptr(tmp, num_deps, masks);
+        uint64_t *depvals           = pl_calloc_ptr(tmp, num_deps, depvals);
+        VkSemaphore *sigs           = pl_calloc_ptr(tmp, num_sigs, sigs);
+        uint64_t *sigvals           = pl_calloc_ptr(tmp, num_sigs, sigvals);
+        VkCommandBuffer *cmds       = pl_calloc_ptr(tmp, num_cmds, cmds);
+
+        for (int i = 0; i < num_deps; i++) {
+            deps[i] = info2->pWaitSemaphoreInfos[i].semaphore;
+            masks[i] = info2->pWaitSemaphoreInfos[i].stageMask;
+            depvals[i] = info2->pWaitSemaphoreInfos[i].value;
+        }
+        for (int i = 0; i < num_sigs; i++) {
+            sigs[i] = info2->pSignalSemaphoreInfos[i].semaphore;
+            sigvals[i] = info2->pSignalSemaphoreInfos[i].value;
+        }
+        for (int i = 0; i < num_cmds; i++)
+            cmds[i] = info2->pCommandBufferInfos[i].commandBuffer;
+
+        tinfos[n] = (VkTimelineSemaphoreSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = info2->pNext,
+            .waitSemaphoreValueCount = num_deps,
+            .pWaitSemaphoreValues = depvals,
+            .signalSemaphoreValueCount = num_sigs,
+            .pSignalSemaphoreValues = sigvals,
+        };
 
-    const VkSubmitInfo info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = &tinfo,
-        .waitSemaphoreCount = num_deps,
-        .pWaitSemaphores = deps,
-        .pWaitDstStageMask = masks,
-        .commandBufferCount = num_cmds,
-        .pCommandBuffers = cmds,
-        .signalSemaphoreCount = num_sigs,
-        .pSignalSemaphores = sigs,
-    };
+        infos[n] = (VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &tinfos[n],
+            .waitSemaphoreCount = num_deps,
+            .pWaitSemaphores = deps,
+            .pWaitDstStageMask = masks,
+            .commandBufferCount = num_cmds,
+            .pCommandBuffers = cmds,
+            .signalSemaphoreCount = num_sigs,
+            .pSignalSemaphores = sigs,
+        };
+    }
 
-    VkResult res = vk->QueueSubmit(queue, 1, &info, fence);
+    VkResult res = vk->QueueSubmit(queue, count, infos, fence);
     pl_free(tmp);
     return res;
 }
@@ -470,55 +537,160 @@ bool vk_cmd_submit(struct vk_cmd **pcmd)
 
     VK(vk->EndCommandBuffer(cmd->buf));
 
-    VkSubmitInfo2 sinfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-        .waitSemaphoreInfoCount = cmd->deps.num,
-        .pWaitSemaphoreInfos = cmd->deps.elem,
-        .signalSemaphoreInfoCount = cmd->sigs.num,
-        .pSignalSemaphoreInfos = cmd->sigs.elem,
-        .commandBufferInfoCount = 1,
-        .pCommandBufferInfos = &(VkCommandBufferSubmitInfo) {
+    pl_mutex_lock(&vk->lock);
+    PL_ARRAY_APPEND(vk->alloc, vk->cmds_queued, cmd);
+    pool->queue_load[cmd->qindex]++;
+    bool flush = vk->cmds_queued.num >= MAX_QUEUED_CMDS;
+    pl_mutex_unlock(&vk->lock);
+
+    return flush ? vk_flush_commands(vk) : true;
+
+error:
+    vk_cmd_reset(cmd);
+    pl_mutex_lock(&vk->lock);
+    PL_ARRAY_APPEND(pool, pool->cmds, cmd);
+    pl_mutex_unlock(&vk->lock);
+    vk->failed = true;
+    return false;
+}
+
+static void trace_cmd(struct vk_ctx *vk, const struct vk_cmd *cmd)
+{
+    PL_TRACE(vk, "Submitting command %p on queue %p (QF %d):",
+             (void *) cmd->buf, (void *) cmd->queue, cmd->pool->qf);
+    for (int n = 0; n < cmd->deps.num; n++) {
+        PL_TRACE(vk, "    waits on semaphore 0x%"PRIx64" = %"PRIu64,
+                 (uint64_t) cmd->deps.elem[n].semaphore, cmd->deps.elem[n].value);
+    }
+    for (int n = 0; n < cmd->sigs.num; n++) {
+        PL_TRACE(vk, "    signals semaphore 0x%"PRIx64" = %"PRIu64,
+                (uint64_t) cmd->sigs.elem[n].semaphore, cmd->sigs.elem[n].value);
+    }
+    if (cmd->callbacks.num)
+        PL_TRACE(vk, "    signals %d callbacks", cmd->callbacks.num);
+}
+
+// Submits a run of consecutive commands sharing the same queue
+static bool submit_batch(struct vk_ctx *vk, struct vk_cmd **cmds, int num)
+{
+    const struct vk_cmd *first = cmds[0];
+    void *tmp = pl_tmp(NULL);
+    VkSubmitInfo2 *infos = pl_calloc_ptr(tmp, num, infos);
+    VkCommandBufferSubmitInfo *bufs = pl_calloc_ptr(tmp, num, bufs);
+
+    for (int i = 0; i < num; i++) {
+        const struct vk_cmd *cmd = cmds[i];
+        bufs[i] = (VkCommandBufferSubmitInfo) {
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
             .commandBuffer = cmd->buf,
-        },
-    };
+        };
 
-    if (pl_msg_test(vk->log, PL_LOG_TRACE)) {
-        PL_TRACE(vk, "Submitting command %p on queue %p (QF %d):",
-                 (void *) cmd->buf, (void *) cmd->queue, pool->qf);
-        for (int n = 0; n < cmd->deps.num; n++) {
-            PL_TRACE(vk, "    waits on semaphore 0x%"PRIx64" = %"PRIu64,
-                     (uint64_t) cmd->deps.elem[n].semaphore, cmd->deps.elem[n].value);
-        }
-        for (int n = 0; n < cmd->sigs.num; n++) {
-            PL_TRACE(vk, "    signals semaphore 0x%"PRIx64" = %"PRIu64,
-                    (uint64_t) cmd->sigs.elem[n].semaphore, cmd->sigs.elem[n].value);
-        }
-        if (cmd->callbacks.num)
-            PL_TRACE(vk, "    signals %d callbacks", cmd->callbacks.num);
+        infos[i] = (VkSubmitInfo2) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = cmd->deps.num,
+            .pWaitSemaphoreInfos = cmd->deps.elem,
+            .signalSemaphoreInfoCount = cmd->sigs.num,
+            .pSignalSemaphoreInfos = cmd->sigs.elem,
+            .commandBufferInfoCount = 1,
+            .pCommandBufferInfos = &bufs[i],
+        };
+
+        if (pl_msg_test(vk->log, PL_LOG_TRACE))
+            trace_cmd(vk, cmd);
     }
 
-    vk->lock_queue(vk->queue_ctx, pool->qf, cmd->qindex);
-    VkResult res = vk_queue_submit2(vk, cmd->queue, &sinfo, VK_NULL_HANDLE);
-    vk->unlock_queue(vk->queue_ctx, pool->qf, cmd->qindex);
-    PL_VK_ASSERT(res, "vkQueueSubmit2");
+    vk->lock_queue(vk->queue_ctx, first->pool->qf, first->qindex);
+    VkResult res = vk_queue_submit2(vk, first->queue, num, infos, VK_NULL_HANDLE);
+    vk->unlock_queue(vk->queue_ctx, first->pool->qf, first->qindex);
+    pl_free(tmp);
 
+    // Commands stay queued until submitted, so that `vk_dev_callback` always
+    // finds them either queued or pending
     pl_mutex_lock(&vk->lock);
-    PL_ARRAY_APPEND(vk->alloc, vk->cmds_pending, cmd);
-    pl_mutex_unlock(&vk->lock);
-    return true;
+    pl_assert(vk->cmds_queued.num >= num && vk->cmds_queued.elem[0] == first);
+    PL_ARRAY_REMOVE_RANGE(vk->cmds_queued, 0, num);
 
-error:
-    vk_cmd_reset(cmd);
-    pl_mutex_lock(&vk->lock);
-    PL_ARRAY_APPEND(pool, pool->cmds, cmd);
+    if (res == VK_SUCCESS) {
+        for (int i = 0; i < num; i++) {
+            PL_ARRAY_APPEND(vk->alloc, vk->cmds_pending, cmds[i]);
+            vk->num_sem_waits += cmds[i]->deps.num;
+        }
+        vk->num_cmds_submitted += num;
+        vk->num_submits++;
+        vk->frame_cmds += num;
+        vk->frame_submits++;
+        pl_mutex_unlock(&vk->lock);
+        return true;
+    }
+
+    // Callbacks attached by `vk_dev_callback` may still need to wait for
+    // previously submitted commands, so hand them over to the most recent
+    // pending command instead of running them right away
+    if (vk->cmds_pending.num > 0) {
+        struct vk_cmd *last = vk->cmds_pending.elem[vk->cmds_pending.num - 1];
+        for (int i = 0; i < num; i++) {
+            struct vk_cmd *cmd = cmds[i];
+            for (int n = 0; n < cmd->callbacks.num; n++)
+                PL_ARRAY_APPEND(last, last->callbacks, cmd->callbacks.elem[n]);
+            cmd->callbacks.num = 0;
+        }
+    }
     pl_mutex_unlock(&vk->lock);
+
+    PL_ERR(vk, "vkQueueSubmit2: %s (%d commands)", vk_res_str(res), num);
+    for (int i = 0; i < num; i++) {
+        struct vk_cmd *cmd = cmds[i];
+        struct vk_cmdpool *pool = cmd->pool;
+        vk_cmd_reset(cmd);
+        pl_mutex_lock(&vk->lock);
+        pool->queue_load[cmd->qindex]--;
+        PL_ARRAY_APPEND(pool, pool->cmds, cmd);
+        pl_mutex_unlock(&vk->lock);
+    }
+
     vk->failed = true;
     return false;
 }
 
+bool vk_flush_commands(struct vk_ctx *vk)
+{
+    // Held for the entire flush, so that commands queued later can't be
+    // submitted by another thread before the ones we are about to submit,
+    // since same-queue dependencies rely on the order of submission
+    pl_mutex_lock(&vk->submit_lock);
+    pl_mutex_lock(&vk->lock);
+    const int num_cmds = vk->cmds_queued.num;
+    if (!num_cmds) {
+        pl_mutex_unlock(&vk->lock);
+        pl_mutex_unlock(&vk->submit_lock);
+        return true;
+    }
+
+    struct vk_cmd **cmds = pl_memdup(NULL, vk->cmds_queued.elem,
+                                     num_cmds * sizeof(cmds[0]));
+    pl_mutex_unlock(&vk->lock);
+
+    // Commands are only ever merged with their direct neighbours, so that
+    // the overall order of submission is preserved across queues
+    bool ret = true;
+    for (int i = 0, num; i < num_cmds; i += num) {
+        num = 1;
+        while (i + num < num_cmds && cmds[i + num]->queue == cmds[i]->queue)
+            num++;
+        ret &= submit_batch(vk, &cmds[i], num);
+    }
+
+    pl_mutex_unlock(&vk->submit_lock);
+    pl_free(cmds);
+    return ret;
+}
+
 bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
 {
+    // Make sure we never block on commands that were not submitted yet
+    if (timeout)
+        vk_flush_commands(vk);
+
     bool ret = false;
     pl_mutex_lock(&vk->lock);
 
@@ -535,6 +707,7 @@ bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
         PL_TRACE(vk, "VkSemaphore signalled: 0x%"PRIx64" = %"PRIu64,
                  (uint64_t) cmd->sync.sem, cmd->sync.value);
         PL_ARRAY_REMOVE_AT(vk->cmds_pending, 0); // remove before callbacks
+        pool->queue_load[cmd->qindex]--;
         vk_cmd_reset(cmd);
         PL_ARRAY_APPEND(pool, pool->cmds, cmd);
         ret = true;
@@ -553,16 +726,47 @@ bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
 
 void vk_rotate_queues(struct vk_ctx *vk)
 {
+    vk_flush_commands(vk);
     pl_mutex_lock(&vk->lock);
 
-    // Rotate the queues to ensure good parallelism across frames
+    // Move each pool on to its least loaded queue, to ensure good parallelism
+    // across frames. On ties, this prefers the next queue in line, so idle
+    // queues are still used in round-robin order.
     for (int i = 0; i < vk->pools.num; i++) {
         struct vk_cmdpool *pool = vk->pools.elem[i];
-        pool->idx_queues = (pool->idx_queues + 1) % pool->num_queues;
-        PL_TRACE(vk, "QF %d: %d/%d", pool->qf, pool->idx_queues, pool->num_queues);
+        int best = (pool->idx_queues + 1) % pool->num_queues;
+        for (int n = 1; n < pool->num_queues; n++) {
+            int idx = (best + n) % pool->num_queues;
+            if (pool->queue_load[idx] < pool->queue_load[best])
+                best = idx;
+        }
+
+        pool->idx_queues = best;
+        PL_TRACE(vk, "QF %d: %d/%d (%d commands outstanding)", pool->qf,
+                 pool->idx_queues, pool->num_queues, pool->queue_load[best]);
     }
 
+    PL_TRACE(vk, "Submitted %d commands in %d batches since last rotation",
+             vk->frame_cmds, vk->frame_submits);
+    vk->last_frame_cmds = vk->frame_cmds;
+    vk->last_frame_submits = vk->frame_submits;
+    vk->frame_cmds = vk->frame_submits = 0;
+
+    pl_mutex_unlock(&vk->lock);
+}
+
+struct vk_submit_stats vk_get_submit_stats(struct vk_ctx *vk)
+{
+    pl_mutex_lock(&vk->lock);
+    struct vk_submit_stats stats = {
+        .cmds           = vk->num_cmds_submitted,
+        .submits        = vk->num_submits,
+        .sem_waits      = vk->num_sem_waits,
+        .frame_cmds     = vk->last_frame_cmds,
+        .frame_submits  = vk->last_frame_submits,
+    };
     pl_mutex_unlock(&vk->lock);
+    return stats;
 }
 
 void vk_wait_idle(struct vk_ctx *vk)
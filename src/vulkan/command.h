@@ -82,9 +82,15 @@ struct vk_sync_scope {
     VkAccessFlags2 access;      // access type bitmask
 };
 
-// Synchronization primitive
+// Synchronization primitive. Tracks the last write, as well as all reads
+// since then, with one access scope per queue. This allows reads on different
+// queues to proceed concurrently, with only writes waiting for all of them.
+#define VK_SEM_MAX_READS 8
+
 struct vk_sem {
-    struct vk_sync_scope read, write;
+    struct vk_sync_scope write;
+    struct vk_sync_scope read[VK_SEM_MAX_READS];
+    int num_reads;
 };
 
 // Updates the `vk_sem` state for a given access. If `is_trans` is set, this
@@ -96,6 +102,14 @@ struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
                                     VkPipelineStageFlags2 stage,
                                     VkAccessFlags2 access, bool is_trans);
 
+// Returns true if the last write, or any read since then, happened on a queue
+// other than `queue`.
+bool vk_sem_shared(const struct vk_sem *sem, VkQueue queue);
+
+// Forgets the queues of all past accesses, so that all future accesses
+// synchronize via semaphores. Used when releasing a resource to the user.
+void vk_sem_forget_queues(struct vk_sem *sem);
+
 // Command pool / queue family hybrid abstraction
 struct vk_cmdpool {
     struct vk_ctx *vk;
@@ -103,6 +117,7 @@ struct vk_cmdpool {
     int qf; // queue family index
     VkCommandPool pool;
     VkQueue *queues;
+    int *queue_load; // number of outstanding commands per queue
     int num_queues;
     int idx_queues;
     // Command buffers associated with this queue. These are available for
@@ -121,26 +136,46 @@ void vk_cmdpool_destroy(struct vk_cmdpool *pool);
 // Returns NULL on failure.
 struct vk_cmd *vk_cmd_begin(struct vk_cmdpool *pool, pl_debug_tag debug_tag);
 
-// Finish recording a command buffer and submit it for execution. This function
+// Finish recording a command buffer and queue it for execution. This function
 // takes over ownership of **cmd, and sets *cmd to NULL in doing so.
+//
+// Queued commands are submitted in batches, by `vk_flush_commands`. This
+// happens implicitly once enough commands have accumulated.
 bool vk_cmd_submit(struct vk_cmd **cmd);
 
+// Submit all commands queued by `vk_cmd_submit`. Consecutive commands sharing
+// the same queue are submitted together, with a single call to
+// vkQueueSubmit2. This must be called before anything outside of libplacebo
+// waits on a semaphore signalled by a queued command.
+bool vk_flush_commands(struct vk_ctx *vk);
+
 // Block until some commands complete executing. This is the only function that
 // actually processes the callbacks. Will wait at most `timeout` nanoseconds
 // for the completion of any command. The timeout may also be passed as 0, in
 // which case this function will not block, but only poll for completed
 // commands. Returns whether any forward progress was made.
 //
-// This does *not* flush any queued commands, forgetting to do so may result
-// in infinite loops if waiting for the completion of callbacks that were
-// never flushed!
+// If `timeout` is nonzero, this first flushes any queued commands. Otherwise,
+// queued commands are not considered, so polling in a loop for the completion
+// of callbacks that were never flushed may result in infinite loops!
 bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout);
 
-// Rotate through queues in each command pool. Call this once per frame, after
-// submitting all of the command buffers for that frame. Calling this more
-// often than that is possible but bad for performance.
+// Flush all queued commands, and move each command pool on to its least loaded
+// queue. Call this once per frame, after submitting all of the command buffers
+// for that frame. Calling this more often than that is possible but bad for
+// performance.
 void vk_rotate_queues(struct vk_ctx *vk);
 
+struct vk_submit_stats {
+    uint64_t cmds;      // total number of command buffers submitted
+    uint64_t submits;   // total number of calls to vkQueueSubmit2
+    uint64_t sem_waits; // total number of semaphore waits submitted
+    int frame_cmds;     // ... in between the last two calls to `vk_rotate_queues`
+    int frame_submits;
+};
+
+struct vk_submit_stats vk_get_submit_stats(struct vk_ctx *vk);
+
 // Wait until all commands are complete, i.e. the device is idle. This is
 // basically equivalent to calling `vk_poll_commands` with a timeout of
 // UINT64_MAX until it returns `false`.
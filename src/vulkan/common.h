@@ -65,6 +65,7 @@ struct vk_ctx {
     uint32_t api_ver; // device API version
     VkDevice dev;
     bool imported; // device was not created by us
+    float defrag_threshold; // see `pl_vulkan_params.defrag_threshold`
 
     // Generic error flag for catching "failed" devices
     bool failed;
@@ -88,7 +89,16 @@ struct vk_ctx {
 
     // Pending commands. These are shared for the entire mpvk_ctx to ensure
     // submission and callbacks are FIFO
+    PL_ARRAY(struct vk_cmd *) cmds_queued;  // recorded but not yet submitted
     PL_ARRAY(struct vk_cmd *) cmds_pending; // submitted but not completed
+    pl_mutex submit_lock; // held while moving commands from queued to pending
+
+    // Submission counters, see `vk_get_submit_stats`
+    uint64_t num_cmds_submitted;
+    uint64_t num_submits;
+    uint64_t num_sem_waits;
+    int frame_cmds, frame_submits;
+    int last_frame_cmds, last_frame_submits;
 
     // Pending callbacks that still need to be drained before processing
     // callbacks for the next command (in case commands are recursively being
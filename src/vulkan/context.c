@@ -932,6 +932,7 @@ void pl_vulkan_destroy(pl_vulkan *pl_vk)
     }
 
     pl_vk_inst_destroy(&vk->internal_instance);
+    pl_mutex_destroy(&vk->submit_lock);
     pl_mutex_destroy(&vk->lock);
     pl_free_ptr((void **) pl_vk);
 }
@@ -1441,6 +1442,7 @@ pl_vulkan pl_vulkan_create(pl_log log, const struct pl_vulkan_params *params)
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
+    pl_mutex_init_type(&vk->submit_lock, PL_MUTEX_RECURSIVE);
     if (!vk->GetInstanceProcAddr)
         goto error;
 
@@ -1524,6 +1526,7 @@ pl_vulkan pl_vulkan_create(pl_log log, const struct pl_vulkan_params *params)
     if (!device_init(vk, params))
         goto error;
 
+    vk->defrag_threshold = params->defrag_threshold;
     if (!finalize_context(pl_vk, params->max_glsl_version, params->no_compute))
         goto error;
 
@@ -1556,6 +1559,7 @@ pl_vulkan pl_vulkan_import(pl_log log, const struct pl_vulkan_import_params *par
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
+    pl_mutex_init_type(&vk->submit_lock, PL_MUTEX_RECURSIVE);
     if (!vk->GetInstanceProcAddr)
         goto error;
 
@@ -1693,6 +1697,7 @@ next_qf: ;
         goto error;
     }
 
+    vk->defrag_threshold = params->defrag_threshold;
     if (!finalize_context(pl_vk, params->max_glsl_version, params->no_compute))
         goto error;
 
@@ -0,0 +1,298 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "descriptors.h"
+#include "utils.h"
+#include "hash.h"
+
+// Number of sets in the first descriptor pool of each layout. Every further
+// pool doubles in size, up to the maximum.
+#define MIN_POOL_SETS 16
+#define MAX_POOL_SETS 1024
+
+struct ds_entry {
+    VkDescriptorSet set;
+    uint64_t hash;      // hash of the current contents, or 0 if unknown
+    uint64_t last_used; // for LRU recycling
+    int uses;           // number of pending commands using this set
+};
+
+struct ds_layout {
+    struct vk_desc_layout pub; // must be first
+    uint64_t signature;
+    VkDescriptorSetLayoutBinding *bindings;
+    int num_bindings;
+
+    // Descriptor pools, the last of which has `pool_free` sets left
+    PL_ARRAY(VkDescriptorPoolSize) sizes; // per set
+    PL_ARRAY(VkDescriptorPool) pools;
+    int pool_sets;
+    int pool_free;
+
+    PL_ARRAY(struct ds_entry *) sets;
+};
+
+struct vk_desc_alloc {
+    struct vk_ctx *vk;
+    pl_mutex lock;
+    PL_ARRAY(struct ds_layout *) layouts;
+    struct vk_desc_stats stats;
+    uint64_t tick;
+};
+
+struct vk_desc_alloc *vk_desc_alloc_create(struct vk_ctx *vk)
+{
+    struct vk_desc_alloc *da = pl_zalloc_ptr(NULL, da);
+    pl_mutex_init(&da->lock);
+    da->vk = vk;
+    return da;
+}
+
+void vk_desc_alloc_destroy(struct vk_desc_alloc **da_ptr)
+{
+    struct vk_desc_alloc *da = *da_ptr;
+    if (!da)
+        return;
+
+    struct vk_ctx *vk = da->vk;
+    PL_DEBUG(vk, "Destroying descriptor allocator: %d layouts, %d pools, "
+             "%d sets, %"PRIu64" hits, %"PRIu64" updates", da->stats.num_layouts,
+             da->stats.num_pools, da->stats.num_sets, da->stats.hits,
+             da->stats.updates);
+
+    for (int i = 0; i < da->layouts.num; i++) {
+        struct ds_layout *lay = da->layouts.elem[i];
+        for (int n = 0; n < lay->sets.num; n++)
+            pl_assert(!lay->sets.elem[n]->uses);
+        for (int n = 0; n < lay->pools.num; n++)
+            vk->DestroyDescriptorPool(vk->dev, lay->pools.elem[n], PL_VK_ALLOC);
+        vk->DestroyDescriptorSetLayout(vk->dev, lay->pub.layout, PL_VK_ALLOC);
+    }
+
+    pl_mutex_destroy(&da->lock);
+    pl_free_ptr(da_ptr);
+}
+
+static bool bindings_equal(const struct ds_layout *lay,
+                           const VkDescriptorSetLayoutBinding *bindings,
+                           int num_bindings)
+{
+    if (lay->num_bindings != num_bindings)
+        return false;
+
+    for (int i = 0; i < num_bindings; i++) {
+        const VkDescriptorSetLayoutBinding *a = &lay->bindings[i], *b = &bindings[i];
+        if (a->binding != b->binding ||
+            a->descriptorType != b->descriptorType ||
+            a->descriptorCount != b->descriptorCount ||
+            a->stageFlags != b->stageFlags ||
+            a->pImmutableSamplers != b->pImmutableSamplers)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const struct vk_desc_layout *vk_desc_layout_get(struct vk_desc_alloc *da,
+                                                const VkDescriptorSetLayoutBinding *bindings,
+                                                int num_bindings, bool push)
+{
+    struct vk_ctx *vk = da->vk;
+
+    uint64_t sig = push;
+    for (int i = 0; i < num_bindings; i++) {
+        pl_hash_merge(&sig, bindings[i].binding);
+        pl_hash_merge(&sig, bindings[i].descriptorType);
+        pl_hash_merge(&sig, bindings[i].descriptorCount);
+        pl_hash_merge(&sig, bindings[i].stageFlags);
+    }
+
+    pl_mutex_lock(&da->lock);
+    for (int i = 0; i < da->layouts.num; i++) {
+        struct ds_layout *lay = da->layouts.elem[i];
+        if (lay->signature == sig && lay->pub.push == push &&
+            bindings_equal(lay, bindings, num_bindings))
+        {
+            pl_mutex_unlock(&da->lock);
+            return &lay->pub;
+        }
+    }
+
+    struct ds_layout *lay = pl_zalloc_ptr(da, lay);
+    lay->signature = sig;
+    lay->pub.push = push;
+    lay->num_bindings = num_bindings;
+    lay->bindings = pl_memdup(lay, bindings, num_bindings * sizeof(*bindings));
+
+    for (int i = 0; i < num_bindings; i++) {
+        VkDescriptorPoolSize *size = NULL;
+        for (int n = 0; n < lay->sizes.num; n++) {
+            if (lay->sizes.elem[n].type == bindings[i].descriptorType)
+                size = &lay->sizes.elem[n];
+        }
+
+        if (!size) {
+            PL_ARRAY_APPEND(lay, lay->sizes, (VkDescriptorPoolSize) {
+                .type = bindings[i].descriptorType,
+            });
+            size = &lay->sizes.elem[lay->sizes.num - 1];
+        }
+
+        size->descriptorCount += bindings[i].descriptorCount;
+    }
+
+    VkDescriptorSetLayoutCreateInfo dinfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pBindings = bindings,
+        .bindingCount = num_bindings,
+    };
+
+    if (push)
+        dinfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+
+    VK(vk->CreateDescriptorSetLayout(vk->dev, &dinfo, PL_VK_ALLOC, &lay->pub.layout));
+    PL_ARRAY_APPEND(da, da->layouts, lay);
+    da->stats.num_layouts++;
+    pl_mutex_unlock(&da->lock);
+    return &lay->pub;
+
+error:
+    pl_free(lay);
+    pl_mutex_unlock(&da->lock);
+    return NULL;
+}
+
+static struct ds_entry *alloc_set(struct vk_desc_alloc *da, struct ds_layout *lay)
+{
+    struct vk_ctx *vk = da->vk;
+
+    if (!lay->pool_free) {
+        int num_sets = lay->pool_sets ? PL_MIN(lay->pool_sets * 2, MAX_POOL_SETS)
+                                      : MIN_POOL_SETS;
+
+        VkDescriptorPoolSize sizes[PL_DESC_TYPE_COUNT];
+        pl_assert(lay->sizes.num <= PL_ARRAY_SIZE(sizes));
+        for (int i = 0; i < lay->sizes.num; i++) {
+            sizes[i] = lay->sizes.elem[i];
+            sizes[i].descriptorCount *= num_sets;
+        }
+
+        VkDescriptorPoolCreateInfo pinfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .maxSets = num_sets,
+            .pPoolSizes = sizes,
+            .poolSizeCount = lay->sizes.num,
+        };
+
+        VkDescriptorPool pool;
+        VK(vk->CreateDescriptorPool(vk->dev, &pinfo, PL_VK_ALLOC, &pool));
+        PL_ARRAY_APPEND(lay, lay->pools, pool);
+        PL_DEBUG(vk, "Allocated descriptor pool of %d sets (%d total)",
+                 num_sets, lay->sets.num + num_sets);
+        lay->pool_sets = lay->pool_free = num_sets;
+        da->stats.num_pools++;
+    }
+
+    VkDescriptorSetAllocateInfo ainfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = lay->pools.elem[lay->pools.num - 1],
+        .descriptorSetCount = 1,
+        .pSetLayouts = &lay->pub.layout,
+    };
+
+    VkDescriptorSet set;
+    VK(vk->AllocateDescriptorSets(vk->dev, &ainfo, &set));
+    lay->pool_free--;
+
+    struct ds_entry *entry = pl_alloc_ptr(lay, entry);
+    *entry = (struct ds_entry) { .set = set };
+    PL_ARRAY_APPEND(lay, lay->sets, entry);
+    da->stats.num_sets++;
+    return entry;
+
+error:
+    return NULL;
+}
+
+static void release_set(struct vk_desc_alloc *da, struct ds_entry *entry)
+{
+    pl_mutex_lock(&da->lock);
+    pl_assert(entry->uses > 0);
+    entry->uses--;
+    pl_mutex_unlock(&da->lock);
+}
+
+VK_CB_FUNC_DEF(release_set);
+
+VkDescriptorSet vk_desc_set_acquire(struct vk_desc_alloc *da,
+                                    const struct vk_desc_layout *layout,
+                                    struct vk_cmd *cmd, uint64_t hash,
+                                    bool *update)
+{
+    struct ds_layout *lay = (struct ds_layout *) layout;
+    pl_assert(!layout->push);
+
+    pl_mutex_lock(&da->lock);
+    const uint64_t tick = ++da->tick;
+
+    // Look for a set with identical contents, and otherwise recycle the
+    // least recently used idle set
+    struct ds_entry *entry = NULL, *idle = NULL;
+    for (int i = 0; i < lay->sets.num; i++) {
+        struct ds_entry *e = lay->sets.elem[i];
+        if (hash && e->hash == hash) {
+            entry = e;
+            break;
+        }
+
+        if (!e->uses && (!idle || e->last_used < idle->last_used))
+            idle = e;
+    }
+
+    if (entry) {
+        da->stats.hits++;
+        *update = false;
+    } else {
+        entry = idle ? idle : alloc_set(da, lay);
+        if (!entry) {
+            pl_mutex_unlock(&da->lock);
+            return VK_NULL_HANDLE;
+        }
+
+        da->stats.updates++;
+        entry->hash = hash;
+        *update = true;
+    }
+
+    entry->uses++;
+    entry->last_used = tick;
+    VkDescriptorSet set = entry->set;
+    pl_mutex_unlock(&da->lock);
+
+    vk_cmd_callback(cmd, VK_CB_FUNC(release_set), da, entry);
+    return set;
+}
+
+struct vk_desc_stats vk_desc_alloc_get_stats(struct vk_desc_alloc *da)
+{
+    pl_mutex_lock(&da->lock);
+    struct vk_desc_stats stats = da->stats;
+    pl_mutex_unlock(&da->lock);
+    return stats;
+}
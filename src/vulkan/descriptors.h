@@ -0,0 +1,72 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+#include "command.h"
+
+// Device-wide allocator for descriptor set layouts and descriptor sets. Passes
+// with identical bindings share a single VkDescriptorSetLayout, and draw their
+// descriptor sets from a common list of descriptor pools, which grows on
+// demand. Sets are recycled once all commands using them have completed.
+//
+// Since a descriptor set may be bound by any number of commands as long as it
+// is not updated, sets are also tagged with a hash of their contents, and a
+// set with matching contents is handed out again directly, even while still
+// in use, skipping the descriptor update altogether.
+//
+// Thread-safety: Safe
+struct vk_desc_alloc *vk_desc_alloc_create(struct vk_ctx *vk);
+
+// Destroys all layouts and descriptor sets. The caller must ensure that none
+// of them are still in use by the device.
+void vk_desc_alloc_destroy(struct vk_desc_alloc **da);
+
+// A descriptor set layout, owned by the allocator. Valid until the allocator
+// is destroyed.
+struct vk_desc_layout {
+    VkDescriptorSetLayout layout;
+    bool push; // push descriptor layout (no descriptor sets)
+};
+
+// Returns the layout for a given list of bindings, creating it if needed.
+// Returns NULL on failure.
+const struct vk_desc_layout *vk_desc_layout_get(struct vk_desc_alloc *da,
+                                                const VkDescriptorSetLayoutBinding *bindings,
+                                                int num_bindings, bool push);
+
+// Returns a descriptor set for a (non-push) layout, which is released again
+// once `cmd` completes. If `hash` is nonzero and matches the contents of an
+// existing set, that set is returned as-is and `*update` is set to false.
+// Otherwise, `*update` is set to true and the caller must write all of the
+// set's descriptors before using it, and before the next call to this
+// function. Returns VK_NULL_HANDLE on failure.
+VkDescriptorSet vk_desc_set_acquire(struct vk_desc_alloc *da,
+                                    const struct vk_desc_layout *layout,
+                                    struct vk_cmd *cmd, uint64_t hash,
+                                    bool *update);
+
+struct vk_desc_stats {
+    int num_layouts;    // number of distinct layouts
+    int num_pools;      // number of descriptor pools
+    int num_sets;       // number of descriptor sets allocated
+    uint64_t hits;      // acquisitions served by a set with matching contents
+    uint64_t updates;   // acquisitions requiring a descriptor update
+};
+
+struct vk_desc_stats vk_desc_alloc_get_stats(struct vk_desc_alloc *da);
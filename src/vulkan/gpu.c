@@ -26,6 +26,10 @@
 // Gives us enough queries for 8 results
 #define QUERY_POOL_SIZE 16
 
+// Evacuate sparse memory slabs once every this many calls to `pl_gpu_flush`,
+// i.e. roughly once per second at typical frame rates (if enabled)
+#define DEFRAG_INTERVAL 60
+
 struct pl_timer_t {
     VkQueryPool qpool; // even=start, odd=stop
     int index_write; // next index to write to
@@ -200,6 +204,7 @@ bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
             pl_mutex_lock(&p->recording);
             ret = vk_cmd_submit(&p->cmd);
             pl_mutex_unlock(&p->recording);
+            ret &= vk_flush_commands(vk);
         }
         return ret;
     }
@@ -235,6 +240,123 @@ bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
     return ret;
 }
 
+void vk_gpu_register_tex(pl_gpu gpu, pl_tex tex)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    if (!p->vk->defrag_threshold)
+        return;
+
+    pl_mutex_lock(&p->objects_lock);
+    PL_ARRAY_APPEND((void *) gpu, p->textures, tex);
+    pl_mutex_unlock(&p->objects_lock);
+}
+
+void vk_gpu_unregister_tex(pl_gpu gpu, pl_tex tex)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    if (!p->vk->defrag_threshold)
+        return;
+
+    pl_mutex_lock(&p->objects_lock);
+    for (int i = 0; i < p->textures.num; i++) {
+        if (p->textures.elem[i] == tex) {
+            PL_ARRAY_REMOVE_AT(p->textures, i);
+            break;
+        }
+    }
+    pl_mutex_unlock(&p->objects_lock);
+}
+
+void vk_gpu_register_buf(pl_gpu gpu, pl_buf buf)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    if (!p->vk->defrag_threshold)
+        return;
+
+    pl_mutex_lock(&p->objects_lock);
+    PL_ARRAY_APPEND((void *) gpu, p->buffers, buf);
+    pl_mutex_unlock(&p->objects_lock);
+}
+
+void vk_gpu_unregister_buf(pl_gpu gpu, pl_buf buf)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    if (!p->vk->defrag_threshold)
+        return;
+
+    pl_mutex_lock(&p->objects_lock);
+    for (int i = 0; i < p->buffers.num; i++) {
+        if (p->buffers.elem[i] == buf) {
+            PL_ARRAY_REMOVE_AT(p->buffers, i);
+            break;
+        }
+    }
+    pl_mutex_unlock(&p->objects_lock);
+}
+
+// Takes a reference to an object only if nobody but the user holds one. This
+// avoids resurrecting objects which are concurrently being destroyed.
+static bool ref_if_idle(pl_rc_t *rc)
+{
+    uint_fast32_t idle = 1;
+    return atomic_compare_exchange_strong(rc, &idle, 2);
+}
+
+// Evacuates sparse memory slabs by relocating all movable objects they
+// contain, and returns the total size of slabs freed as a result
+static size_t vk_gpu_defrag(pl_gpu gpu)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    if (!vk->defrag_threshold || !vk_malloc_defrag(vk->ma, vk->defrag_threshold))
+        return 0;
+
+    // Hold references to all candidates, so they can't disappear while we
+    // relocate them without holding `objects_lock`
+    PL_ARRAY(pl_tex) textures = {0};
+    PL_ARRAY(pl_buf) buffers = {0};
+    pl_mutex_lock(&p->objects_lock);
+    for (int i = 0; i < p->textures.num; i++) {
+        pl_tex tex = p->textures.elem[i];
+        struct pl_tex_vk *tex_vk = PL_PRIV(tex);
+        if (vk_malloc_should_move(&tex_vk->mem) && ref_if_idle(&tex_vk->rc))
+            PL_ARRAY_APPEND(NULL, textures, tex);
+    }
+    for (int i = 0; i < p->buffers.num; i++) {
+        pl_buf buf = p->buffers.elem[i];
+        struct pl_buf_vk *buf_vk = PL_PRIV(buf);
+        if (vk_malloc_should_move(&buf_vk->mem) && ref_if_idle(&buf_vk->rc))
+            PL_ARRAY_APPEND(NULL, buffers, buf);
+    }
+    pl_mutex_unlock(&p->objects_lock);
+
+    int num_moved = 0;
+    for (int i = 0; i < textures.num; i++) {
+        num_moved += vk_tex_relocate(gpu, textures.elem[i]);
+        vk_tex_deref(gpu, textures.elem[i]);
+    }
+    for (int i = 0; i < buffers.num; i++) {
+        num_moved += vk_buf_relocate(gpu, buffers.elem[i]);
+        vk_buf_deref(gpu, buffers.elem[i]);
+    }
+
+    size_t reclaimed = vk_malloc_reclaimable(vk->ma);
+    PL_DEBUG(gpu, "Memory defragmentation: relocated %d/%d objects, "
+             "reclaiming %zu bytes", num_moved, textures.num + buffers.num,
+             reclaimed);
+    pl_free(textures.elem);
+    pl_free(buffers.elem);
+    return reclaimed;
+}
+
+size_t pl_vulkan_defrag(pl_gpu gpu)
+{
+    if (!pl_vulkan_get(gpu))
+        return 0;
+
+    return vk_gpu_defrag(gpu);
+}
+
 void vk_gpu_idle_callback(pl_gpu gpu, vk_cb cb, const void *priv, const void *arg)
 {
     struct pl_vk *p = PL_PRIV(gpu);
@@ -249,6 +371,12 @@ void vk_gpu_idle_callback(pl_gpu gpu, vk_cb cb, const void *priv, const void *ar
     pl_mutex_unlock(&p->recording);
 }
 
+uint64_t vk_gpu_resource_id(pl_gpu gpu)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    return atomic_fetch_add(&p->resource_id, 1) + 1;
+}
+
 static void vk_gpu_destroy(pl_gpu gpu)
 {
     struct pl_vk *p = PL_PRIV(gpu);
@@ -262,8 +390,10 @@ static void vk_gpu_destroy(pl_gpu gpu)
             vk->DestroySampler(vk->dev, p->samplers[s][a], PL_VK_ALLOC);
     }
 
+    vk_desc_alloc_destroy(&p->da);
     pl_spirv_destroy(&p->spirv);
     pl_mutex_destroy(&p->recording);
+    pl_mutex_destroy(&p->objects_lock);
     pl_free((void *) gpu);
 }
 
@@ -417,8 +547,11 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
 
     struct pl_vk *p = PL_PRIV(gpu);
     pl_mutex_init(&p->recording);
+    pl_mutex_init(&p->objects_lock);
     p->vk = vk;
     p->impl = pl_fns_vk;
+    p->da = vk_desc_alloc_create(vk);
+    atomic_init(&p->resource_id, 0);
     p->spirv = pl_spirv_create(vk->log, get_spirv_version(vk));
     if (!p->spirv)
         goto error;
@@ -722,6 +855,11 @@ static void vk_gpu_flush(pl_gpu gpu)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
+    if (vk->defrag_threshold && ++p->flush_count >= DEFRAG_INTERVAL) {
+        p->flush_count = 0;
+        vk_gpu_defrag(gpu);
+    }
+
     CMD_SUBMIT(NULL);
     vk_rotate_queues(vk);
     vk_malloc_garbage_collect(vk->ma);
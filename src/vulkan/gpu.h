@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "command.h"
+#include "descriptors.h"
 #include "formats.h"
 #include "malloc.h"
 #include "utils.h"
@@ -69,6 +70,20 @@ struct pl_vk {
     // Array of VkSamplers for every combination of sample/address modes
     VkSampler samplers[PL_TEX_SAMPLE_MODE_COUNT][PL_TEX_ADDRESS_MODE_COUNT];
 
+    // Descriptor set layouts and descriptor sets, shared by all passes
+    struct vk_desc_alloc *da;
+
+    // Source of unique identifiers for resources bound to descriptors. Unlike
+    // Vulkan handles, these are never reused, so they can be used to identify
+    // the contents of cached descriptor sets.
+    atomic_uint_fast64_t resource_id;
+
+    // Objects which may be relocated by memory defragmentation (if enabled)
+    pl_mutex objects_lock;
+    PL_ARRAY(pl_tex) textures;
+    PL_ARRAY(pl_buf) buffers;
+    int flush_count;
+
     // To avoid spamming warnings
     bool warned_modless;
 };
@@ -81,6 +96,16 @@ bool _end_cmd(pl_gpu, struct vk_cmd **, bool submit);
 #define CMD_FINISH(cmd) _end_cmd(gpu, cmd, false)
 #define CMD_SUBMIT(cmd) _end_cmd(gpu, cmd, true)
 
+// Note: CMD_SUBMIT(NULL) additionally flushes all queued commands, see
+// `vk_flush_commands`
+
+// Add/remove objects to/from the list of objects considered for memory
+// defragmentation. These are no-ops unless defragmentation is enabled.
+void vk_gpu_register_tex(pl_gpu, pl_tex);
+void vk_gpu_unregister_tex(pl_gpu, pl_tex);
+void vk_gpu_register_buf(pl_gpu, pl_buf);
+void vk_gpu_unregister_buf(pl_gpu, pl_buf);
+
 // Helper to fire a callback the next time the `pl_gpu` is in an idle state
 //
 // Use this instead of `vk_dev_callback` when you need to clean up after
@@ -88,6 +113,9 @@ bool _end_cmd(pl_gpu, struct vk_cmd **, bool submit);
 // creating the callback.
 void vk_gpu_idle_callback(pl_gpu, vk_cb, const void *priv, const void *arg);
 
+// Returns a new unique (nonzero) resource identifier, see `pl_vk.resource_id`
+uint64_t vk_gpu_resource_id(pl_gpu);
+
 struct pl_tex_vk {
     pl_rc_t rc;
     bool external_img;
@@ -101,6 +129,7 @@ struct pl_tex_vk {
     VkImageUsageFlags usage_flags;
     // for sampling
     VkImageView view;
+    uint64_t id; // see `pl_vk.resource_id`
     // for rendering
     VkFramebuffer framebuffer;
     // for vk_tex_upload/download fallback code
@@ -116,6 +145,7 @@ struct pl_tex_vk {
     uint32_t qf; // last queue family to access this texture (for barriers)
     bool may_invalidate;
     bool held;
+    bool pinned; // VkImage was exposed to the user, can't be relocated
 };
 
 pl_tex vk_tex_create(pl_gpu, const struct pl_tex_params *);
@@ -129,11 +159,18 @@ bool vk_tex_poll(pl_gpu, pl_tex, uint64_t timeout);
 void vk_tex_barrier(pl_gpu, struct vk_cmd *, pl_tex, VkPipelineStageFlags2,
                     VkAccessFlags2, VkImageLayout, uint32_t qf);
 
+// Moves the contents of a texture to a freshly allocated image, if its memory
+// lives in a slab marked for evacuation. Fails for textures which are in use
+// by pending commands, or otherwise shared outside of libplacebo. The caller
+// must hold a reference to `tex`, in addition to the user's.
+bool vk_tex_relocate(pl_gpu, pl_tex);
+
 struct pl_buf_vk {
     pl_rc_t rc;
     struct vk_memslice mem;
     enum queue_type update_queue;
     VkBufferView view; // for texel buffers
+    uint64_t id; // see `pl_vk.resource_id`
 
     // synchronization and current state
     struct vk_sem sem;
@@ -150,6 +187,9 @@ void vk_buf_copy(pl_gpu, pl_buf dst, size_t dst_offset,
 bool vk_buf_export(pl_gpu, pl_buf);
 bool vk_buf_poll(pl_gpu, pl_buf, uint64_t timeout);
 
+// Equivalent of `vk_tex_relocate` for buffers
+bool vk_buf_relocate(pl_gpu, pl_buf);
+
 // Helper to ease buffer barrier creation. (`offset` is relative to pl_buf)
 void vk_buf_barrier(pl_gpu, struct vk_cmd *, pl_buf, VkPipelineStageFlags2,
                     VkAccessFlags2, size_t offset, size_t size, bool export);
@@ -88,6 +88,7 @@ void vk_buf_deref(pl_gpu gpu, pl_buf buf)
     struct pl_buf_vk *buf_vk = PL_PRIV(buf);
 
     if (pl_rc_deref(&buf_vk->rc)) {
+        vk_gpu_unregister_buf(gpu, buf);
         vk->DestroyBufferView(vk->dev, buf_vk->view, PL_VK_ALLOC);
         vk_malloc_free(vk->ma, &buf_vk->mem);
         pl_free((void *) buf);
@@ -105,6 +106,7 @@ pl_buf vk_buf_create(pl_gpu gpu, const struct pl_buf_params *params)
 
     struct pl_buf_vk *buf_vk = PL_PRIV(buf);
     pl_rc_init(&buf_vk->rc);
+    buf_vk->id = vk_gpu_resource_id(gpu);
 
     struct vk_malloc_params mparams = {
         .reqs = {
@@ -250,6 +252,10 @@ pl_buf vk_buf_create(pl_gpu gpu, const struct pl_buf_params *params)
     if (params->initial_data)
         vk_buf_write(gpu, buf, 0, params->initial_data, params->size);
 
+    // Buffers visible to the user or external APIs can't be relocated
+    if (!params->host_mapped && !params->export_handle && !params->import_handle)
+        vk_gpu_register_buf(gpu, buf);
+
     return buf;
 
 error:
@@ -456,6 +462,67 @@ void vk_buf_copy(pl_gpu gpu, pl_buf dst, size_t dst_offset,
     CMD_FINISH(&cmd);
 }
 
+bool vk_buf_relocate(pl_gpu gpu, pl_buf buf)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct pl_buf_vk *buf_vk = PL_PRIV(buf);
+    if (buf->params.host_mapped || buf->params.export_handle ||
+        buf->params.import_handle)
+    {
+        return false;
+    }
+
+    pl_buf new = vk_buf_create(gpu, &buf->params);
+    if (!new)
+        return false;
+
+    struct pl_buf_vk *new_vk = PL_PRIV(new);
+    struct vk_cmd *cmd = CMD_BEGIN(buf_vk->update_queue);
+    if (!cmd)
+        goto error;
+
+    // Re-check everything while holding the recording lock, since commands
+    // referencing `buf` may have been recorded in the meantime
+    if (pl_rc_count(&buf_vk->rc) > 2 || buf_vk->exported ||
+        !vk_malloc_should_move(&buf_vk->mem))
+    {
+        CMD_FINISH(&cmd);
+        goto error;
+    }
+
+    const size_t size = buf->params.size;
+    vk_buf_barrier(gpu, cmd, new, VK_PIPELINE_STAGE_2_COPY_BIT,
+                   VK_ACCESS_2_TRANSFER_WRITE_BIT, 0, size, false);
+    vk_buf_barrier(gpu, cmd, buf, VK_PIPELINE_STAGE_2_COPY_BIT,
+                   VK_ACCESS_2_TRANSFER_READ_BIT, 0, size, false);
+
+    VkBufferCopy region = {
+        .srcOffset = buf_vk->mem.offset,
+        .dstOffset = new_vk->mem.offset,
+        .size = size,
+    };
+
+    vk->CmdCopyBuffer(cmd->buf, buf_vk->mem.buf, new_vk->mem.buf, 1, &region);
+
+    // Swap the underlying memory (and its synchronization state), so that
+    // `new` now owns the old memory and frees it once the copy completes
+    PL_SWAP(buf_vk->mem, new_vk->mem);
+    PL_SWAP(buf_vk->view, new_vk->view);
+    PL_SWAP(buf_vk->id, new_vk->id);
+    PL_SWAP(buf_vk->sem, new_vk->sem);
+    vk_malloc_mark_moved(&new_vk->mem);
+    vk_buf_flush(gpu, cmd, buf, 0, size);
+    CMD_FINISH(&cmd);
+
+    vk_buf_deref(gpu, new);
+    return true;
+
+error:
+    vk_buf_deref(gpu, new);
+    return false;
+}
+
 bool vk_buf_export(pl_gpu gpu, pl_buf buf)
 {
     struct pl_buf_vk *buf_vk = PL_PRIV(buf);
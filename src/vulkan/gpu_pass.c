@@ -19,21 +19,26 @@
 #include "cache.h"
 #include "glsl/spirv.h"
 
+// Number of specializations kept around per pass, in addition to the base
+// pipeline, so that switching back and forth between sets of constants does
+// not need to re-create pipelines every time
+#define MAX_VARIANTS 4
+
+struct pl_pass_vk_variant {
+    VkPipeline pipe;
+    void *data; // specialization constants, `spec_size` bytes
+    uint64_t last_used;
+};
+
 // For pl_pass.priv
 struct pl_pass_vk {
     // Pipeline / render pass
     VkPipeline base;
-    VkPipeline pipe;
+    VkPipeline pipe; // for specialized passes, one of `variants` (or NULL)
     VkPipelineLayout pipeLayout;
     VkRenderPass renderPass;
-    // Descriptor set (bindings)
-    bool use_pushd;
-    VkDescriptorSetLayout dsLayout;
-    VkDescriptorPool dsPool;
-    // To keep track of which descriptor sets are and aren't available, we
-    // allocate a fixed number and use a bitmask of all available sets.
-    VkDescriptorSet dss[16];
-    uint16_t dmask;
+    // Descriptor set (bindings), owned by `pl_vk.da`
+    const struct vk_desc_layout *dsLayout;
 
     // For recompilation
     VkVertexInputAttributeDescription *attrs;
@@ -47,6 +52,11 @@ struct pl_pass_vk {
     VkDescriptorBufferInfo *dsbinfo;
     VkSpecializationInfo specInfo;
     size_t spec_size;
+
+    // For re-specialization
+    void *base_data; // constants `base` was specialized with, or NULL
+    PL_ARRAY(struct pl_pass_vk_variant) variants;
+    uint64_t tick;
 };
 
 int vk_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
@@ -60,13 +70,14 @@ static void pass_destroy_cb(pl_gpu gpu, pl_pass pass)
     struct vk_ctx *vk = p->vk;
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
 
-    vk->DestroyPipeline(vk->dev, pass_vk->pipe, PL_VK_ALLOC);
+    for (int i = 0; i < pass_vk->variants.num; i++)
+        vk->DestroyPipeline(vk->dev, pass_vk->variants.elem[i].pipe, PL_VK_ALLOC);
+    if (!pass_vk->variants.num)
+        vk->DestroyPipeline(vk->dev, pass_vk->pipe, PL_VK_ALLOC);
     vk->DestroyPipeline(vk->dev, pass_vk->base, PL_VK_ALLOC);
     vk->DestroyRenderPass(vk->dev, pass_vk->renderPass, PL_VK_ALLOC);
     vk->DestroyPipelineLayout(vk->dev, pass_vk->pipeLayout, PL_VK_ALLOC);
     vk->DestroyPipelineCache(vk->dev, pass_vk->cache, PL_VK_ALLOC);
-    vk->DestroyDescriptorPool(vk->dev, pass_vk->dsPool, PL_VK_ALLOC);
-    vk->DestroyDescriptorSetLayout(vk->dev, pass_vk->dsLayout, PL_VK_ALLOC);
     vk->DestroyShaderModule(vk->dev, pass_vk->vert, PL_VK_ALLOC);
     vk->DestroyShaderModule(vk->dev, pass_vk->shader, PL_VK_ALLOC);
 
@@ -296,7 +307,6 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     pass->params = pl_pass_params_copy(pass, params);
 
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
-    pass_vk->dmask = -1; // all descriptors available
 
     // temporary allocations
     void *tmp = pl_tmp(NULL);
@@ -315,9 +325,6 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     pass_vk->dsiinfo = pl_calloc(pass, num_desc, sizeof(VkDescriptorImageInfo));
     pass_vk->dsbinfo = pl_calloc(pass, num_desc, sizeof(VkDescriptorBufferInfo));
 
-#define NUM_DS (PL_ARRAY_SIZE(pass_vk->dss))
-
-    int dsSize[PL_DESC_TYPE_COUNT] = {0};
     VkDescriptorSetLayoutBinding *bindings = pl_calloc_ptr(tmp, num_desc, bindings);
 
     uint32_t max_tex = vk->props.limits.maxPerStageDescriptorSampledImages,
@@ -342,7 +349,6 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
             goto error;
         }
 
-        dsSize[desc->type]++;
         bindings[i] = (VkDescriptorSetLayoutBinding) {
             .binding = desc->binding,
             .descriptorType = dsType[desc->type],
@@ -351,60 +357,16 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
         };
     }
 
-    VkDescriptorSetLayoutCreateInfo dinfo = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .pBindings = bindings,
-        .bindingCount = num_desc,
-    };
-
-    if (p->max_push_descriptors && num_desc <= p->max_push_descriptors) {
-        dinfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
-        pass_vk->use_pushd = true;
-    } else if (p->max_push_descriptors) {
+    bool use_pushd = p->max_push_descriptors && num_desc <= p->max_push_descriptors;
+    if (p->max_push_descriptors && !use_pushd) {
         PL_INFO(gpu, "Pass with %d descriptors exceeds the maximum push "
                 "descriptor count (%d). Falling back to descriptor sets!",
                 num_desc, p->max_push_descriptors);
     }
 
-    VK(vk->CreateDescriptorSetLayout(vk->dev, &dinfo, PL_VK_ALLOC,
-                                     &pass_vk->dsLayout));
-
-    if (!pass_vk->use_pushd) {
-        PL_ARRAY(VkDescriptorPoolSize) dsPoolSizes = {0};
-
-        for (enum pl_desc_type t = 0; t < PL_DESC_TYPE_COUNT; t++) {
-            if (dsSize[t] > 0) {
-                PL_ARRAY_APPEND(tmp, dsPoolSizes, (VkDescriptorPoolSize) {
-                    .type = dsType[t],
-                    .descriptorCount = dsSize[t] * NUM_DS,
-                });
-            }
-        }
-
-        if (dsPoolSizes.num) {
-            VkDescriptorPoolCreateInfo pinfo = {
-                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                .maxSets = NUM_DS,
-                .pPoolSizes = dsPoolSizes.elem,
-                .poolSizeCount = dsPoolSizes.num,
-            };
-
-            VK(vk->CreateDescriptorPool(vk->dev, &pinfo, PL_VK_ALLOC, &pass_vk->dsPool));
-
-            VkDescriptorSetLayout layouts[NUM_DS];
-            for (int i = 0; i < NUM_DS; i++)
-                layouts[i] = pass_vk->dsLayout;
-
-            VkDescriptorSetAllocateInfo ainfo = {
-                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                .descriptorPool = pass_vk->dsPool,
-                .descriptorSetCount = NUM_DS,
-                .pSetLayouts = layouts,
-            };
-
-            VK(vk->AllocateDescriptorSets(vk->dev, &ainfo, pass_vk->dss));
-        }
-    }
+    pass_vk->dsLayout = vk_desc_layout_get(p->da, bindings, num_desc, use_pushd);
+    if (!pass_vk->dsLayout)
+        goto error;
 
 no_descriptors: ;
 
@@ -436,13 +398,14 @@ no_descriptors: ;
         if (params->constant_data) {
             pass_vk->specInfo.pData = pl_memdup(pass, params->constant_data, spec_size);
             pass_vk->specInfo.dataSize = spec_size;
+            pass_vk->base_data = pl_memdup(pass, params->constant_data, spec_size);
         }
     }
 
     VkPipelineLayoutCreateInfo linfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = num_desc ? 1 : 0,
-        .pSetLayouts = &pass_vk->dsLayout,
+        .pSetLayouts = num_desc ? &pass_vk->dsLayout->layout : NULL,
         .pushConstantRangeCount = params->push_constants_size ? 1 : 0,
         .pPushConstantRanges = &(VkPushConstantRange){
             .stageFlags = stageFlags[params->type],
@@ -606,8 +569,6 @@ error:
         pass = NULL;
     }
 
-#undef NUM_DS
-
     pl_free(tmp);
     return pass;
 }
@@ -618,8 +579,7 @@ static const VkPipelineStageFlags2 shaderStages[] = {
 };
 
 static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
-                                 struct pl_desc_binding db,
-                                 VkDescriptorSet ds, int idx)
+                                 struct pl_desc_binding db, int idx)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
@@ -628,7 +588,6 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
     VkWriteDescriptorSet *wds = &pass_vk->dswrite[idx];
     *wds = (VkWriteDescriptorSet) {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = ds,
         .dstBinding = desc->binding,
         .descriptorCount = 1,
         .descriptorType = dsType[desc->type],
@@ -749,35 +708,114 @@ static void vk_release_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
     pl_unreachable();
 }
 
-static void set_ds(struct pl_pass_vk *pass_vk, void *dsbit)
+// Hashes the current contents of `dswrite`, as filled in by
+// `vk_update_descriptor`. Resources are identified by their unique IDs rather
+// than by their Vulkan handles, since the latter may be reused after the
+// object is destroyed.
+static uint64_t vk_desc_hash(pl_pass pass, const struct pl_pass_run_params *params)
 {
-    pass_vk->dmask |= (uintptr_t) dsbit;
-}
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+    uint64_t hash = 0;
+
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        const struct pl_desc *desc = &pass->params.descriptors[i];
+        struct pl_desc_binding db = params->desc_bindings[i];
+
+        switch (desc->type) {
+        case PL_DESC_SAMPLED_TEX:
+            pl_hash_merge(&hash, db.sample_mode);
+            pl_hash_merge(&hash, db.address_mode);
+            // fall through
+        case PL_DESC_STORAGE_IMG: {
+            const struct pl_tex_vk *tex_vk = PL_PRIV((pl_tex) db.object);
+            pl_hash_merge(&hash, tex_vk->id);
+            pl_hash_merge(&hash, pass_vk->dsiinfo[i].imageLayout);
+            continue;
+        }
+        case PL_DESC_BUF_UNIFORM:
+        case PL_DESC_BUF_STORAGE:
+        case PL_DESC_BUF_TEXEL_UNIFORM:
+        case PL_DESC_BUF_TEXEL_STORAGE: {
+            const struct pl_buf_vk *buf_vk = PL_PRIV((pl_buf) db.object);
+            pl_hash_merge(&hash, buf_vk->id);
+            continue;
+        }
+        case PL_DESC_INVALID:
+        case PL_DESC_TYPE_COUNT:
+            break;
+        }
+
+        pl_unreachable();
+    }
 
-VK_CB_FUNC_DEF(set_ds);
+    return hash;
+}
 
-static bool need_respec(pl_pass pass, const struct pl_pass_run_params *params)
+// Switches `pass_vk->pipe` to the specialization matching `data`, re-using
+// the base pipeline or a previously created specialization if possible
+static VkResult vk_pass_specialize(pl_gpu gpu, pl_pass pass, const void *data)
 {
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
-    if (!pass_vk->spec_size || !params->constant_data)
-        return false;
+    const size_t size = pass_vk->spec_size;
+    if (!size || !data)
+        return VK_SUCCESS;
 
     VkSpecializationInfo *specInfo = &pass_vk->specInfo;
-    size_t size = pass_vk->spec_size;
     if (!specInfo->pData) {
         // Shader was never specialized before
-        specInfo->pData = pl_memdup((void *) pass, params->constant_data, size);
+        specInfo->pData = pl_alloc((void *) pass, size);
         specInfo->dataSize = size;
-        return true;
+    } else if (memcmp(specInfo->pData, data, size) == 0) {
+        return VK_SUCCESS;
+    }
+
+    memcpy((void *) specInfo->pData, data, size);
+    if (pass_vk->base_data && memcmp(pass_vk->base_data, data, size) == 0) {
+        pass_vk->pipe = VK_NULL_HANDLE;
+        return VK_SUCCESS;
+    }
+
+    struct pl_pass_vk_variant *var = NULL;
+    for (int i = 0; i < pass_vk->variants.num; i++) {
+        if (memcmp(pass_vk->variants.elem[i].data, data, size) == 0) {
+            var = &pass_vk->variants.elem[i];
+            break;
+        }
     }
 
-    // Shader is being re-specialized with new values
-    if (memcmp(specInfo->pData, params->constant_data, size) != 0) {
-        memcpy((void *) specInfo->pData, params->constant_data, size);
-        return true;
+    if (!var) {
+        if (pass_vk->variants.num < MAX_VARIANTS) {
+            PL_ARRAY_APPEND((void *) pass, pass_vk->variants, (struct pl_pass_vk_variant) {
+                .data = pl_alloc((void *) pass, size),
+            });
+            var = &pass_vk->variants.elem[pass_vk->variants.num - 1];
+        } else {
+            // Replace the least recently used specialization. The old pipeline
+            // is destroyed by `vk_recreate_pipelines`
+            var = &pass_vk->variants.elem[0];
+            for (int i = 1; i < pass_vk->variants.num; i++) {
+                if (pass_vk->variants.elem[i].last_used < var->last_used)
+                    var = &pass_vk->variants.elem[i];
+            }
+        }
+
+        memcpy(var->data, data, size);
+        pl_clock_t start = pl_clock_now();
+        VkResult res = vk_recreate_pipelines(vk, pass, false, pass_vk->base, &var->pipe);
+        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "re-specializing shader");
+        if (res != VK_SUCCESS) {
+            pl_free(var->data);
+            PL_ARRAY_REMOVE_AT(pass_vk->variants, var - pass_vk->variants.elem);
+            pass_vk->pipe = VK_NULL_HANDLE;
+            return res;
+        }
     }
 
-    return false;
+    var->last_used = ++pass_vk->tick;
+    pass_vk->pipe = var->pipe;
+    return VK_SUCCESS;
 }
 
 void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
@@ -791,19 +829,7 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         return pl_pass_run_vbo(gpu, params);
 
     // Check if we need to re-specialize this pipeline
-    if (need_respec(pass, params)) {
-        pl_clock_t start = pl_clock_now();
-        VK(vk_recreate_pipelines(vk, pass, false, pass_vk->base, &pass_vk->pipe));
-        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "re-specializing shader");
-    }
-
-    if (!pass_vk->use_pushd) {
-        // Wait for a free descriptor set
-        while (!pass_vk->dmask) {
-            PL_TRACE(gpu, "No free descriptor sets! ...blocking (slow path)");
-            vk_poll_commands(vk, 10000000); // 10 ms
-        }
-    }
+    VK(vk_pass_specialize(gpu, pass, params->constant_data));
 
     static const enum queue_type types[] = {
         [PL_PASS_RASTER]  = GRAPHICS,
@@ -814,28 +840,30 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     if (!cmd)
         goto error;
 
-    // Find a descriptor set to use
+    // Update the dswrite structure with all of the new values
+    const int num_desc = pass->params.num_descriptors;
+    for (int i = 0; i < num_desc; i++)
+        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], i);
+
+    // Find a descriptor set to use, reusing one with identical contents if
+    // possible
     VkDescriptorSet ds = VK_NULL_HANDLE;
-    if (!pass_vk->use_pushd) {
-        for (int i = 0; i < PL_ARRAY_SIZE(pass_vk->dss); i++) {
-            uint16_t dsbit = 1u << i;
-            if (pass_vk->dmask & dsbit) {
-                ds = pass_vk->dss[i];
-                pass_vk->dmask &= ~dsbit; // unset
-                vk_cmd_callback(cmd, VK_CB_FUNC(set_ds), pass_vk,
-                                (void *)(uintptr_t) dsbit);
-                break;
-            }
+    const bool use_pushd = num_desc && pass_vk->dsLayout->push;
+    if (num_desc && !use_pushd) {
+        bool update;
+        ds = vk_desc_set_acquire(p->da, pass_vk->dsLayout, cmd,
+                                 vk_desc_hash(pass, params), &update);
+        if (!ds) {
+            PL_ERR(gpu, "Failed allocating descriptor set!");
+            CMD_FINISH(&cmd);
+            goto error;
         }
-    }
 
-    // Update the dswrite structure with all of the new values
-    for (int i = 0; i < pass->params.num_descriptors; i++)
-        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], ds, i);
-
-    if (!pass_vk->use_pushd) {
-        vk->UpdateDescriptorSets(vk->dev, pass->params.num_descriptors,
-                                 pass_vk->dswrite, 0, NULL);
+        if (update) {
+            for (int i = 0; i < num_desc; i++)
+                pass_vk->dswrite[i].dstSet = ds;
+            vk->UpdateDescriptorSets(vk->dev, num_desc, pass_vk->dswrite, 0, NULL);
+        }
     }
 
     // Bind the pipeline, descriptor set, etc.
@@ -852,7 +880,7 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
                                   pass_vk->pipeLayout, 0, 1, &ds, 0, NULL);
     }
 
-    if (pass_vk->use_pushd) {
+    if (use_pushd) {
         vk->CmdPushDescriptorSetKHR(cmd->buf, bindPoint[pass->params.type],
                                     pass_vk->pipeLayout, 0,
                                     pass->params.num_descriptors,
@@ -962,7 +990,8 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     for (int i = 0; i < pass->params.num_descriptors; i++)
         vk_release_descriptor(gpu, cmd, pass, params->desc_bindings[i], i);
 
-    // submit this command buffer for better intra-frame granularity
+    // submit this command buffer for better intra-frame granularity, batched
+    // together with the other commands of this frame
     CMD_SUBMIT(&cmd);
 
 error:
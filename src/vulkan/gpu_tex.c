@@ -19,6 +19,18 @@
 
 VK_CB_FUNC_DEF(vk_tex_deref);
 
+static inline bool is_read_layout(VkImageLayout layout)
+{
+    switch (layout) {
+    case VK_IMAGE_LAYOUT_GENERAL:
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
 void vk_tex_barrier(pl_gpu gpu, struct vk_cmd *cmd, pl_tex tex,
                     VkPipelineStageFlags2 stage, VkAccessFlags2 access,
                     VkImageLayout layout, uint32_t qf)
@@ -39,6 +51,17 @@ void vk_tex_barrier(pl_gpu gpu, struct vk_cmd *cmd, pl_tex tex,
             qf = cmd->pool->qf;
     }
 
+    // Concurrent reads on different queues that require different layouts
+    // (e.g. sampling and downloading) would otherwise keep transitioning the
+    // image back and forth, with every transition serializing against all
+    // pending reads. Settle on GENERAL instead, which allows all of them.
+    if (access && !(access & vk_access_write) && layout != tex_vk->layout &&
+        is_read_layout(layout) && is_read_layout(tex_vk->layout) &&
+        vk_sem_shared(&tex_vk->sem, cmd->queue))
+    {
+        layout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
     struct vk_sync_scope last;
     bool is_trans = layout != tex_vk->layout, is_xfer = qf != tex_vk->qf;
     last = vk_sem_barrier(cmd, &tex_vk->sem, stage, access, is_trans || is_xfer);
@@ -100,6 +123,7 @@ static void vk_tex_destroy(pl_gpu gpu, struct pl_tex_t *tex)
     struct vk_ctx *vk = p->vk;
     struct pl_tex_vk *tex_vk = PL_PRIV(tex);
 
+    vk_gpu_unregister_tex(gpu, tex);
     vk->DestroyFramebuffer(vk->dev, tex_vk->framebuffer, PL_VK_ALLOC);
     vk->DestroyImageView(vk->dev, tex_vk->view, PL_VK_ALLOC);
     for (int i = 0; i < tex_vk->num_planes; i++)
@@ -122,6 +146,91 @@ void vk_tex_deref(pl_gpu gpu, pl_tex tex)
         vk_tex_destroy(gpu, (struct pl_tex_t *) tex);
 }
 
+bool vk_tex_relocate(pl_gpu gpu, pl_tex tex)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct pl_tex_vk *tex_vk = PL_PRIV(tex);
+    const VkImageUsageFlags xfer = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((tex_vk->usage_flags & xfer) != xfer || tex_vk->external_img ||
+        tex_vk->num_planes || tex->params.export_handle ||
+        tex->params.import_handle)
+    {
+        return false;
+    }
+
+    pl_tex new = vk_tex_create(gpu, &tex->params);
+    if (!new)
+        return false;
+
+    struct pl_tex_vk *new_vk = PL_PRIV(new);
+    struct vk_cmd *cmd = CMD_BEGIN(GRAPHICS);
+    if (!cmd)
+        goto error;
+
+    // Re-check everything while holding the recording lock, since commands
+    // referencing `tex` may have been recorded in the meantime
+    if (pl_rc_count(&tex_vk->rc) > 2 || tex_vk->held || tex_vk->pinned ||
+        tex_vk->ext_deps.num || !vk_malloc_should_move(&tex_vk->mem))
+    {
+        CMD_FINISH(&cmd);
+        goto error;
+    }
+
+    if (tex_vk->layout != VK_IMAGE_LAYOUT_UNDEFINED && !tex_vk->may_invalidate) {
+        vk_tex_barrier(gpu, cmd, tex, VK_PIPELINE_STAGE_2_COPY_BIT,
+                       VK_ACCESS_2_TRANSFER_READ_BIT,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_QUEUE_FAMILY_IGNORED);
+
+        vk_tex_barrier(gpu, cmd, new, VK_PIPELINE_STAGE_2_COPY_BIT,
+                       VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_QUEUE_FAMILY_IGNORED);
+
+        VkImageCopy region = {
+            .srcSubresource = {
+                .aspectMask = tex_vk->aspect,
+                .layerCount = 1,
+            },
+            .dstSubresource = {
+                .aspectMask = new_vk->aspect,
+                .layerCount = 1,
+            },
+            .extent = {
+                tex->params.w,
+                PL_MAX(tex->params.h, 1),
+                PL_MAX(tex->params.d, 1),
+            },
+        };
+
+        vk->CmdCopyImage(cmd->buf, tex_vk->img, tex_vk->layout,
+                         new_vk->img, new_vk->layout, 1, &region);
+    }
+
+    // Swap the underlying resources (and their synchronization state), so
+    // that `new` now owns the old image and frees it once the copy completes
+    PL_SWAP(tex_vk->img, new_vk->img);
+    PL_SWAP(tex_vk->mem, new_vk->mem);
+    PL_SWAP(tex_vk->view, new_vk->view);
+    PL_SWAP(tex_vk->id, new_vk->id);
+    PL_SWAP(tex_vk->framebuffer, new_vk->framebuffer);
+    PL_SWAP(tex_vk->sem, new_vk->sem);
+    PL_SWAP(tex_vk->layout, new_vk->layout);
+    PL_SWAP(tex_vk->qf, new_vk->qf);
+    PL_SWAP(tex_vk->may_invalidate, new_vk->may_invalidate);
+    vk_malloc_mark_moved(&new_vk->mem);
+    CMD_FINISH(&cmd);
+
+    vk_tex_deref(gpu, new);
+    return true;
+
+error:
+    vk_tex_deref(gpu, new);
+    return false;
+}
+
 
 // Initializes non-VkImage values like the image view, framebuffers, etc.
 static bool vk_init_image(pl_gpu gpu, pl_tex tex, pl_debug_tag debug_tag)
@@ -134,6 +243,7 @@ static bool vk_init_image(pl_gpu gpu, pl_tex tex, pl_debug_tag debug_tag)
     pl_assert(tex_vk->img);
     PL_VK_NAME(IMAGE, tex_vk->img, debug_tag);
     pl_rc_init(&tex_vk->rc);
+    tex_vk->id = vk_gpu_resource_id(gpu);
     if (tex_vk->num_planes)
         return true;
     tex_vk->layout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -302,6 +412,12 @@ pl_tex vk_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
     if (tex->params.host_writable || tex->params.blit_dst || params->initial_data)
         usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
+    // Memory defragmentation relocates images using transfer operations
+    bool movable = vk->defrag_threshold && !handle_type && !tex_vk->num_planes &&
+                   !fmt->opaque && !fmt->emulated;
+    if (movable)
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
     if (!usage) {
         // Vulkan requires images have at least *some* image usage set, but our
         // API is perfectly happy with a (useless) image. So just put
@@ -620,6 +736,9 @@ pl_tex vk_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
         tex->params.host_writable = writable;
     }
 
+    if (movable)
+        vk_gpu_register_tex(gpu, tex);
+
     return tex;
 
 error:
@@ -1286,6 +1405,7 @@ VkImage pl_vulkan_unwrap(pl_gpu gpu, pl_tex tex, VkFormat *out_format,
                          VkImageUsageFlags *out_flags)
 {
     struct pl_tex_vk *tex_vk = PL_PRIV(tex);
+    tex_vk->pinned = true;
 
     if (out_format)
         *out_format = tex_vk->img_fmt;
@@ -1342,15 +1462,16 @@ bool pl_vulkan_hold_ex(pl_gpu gpu, const struct pl_vulkan_hold_params *params)
 
     vk_cmd_sig(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, params->semaphore);
     bool ok = CMD_SUBMIT(&cmd);
+    ok &= CMD_SUBMIT(NULL); // the semaphore may be waited on externally
 
     if (!tex_vk->num_planes) {
-        tex_vk->sem.write.queue = tex_vk->sem.read.queue = NULL;
+        vk_sem_forget_queues(&tex_vk->sem);
         tex_vk->held = ok;
     }
 
     for (int i = 0; i < tex_vk->num_planes; i++) {
         struct pl_tex_vk *plane_vk = tex_vk->planes[i];
-        plane_vk->sem.write.queue = plane_vk->sem.read.queue = NULL;
+        vk_sem_forget_queues(&plane_vk->sem);
         plane_vk->held = ok;
     }
 
@@ -19,55 +19,46 @@
 #include "command.h"
 #include "utils.h"
 #include "pl_thread.h"
+#include "suballoc.h"
 
 #ifdef PL_HAVE_UNIX
 #include <errno.h>
 #include <unistd.h>
 #endif
 
-// Controls the page size alignment, to help coalesce allocations into the same
-// slab. Pages are rounded up to multiples of this value. (Default: 4 KB)
+// Controls the allocation granularity, to reduce fragmentation of slabs into
+// tiny free regions. Suballocations are rounded up to multiples of this value.
+// (Default: 4 KB)
 #define PAGE_SIZE_ALIGN (1LLU << 12)
 
-// Controls the minimum/maximum number of pages for new slabs. As slabs are
-// exhausted of memory, the number of pages per new slab grows exponentially,
-// starting with the minimum until the maximum is reached.
-//
-// Note: The maximum must never exceed the size of `vk_slab.spacemap`.
-#define MINIMUM_PAGE_COUNT 4
-#define MAXIMUM_PAGE_COUNT (sizeof(uint64_t) * 8)
-
-// Controls the maximum page size. Any allocations above this threshold
-// (absolute size or fraction of VRAM, whichever is higher) will be served by
-// dedicated allocations. (Default: 64 MB or 1/16 of VRAM)
+// Controls the maximum suballocation size. Any allocations above this
+// threshold (absolute size or fraction of VRAM, whichever is higher) will be
+// served by dedicated allocations. (Default: 64 MB or 1/16 of VRAM)
 #define MAXIMUM_PAGE_SIZE_ABSOLUTE (1LLU << 26)
 #define MAXIMUM_PAGE_SIZE_RELATIVE 16
 
-// Controls the minimum slab size, to avoid excessive re-allocation of very
-// small slabs. (Default: 256 KB)
+// Controls the minimum/maximum slab size. As slabs are exhausted of memory,
+// the size of new slabs grows with the total size of the pool, starting with
+// the minimum until the maximum (a multiple of the maximum suballocation
+// size) is reached. (Default: 256 KB / 4x)
 #define MINIMUM_SLAB_SIZE (1LLU << 18)
+#define MAXIMUM_SLAB_SCALE 4
 
 // How long to wait before garbage collecting empty slabs. Slabs older than
 // this many invocations of `vk_malloc_garbage_collect` will be released.
 #define MAXIMUM_SLAB_AGE 32
 
 // A single slab represents a contiguous region of allocated memory. Actual
-// allocations are served as pages of this. Slabs are organized into pools,
-// each of which contains a list of slabs of differing page sizes.
+// allocations are suballocated from this by the `pl_suballoc` of the pool
+// the slab belongs to.
 struct vk_slab {
-    pl_mutex lock;
     pl_debug_tag debug_tag; // debug tag of the triggering allocation
     VkDeviceMemory mem;     // underlying device allocation
     VkDeviceSize size;      // total allocated size of `mem`
     VkMemoryType mtype;     // underlying memory type
     bool dedicated;         // slab is allocated specifically for one object
     bool imported;          // slab represents an imported memory allocation
-
-    // free space accounting (only for non-dedicated slabs)
-    uint64_t spacemap;      // bitset of available pages
-    size_t pagesize;        // size in bytes per page
-    size_t used;            // number of bytes actually in use
-    uint64_t age;           // timestamp of last use
+    pl_suballoc sa;         // suballocator owning this slab (if not dedicated)
 
     // optional, depends on the memory type:
     VkBuffer buffer;        // buffer spanning the entire slab
@@ -81,12 +72,10 @@ struct vk_slab {
 // combination of malloc parameters. This shouldn't actually be that many in
 // practice, because some combinations simply never occur, and others will
 // generally be the same for the same objects.
-//
-// Note: `vk_pool` addresses are not immutable, so we mustn't expose any
-// dangling references to a `vk_pool` from e.g. `vk_memslice.priv = vk_slab`.
 struct vk_pool {
+    struct vk_malloc *ma;
     struct vk_malloc_params params;   // allocation params (with some fields nulled)
-    PL_ARRAY(struct vk_slab *) slabs; // array of slabs, unsorted
+    pl_suballoc sa;                   // suballocator managing the slabs
     int index;                        // running index in `vk_malloc.pools`
 };
 
@@ -97,8 +86,7 @@ struct vk_malloc {
     pl_mutex lock;
     VkPhysicalDeviceMemoryProperties props;
     size_t maximum_page_size;
-    PL_ARRAY(struct vk_pool) pools;
-    uint64_t age;
+    PL_ARRAY(struct vk_pool *) pools;
 };
 
 static inline float efficiency(size_t used, size_t total)
@@ -130,7 +118,6 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
     struct vk_ctx *vk = ma->vk;
     size_t total_size = 0;
     size_t total_used = 0;
-    size_t total_res = 0;
 
     PL_MSG(vk, lev, "Memory heaps supported by device:");
     for (int i = 0; i < ma->props.memoryHeapCount; i++) {
@@ -148,7 +135,7 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
 
     pl_mutex_lock(&ma->lock);
     for (int i = 0; i < ma->pools.num; i++) {
-        struct vk_pool *pool = &ma->pools.elem[i];
+        struct vk_pool *pool = ma->pools.elem[i];
         const struct vk_malloc_params *par = &pool->params;
 
         PL_MSG(vk, lev, "Memory pool %d:", i);
@@ -162,48 +149,25 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
         if (par->export_handle)
             PL_MSG(vk, lev, "    Export handle: 0x%x", par->export_handle);
 
-        size_t pool_size = 0;
-        size_t pool_used = 0;
-        size_t pool_res = 0;
-
-        for (int j = 0; j < pool->slabs.num; j++) {
-            struct vk_slab *slab = pool->slabs.elem[j];
-            pl_mutex_lock(&slab->lock);
-
-            size_t avail = __builtin_popcountll(slab->spacemap) * slab->pagesize;
-            size_t slab_res = slab->size - avail;
-
-            PL_MSG(vk, lev, "    Slab %2d: %8"PRIx64" x %s: "
-                   "%s used %s res %s alloc from heap %d, efficiency %.2f%%  [%s]",
-                   j, slab->spacemap, PRINT_SIZE(slab->pagesize),
-                   PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
-                   PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
-                   efficiency(slab->used, slab_res),
-                   PL_DEF(slab->debug_tag, "unknown"));
-
-            pool_size += slab->size;
-            pool_used += slab->used;
-            pool_res += slab_res;
-            pl_mutex_unlock(&slab->lock);
-        }
+        struct pl_suballoc_stats stats = pl_suballoc_get_stats(pool->sa);
+        PL_MSG(vk, lev, "    %d slabs, %d allocations, %d free regions, "
+               "largest free region %s",
+               stats.num_blocks, stats.num_allocs, stats.num_free,
+               PRINT_SIZE(stats.largest_free));
 
-        PL_MSG(vk, lev, "    Pool summary: %s used %s res %s alloc, "
-               "efficiency %.2f%%, utilization %.2f%%",
-               PRINT_SIZE(pool_used), PRINT_SIZE(pool_res),
-               PRINT_SIZE(pool_size), efficiency(pool_used, pool_res),
-               efficiency(pool_res, pool_size));
+        PL_MSG(vk, lev, "    Pool summary: %s used %s alloc, utilization %.2f%%",
+               PRINT_SIZE(stats.used), PRINT_SIZE(stats.size),
+               efficiency(stats.used, stats.size));
 
-        total_size += pool_size;
-        total_used += pool_used;
-        total_res += pool_res;
+        total_size += stats.size;
+        total_used += stats.used;
     }
     pl_mutex_unlock(&ma->lock);
 
-    PL_MSG(vk, lev, "Memory summary: %s used %s res %s alloc, "
-           "efficiency %.2f%%, utilization %.2f%%, max page: %s",
-           PRINT_SIZE(total_used), PRINT_SIZE(total_res),
-           PRINT_SIZE(total_size), efficiency(total_used, total_res),
-           efficiency(total_res, total_size),
+    PL_MSG(vk, lev, "Memory summary: %s used %s alloc, utilization %.2f%%, "
+           "max page: %s",
+           PRINT_SIZE(total_used), PRINT_SIZE(total_size),
+           efficiency(total_used, total_size),
            PRINT_SIZE(ma->maximum_page_size));
 }
 
@@ -212,19 +176,6 @@ static void slab_free(struct vk_ctx *vk, struct vk_slab *slab)
     if (!slab)
         return;
 
-#ifndef NDEBUG
-    if (!slab->dedicated && slab->used > 0) {
-        PL_WARN(vk, "Leaked %zu bytes of vulkan memory!", slab->used);
-        PL_WARN(vk, "slab total size: %zu bytes, heap: %d, flags: 0x%"PRIX64,
-                (size_t) slab->size, (int) slab->mtype.heapIndex,
-                (uint64_t) slab->mtype.propertyFlags);
-        if (slab->debug_tag)
-            PL_WARN(vk, "last used for: %s", slab->debug_tag);
-        pl_log_stack_trace(vk->log, PL_LOG_WARN);
-        pl_debug_abort();
-    }
-#endif
-
     if (slab->imported) {
         switch (slab->handle_type) {
         case PL_HANDLE_FD:
@@ -280,7 +231,6 @@ static void slab_free(struct vk_ctx *vk, struct vk_slab *slab)
     // also implicitly unmaps the memory if needed
     vk->FreeMemory(vk->dev, slab->mem, PL_VK_ALLOC);
 
-    pl_mutex_destroy(&slab->lock);
     pl_free(slab);
 }
 
@@ -364,12 +314,10 @@ static struct vk_slab *slab_alloc(struct vk_malloc *ma,
     struct vk_ctx *vk = ma->vk;
     struct vk_slab *slab = pl_alloc_ptr(NULL, slab);
     *slab = (struct vk_slab) {
-        .age = ma->age,
         .size = params->reqs.size,
         .handle_type = params->export_handle,
         .debug_tag = params->debug_tag,
     };
-    pl_mutex_init(&slab->lock);
 
     switch (slab->handle_type) {
     case PL_HANDLE_FD:
@@ -529,11 +477,21 @@ error:
 
 static void pool_uninit(struct vk_ctx *vk, struct vk_pool *pool)
 {
-    for (int i = 0; i < pool->slabs.num; i++)
-        slab_free(vk, pool->slabs.elem[i]);
+#ifndef NDEBUG
+    struct pl_suballoc_stats stats = pl_suballoc_get_stats(pool->sa);
+    if (stats.used > 0) {
+        PL_WARN(vk, "Leaked %zu bytes of vulkan memory!", stats.used);
+        PL_WARN(vk, "pool %d total size: %zu bytes, %d allocations",
+                pool->index, stats.size, stats.num_allocs);
+        if (pool->params.debug_tag)
+            PL_WARN(vk, "first used for: %s", pool->params.debug_tag);
+        pl_log_stack_trace(vk->log, PL_LOG_WARN);
+        pl_debug_abort();
+    }
+#endif
 
-    pl_free(pool->slabs.elem);
-    *pool = (struct vk_pool) {0};
+    pl_suballoc_destroy(&pool->sa);
+    pl_free(pool);
 }
 
 struct vk_malloc *vk_malloc_create(struct vk_ctx *vk)
@@ -565,7 +523,7 @@ void vk_malloc_destroy(struct vk_malloc **ma_ptr)
 
     vk_malloc_print_stats(ma, PL_LOG_DEBUG);
     for (int i = 0; i < ma->pools.num; i++)
-        pool_uninit(ma->vk, &ma->pools.elem[i]);
+        pool_uninit(ma->vk, ma->pools.elem[i]);
 
     pl_mutex_destroy(&ma->lock);
     pl_free_ptr(ma_ptr);
@@ -576,28 +534,62 @@ void vk_malloc_garbage_collect(struct vk_malloc *ma)
     struct vk_ctx *vk = ma->vk;
 
     pl_mutex_lock(&ma->lock);
-    ma->age++;
+    for (int i = 0; i < ma->pools.num; i++) {
+        struct vk_pool *pool = ma->pools.elem[i];
+        int num_freed = pl_suballoc_gc(pool->sa);
+        if (num_freed) {
+            PL_DEBUG(vk, "Garbage collected %d slabs from pool %d",
+                     num_freed, pool->index);
+        }
+    }
+    pl_mutex_unlock(&ma->lock);
+}
 
+int vk_malloc_defrag(struct vk_malloc *ma, float threshold)
+{
+    struct vk_ctx *vk = ma->vk;
+    int num_marked = 0;
+
+    pl_mutex_lock(&ma->lock);
     for (int i = 0; i < ma->pools.num; i++) {
-        struct vk_pool *pool = &ma->pools.elem[i];
-        for (int n = 0; n < pool->slabs.num; n++) {
-            struct vk_slab *slab = pool->slabs.elem[n];
-            pl_mutex_lock(&slab->lock);
-            if (slab->used || (ma->age - slab->age) <= MAXIMUM_SLAB_AGE) {
-                pl_mutex_unlock(&slab->lock);
-                continue;
-            }
-
-            PL_DEBUG(vk, "Garbage collected slab of size %s from pool %d",
-                     PRINT_SIZE(slab->size), pool->index);
-
-            pl_mutex_unlock(&slab->lock);
-            slab_free(ma->vk, slab);
-            PL_ARRAY_REMOVE_AT(pool->slabs, n--);
+        struct vk_pool *pool = ma->pools.elem[i];
+        if (pool->params.export_handle)
+            continue;
+        int num = pl_suballoc_defrag(pool->sa, threshold);
+        if (num) {
+            PL_DEBUG(vk, "Evacuating %d sparse slabs from pool %d",
+                     num, pool->index);
         }
+        num_marked += num;
     }
+    pl_mutex_unlock(&ma->lock);
+    return num_marked;
+}
+
+bool vk_malloc_should_move(const struct vk_memslice *slice)
+{
+    const struct vk_slab *slab = slice->priv;
+    if (!slab || slab->dedicated)
+        return false;
+
+    return pl_suballoc_is_evacuating(slab->sa, &slice->region);
+}
 
+void vk_malloc_mark_moved(const struct vk_memslice *slice)
+{
+    const struct vk_slab *slab = slice->priv;
+    pl_assert(slab && !slab->dedicated);
+    pl_suballoc_mark_moved(slab->sa, &slice->region);
+}
+
+size_t vk_malloc_reclaimable(struct vk_malloc *ma)
+{
+    size_t total = 0;
+    pl_mutex_lock(&ma->lock);
+    for (int i = 0; i < ma->pools.num; i++)
+        total += pl_suballoc_get_stats(ma->pools.elem[i]->sa).reclaimable;
     pl_mutex_unlock(&ma->lock);
+    return total;
 }
 
 pl_handle_caps vk_malloc_handle_caps(const struct vk_malloc *ma, bool import)
@@ -624,20 +616,10 @@ void vk_malloc_free(struct vk_malloc *ma, struct vk_memslice *slice)
     struct vk_slab *slab = slice->priv;
     if (!slab || slab->dedicated) {
         slab_free(vk, slab);
-        goto done;
+    } else {
+        pl_suballoc_free(slab->sa, &slice->region);
     }
 
-    pl_mutex_lock(&slab->lock);
-
-    int page_idx = slice->offset / slab->pagesize;
-    slab->spacemap |= 0x1LLU << page_idx;
-    slab->used -= slice->size;
-    slab->age = ma->age;
-    pl_assert(slab->used >= 0);
-
-    pl_mutex_unlock(&slab->lock);
-
-done:
     *slice = (struct vk_memslice) {0};
 }
 
@@ -653,6 +635,27 @@ static inline bool pool_params_eq(const struct vk_malloc_params *a,
            a->export_handle == b->export_handle;
 }
 
+static void *pool_alloc_slab(void *priv, size_t *size)
+{
+    struct vk_pool *pool = priv;
+    struct vk_malloc_params params = pool->params;
+    params.reqs.size = *size;
+
+    struct vk_slab *slab = slab_alloc(pool->ma, &params);
+    if (!slab)
+        return NULL;
+
+    slab->sa = pool->sa;
+    *size = slab->size;
+    return slab;
+}
+
+static void pool_free_slab(void *priv, void *slab)
+{
+    struct vk_pool *pool = priv;
+    slab_free(pool->ma->vk, slab);
+}
+
 static struct vk_pool *find_pool(struct vk_malloc *ma,
                                  const struct vk_malloc_params *params)
 {
@@ -665,86 +668,30 @@ static struct vk_pool *find_pool(struct vk_malloc *ma,
     fixed.shared_mem = (struct pl_shared_mem) {0};
 
     for (int i = 0; i < ma->pools.num; i++) {
-        if (pool_params_eq(&ma->pools.elem[i].params, &fixed))
-            return &ma->pools.elem[i];
+        if (pool_params_eq(&ma->pools.elem[i]->params, &fixed))
+            return ma->pools.elem[i];
     }
 
     // Not found => add it
-    PL_ARRAY_GROW(ma, ma->pools);
-    size_t idx = ma->pools.num++;
-    ma->pools.elem[idx] = (struct vk_pool) {
+    struct vk_pool *pool = pl_alloc_ptr(NULL, pool);
+    *pool = (struct vk_pool) {
+        .ma = ma,
         .params = fixed,
-        .index = idx,
+        .index = ma->pools.num,
     };
-    return &ma->pools.elem[idx];
-}
-
-// Returns a suitable memory page from the pool. A new slab will be allocated
-// under the hood, if necessary.
-//
-// Note: This locks the slab it returns
-static struct vk_slab *pool_get_page(struct vk_malloc *ma, struct vk_pool *pool,
-                                     size_t size, size_t align,
-                                     VkDeviceSize *offset)
-{
-    struct vk_slab *slab = NULL;
-    int slab_pages = MINIMUM_PAGE_COUNT;
-    size = PL_ALIGN2(size, PAGE_SIZE_ALIGN);
-    const size_t pagesize = PL_ALIGN(size, align);
-
-    for (int i = 0; i < pool->slabs.num; i++) {
-        slab = pool->slabs.elem[i];
-        if (slab->pagesize < size)
-            continue;
-        if (slab->pagesize > pagesize * MINIMUM_PAGE_COUNT) // rough heuristic
-            continue;
-        if (slab->pagesize % align)
-            continue;
 
-        pl_mutex_lock(&slab->lock);
-        int page_idx = __builtin_ffsll(slab->spacemap);
-        if (!page_idx--) {
-            pl_mutex_unlock(&slab->lock);
-            // Increase the number of slabs to allocate for new slabs the
-            // more existing full slabs exist for this size range
-            slab_pages = PL_MIN(slab_pages << 1, MAXIMUM_PAGE_COUNT);
-            continue;
-        }
-
-        slab->spacemap ^= 0x1LLU << page_idx;
-        *offset = page_idx * slab->pagesize;
-        return slab;
-    }
-
-    // Otherwise, allocate a new vk_slab and append it to the list.
-    VkDeviceSize slab_size = slab_pages * pagesize;
-    pl_static_assert(MINIMUM_SLAB_SIZE <= PAGE_SIZE_ALIGN * MAXIMUM_PAGE_COUNT);
-    const VkDeviceSize max_slab_size = ma->maximum_page_size * MINIMUM_PAGE_COUNT;
-    pl_assert(pagesize <= ma->maximum_page_size);
-    slab_size = PL_CLAMP(slab_size, MINIMUM_SLAB_SIZE, max_slab_size);
-    slab_pages = slab_size / pagesize;
-    slab_size = slab_pages * pagesize; // max_slab_size may be npot2, trim excess
-
-    struct vk_malloc_params params = pool->params;
-    params.reqs.size = slab_size;
-
-    // Don't hold the lock while allocating the slab, because it can be a
-    // potentially very costly operation.
-    pl_mutex_unlock(&ma->lock);
-    slab = slab_alloc(ma, &params);
-    pl_mutex_lock(&ma->lock);
-    if (!slab)
-        return NULL;
-    pl_mutex_lock(&slab->lock);
-
-    slab->spacemap = (slab_pages == sizeof(uint64_t) * 8) ? ~0LLU : ~(~0LLU << slab_pages);
-    slab->pagesize = pagesize;
-    PL_ARRAY_APPEND(NULL, pool->slabs, slab);
-
-    // Return the first page in this newly allocated slab
-    slab->spacemap ^= 0x1;
-    *offset = 0;
-    return slab;
+    pool->sa = pl_suballoc_create(ma->vk->log, pl_suballoc_params(
+        .alloc_block    = pool_alloc_slab,
+        .free_block     = pool_free_slab,
+        .priv           = pool,
+        .granularity    = PAGE_SIZE_ALIGN,
+        .min_block_size = MINIMUM_SLAB_SIZE,
+        .max_block_size = ma->maximum_page_size * MAXIMUM_SLAB_SCALE,
+        .max_age        = MAXIMUM_SLAB_AGE,
+    ));
+
+    PL_ARRAY_APPEND(ma, ma->pools, pool);
+    return pool;
 }
 
 static bool vk_malloc_import(struct vk_malloc *ma, struct vk_memslice *out,
@@ -904,7 +851,6 @@ static bool vk_malloc_import(struct vk_malloc *ma, struct vk_memslice *out,
         .size = shmem->size,
         .handle_type = params->import_handle,
     };
-    pl_mutex_init(&slab->lock);
 
     *out = (struct vk_memslice) {
         .vkmem = vkmem,
@@ -1006,6 +952,7 @@ bool vk_malloc_slice(struct vk_malloc *ma, struct vk_memslice *out,
     align = pl_lcm(align, vk->props.limits.nonCoherentAtomSize);
 
     struct vk_slab *slab;
+    struct pl_suballoc_region region = {0};
     VkDeviceSize offset;
 
     if (params->ded_image || size > ma->maximum_page_size) {
@@ -1017,24 +964,21 @@ bool vk_malloc_slice(struct vk_malloc *ma, struct vk_memslice *out,
     } else {
         pl_mutex_lock(&ma->lock);
         struct vk_pool *pool = find_pool(ma, params);
-        slab = pool_get_page(ma, pool, size, align, &offset);
         pl_mutex_unlock(&ma->lock);
-        if (!slab) {
+
+        // For accounting, the alignment is treated as part of the used size.
+        // Doing it this way makes sure that the sizes reported to vk_memslice
+        // consumers are always aligned properly.
+        if (!pl_suballoc_alloc(pool->sa, size, align, &region)) {
             PL_ERR(ma->vk, "No slab to serve request for %s bytes (with "
                    "alignment 0x%zx) in pool %d!",
                    PRINT_SIZE(size), align, pool->index);
             return false;
         }
 
-        // For accounting, just treat the alignment as part of the used size.
-        // Doing it this way makes sure that the sizes reported to vk_memslice
-        // consumers are always aligned properly.
-        size = PL_ALIGN(size, align);
-        slab->used += size;
-        slab->age = ma->age;
-        if (params->debug_tag)
-            slab->debug_tag = params->debug_tag;
-        pl_mutex_unlock(&slab->lock);
+        slab = region.block;
+        offset = region.offset;
+        size = region.size;
     }
 
     pl_assert(offset % align == 0);
@@ -1048,6 +992,7 @@ bool vk_malloc_slice(struct vk_malloc *ma, struct vk_memslice *out,
         .map_offset = slab->data ? offset : 0,
         .map_size = slab->data ? size : 0,
         .priv = slab,
+        .region = region,
         .shared_mem = {
             .handle = slab->handle,
             .offset = offset,
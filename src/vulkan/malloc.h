@@ -18,6 +18,7 @@
 #pragma once
 
 #include "common.h"
+#include "suballoc.h"
 
 // The threshold for which allocations to serve from host-mapped VRAM, as
 // opposed to host memory. Will not allocate more than this fraction of VRAM in
@@ -41,6 +42,7 @@ struct vk_memslice {
     VkDeviceSize offset;
     VkDeviceSize size;
     void *priv;
+    struct pl_suballoc_region region;
     // depending on the type/flags:
     struct pl_shared_mem shared_mem;
     VkBuffer buf;   // associated buffer (when `buf_usage` is nonzero)
@@ -75,5 +77,21 @@ void vk_malloc_free(struct vk_malloc *ma, struct vk_memslice *slice);
 // memory pressure / memory leaks.
 void vk_malloc_garbage_collect(struct vk_malloc *ma);
 
+// Marks sparsely utilized slabs (below `threshold`, as a fraction of the slab
+// size) for evacuation, after which they no longer serve new allocations.
+// Slabs holding exportable memory are never marked. Returns the number of
+// slabs marked.
+int vk_malloc_defrag(struct vk_malloc *ma, float threshold);
+
+// Returns true if `slice` lives in a slab marked for evacuation. The caller
+// should move its contents to a new slice, and then call
+// `vk_malloc_mark_moved` on the old one before freeing it.
+bool vk_malloc_should_move(const struct vk_memslice *slice);
+void vk_malloc_mark_moved(const struct vk_memslice *slice);
+
+// Returns the total size of evacuated slabs whose slices have all been moved,
+// i.e. which will be released as soon as the old slices are freed.
+size_t vk_malloc_reclaimable(struct vk_malloc *ma);
+
 // For debugging purposes. Doesn't include dedicated slab allocations!
 void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level);
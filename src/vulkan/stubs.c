@@ -52,6 +52,11 @@ pl_vulkan pl_vulkan_get(pl_gpu gpu)
     return NULL;
 }
 
+size_t pl_vulkan_defrag(pl_gpu gpu)
+{
+    return 0;
+}
+
 VkPhysicalDevice pl_vulkan_choose_device(pl_log log,
                               const struct pl_vulkan_device_params *params)
 {